@@ -30,7 +30,7 @@ export function useMqttPublish() {
     return () => void client.disconnect();
   }, []);
 
-  const publish = useCallback((topic: string, message: object) => {
+  const publish = useCallback((topic: string, message: object, options: { retained?: boolean; qos?: 0 | 1 | 2 } = {}) => {
     const c = clientRef.current;
     if (!c || !c.isConnected()) {
       console.warn("⚠️ MQTT not connected");
@@ -38,6 +38,8 @@ export function useMqttPublish() {
     }
     const msg = new Message(JSON.stringify(message));
     msg.destinationName = topic;
+    if (options.retained) msg.retained = true;
+    if (options.qos !== undefined) msg.qos = options.qos;
     c.send(msg);
   }, []);
 
@@ -1,15 +1,20 @@
 import { useState } from "react";
 import { claimDevice } from "@/lib/devices";
+import { useMqttPublish } from "@/hooks/common";
 
 export function useClaimDevice(uid: string) {
   const [claiming, setClaiming] = useState(false);
   const [error, setError]       = useState<string | null>(null);
+  const { publish } = useMqttPublish();
 
   const claim = async (deviceId: string) => {
     setError(null);
     setClaiming(true);
     try {
       await claimDevice(deviceId, uid);
+      // Lets a device waiting to be claimed know right away instead of on its next Firestore check.
+      // Retained, so a device that is reconnecting or not subscribed yet still gets it.
+      publish(`${deviceId}/owner`, { ownerId: uid }, { retained: true, qos: 1 });
     } catch (e: any) {
       setError(e.message);
       throw e;
@@ -0,0 +1,144 @@
+#ifndef BITMAP_CACHE_H
+#define BITMAP_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+static const uint32_t PAYLOAD_HASH_OFFSET = 2166136261u;
+static const uint32_t PAYLOAD_HASH_PRIME = 16777619u;
+
+/**
+ * FNV-1a hash of a payload, to skip most entries before comparing payloads.
+ */
+inline uint32_t hashPayload(const char *payload)
+{
+  uint32_t hash = PAYLOAD_HASH_OFFSET;
+  for (; *payload; payload++)
+  {
+    hash = (hash ^ (uint8_t)*payload) * PAYLOAD_HASH_PRIME;
+  }
+  return hash;
+}
+
+struct BitmapCacheStats
+{
+  uint32_t hits = 0;
+  uint32_t misses = 0;
+  uint32_t evictions = 0;
+  uint64_t savedUs = 0; // Render time avoided by the hits.
+};
+
+/**
+ * Least recently used cache of rendered bitmaps, keyed by the payload they were rendered from.
+ * The payload is kept with the bitmap and compared on a hit, so two payloads with the same hash
+ * never share a bitmap (these are device-claim QR codes). Payloads of PAYLOAD_SIZE or more
+ * characters are not cached.
+ */
+template <size_t ENTRY_SIZE, size_t CAPACITY, size_t PAYLOAD_SIZE = 64>
+class BitmapCache
+{
+public:
+  struct Entry
+  {
+    uint32_t hash;
+    uint32_t renderUs; // How long rendering this bitmap took.
+    uint32_t lastUse;
+    bool used;
+    char payload[PAYLOAD_SIZE];
+    uint8_t data[ENTRY_SIZE];
+  };
+
+  /**
+   * Looks up a bitmap, counting a hit (and the render time saved) or a miss.
+   *
+   * @param payload The payload the bitmap is rendered from.
+   * @return The entry, nullptr if not cached.
+   */
+  const Entry *find(const char *payload)
+  {
+    Entry *entry = lookup(payload, hashPayload(payload));
+    if (!entry)
+    {
+      stats.misses++;
+      return nullptr;
+    }
+    entry->lastUse = ++useCounter;
+    stats.hits++;
+    stats.savedUs += entry->renderUs;
+    return entry;
+  }
+
+  /**
+   * Stores a bitmap, evicting the least recently used one when full.
+   *
+   * @param payload The payload the bitmap is rendered from.
+   * @param data The bitmap (ENTRY_SIZE bytes).
+   * @param renderUs How long rendering it took.
+   */
+  void insert(const char *payload, const uint8_t *data, uint32_t renderUs)
+  {
+    if (strlen(payload) >= PAYLOAD_SIZE)
+    {
+      return;
+    }
+    uint32_t hash = hashPayload(payload);
+    Entry *slot = lookup(payload, hash);
+    if (!slot)
+    {
+      slot = &entries[0];
+      for (size_t i = 0; i < CAPACITY; i++)
+      {
+        if (!entries[i].used)
+        {
+          slot = &entries[i];
+          break;
+        }
+        if (entries[i].lastUse < slot->lastUse)
+        {
+          slot = &entries[i];
+        }
+      }
+      if (slot->used)
+      {
+        stats.evictions++;
+      }
+    }
+
+    slot->hash = hash;
+    slot->renderUs = renderUs;
+    slot->lastUse = ++useCounter;
+    slot->used = true;
+    strcpy(slot->payload, payload);
+    memcpy(slot->data, data, ENTRY_SIZE);
+  }
+
+  void clear()
+  {
+    for (size_t i = 0; i < CAPACITY; i++)
+    {
+      entries[i].used = false;
+    }
+  }
+
+  const BitmapCacheStats &getStats() const { return stats; }
+
+private:
+  Entry *lookup(const char *payload, uint32_t hash)
+  {
+    for (size_t i = 0; i < CAPACITY; i++)
+    {
+      if (entries[i].used && entries[i].hash == hash && strcmp(entries[i].payload, payload) == 0)
+      {
+        return &entries[i];
+      }
+    }
+    return nullptr;
+  }
+
+  Entry entries[CAPACITY] = {};
+  uint32_t useCounter = 0;
+  BitmapCacheStats stats;
+};
+
+#endif
@@ -1,5 +1,11 @@
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
 #include "esp_camera.h"
 #include "camera.h"
+#include "frame_ring.h"
+#include "metrics.h"
 
 // Camera configuration for our AI Thinker module
 #define PWDN_GPIO_NUM -1
@@ -20,6 +26,103 @@
 #define HREF_GPIO_NUM 23
 #define PCLK_GPIO_NUM 22
 
+// Continuous capture keeps the last RING_FRAMES JPEGs (QVGA at quality 12 stays well below RING_SLOT_SIZE).
+#define RING_FRAMES 6
+#define RING_SLOT_SIZE (32 * 1024)
+#define RING_MAX_BURST 8
+#define CAPTURE_TASK_STACK 4096
+
+static FrameRing<RING_FRAMES> frameRing;
+static SemaphoreHandle_t frameRingMutex = nullptr;
+static uint32_t captureIntervalMs = 0;
+static bool captureRunning = false;
+
+// Frames dropped because every ring slot was pinned by a reader.
+static MetricCounter ringFullFrames("cam_ring_full");
+// Frames dropped because they are larger than a ring slot.
+static MetricCounter oversizedFrames("cam_oversized");
+
+// Frames handed out from the ring, one per slot (a slot pinned twice shares its frame).
+static camera_fb_t ringFrames[RING_FRAMES];
+
+static void *allocFrameSlot(size_t size)
+{
+  return psramFound() ? ps_malloc(size) : nullptr;
+}
+
+static uint32_t frameTimestampMs(const camera_fb_t *fb)
+{
+  return fb->timestamp.tv_sec * 1000UL + fb->timestamp.tv_usec / 1000UL;
+}
+
+static void captureTask(void *)
+{
+  for (;;)
+  {
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (fb)
+    {
+      FrameRing<RING_FRAMES>::Slot *slot = nullptr;
+      // Checked before claiming a slot, which would already drop the oldest frame.
+      if (!frameRing.fits(fb->len))
+      {
+        oversizedFrames.add();
+      }
+      else
+      {
+        xSemaphoreTake(frameRingMutex, portMAX_DELAY);
+        slot = frameRing.beginWrite();
+        xSemaphoreGive(frameRingMutex);
+
+        if (!slot)
+        {
+          ringFullFrames.add();
+        }
+      }
+
+      if (slot)
+      {
+        memcpy(slot->buf, fb->buf, fb->len);
+
+        xSemaphoreTake(frameRingMutex, portMAX_DELAY);
+        frameRing.commitWrite(slot, fb->len, frameTimestampMs(fb), fb->width, fb->height);
+        xSemaphoreGive(frameRingMutex);
+      }
+
+      esp_camera_fb_return(fb);
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(captureIntervalMs));
+  }
+}
+
+// Must be called with frameRingMutex held.
+static camera_fb_t *pinRingFrame(int index)
+{
+  if (index < 0)
+  {
+    return nullptr;
+  }
+
+  frameRing.pin(index);
+  const FrameRing<RING_FRAMES>::Slot &slot = frameRing[index];
+
+  camera_fb_t *fb = &ringFrames[index];
+  fb->buf = slot.buf;
+  fb->len = slot.len;
+  fb->width = slot.width;
+  fb->height = slot.height;
+  fb->format = PIXFORMAT_JPEG;
+  fb->timestamp.tv_sec = slot.timestampMs / 1000;
+  fb->timestamp.tv_usec = (slot.timestampMs % 1000) * 1000;
+  return fb;
+}
+
+static bool isRingFrame(const camera_fb_t *fb)
+{
+  return fb >= ringFrames && fb < ringFrames + RING_FRAMES;
+}
+
 bool loadCamera()
 {
   camera_config_t config;
@@ -46,23 +149,146 @@ bool loadCamera()
 
   config.frame_size = FRAMESIZE_QVGA;
   config.jpeg_quality = 12;
-  config.fb_count = 1;
+
+  // Double-buffer in PSRAM so the sensor keeps streaming while a frame is being read.
+  if (psramFound())
+  {
+    config.fb_count = 2;
+    config.fb_location = CAMERA_FB_IN_PSRAM;
+    config.grab_mode = CAMERA_GRAB_LATEST;
+  }
+  else
+  {
+    config.fb_count = 1;
+    config.fb_location = CAMERA_FB_IN_DRAM;
+    config.grab_mode = CAMERA_GRAB_WHEN_EMPTY;
+  }
 
   return esp_camera_init(&config) != ESP_OK;
 }
 
+bool startContinuousCapture(uint32_t intervalMs)
+{
+  if (captureRunning)
+  {
+    return true;
+  }
+
+  frameRingMutex = xSemaphoreCreateMutex();
+  if (!frameRingMutex || !frameRing.begin(RING_SLOT_SIZE, allocFrameSlot))
+  {
+    return false;
+  }
+
+  captureIntervalMs = intervalMs;
+  captureRunning = xTaskCreatePinnedToCore(captureTask, "camera_capture", CAPTURE_TASK_STACK, nullptr, 1, nullptr, 1) == pdPASS;
+  return captureRunning;
+}
+
+bool isContinuousCaptureRunning()
+{
+  return captureRunning;
+}
+
 camera_fb_t *takePhoto()
 {
-  return esp_camera_fb_get();
+  if (!captureRunning)
+  {
+    return esp_camera_fb_get();
+  }
+
+  xSemaphoreTake(frameRingMutex, portMAX_DELAY);
+  camera_fb_t *fb = pinRingFrame(frameRing.latest());
+  xSemaphoreGive(frameRingMutex);
+
+  return fb ? fb : esp_camera_fb_get();
+}
+
+camera_fb_t *takePhotoAt(uint32_t eventMs)
+{
+  if (!captureRunning)
+  {
+    return esp_camera_fb_get();
+  }
+
+  xSemaphoreTake(frameRingMutex, portMAX_DELAY);
+  camera_fb_t *fb = pinRingFrame(frameRing.closest(eventMs));
+  xSemaphoreGive(frameRingMutex);
+
+  return fb ? fb : esp_camera_fb_get();
+}
+
+void releasePhoto(camera_fb_t *fb)
+{
+  if (!fb)
+  {
+    return;
+  }
+
+  if (!isRingFrame(fb))
+  {
+    esp_camera_fb_return(fb);
+    return;
+  }
+
+  xSemaphoreTake(frameRingMutex, portMAX_DELAY);
+  frameRing.unpin(fb - ringFrames);
+  xSemaphoreGive(frameRingMutex);
 }
 
 void takeSafePhoto(void (*callback)(camera_fb_t *fb))
 {
-  camera_fb_t *fb = esp_camera_fb_get();
+  camera_fb_t *fb = takePhoto();
 
   if (fb)
   {
     callback(fb);
-    esp_camera_fb_return(fb);
+    releasePhoto(fb);
+  }
+}
+
+void takeSafePhotoAt(uint32_t eventMs, void (*callback)(camera_fb_t *fb))
+{
+  camera_fb_t *fb = takePhotoAt(eventMs);
+
+  if (fb)
+  {
+    callback(fb);
+    releasePhoto(fb);
+  }
+}
+
+void takeSafeBurst(uint32_t eventMs, size_t pre, size_t post, void (*callback)(camera_fb_t **frames, size_t count))
+{
+  if (!captureRunning)
+  {
+    return;
+  }
+
+  if (pre + post + 1 > RING_MAX_BURST)
+  {
+    post = pre < RING_MAX_BURST ? RING_MAX_BURST - 1 - pre : 0;
+    pre = RING_MAX_BURST - 1 - post;
+  }
+
+  int indexes[RING_MAX_BURST];
+  camera_fb_t *frames[RING_MAX_BURST];
+
+  xSemaphoreTake(frameRingMutex, portMAX_DELAY);
+  size_t count = frameRing.burst(eventMs, pre, post, indexes);
+  for (size_t i = 0; i < count; i++)
+  {
+    frames[i] = pinRingFrame(indexes[i]);
+  }
+  xSemaphoreGive(frameRingMutex);
+
+  if (count > 0)
+  {
+    callback(frames, count);
+  }
+
+  for (size_t i = 0; i < count; i++)
+  {
+    releasePhoto(frames[i]);
   }
 }
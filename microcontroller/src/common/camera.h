@@ -11,12 +11,45 @@
 bool loadCamera();
 
 /**
- * Takes a photo from the camera sensor.
+ * Starts capturing frames continuously into a PSRAM ring buffer, so photos can be taken
+ * from frames that were captured before the event arrived.
+ *
+ * @param intervalMs The time between captured frames (in milliseconds).
+ * @return Whether started successfully.
+ */
+bool startContinuousCapture(uint32_t intervalMs = 100);
+
+/**
+ * Whether continuous capture is running (photos are then served from the ring buffer).
+ */
+bool isContinuousCaptureRunning();
+
+/**
+ * Takes a photo from the camera sensor (or the latest buffered frame in continuous mode).
+ * The frame must be given back with releasePhoto().
  *
  * @return The camera frame buffer.
  */
 camera_fb_t *takePhoto();
 
+/**
+ * Takes the buffered frame closest to the given time (falls back to takePhoto() when
+ * continuous capture is not running). The frame must be given back with releasePhoto().
+ * A buffered frame is pinned until then, and the ring stops refreshing once every slot is
+ * pinned, so copy the frame out before slow work such as an upload.
+ *
+ * @param eventMs The event time as returned by millis().
+ * @return The camera frame buffer.
+ */
+camera_fb_t *takePhotoAt(uint32_t eventMs);
+
+/**
+ * Gives a frame returned by takePhoto() or takePhotoAt() back to the camera.
+ *
+ * @param fb The camera frame buffer.
+ */
+void releasePhoto(camera_fb_t *fb);
+
 /**
  * Takes a photo from the camera sensor and calls the callback function with the frame buffer (frees the allocated memory at the end).
  *
@@ -24,4 +57,23 @@ camera_fb_t *takePhoto();
  */
 void takeSafePhoto(void (*callback)(camera_fb_t *fb));
 
-#endif
\ No newline at end of file
+/**
+ * Calls the callback function with the buffered frame closest to the given time (frees the allocated memory at the end).
+ *
+ * @param eventMs The event time as returned by millis().
+ * @param callback The callback function to be called with the frame buffer.
+ */
+void takeSafePhotoAt(uint32_t eventMs, void (*callback)(camera_fb_t *fb));
+
+/**
+ * Calls the callback function with the buffered frames around the given time, in capture order
+ * (requires continuous capture).
+ *
+ * @param eventMs The event time as returned by millis().
+ * @param pre The maximum number of frames before the event.
+ * @param post The maximum number of frames after the event.
+ * @param callback The callback function to be called with the frame buffers.
+ */
+void takeSafeBurst(uint32_t eventMs, size_t pre, size_t post, void (*callback)(camera_fb_t **frames, size_t count));
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Keep-alive client sessions to a few hosts. A client is reused while it is still connected to the
+ * same host and has not been idle longer than the server keeps a session open.
+ *
+ * Client needs connected(), connect(host, port) and stop() (WiFiClientSecure on the device).
+ * Lock needs lock() and unlock(); it is held only while a slot is chosen or given back, never
+ * during a connect, so it can be a spinlock.
+ */
+template <typename Client, typename Lock, size_t SIZE>
+class ConnectionPool
+{
+public:
+  // Longest host name a slot has room for, including the terminator.
+  static const size_t HOST_SIZE = 64;
+
+  /**
+   * @param idleTimeoutMs Sessions idle for longer are reopened rather than reused.
+   * @param nowMs The clock in milliseconds.
+   */
+  ConnectionPool(uint32_t idleTimeoutMs, uint32_t (*nowMs)()) : idleTimeoutMs(idleTimeoutMs), nowMs(nowMs) {}
+
+  /**
+   * Returns a connected client for the host, reusing its idle session when it is still open.
+   * The client must be given back with release().
+   *
+   * @param host The server host name (copied, so it may be a temporary).
+   * @param port The server port.
+   * @param reused Set to whether an open session was reused (optional).
+   * @return The client, nullptr if every slot is busy, the host name is too long or the connection failed.
+   */
+  Client *acquire(const char *host, uint16_t port, bool *reused = nullptr)
+  {
+    if (strlen(host) >= HOST_SIZE)
+    {
+      return nullptr;
+    }
+
+    lock.lock();
+    Slot *slot = claimSlot(host, port);
+    bool canReuse = false;
+    if (slot)
+    {
+      canReuse = isSameHost(*slot, host, port) && nowMs() - slot->lastUsedMs <= idleTimeoutMs;
+      strcpy(slot->host, host);
+      slot->port = port;
+    }
+    lock.unlock();
+
+    if (!slot)
+    {
+      return nullptr;
+    }
+    // The slot is ours from here on, only its bookkeeping is shared.
+    if (canReuse && slot->client.connected())
+    {
+      if (reused)
+        *reused = true;
+      return &slot->client;
+    }
+
+    slot->client.stop();
+    if (!slot->client.connect(host, port))
+    {
+      slot->client.stop();
+      lock.lock();
+      slot->host[0] = '\0';
+      slot->inUse = false;
+      lock.unlock();
+      return nullptr;
+    }
+    if (reused)
+      *reused = false;
+    return &slot->client;
+  }
+
+  /**
+   * Gives a client back to the pool.
+   *
+   * @param client The client returned by acquire().
+   * @param keepAlive Whether the session is still usable (the server did not close it and no error happened).
+   */
+  void release(Client *client, bool keepAlive = true)
+  {
+    for (Slot &slot : slots)
+    {
+      if (&slot.client != client)
+        continue;
+
+      if (!keepAlive)
+      {
+        slot.client.stop();
+      }
+      lock.lock();
+      if (!keepAlive)
+      {
+        slot.host[0] = '\0';
+      }
+      slot.lastUsedMs = nowMs();
+      slot.inUse = false;
+      lock.unlock();
+      return;
+    }
+  }
+
+private:
+  struct Slot
+  {
+    Client client;
+    char host[HOST_SIZE] = "";
+    uint16_t port = 0;
+    bool inUse = false;
+    uint32_t lastUsedMs = 0;
+  };
+
+  static bool isSameHost(const Slot &slot, const char *host, uint16_t port)
+  {
+    return slot.host[0] && slot.port == port && strcmp(slot.host, host) == 0;
+  }
+
+  // Prefers the idle session of the same host, then an unused slot, then the least recently used one.
+  // Called with the lock held.
+  Slot *claimSlot(const char *host, uint16_t port)
+  {
+    Slot *slot = nullptr;
+    for (Slot &candidate : slots)
+    {
+      if (candidate.inUse)
+        continue;
+
+      if (isSameHost(candidate, host, port))
+      {
+        slot = &candidate;
+        break;
+      }
+      if (!slot || !candidate.host[0] || (slot->host[0] && candidate.lastUsedMs < slot->lastUsedMs))
+      {
+        slot = &candidate;
+      }
+    }
+    if (slot)
+    {
+      slot->inUse = true;
+    }
+    return slot;
+  }
+
+  Slot slots[SIZE];
+  Lock lock;
+  uint32_t idleTimeoutMs;
+  uint32_t (*nowMs)();
+};
+
+#endif
@@ -0,0 +1,67 @@
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include "connections.h"
+#include "connection_pool.h"
+#include "metrics.h"
+
+#define POOL_SIZE 2
+#define IDLE_TIMEOUT_MS 50000
+#define HANDSHAKE_TIMEOUT_S 10
+
+class TlsClient : public WiFiClientSecure
+{
+public:
+  TlsClient()
+  {
+    setInsecure();
+    setHandshakeTimeout(HANDSHAKE_TIMEOUT_S);
+  }
+};
+
+class PoolLock
+{
+public:
+  void lock() { portENTER_CRITICAL(&mux); }
+  void unlock() { portEXIT_CRITICAL(&mux); }
+
+private:
+  portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+static ConnectionPool<TlsClient, PoolLock, POOL_SIZE> pool(IDLE_TIMEOUT_MS, []() -> uint32_t
+                                                          { return millis(); });
+
+static MetricCounter tlsHandshakes("tls_handshakes");
+static MetricCounter tlsReuses("tls_reuses");
+static MetricCounter tlsFailures("tls_failures");
+static MetricHistogram tlsHandshakeMs("tls_handshake_ms");
+
+WiFiClientSecure *acquireConnection(const char *host, uint16_t port, bool *reused)
+{
+  bool wasReused = false;
+  uint32_t start = millis();
+  WiFiClientSecure *client = pool.acquire(host, port, &wasReused);
+  if (!client)
+  {
+    tlsFailures.add();
+    return nullptr;
+  }
+
+  if (wasReused)
+  {
+    tlsReuses.add();
+  }
+  else
+  {
+    tlsHandshakes.add();
+    tlsHandshakeMs.record(millis() - start);
+  }
+  if (reused)
+    *reused = wasReused;
+  return client;
+}
+
+void releaseConnection(WiFiClientSecure *client, bool keepAlive)
+{
+  pool.release(static_cast<TlsClient *>(client), keepAlive);
+}
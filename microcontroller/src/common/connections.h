@@ -0,0 +1,26 @@
+#ifndef CONNECTIONS_H
+#define CONNECTIONS_H
+
+#include <WiFiClientSecure.h>
+
+/**
+ * Returns a connected TLS client for the host, reusing its idle keep-alive session when it is still open.
+ * The client must be given back with releaseConnection(). Handshakes, reuses and failures are counted
+ * in the metrics (tls_handshakes, tls_reuses, tls_failures, tls_handshake_ms).
+ *
+ * @param host The server host name.
+ * @param port The server port.
+ * @param reused Set to whether an open session was reused (optional).
+ * @return The client, nullptr if every connection is busy or the connection failed.
+ */
+WiFiClientSecure *acquireConnection(const char *host, uint16_t port = 443, bool *reused = nullptr);
+
+/**
+ * Gives a client back to the pool.
+ *
+ * @param client The client returned by acquireConnection().
+ * @param keepAlive Whether the session is still usable (the server did not close it and no error happened).
+ */
+void releaseConnection(WiFiClientSecure *client, bool keepAlive = true);
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef DISTANCE_FILTER_H
+#define DISTANCE_FILTER_H
+
+#include <stddef.h>
+
+enum DistanceEvent
+{
+  DISTANCE_NO_EVENT,
+  DISTANCE_ENTERED, // Something came closer than the enter threshold.
+  DISTANCE_LEFT     // It moved back past the exit threshold.
+};
+
+/**
+ * Smooths raw ultrasonic readings and turns them into enter/leave events.
+ * A median over the last readings removes single-echo spikes, an EMA smooths what is left, and
+ * separate enter/exit thresholds stop the state from flapping around a single cut-off.
+ * Pure C++ so it can be fed recorded traces on the host.
+ */
+class DistanceFilter
+{
+public:
+  static const size_t WINDOW = 5;
+
+  /**
+   * @param enterCm The smoothed distance at or below which something counts as close.
+   * @param exitCm The smoothed distance at or above which it stops being close (above enterCm).
+   * @param smoothing The EMA weight of each new median, between 0 and 1.
+   * @param maxCm Readings beyond this (including sensor timeouts) count as this far.
+   */
+  DistanceFilter(float enterCm, float exitCm, float smoothing = 0.5f, float maxCm = 400.0f)
+      : enterCm(enterCm), exitCm(exitCm), smoothing(smoothing), maxCm(maxCm) {}
+
+  /**
+   * Adds a reading.
+   *
+   * @param distanceCm The raw distance in cm (0 or less is ignored as invalid).
+   * @return Whether the reading changed the close state.
+   */
+  DistanceEvent update(float distanceCm)
+  {
+    if (distanceCm <= 0)
+    {
+      return DISTANCE_NO_EVENT;
+    }
+    if (distanceCm > maxCm)
+    {
+      distanceCm = maxCm;
+    }
+
+    window[next] = distanceCm;
+    next = (next + 1) % WINDOW;
+    if (count < WINDOW)
+    {
+      count++;
+    }
+
+    float med = median();
+    smoothed = hasSmoothed ? smoothed + smoothing * (med - smoothed) : med;
+    hasSmoothed = true;
+
+    // Wait for a majority of the window so a single early spike cannot trigger.
+    if (count <= WINDOW / 2)
+    {
+      return DISTANCE_NO_EVENT;
+    }
+    if (!close && smoothed <= enterCm)
+    {
+      close = true;
+      return DISTANCE_ENTERED;
+    }
+    if (close && smoothed >= exitCm)
+    {
+      close = false;
+      return DISTANCE_LEFT;
+    }
+    return DISTANCE_NO_EVENT;
+  }
+
+  bool isClose() const { return close; }
+
+  /**
+   * Returns the smoothed distance in cm (negative before the first reading).
+   */
+  float getDistance() const { return hasSmoothed ? smoothed : -1.0f; }
+
+private:
+  float enterCm;
+  float exitCm;
+  float smoothing;
+  float maxCm;
+
+  float window[WINDOW] = {};
+  size_t next = 0;
+  size_t count = 0;
+  float smoothed = 0;
+  bool hasSmoothed = false;
+  bool close = false;
+
+  float median() const
+  {
+    float sorted[WINDOW];
+    for (size_t i = 0; i < count; i++)
+    {
+      size_t j = i;
+      for (; j > 0 && sorted[j - 1] > window[i]; j--)
+      {
+        sorted[j] = sorted[j - 1];
+      }
+      sorted[j] = window[i];
+    }
+    return sorted[count / 2];
+  }
+};
+
+#endif
@@ -1,169 +1,308 @@
 #include <Adafruit_Fingerprint.h>
 #include <HardwareSerial.h>
+#include <Preferences.h>
 #include "fingerprint.h"
+#include "fingerprint_index.h"
+#include "fingerprint_users.h"
+#include "log.h"
 
 const int RX_PORT = 16;
 const int TX_PORT = 17;
+// The sensor's touch output (TOUCH/WAKEUP, high while a finger is on it), -1 when not wired.
+const int TOUCH_PORT = -1;
 
 HardwareSerial mySerial(1);
 Adafruit_Fingerprint finger = Adafruit_Fingerprint(&mySerial);
 
-uint16_t current_free_id = 1; // Don't trust this value, it's only for findFreeId() (min value: 1).
+static const uint8_t FINGERPRINT_READ_INDEX_TABLE = 0x1F;
+static const char *SLOT_INDEX_NAMESPACE = "fingerprint";
+static const char *SLOT_INDEX_KEY = "slots";
+
+// Mirror of the sensor's template index, saved in NVS whenever it changes.
+static SlotIndex<FINGERPRINT_MAX_SLOTS> slotIndex;
+static Preferences preferences;
+// Whether slotIndex matches the sensor. Enrolling without it could overwrite a stored template.
+static bool slotIndexLoaded = false;
+
+// Slot -> user ID, one NVS entry per slot ("u<slot>") so an update only rewrites that slot.
+static const char *USERS_NAMESPACE = "fpusers";
+static const char *SYNCED_HASH_KEY = "synced";
+static FingerprintUserTable<FINGERPRINT_MAX_USERS, FINGERPRINT_USER_ID_SIZE> userTable;
+static Preferences userPreferences;
 
 bool isFingerprintRegistering = false;
 
-bool loadFingerprint()
+class AdafruitFingerprintSensor : public FingerprintSensor
 {
-  mySerial.begin(57600, SERIAL_8N1, RX_PORT, TX_PORT);
-  finger.begin(57600);
+public:
+  uint8_t getImage() override { return finger.getImage(); }
+  uint8_t image2Tz(uint8_t slot) override { return finger.image2Tz(slot); }
+  uint8_t createModel() override { return finger.createModel(); }
+  uint8_t storeModel(uint16_t id) override { return finger.storeModel(id); }
+};
+
+static AdafruitFingerprintSensor sensor;
+static FingerprintEnrollment enrollment(sensor, []() -> uint32_t
+                                        { return millis(); });
 
-  finger.emptyDatabase();
+static bool readIndexPage(uint8_t page, uint8_t *out)
+{
+  uint8_t command[] = {FINGERPRINT_READ_INDEX_TABLE, page};
+  finger.writeStructuredPacket(Adafruit_Fingerprint_Packet(FINGERPRINT_COMMANDPACKET, sizeof(command), command));
 
-  if (finger.verifyPassword())
+  uint8_t empty = 0;
+  Adafruit_Fingerprint_Packet reply(FINGERPRINT_ACKPACKET, 0, &empty);
+  if (finger.getStructuredPacket(&reply) != FINGERPRINT_OK || reply.type != FINGERPRINT_ACKPACKET || reply.data[0] != FINGERPRINT_OK)
   {
-    return true;
+    return false;
   }
-  else
+  memcpy(out, reply.data + 1, FINGERPRINT_INDEX_PAGE_SIZE);
+  return true;
+}
+
+static void saveSlotIndex()
+{
+  preferences.putBytes(SLOT_INDEX_KEY, slotIndex.data(), slotIndex.size());
+}
+
+/**
+ * Rebuilds the slot index with one loadModel() per slot (slow, only used when no index table is available).
+ */
+static bool probeSlotIndex()
+{
+  slotIndex.clearAll();
+  for (uint16_t id = 1; id < finger.capacity && id < FINGERPRINT_MAX_SLOTS; id++)
   {
-    return false;
+    uint8_t p = finger.loadModel(id);
+    if (p == FINGERPRINT_OK)
+    {
+      slotIndex.set(id);
+    }
+    else if (p != FINGERPRINT_DBREADFAIL) // DBREADFAIL: the slot is empty.
+    {
+      return false;
+    }
   }
+  saveSlotIndex();
+  return true;
 }
 
-uint16_t findFreeId(uint16_t maxId = finger.capacity - 1)
+/**
+ * Loads the slot index from the sensor, from NVS when the sensor cannot be read, or by probing every slot.
+ */
+static bool loadSlotIndex()
 {
-  if (finger.templateCount >= maxId)
+  size_t pages = (finger.capacity + FINGERPRINT_INDEX_PAGE_SLOTS - 1) / FINGERPRINT_INDEX_PAGE_SLOTS;
+  if (slotIndex.loadFromSensor(readIndexPage, pages))
   {
-    return -1;
+    saveSlotIndex();
+    return true;
   }
 
-  if (current_free_id > maxId)
+  LOG_WARN("[Fingerprint] Could not read the index table, using the saved one\n");
+  if (preferences.getBytes(SLOT_INDEX_KEY, slotIndex.data(), slotIndex.size()) == slotIndex.size())
   {
-    current_free_id = 1;
+    return true;
   }
 
-  for (uint16_t id = 0; id <= maxId; id++)
+  LOG_WARN("[Fingerprint] No saved index table, probing every slot\n");
+  return probeSlotIndex();
+}
+
+static void userKey(uint16_t id, char *key, size_t size)
+{
+  snprintf(key, size, "u%u", id);
+}
+
+static void loadUserTable()
+{
+  userPreferences.begin(USERS_NAMESPACE, false);
+
+  char key[8];
+  char userId[FINGERPRINT_USER_ID_SIZE];
+  for (uint16_t id = 1; id < FINGERPRINT_MAX_USERS; id++)
   {
-    uint16_t id2 = (((current_free_id - 1) + id) % maxId) + 1; 
-    if (finger.loadModel(id2) != FINGERPRINT_OK)
+    if (!slotIndex.isUsed(id))
+    {
+      continue;
+    }
+    userKey(id, key, sizeof(key));
+    if (userPreferences.isKey(key) && userPreferences.getString(key, userId, sizeof(userId)) > 0)
     {
-      current_free_id = id2 + 1;
-      return id2;
+      userTable.set(id, userId);
     }
   }
-
-  return -1;
 }
 
-uint16_t registerFingerprint2(void (*callback)(FingerprintStage, FingerprintError)) {
-  Serial.println("   >> registerFingerprint2()");
-  int p = -1;
+bool loadFingerprint()
+{
+  mySerial.begin(57600, SERIAL_8N1, RX_PORT, TX_PORT);
+  finger.begin(57600);
 
-  uint16_t id = findFreeId();
-  Serial.print  ("      findFreeId() -> "); Serial.println(id);
-  if (id == 0) {  // or id < 0 depending on your implementation
-    Serial.println("      No free slot! Invoking error callback");
-    callback(FINGERPRINT_ERROR, FINGERPRINT_STORAGE_FULL_ERROR);
-    return 0;
+  if (!finger.verifyPassword() || finger.getParameters() != FINGERPRINT_OK)
+  {
+    return false;
   }
 
-  Serial.println("      Invoking callback: FIRST_REGISTRATION_STAGE");
-  callback(FINGERPRINT_FIRST_REGISTRATION_STAGE, FINGERPRINT_NO_ERROR);
+  preferences.begin(SLOT_INDEX_NAMESPACE, false);
+  slotIndexLoaded = loadSlotIndex();
+  if (!slotIndexLoaded)
+  {
+    LOG_WARN("[Fingerprint] Slot index unavailable, enrollment disabled until it loads\n");
+  }
+  loadUserTable();
+  LOG_INFO("[Fingerprint] %u of %u slots used\n", (unsigned)slotIndex.count(), finger.capacity);
+  return true;
+}
 
-  // wait for finger down
-  Serial.println("      Waiting for finger image…");
-  while ((p = finger.getImage()) != FINGERPRINT_OK) {
-    delay(100);
+bool attachFingerprintTouch(void (*onTouch)())
+{
+  if (TOUCH_PORT < 0)
+  {
+    return false;
   }
-  Serial.println("      Image captured");
+  pinMode(TOUCH_PORT, INPUT);
+  attachInterrupt(digitalPinToInterrupt(TOUCH_PORT), onTouch, RISING);
+  return true;
+}
 
-  Serial.println("      Converting image to template #1");
-  p = finger.image2Tz(1);
-  Serial.print  ("      image2Tz(1) -> "); Serial.println(p);
-  if (p != FINGERPRINT_OK) {
-    Serial.println("      Conversion error, invoking callback");
-    callback(FINGERPRINT_ERROR, FINGERPRINT_IMAGE_CONVERSION_ERROR);
-    return 0;
+uint16_t findFreeId(uint16_t maxId)
+{
+  return slotIndex.findFree(1, maxId);
+}
+
+bool deleteFingerprint(uint16_t id)
+{
+  if (finger.deleteModel(id) != FINGERPRINT_OK)
+  {
+    return false;
   }
+  slotIndex.clear(id);
+  saveSlotIndex();
 
-  Serial.println("      Invoking callback: REMOVE_FINGER_STAGE");
-  callback(FINGERPRINT_REMOVE_FINGER_STAGE, FINGERPRINT_NO_ERROR);
-  delay(1000);
+  char key[8];
+  userKey(id, key, sizeof(key));
+  userTable.remove(id);
+  userPreferences.remove(key);
+  return true;
+}
+
+const char *getFingerprintUser(uint16_t id)
+{
+  return userTable.get(id);
+}
 
-  Serial.println("      Waiting for finger removal…");
-  while (finger.getImage() != FINGERPRINT_NOFINGER) {
-    delay(100);
+bool setFingerprintUser(uint16_t id, const char *userId)
+{
+  if (!userTable.set(id, userId))
+  {
+    return false;
   }
-  Serial.println("      Finger removed");
+  char key[8];
+  userKey(id, key, sizeof(key));
+  return userPreferences.putString(key, userId) > 0;
+}
+
+bool hasFingerprintUser(const char *userId)
+{
+  return userTable.find(userId) >= 0;
+}
+
+uint32_t getSyncedFingerprintHash()
+{
+  return userPreferences.getUInt(SYNCED_HASH_KEY, 0);
+}
+
+bool setSyncedFingerprintHash(uint32_t tableHash)
+{
+  return userPreferences.putUInt(SYNCED_HASH_KEY, tableHash) > 0;
+}
 
-  Serial.println("      Invoking callback: SECOND_REGISTRATION_STAGE");
-  callback(FINGERPRINT_SECOND_REGISTRATION_STAGE, FINGERPRINT_NO_ERROR);
+bool startFingerprintEnrollment(void (*callback)(FingerprintStage, FingerprintError))
+{
+  if (enrollment.isActive())
+  {
+    return false;
+  }
 
-  Serial.println("      Waiting for second finger image…");
-  while ((p = finger.getImage()) != FINGERPRINT_OK) {
-    delay(100);
+  enrollment.setCallback(callback);
+  if (!slotIndexLoaded && !(slotIndexLoaded = loadSlotIndex()))
+  {
+    LOG_WARN("[Fingerprint] Slot index unavailable, not enrolling\n");
+    callback(FINGERPRINT_ERROR, FINGERPRINT_INDEX_ERROR);
+    return false;
   }
-  Serial.println("      Second image captured");
 
-  Serial.println("      Converting image to template #2");
-  p = finger.image2Tz(2);
-  Serial.print  ("      image2Tz(2) -> "); Serial.println(p);
-  if (p != FINGERPRINT_OK) {
-    Serial.println("      Conversion error on second image");
-    callback(FINGERPRINT_ERROR, FINGERPRINT_IMAGE_CONVERSION_ERROR);
-    return 0;
+  // Only slots below FINGERPRINT_MAX_USERS can be mapped to a user.
+  uint16_t maxId = finger.capacity < FINGERPRINT_MAX_USERS ? finger.capacity : FINGERPRINT_MAX_USERS;
+  uint16_t id = findFreeId(maxId - 1);
+  if (id == 0)
+  {
+    LOG_WARN("[Fingerprint] No free slot\n");
+    callback(FINGERPRINT_ERROR, FINGERPRINT_STORAGE_FULL_ERROR);
+    return false;
   }
 
-  Serial.println("      Creating model");
-  p = finger.createModel();
-  Serial.print  ("      createModel() -> "); Serial.println(p);
-  if (p != FINGERPRINT_OK) {
-    Serial.println("      Model creation error");
-    callback(FINGERPRINT_ERROR, FINGERPRINT_MODEL_CREATION_ERROR);
-    return 0;
+  LOG_INFO("[Fingerprint] Enrolling into slot %u\n", id);
+  isFingerprintRegistering = enrollment.start(id);
+  return isFingerprintRegistering;
+}
+
+EnrollmentResult loopFingerprintEnrollment()
+{
+  EnrollmentResult result = enrollment.step();
+  if (result == ENROLLMENT_SUCCEEDED)
+  {
+    slotIndex.set(enrollment.getId());
+    saveSlotIndex();
   }
+  if (result == ENROLLMENT_SUCCEEDED || result == ENROLLMENT_FAILED)
+  {
+    isFingerprintRegistering = false;
 
-  Serial.print  ("      Storing model at slot "); Serial.println(id);
-  p = finger.storeModel(id);
-  Serial.print  ("      storeModel() -> "); Serial.println(p);
-  if (p != FINGERPRINT_OK) {
-    Serial.println("      Store error");
-    callback(FINGERPRINT_ERROR, FINGERPRINT_STORE_ERROR);
-    return 0;
+    const EnrollmentStats &stats = enrollment.getStats();
+    LOG_INFO("[Fingerprint] Enrollment %s: first=%ums removal=%ums second=%ums store=%ums\n",
+             result == ENROLLMENT_SUCCEEDED ? "succeeded" : "failed",
+             stats.stageMs[ENROLLMENT_STATE_FIRST_IMAGE], stats.stageMs[ENROLLMENT_STATE_REMOVAL],
+             stats.stageMs[ENROLLMENT_STATE_SECOND_IMAGE], stats.storeMs);
   }
+  return result;
+}
+
+void cancelFingerprintEnrollment()
+{
+  enrollment.cancel();
+}
 
-  Serial.println("      Invoking callback: FINISHED_STAGE");
-  callback(FINGERPRINT_FINISHED_STAGE, FINGERPRINT_NO_ERROR);
-  delay(2000);
-  Serial.println("   << registerFingerprint2() success");
-  return id;
+FingerprintSensor &getFingerprintSensor()
+{
+  return sensor;
 }
 
-uint16_t registerFingerprint(void (*callback)(FingerprintStage, FingerprintError)) {
-  Serial.println(">> registerFingerprint()");
-  isFingerprintRegistering = true;
-  Serial.print("callback ptr="); 
-  Serial.printf("   callback ptr=%p\n", (void*)callback);
-  uint16_t id = registerFingerprint2(callback);
-  isFingerprintRegistering = false;
-  Serial.print  ("<< registerFingerprint() returning "); Serial.println(id);
-  return id;
+const FingerprintEnrollment &getFingerprintEnrollment()
+{
+  return enrollment;
 }
 
 int16_t scanFingerprint()
 {
   if (isFingerprintRegistering)
-    return -1;
+    return FINGERPRINT_SCAN_ERROR;
 
   int p = finger.getImage();
+  if (p == FINGERPRINT_NOFINGER)
+  {
+    return FINGERPRINT_SCAN_NO_FINGER;
+  }
   if (p != FINGERPRINT_OK)
   {
-    return -1;
+    return FINGERPRINT_SCAN_ERROR;
   }
 
   p = finger.image2Tz();
   if (p != FINGERPRINT_OK)
   {
-    return -1;
+    return FINGERPRINT_SCAN_ERROR;
   }
 
   p = finger.fingerFastSearch();
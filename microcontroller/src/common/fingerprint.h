@@ -3,24 +3,11 @@
 
 #include <Adafruit_Fingerprint.h>
 #include <HardwareSerial.h>
+#include "fingerprint_enrollment.h"
+#include "fingerprint_users.h"
 
-typedef enum
-{
-  FINGERPRINT_ERROR,
-  FINGERPRINT_FIRST_REGISTRATION_STAGE,  // "Place your finger on the sensor..."
-  FINGERPRINT_REMOVE_FINGER_STAGE,       // "Remove your finger..."
-  FINGERPRINT_SECOND_REGISTRATION_STAGE, // "Place the same finger again..."
-  FINGERPRINT_FINISHED_STAGE             // "Fingerprint enrolled successfully!"
-} FingerprintStage;
-
-typedef enum
-{
-  FINGERPRINT_NO_ERROR,
-  FINGERPRINT_STORAGE_FULL_ERROR,     // "The sensor cannot store more fingerprints..."
-  FINGERPRINT_IMAGE_CONVERSION_ERROR, // "Failed to convert image."
-  FINGERPRINT_MODEL_CREATION_ERROR,   // "Could not create model."
-  FINGERPRINT_STORE_ERROR             // "Failed to store fingerprint."
-} FingerprintError;
+// Slots tracked by the slot index (enough for the 162 and 300 template AS608 variants).
+static const size_t FINGERPRINT_MAX_SLOTS = 512;
 
 extern Adafruit_Fingerprint finger;
 
@@ -34,26 +21,103 @@ extern bool isFingerprintRegistering;
 bool loadFingerprint();
 
 /**
- * Finds a free ID for storing the fingerprint in the sensor.
+ * Calls a function (from an interrupt) whenever a finger touches the sensor.
+ *
+ * @param onTouch The interrupt handler, must be IRAM_ATTR.
+ * @return Whether the sensor's touch line is wired.
+ */
+bool attachFingerprintTouch(void (*onTouch)());
+
+/**
+ * Finds a free ID for storing the fingerprint in the sensor, from the slot index (no sensor round trip).
  *
  * @param maxId The maximum ID to check for free space.
- *              Default is the maximum capacity of the sensor.
- * @return The ID if available, -1 if not.
+ * @return The lowest free ID if available, 0 if not.
  */
 uint16_t findFreeId(uint16_t maxId);
 
 /**
- * Registers a fingerprint and calls the callback function with the current stage or error.
+ * Deletes a fingerprint from the sensor and the slot index.
+ *
+ * @param id The ID of the fingerprint.
+ * @return Whether deleted successfully.
+ */
+bool deleteFingerprint(uint16_t id);
+
+/**
+ * Starts registering a fingerprint into a free slot. The registration then runs in
+ * loopFingerprintEnrollment() and calls the callback function with the current stage or error.
  *
  * @param callback The function to call with the current stage or error.
- * @return The ID of the registered fingerprint.
+ * @return Whether the registration started.
+ */
+bool startFingerprintEnrollment(void (*callback)(FingerprintStage stage, FingerprintError error));
+
+/**
+ * Advances the running registration (REQUIRED IN THE LOOP while registering). Never blocks.
+ *
+ * @return ENROLLMENT_SUCCEEDED or ENROLLMENT_FAILED once, when the registration finishes.
+ */
+EnrollmentResult loopFingerprintEnrollment();
+
+/**
+ * Cancels the running registration.
+ */
+void cancelFingerprintEnrollment();
+
+/**
+ * Returns the sensor as used by the registration.
+ */
+FingerprintSensor &getFingerprintSensor();
+
+/**
+ * Returns the registration state machine (slot ID, stage timings).
+ */
+const FingerprintEnrollment &getFingerprintEnrollment();
+
+/**
+ * Returns the user a fingerprint was registered for.
+ *
+ * @param id The ID of the fingerprint.
+ * @return The user ID, "" if unknown.
+ */
+const char *getFingerprintUser(uint16_t id);
+
+/**
+ * Saves the user a fingerprint was registered for (kept across reboots).
+ *
+ * @param id The ID of the fingerprint.
+ * @param userId The user ID.
+ * @return Whether saved successfully.
+ */
+bool setFingerprintUser(uint16_t id, const char *userId);
+
+/**
+ * Whether a user already has a registered fingerprint.
+ */
+bool hasFingerprintUser(const char *userId);
+
+/**
+ * Returns the user table hash last acknowledged as synced to Firestore, 0 if none.
  */
-uint16_t registerFingerprint(void (*callback)(FingerprintStage stage, FingerprintError error));
+uint32_t getSyncedFingerprintHash();
+
+/**
+ * Saves the user table hash acknowledged as synced to Firestore (kept across reboots).
+ *
+ * @return Whether saved successfully.
+ */
+bool setSyncedFingerprintHash(uint32_t tableHash);
+
+// scanFingerprint() results other than a fingerprint ID.
+static const int16_t FINGERPRINT_SCAN_NO_FINGER = -1;
+static const int16_t FINGERPRINT_SCAN_ERROR = -2; // Finger state unknown (read or imaging error).
 
 /**
  * Scans the fingerprint and returns its ID if valid.
  *
- * @return The fingerprint ID if valid (1-64 for AS608).
+ * @return The fingerprint ID if valid (1-64 for AS608), 0 for an unknown finger, FINGERPRINT_SCAN_NO_FINGER
+ *         when the sensor is empty, FINGERPRINT_SCAN_ERROR otherwise.
  */
 int16_t scanFingerprint();
 
@@ -0,0 +1,135 @@
+#include "fingerprint_enrollment.h"
+
+bool FingerprintEnrollment::start(uint16_t slot)
+{
+  if (isActive())
+  {
+    return false;
+  }
+
+  id = slot;
+  cancelRequested = false;
+  stats.started++;
+  for (uint32_t &ms : stats.stageMs)
+  {
+    ms = 0;
+  }
+  stats.storeMs = 0;
+
+  uint32_t now = clockMs();
+  lastPollMs = now - POLL_INTERVAL_MS;
+  enter(ENROLLMENT_STATE_FIRST_IMAGE, FINGERPRINT_FIRST_REGISTRATION_STAGE, now);
+  return true;
+}
+
+EnrollmentResult FingerprintEnrollment::step()
+{
+  if (!isActive())
+  {
+    return ENROLLMENT_IDLE;
+  }
+  if (cancelRequested)
+  {
+    stats.cancelled++;
+    return fail(FINGERPRINT_CANCELLED_ERROR);
+  }
+
+  uint32_t now = clockMs();
+  uint32_t timeout = state == ENROLLMENT_STATE_REMOVAL ? REMOVAL_TIMEOUT_MS : FINGER_TIMEOUT_MS;
+  if (now - stageStartMs >= timeout)
+  {
+    stats.timedOut++;
+    return fail(FINGERPRINT_TIMEOUT_ERROR);
+  }
+  if (now - lastPollMs < POLL_INTERVAL_MS)
+  {
+    return ENROLLMENT_IN_PROGRESS;
+  }
+  lastPollMs = now;
+
+  uint8_t p = sensor.getImage();
+  switch (state)
+  {
+  case ENROLLMENT_STATE_FIRST_IMAGE:
+    if (p != FINGERPRINT_SENSOR_OK)
+    {
+      return ENROLLMENT_IN_PROGRESS;
+    }
+    if (sensor.image2Tz(1) != FINGERPRINT_SENSOR_OK)
+    {
+      return fail(FINGERPRINT_IMAGE_CONVERSION_ERROR);
+    }
+    enter(ENROLLMENT_STATE_REMOVAL, FINGERPRINT_REMOVE_FINGER_STAGE, now);
+    return ENROLLMENT_IN_PROGRESS;
+
+  case ENROLLMENT_STATE_REMOVAL:
+    if (p != FINGERPRINT_SENSOR_NO_FINGER)
+    {
+      return ENROLLMENT_IN_PROGRESS;
+    }
+    enter(ENROLLMENT_STATE_SECOND_IMAGE, FINGERPRINT_SECOND_REGISTRATION_STAGE, now);
+    return ENROLLMENT_IN_PROGRESS;
+
+  case ENROLLMENT_STATE_SECOND_IMAGE:
+    if (p != FINGERPRINT_SENSOR_OK)
+    {
+      return ENROLLMENT_IN_PROGRESS;
+    }
+    if (sensor.image2Tz(2) != FINGERPRINT_SENSOR_OK)
+    {
+      return fail(FINGERPRINT_IMAGE_CONVERSION_ERROR);
+    }
+    stats.stageMs[state] = now - stageStartMs;
+    return store();
+
+  default:
+    return ENROLLMENT_IN_PROGRESS;
+  }
+}
+
+EnrollmentResult FingerprintEnrollment::store()
+{
+  uint32_t start = clockMs();
+  if (sensor.createModel() != FINGERPRINT_SENSOR_OK)
+  {
+    return fail(FINGERPRINT_MODEL_CREATION_ERROR);
+  }
+  if (sensor.storeModel(id) != FINGERPRINT_SENSOR_OK)
+  {
+    return fail(FINGERPRINT_STORE_ERROR);
+  }
+  stats.storeMs = clockMs() - start;
+
+  state = ENROLLMENT_STATE_IDLE;
+  stats.succeeded++;
+  notify(FINGERPRINT_FINISHED_STAGE, FINGERPRINT_NO_ERROR);
+  return ENROLLMENT_SUCCEEDED;
+}
+
+void FingerprintEnrollment::enter(EnrollmentState next, FingerprintStage stage, uint32_t now)
+{
+  if (state != ENROLLMENT_STATE_IDLE)
+  {
+    stats.stageMs[state] = now - stageStartMs;
+  }
+  state = next;
+  stageStartMs = now;
+  notify(stage, FINGERPRINT_NO_ERROR);
+}
+
+EnrollmentResult FingerprintEnrollment::fail(FingerprintError error)
+{
+  state = ENROLLMENT_STATE_IDLE;
+  cancelRequested = false;
+  stats.failed++;
+  notify(FINGERPRINT_ERROR, error);
+  return ENROLLMENT_FAILED;
+}
+
+void FingerprintEnrollment::notify(FingerprintStage stage, FingerprintError error)
+{
+  if (callback)
+  {
+    callback(stage, error);
+  }
+}
@@ -0,0 +1,134 @@
+#ifndef FINGERPRINT_ENROLLMENT_H
+#define FINGERPRINT_ENROLLMENT_H
+
+#include <stdint.h>
+
+// Same values as the Adafruit_Fingerprint confirmation codes.
+static const uint8_t FINGERPRINT_SENSOR_OK = 0x00;
+static const uint8_t FINGERPRINT_SENSOR_NO_FINGER = 0x02;
+
+typedef enum
+{
+  FINGERPRINT_ERROR,
+  FINGERPRINT_FIRST_REGISTRATION_STAGE,  // "Place your finger on the sensor..."
+  FINGERPRINT_REMOVE_FINGER_STAGE,       // "Remove your finger..."
+  FINGERPRINT_SECOND_REGISTRATION_STAGE, // "Place the same finger again..."
+  FINGERPRINT_FINISHED_STAGE             // "Fingerprint enrolled successfully!"
+} FingerprintStage;
+
+typedef enum
+{
+  FINGERPRINT_NO_ERROR,
+  FINGERPRINT_STORAGE_FULL_ERROR,     // "The sensor cannot store more fingerprints..."
+  FINGERPRINT_IMAGE_CONVERSION_ERROR, // "Failed to convert image."
+  FINGERPRINT_MODEL_CREATION_ERROR,   // "Could not create model."
+  FINGERPRINT_STORE_ERROR,            // "Failed to store fingerprint."
+  FINGERPRINT_TIMEOUT_ERROR,          // "Enrollment timed out."
+  FINGERPRINT_CANCELLED_ERROR,        // "Enrollment cancelled."
+  FINGERPRINT_INDEX_ERROR             // "Could not read which slots are used."
+} FingerprintError;
+
+/**
+ * The sensor commands used by enrollment. The device forwards them to Adafruit_Fingerprint,
+ * host tests can simulate a finger being placed and lifted.
+ */
+class FingerprintSensor
+{
+public:
+  virtual ~FingerprintSensor() {}
+
+  virtual uint8_t getImage() = 0;
+  virtual uint8_t image2Tz(uint8_t slot) = 0;
+  virtual uint8_t createModel() = 0;
+  virtual uint8_t storeModel(uint16_t id) = 0;
+};
+
+enum EnrollmentResult
+{
+  ENROLLMENT_IDLE,
+  ENROLLMENT_IN_PROGRESS,
+  ENROLLMENT_SUCCEEDED,
+  ENROLLMENT_FAILED
+};
+
+enum EnrollmentState : uint8_t
+{
+  ENROLLMENT_STATE_IDLE,
+  ENROLLMENT_STATE_FIRST_IMAGE,  // Waiting for the finger.
+  ENROLLMENT_STATE_REMOVAL,      // Waiting for the finger to be lifted.
+  ENROLLMENT_STATE_SECOND_IMAGE, // Waiting for the same finger again.
+  ENROLLMENT_STATE_COUNT
+};
+
+struct EnrollmentStats
+{
+  uint32_t started = 0;
+  uint32_t succeeded = 0;
+  uint32_t failed = 0;
+  uint32_t timedOut = 0;
+  uint32_t cancelled = 0;
+  uint32_t stageMs[ENROLLMENT_STATE_COUNT] = {}; // How long each stage of the last enrollment took.
+  uint32_t storeMs = 0;                          // Model creation and storage of the last enrollment.
+};
+
+/**
+ * Fingerprint enrollment as a state machine. Each step() polls the sensor at most once and returns,
+ * so the caller's loop keeps running while waiting for the user. Every stage has a timeout and the
+ * enrollment can be cancelled at any time. Progress is reported through the callback.
+ */
+class FingerprintEnrollment
+{
+public:
+  static const uint32_t POLL_INTERVAL_MS = 100;
+  static const uint32_t FINGER_TIMEOUT_MS = 30000;
+  static const uint32_t REMOVAL_TIMEOUT_MS = 10000;
+
+  FingerprintEnrollment(FingerprintSensor &sensor, uint32_t (*clockMs)(), void (*callback)(FingerprintStage stage, FingerprintError error) = nullptr)
+      : sensor(sensor), clockMs(clockMs), callback(callback) {}
+
+  void setCallback(void (*newCallback)(FingerprintStage stage, FingerprintError error)) { callback = newCallback; }
+
+  /**
+   * Starts enrolling into a slot.
+   *
+   * @param id The sensor slot to store the fingerprint in.
+   * @return Whether started (false if an enrollment is already running).
+   */
+  bool start(uint16_t id);
+
+  /**
+   * Cancels the running enrollment. The next step() reports the failure.
+   */
+  void cancel() { cancelRequested = true; }
+
+  /**
+   * Advances the enrollment (REQUIRED IN THE LOOP while enrolling).
+   *
+   * @return ENROLLMENT_SUCCEEDED or ENROLLMENT_FAILED once, when it finishes.
+   */
+  EnrollmentResult step();
+
+  bool isActive() const { return state != ENROLLMENT_STATE_IDLE; }
+  EnrollmentState getState() const { return state; }
+  uint16_t getId() const { return id; }
+  const EnrollmentStats &getStats() const { return stats; }
+
+private:
+  FingerprintSensor &sensor;
+  uint32_t (*clockMs)();
+  void (*callback)(FingerprintStage stage, FingerprintError error);
+
+  EnrollmentState state = ENROLLMENT_STATE_IDLE;
+  uint16_t id = 0;
+  uint32_t stageStartMs = 0;
+  uint32_t lastPollMs = 0;
+  volatile bool cancelRequested = false;
+  EnrollmentStats stats;
+
+  void enter(EnrollmentState next, FingerprintStage stage, uint32_t now);
+  EnrollmentResult fail(FingerprintError error);
+  EnrollmentResult store();
+  void notify(FingerprintStage stage, FingerprintError error);
+};
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef FINGERPRINT_INDEX_H
+#define FINGERPRINT_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// The sensor's ReadIndexTable command returns one page of 32 bytes (256 slots) at a time.
+static const size_t FINGERPRINT_INDEX_PAGE_SIZE = 32;
+static const size_t FINGERPRINT_INDEX_PAGE_SLOTS = FINGERPRINT_INDEX_PAGE_SIZE * 8;
+
+/**
+ * Which sensor slots hold a template, one bit per slot, so finding a free slot is a bit scan
+ * instead of a loadModel() round trip per slot.
+ */
+template <size_t CAPACITY>
+class SlotIndex
+{
+  static_assert(CAPACITY % FINGERPRINT_INDEX_PAGE_SLOTS == 0, "SlotIndex capacity must be whole index pages");
+
+public:
+  static const size_t WORDS = CAPACITY / 32;
+  static const size_t PAGES = CAPACITY / FINGERPRINT_INDEX_PAGE_SLOTS;
+
+  bool isUsed(uint16_t id) const
+  {
+    return id < CAPACITY && (words[id / 32] >> (id % 32)) & 1u;
+  }
+
+  void set(uint16_t id)
+  {
+    if (id < CAPACITY)
+      words[id / 32] |= 1u << (id % 32);
+  }
+
+  void clear(uint16_t id)
+  {
+    if (id < CAPACITY)
+      words[id / 32] &= ~(1u << (id % 32));
+  }
+
+  void clearAll() { memset(words, 0, sizeof(words)); }
+
+  /**
+   * Finds the lowest free slot in [first, last].
+   *
+   * @return The slot, 0 if there is none (slot 0 is never handed out).
+   */
+  uint16_t findFree(uint16_t first, uint16_t last) const
+  {
+    if (first == 0)
+      first = 1;
+    if (last >= CAPACITY)
+      last = CAPACITY - 1;
+
+    for (size_t w = first / 32; w <= (size_t)last / 32; w++)
+    {
+      uint32_t free = ~words[w];
+      if (w == first / 32)
+        free &= ~0u << (first % 32);
+      if (free == 0)
+        continue;
+
+      uint16_t id = w * 32 + __builtin_ctz(free);
+      return id <= last ? id : 0;
+    }
+    return 0;
+  }
+
+  size_t count() const
+  {
+    size_t n = 0;
+    for (size_t w = 0; w < WORDS; w++)
+      n += __builtin_popcount(words[w]);
+    return n;
+  }
+
+  /**
+   * Loads one ReadIndexTable page (bit j of byte i is slot page * 256 + i * 8 + j).
+   */
+  void loadPage(uint8_t page, const uint8_t *data)
+  {
+    if (page >= PAGES)
+      return;
+    for (size_t i = 0; i < FINGERPRINT_INDEX_PAGE_SIZE; i++)
+    {
+      size_t bit = page * FINGERPRINT_INDEX_PAGE_SLOTS + i * 8;
+      words[bit / 32] = (words[bit / 32] & ~(0xFFu << (bit % 32))) | ((uint32_t)data[i] << (bit % 32));
+    }
+  }
+
+  /**
+   * Loads every page from the sensor.
+   *
+   * @param readPage Reads one ReadIndexTable page into a 32-byte buffer.
+   * @param pages The number of pages the sensor has.
+   * @return Whether every page was read.
+   */
+  bool loadFromSensor(bool (*readPage)(uint8_t page, uint8_t *out), size_t pages = PAGES)
+  {
+    uint8_t data[FINGERPRINT_INDEX_PAGE_SIZE];
+    for (size_t page = 0; page < pages && page < PAGES; page++)
+    {
+      if (!readPage(page, data))
+        return false;
+      loadPage(page, data);
+    }
+    return true;
+  }
+
+  /**
+   * The raw bitmap, for persisting it.
+   */
+  uint32_t *data() { return words; }
+  const uint32_t *data() const { return words; }
+  size_t size() const { return sizeof(words); }
+
+private:
+  uint32_t words[WORDS] = {};
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef FINGERPRINT_USERS_H
+#define FINGERPRINT_USERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Size of a user ID, terminator included.
+static const size_t FINGERPRINT_USER_ID_SIZE = 40;
+// Slots that can be mapped to a user.
+static const size_t FINGERPRINT_MAX_USERS = 300;
+
+static const uint32_t USER_TABLE_HASH_OFFSET = 2166136261u;
+static const uint32_t USER_TABLE_HASH_PRIME = 16777619u;
+
+/**
+ * Adds a user ID to a running FNV-1a hash of a user table, which starts at USER_TABLE_HASH_OFFSET
+ * and takes the IDs in slot order. The terminator is hashed too, so "ab", "c" differs from "a", "bc".
+ */
+inline uint32_t hashUserId(uint32_t hash, const char *userId)
+{
+  do
+  {
+    hash = (hash ^ (uint8_t)*userId) * USER_TABLE_HASH_PRIME;
+  } while (*userId++);
+  return hash;
+}
+
+/**
+ * Fixed-capacity slot -> user ID table. Lookups index an array, nothing is allocated.
+ * Persistence is left to the caller (one NVS entry per slot on the device).
+ */
+template <size_t CAPACITY, size_t ID_SIZE>
+class FingerprintUserTable
+{
+public:
+  /**
+   * Returns the user ID of a slot, "" if the slot is unknown.
+   */
+  const char *get(uint16_t slot) const
+  {
+    return slot < CAPACITY ? userIds[slot] : "";
+  }
+
+  /**
+   * Sets the user ID of a slot.
+   *
+   * @return Whether the slot and ID fit the table.
+   */
+  bool set(uint16_t slot, const char *userId)
+  {
+    size_t len = strlen(userId);
+    if (slot >= CAPACITY || len >= ID_SIZE)
+    {
+      return false;
+    }
+    memcpy(userIds[slot], userId, len + 1);
+    return true;
+  }
+
+  void remove(uint16_t slot)
+  {
+    if (slot < CAPACITY)
+    {
+      userIds[slot][0] = '\0';
+    }
+  }
+
+  /**
+   * Finds the first slot of a user.
+   *
+   * @return The slot, -1 if the user has none.
+   */
+  int find(const char *userId) const
+  {
+    if (userId[0] == '\0')
+    {
+      return -1;
+    }
+    for (size_t slot = 0; slot < CAPACITY; slot++)
+    {
+      if (strcmp(userIds[slot], userId) == 0)
+      {
+        return slot;
+      }
+    }
+    return -1;
+  }
+
+  size_t count() const
+  {
+    size_t n = 0;
+    for (size_t slot = 0; slot < CAPACITY; slot++)
+    {
+      n += userIds[slot][0] != '\0';
+    }
+    return n;
+  }
+
+private:
+  char userIds[CAPACITY][ID_SIZE] = {};
+};
+
+#endif
@@ -1,10 +1,30 @@
 #include <Firebase_ESP_Client.h>
 #include "addons/TokenHelper.h"
 #include "firebase.h"
+#include "log.h"
+
+// TCP keep-alive probes keep the Firestore session open between events (idle, interval, count).
+#define KEEP_ALIVE_IDLE_S 30
+#define KEEP_ALIVE_INTERVAL_S 10
+#define KEEP_ALIVE_COUNT 3
 
 FirebaseAuth auth;
 FirebaseConfig config;
-extern FirebaseData fbdo;
+FirebaseData fbdo;
+
+static SemaphoreHandle_t sessionMutex = nullptr;
+
+FirestoreSession::FirestoreSession()
+{
+  if (sessionMutex)
+    xSemaphoreTake(sessionMutex, portMAX_DELAY);
+}
+
+FirestoreSession::~FirestoreSession()
+{
+  if (sessionMutex)
+    xSemaphoreGive(sessionMutex);
+}
 
 extern const char *FIREBASE_PROJECT;
 
@@ -12,8 +32,11 @@ bool loadFirebase(const char *apiKey, const std::string email, const std::string
 {
   config.api_key = apiKey;
 
-  Serial.printf("Firebase API Key: %s\n", apiKey);
-  Serial.printf("Firestore Project : %s\n\n", FIREBASE_PROJECT);
+  sessionMutex = xSemaphoreCreateMutex();
+  fbdo.keepAlive(KEEP_ALIVE_IDLE_S, KEEP_ALIVE_INTERVAL_S, KEEP_ALIVE_COUNT);
+
+  LOG_DEBUG("Firebase API Key: %s\n", apiKey);
+  LOG_INFO("Firestore Project : %s\n\n", FIREBASE_PROJECT);
 
   if (email != "" && password != "")
   {
@@ -24,8 +47,8 @@ bool loadFirebase(const char *apiKey, const std::string email, const std::string
   {
     if (!Firebase.signUp(&config, &auth, "", ""))
     {
-      Serial.printf("Firebase anon sign-up failed: %s\n",
-                    config.signer.signupError.message.c_str());
+      LOG_WARN("Firebase anon sign-up failed: %s\n",
+               config.signer.signupError.message.c_str());
       return false;
     }
   }
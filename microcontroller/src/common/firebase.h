@@ -5,6 +5,17 @@
 
 extern FirebaseAuth auth;
 extern FirebaseConfig config;
+extern FirebaseData fbdo;
+
+/**
+ * Scoped exclusive access to the shared Firestore session (fbdo).
+ * The session is kept alive between requests (the library manages its connection, not the pool).
+ */
+struct FirestoreSession
+{
+  FirestoreSession();
+  ~FirestoreSession();
+};
 
 /**
  * Loads Firebase (REQUIRED AT THE START).
@@ -0,0 +1,197 @@
+#ifndef FRAME_FLUSHER_H
+#define FRAME_FLUSHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * A display taking page-organised frames (SSD1306 layout: one byte is 8 vertical pixels of a column).
+ */
+class FramePanel
+{
+public:
+  virtual ~FramePanel() {}
+
+  /**
+   * Writes consecutive columns of one page.
+   *
+   * @param page The page (row of 8 pixels).
+   * @param column The first column.
+   * @param data The column bytes.
+   * @param length The number of columns.
+   * @return The number of bytes sent to the panel, including addressing overhead.
+   */
+  virtual size_t writeColumns(uint8_t page, uint8_t column, const uint8_t *data, size_t length) = 0;
+};
+
+struct FrameFlusherStats
+{
+  uint32_t requests = 0;
+  uint32_t flushes = 0;
+  uint32_t skipped = 0;   // Flushes with nothing changed since the last one.
+  uint32_t coalesced = 0; // Requests merged into a later flush.
+  uint32_t spans = 0;
+  uint32_t lastBytes = 0;
+  uint64_t totalBytes = 0;
+};
+
+/**
+ * Sends a frame to a panel, only the column spans that changed since the last frame sent.
+ * Updates requested faster than the frame interval are coalesced into a single flush.
+ */
+template <size_t WIDTH, size_t HEIGHT>
+class FrameFlusher
+{
+public:
+  static const size_t PAGES = HEIGHT / 8;
+  static const size_t SIZE = WIDTH * PAGES;
+
+  /**
+   * @param panel The display.
+   * @param intervalMs The minimum time between two flushes.
+   * @param mergeGap Spans separated by at most this many unchanged columns are sent together,
+   * as re-sending them costs less than addressing a new span.
+   */
+  FrameFlusher(FramePanel &panel, uint32_t intervalMs, size_t mergeGap = 8)
+      : panel(panel), intervalMs(intervalMs), mergeGap(mergeGap) {}
+
+  /**
+   * Marks the frame as changed, it is sent by the next due loop().
+   */
+  void request()
+  {
+    if (isPending)
+    {
+      stats.coalesced++;
+    }
+    isPending = true;
+    stats.requests++;
+  }
+
+  /**
+   * Forgets what the panel shows, so the next flush sends the whole frame (e.g. after a reset).
+   */
+  void invalidate()
+  {
+    isShadowValid = false;
+  }
+
+  /**
+   * Flushes the frame if a change was requested and the frame interval has passed.
+   *
+   * @param frame The frame buffer (SIZE bytes).
+   * @param nowMs The time in milliseconds.
+   * @return Whether a flush ran.
+   */
+  bool loop(const uint8_t *frame, uint32_t nowMs)
+  {
+    if (!isPending || (hasFlushed && nowMs - lastFlushMs < intervalMs))
+    {
+      return false;
+    }
+    isPending = false;
+    hasFlushed = true;
+    lastFlushMs = nowMs;
+    flush(frame);
+    return true;
+  }
+
+  /**
+   * Sends the changed spans of a frame right away.
+   *
+   * @return The number of bytes sent.
+   */
+  size_t flush(const uint8_t *frame)
+  {
+    size_t bytes = 0;
+    for (size_t page = 0; page < PAGES; page++)
+    {
+      bytes += flushPage(page, frame + page * WIDTH);
+    }
+    isShadowValid = true;
+
+    if (bytes == 0)
+    {
+      stats.skipped++;
+    }
+    else
+    {
+      stats.flushes++;
+    }
+    stats.lastBytes = bytes;
+    stats.totalBytes += bytes;
+    return bytes;
+  }
+
+  bool hasPendingFlush() const { return isPending; }
+
+  const FrameFlusherStats &getStats() const { return stats; }
+
+private:
+  size_t flushPage(size_t page, const uint8_t *row)
+  {
+    uint8_t *shadowRow = shadow + page * WIDTH;
+    size_t bytes = 0;
+    size_t column = 0;
+    while (column < WIDTH)
+    {
+      if (isShadowValid && row[column] == shadowRow[column])
+      {
+        column++;
+        continue;
+      }
+
+      // Extend the span until more than mergeGap unchanged columns follow.
+      size_t first = column;
+      size_t last = column;
+      for (column++; column < WIDTH && column - last <= mergeGap + 1; column++)
+      {
+        if (!isShadowValid || row[column] != shadowRow[column])
+        {
+          last = column;
+        }
+      }
+
+      size_t length = last - first + 1;
+      bytes += panel.writeColumns(page, first, row + first, length);
+      memcpy(shadowRow + first, row + first, length);
+      stats.spans++;
+      column = last + 1;
+    }
+    return bytes;
+  }
+
+  FramePanel &panel;
+  uint32_t intervalMs;
+  size_t mergeGap;
+
+  uint8_t shadow[SIZE] = {};
+  bool isShadowValid = false;
+  bool isPending = false;
+  bool hasFlushed = false;
+  uint32_t lastFlushMs = 0;
+  FrameFlusherStats stats;
+};
+
+/**
+ * Keeps the frame in memory and counts the bytes written (for host tests).
+ */
+template <size_t WIDTH, size_t HEIGHT>
+class MemoryPanel : public FramePanel
+{
+public:
+  static const size_t ADDRESS_BYTES = 6;
+
+  size_t writeColumns(uint8_t page, uint8_t column, const uint8_t *data, size_t length) override
+  {
+    memcpy(frame + page * WIDTH + column, data, length);
+    writes++;
+    return length + ADDRESS_BYTES;
+  }
+
+  uint8_t frame[WIDTH * HEIGHT / 8] = {};
+  uint32_t writes = 0;
+};
+
+#endif
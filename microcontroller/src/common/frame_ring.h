@@ -0,0 +1,202 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Fixed-size ring of the last N encoded frames with their capture time.
+ *
+ * The ring does not lock by itself: the owner serialises calls, while the frame bytes are
+ * copied outside of the lock (between beginWrite() and commitWrite(), or while pinned).
+ * Pinned slots are never overwritten, so readers can hold a frame while capture continues.
+ */
+template <size_t N>
+class FrameRing
+{
+public:
+  struct Slot
+  {
+    uint8_t *buf = nullptr;
+    size_t capacity = 0;
+    size_t len = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+    uint32_t timestampMs = 0;
+    uint32_t seq = 0; // 0 while the slot is empty or being written.
+    uint8_t pins = 0;
+  };
+
+  static constexpr size_t CAPACITY = N;
+
+  /**
+   * Allocates the slot buffers.
+   *
+   * @param slotCapacity The maximum size of a single frame in bytes.
+   * @param alloc The allocator used for the slot buffers (e.g. PSRAM).
+   * @return Whether every slot was allocated.
+   */
+  bool begin(size_t slotCapacity, void *(*alloc)(size_t))
+  {
+    for (size_t i = 0; i < N; i++)
+    {
+      slots[i].buf = static_cast<uint8_t *>(alloc(slotCapacity));
+      if (!slots[i].buf)
+      {
+        return false;
+      }
+      slots[i].capacity = slotCapacity;
+    }
+    this->slotCapacity = slotCapacity;
+    return true;
+  }
+
+  /**
+   * Whether a frame fits a slot. Checked before beginWrite(), which already invalidates the oldest frame.
+   */
+  bool fits(size_t len) const { return len <= slotCapacity; }
+
+  /**
+   * Claims the oldest unpinned slot for writing and invalidates it.
+   *
+   * @return The slot to fill, nullptr if every slot is pinned.
+   */
+  Slot *beginWrite()
+  {
+    Slot *victim = nullptr;
+    for (size_t i = 0; i < N; i++)
+    {
+      Slot &slot = slots[i];
+      if (slot.pins > 0)
+        continue;
+      if (!victim || slot.seq < victim->seq)
+        victim = &slot;
+    }
+
+    if (victim)
+    {
+      victim->seq = 0;
+      victim->len = 0;
+    }
+    return victim;
+  }
+
+  /**
+   * Publishes a slot filled after beginWrite().
+   */
+  void commitWrite(Slot *slot, size_t len, uint32_t timestampMs, uint16_t width = 0, uint16_t height = 0)
+  {
+    slot->len = len;
+    slot->timestampMs = timestampMs;
+    slot->width = width;
+    slot->height = height;
+    slot->seq = ++lastSeq;
+  }
+
+  /**
+   * Finds the frame captured closest to the given time.
+   *
+   * @param timestampMs The reference time.
+   * @return The slot index, -1 if the ring is empty.
+   */
+  int closest(uint32_t timestampMs) const
+  {
+    int best = -1;
+    uint32_t bestDistance = UINT32_MAX;
+
+    for (size_t i = 0; i < N; i++)
+    {
+      const Slot &slot = slots[i];
+      if (slot.seq == 0)
+        continue;
+
+      int32_t delta = (int32_t)(slot.timestampMs - timestampMs);
+      uint32_t distance = delta < 0 ? (uint32_t)-delta : (uint32_t)delta;
+      if (distance < bestDistance || (best >= 0 && distance == bestDistance && slot.seq > slots[best].seq))
+      {
+        best = (int)i;
+        bestDistance = distance;
+      }
+    }
+    return best;
+  }
+
+  /**
+   * Returns the most recent frame.
+   *
+   * @return The slot index, -1 if the ring is empty.
+   */
+  int latest() const
+  {
+    int best = -1;
+    for (size_t i = 0; i < N; i++)
+    {
+      if (slots[i].seq != 0 && (best < 0 || slots[i].seq > slots[best].seq))
+        best = (int)i;
+    }
+    return best;
+  }
+
+  /**
+   * Collects the frames around an event in capture order.
+   *
+   * @param timestampMs The event time.
+   * @param pre The maximum number of frames before the closest one.
+   * @param post The maximum number of frames after the closest one.
+   * @param out The slot indexes (at least pre + post + 1 entries).
+   * @return The number of indexes written.
+   */
+  size_t burst(uint32_t timestampMs, size_t pre, size_t post, int out[]) const
+  {
+    int center = closest(timestampMs);
+    if (center < 0)
+      return 0;
+
+    int ordered[N];
+    size_t count = sortBySeq(ordered);
+
+    size_t centerPos = 0;
+    while (ordered[centerPos] != center)
+      centerPos++;
+
+    size_t first = centerPos > pre ? centerPos - pre : 0;
+    size_t last = centerPos + post < count ? centerPos + post : count - 1;
+
+    size_t written = 0;
+    for (size_t i = first; i <= last; i++)
+      out[written++] = ordered[i];
+    return written;
+  }
+
+  void pin(int index) { slots[index].pins++; }
+  void unpin(int index) { slots[index].pins--; }
+
+  const Slot &operator[](int index) const { return slots[index]; }
+  Slot &operator[](int index) { return slots[index]; }
+
+private:
+  Slot slots[N];
+  size_t slotCapacity = 0;
+  uint32_t lastSeq = 0;
+
+  size_t sortBySeq(int out[]) const
+  {
+    size_t count = 0;
+    for (size_t i = 0; i < N; i++)
+    {
+      if (slots[i].seq == 0)
+        continue;
+
+      size_t pos = count++;
+      while (pos > 0 && slots[out[pos - 1]].seq > slots[i].seq)
+      {
+        out[pos] = out[pos - 1];
+        pos--;
+      }
+      out[pos] = (int)i;
+    }
+    return count;
+  }
+};
+
+#endif
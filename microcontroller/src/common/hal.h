@@ -0,0 +1,146 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fingerprint_enrollment.h"
+#include "mqtt_session.h"
+#include "frame_flusher.h"
+
+/**
+ * Hardware and cloud services the nodes depend on, as interfaces so that the logic using them can
+ * run against fakes. Existing seams are reused: FingerprintSensor (fingerprint_enrollment.h),
+ * MqttBrokerClient (mqtt_session.h), FramePanel (frame_flusher.h) and Transport (transport.h).
+ */
+
+/**
+ * Text and QR code screen (OLED).
+ */
+class Display
+{
+public:
+  virtual ~Display() {}
+
+  virtual void showText(const char *text, int duration) = 0;
+  virtual void showQRCode(const char *qrData, const char *text, int duration) = 0;
+};
+
+/**
+ * Distance sensor read asynchronously (ultrasonic).
+ */
+class DistanceSensor
+{
+public:
+  virtual ~DistanceSensor() {}
+
+  virtual void trigger() = 0;
+  virtual bool read(float &distanceCm) = 0;
+};
+
+struct CameraFrame
+{
+  const uint8_t *data = nullptr;
+  size_t length = 0;
+  void *handle = nullptr; // Backend frame, given back on release.
+};
+
+class Camera
+{
+public:
+  virtual ~Camera() {}
+
+  /**
+   * @param eventMs The event time as returned by millis(), to pick the closest buffered frame.
+   * @param frame The captured frame, to be given back with release().
+   */
+  virtual bool capture(uint32_t eventMs, CameraFrame &frame) = 0;
+  virtual void release(CameraFrame &frame) = 0;
+};
+
+/**
+ * Buzzer and LED signalling an event.
+ */
+class Buzzer
+{
+public:
+  virtual ~Buzzer() {}
+
+  virtual void beep(uint32_t durationMs) = 0;
+};
+
+/**
+ * Users of the fingerprints stored in the sensor, and the running enrollment.
+ */
+class FingerprintDirectory
+{
+public:
+  virtual ~FingerprintDirectory() {}
+
+  /**
+   * @return The user ID, "" if unknown.
+   */
+  virtual const char *getUser(uint16_t id) = 0;
+  virtual bool hasUser(const char *userId) = 0;
+  virtual bool setUser(uint16_t id, const char *userId) = 0;
+
+  /**
+   * The user table hash the WROVER last acknowledged as synced to Firestore (kept across reboots).
+   */
+  virtual uint32_t getSyncedHash() = 0;
+  virtual bool setSyncedHash(uint32_t tableHash) = 0;
+
+  virtual bool isEnrolling() = 0;
+  virtual void cancelEnrollment() = 0;
+};
+
+/**
+ * Storage for uploaded files (Supabase storage).
+ */
+class ObjectStore
+{
+public:
+  virtual ~ObjectStore() {}
+
+  /**
+   * @return The HTTP status code (negative on connection errors).
+   */
+  virtual int upload(const char *bucket, const char *path, const char *mimeType, const uint8_t *data, size_t length) = 0;
+};
+
+/**
+ * Device records (Firestore).
+ */
+class DeviceDatabase
+{
+public:
+  virtual ~DeviceDatabase() {}
+
+  virtual bool hasOwner(const char *nodeId) = 0;
+  /**
+   * @return Whether the user is registered to the node (already or now).
+   */
+  virtual bool addUser(const char *nodeId, const char *userId) = 0;
+};
+
+/**
+ * The set of backends a node runs with. Unused members are nullptr.
+ */
+struct Hal
+{
+  Display *display = nullptr;
+  DistanceSensor *distance = nullptr;
+  FingerprintSensor *fingerprint = nullptr;
+  FingerprintDirectory *fingerprintUsers = nullptr;
+  Buzzer *buzzer = nullptr;
+  Camera *camera = nullptr;
+  ObjectStore *store = nullptr;
+  DeviceDatabase *database = nullptr;
+};
+
+/**
+ * Returns the ESP32 backends of the common modules (the buzzer and the database are WROVER only, see
+ * getBuzzer() and getFirestoreDatabase()).
+ */
+Hal getDeviceHal();
+
+#endif
@@ -0,0 +1,84 @@
+#include "hal.h"
+#include "camera.h"
+#include "fingerprint.h"
+#include "oled.h"
+#include "supabase.h"
+#include "ultrasonic.h"
+
+class OledDisplay : public Display
+{
+public:
+  void showText(const char *text, int duration) override { displayText(text, duration); }
+  void showQRCode(const char *qrData, const char *text, int duration) override { displayQRCode(qrData, text, duration); }
+};
+
+class UltrasonicSensor : public DistanceSensor
+{
+public:
+  void trigger() override { triggerUltrasonic(); }
+  bool read(float &distanceCm) override { return readUltrasonic(distanceCm); }
+};
+
+class SensorFingerprintDirectory : public FingerprintDirectory
+{
+public:
+  const char *getUser(uint16_t id) override { return getFingerprintUser(id); }
+  bool hasUser(const char *userId) override { return hasFingerprintUser(userId); }
+  bool setUser(uint16_t id, const char *userId) override { return setFingerprintUser(id, userId); }
+
+  uint32_t getSyncedHash() override { return getSyncedFingerprintHash(); }
+  bool setSyncedHash(uint32_t tableHash) override { return setSyncedFingerprintHash(tableHash); }
+
+  bool isEnrolling() override { return isFingerprintRegistering; }
+  void cancelEnrollment() override { cancelFingerprintEnrollment(); }
+};
+
+class Esp32Camera : public Camera
+{
+public:
+  bool capture(uint32_t eventMs, CameraFrame &frame) override
+  {
+    camera_fb_t *fb = takePhotoAt(eventMs);
+    if (!fb)
+    {
+      return false;
+    }
+    frame.data = fb->buf;
+    frame.length = fb->len;
+    frame.handle = fb;
+    return true;
+  }
+
+  void release(CameraFrame &frame) override
+  {
+    releasePhoto((camera_fb_t *)frame.handle);
+    frame = CameraFrame();
+  }
+};
+
+class SupabaseStore : public ObjectStore
+{
+public:
+  int upload(const char *bucket, const char *path, const char *mimeType, const uint8_t *data, size_t length) override
+  {
+    return uploadToSupabase(bucket, path, mimeType, data, length);
+  }
+};
+
+static OledDisplay oledDisplay;
+static UltrasonicSensor ultrasonicSensor;
+static SensorFingerprintDirectory fingerprintDirectory;
+static Esp32Camera esp32Camera;
+static SupabaseStore supabaseStore;
+
+Hal getDeviceHal()
+{
+  Hal hal;
+  hal.display = &oledDisplay;
+  hal.distance = &ultrasonicSensor;
+  hal.fingerprint = &getFingerprintSensor();
+  hal.fingerprintUsers = &fingerprintDirectory;
+  hal.camera = &esp32Camera;
+  hal.store = &supabaseStore;
+  return hal;
+}
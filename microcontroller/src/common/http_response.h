@@ -0,0 +1,209 @@
+#ifndef HTTP_RESPONSE_H
+#define HTTP_RESPONSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+enum HttpResponseState : uint8_t
+{
+  HTTP_RESPONSE_STATUS,     // Reading "HTTP/1.1 200 OK".
+  HTTP_RESPONSE_HEADERS,
+  HTTP_RESPONSE_BODY,       // Skipping Content-Length bytes.
+  HTTP_RESPONSE_CHUNK_SIZE, // Reading a chunk size line.
+  HTTP_RESPONSE_CHUNK_DATA,
+  HTTP_RESPONSE_CHUNK_END,  // Reading the CRLF after a chunk.
+  HTTP_RESPONSE_TRAILERS,
+  HTTP_RESPONSE_DONE,
+  HTTP_RESPONSE_ERROR
+};
+
+/**
+ * Incremental HTTP/1.1 response reader, fed one byte at a time as they arrive. It keeps the status
+ * code and skips the body, whether framed by Content-Length or chunked, so that a kept-alive
+ * connection is left at a message boundary. A body with neither ends when the server closes the
+ * connection: the reader stops after the headers and the connection must not be reused.
+ */
+class HttpResponseReader
+{
+public:
+  static const size_t LINE_SIZE = 96;
+
+  /**
+   * Reads the next byte of the response.
+   *
+   * @return Whether the response is finished (done or failed), so reading can stop.
+   */
+  bool feed(char c)
+  {
+    switch (state)
+    {
+    case HTTP_RESPONSE_BODY:
+      if (--remaining == 0)
+      {
+        state = HTTP_RESPONSE_DONE;
+      }
+      break;
+
+    case HTTP_RESPONSE_CHUNK_DATA:
+      if (--remaining == 0)
+      {
+        state = HTTP_RESPONSE_CHUNK_END;
+      }
+      break;
+
+    case HTTP_RESPONSE_DONE:
+    case HTTP_RESPONSE_ERROR:
+      break;
+
+    default:
+      if (c == '\n')
+      {
+        line[lineLength] = '\0';
+        lineLength = 0;
+        onLine();
+      }
+      else if (c != '\r' && lineLength + 1 < LINE_SIZE)
+      {
+        line[lineLength++] = c;
+      }
+      break;
+    }
+    return isFinished();
+  }
+
+  bool isFinished() const { return state == HTTP_RESPONSE_DONE || state == HTTP_RESPONSE_ERROR; }
+
+  /**
+   * @return The status code, -1 until the status line was read or if it is malformed.
+   */
+  int getStatus() const { return status; }
+
+  /**
+   * Whether the whole response was read and the server keeps the connection open.
+   */
+  bool canReuse() const { return state == HTTP_RESPONSE_DONE && !closeDelimited && !closeRequested; }
+
+  HttpResponseState getState() const { return state; }
+
+private:
+  HttpResponseState state = HTTP_RESPONSE_STATUS;
+  char line[LINE_SIZE];
+  size_t lineLength = 0;
+  int status = -1;
+  long contentLength = -1;
+  bool chunked = false;
+  bool closeRequested = false;
+  bool closeDelimited = false;
+  unsigned long remaining = 0;
+
+  static bool hasPrefix(const char *text, const char *prefix)
+  {
+    return strncasecmp(text, prefix, strlen(prefix)) == 0;
+  }
+
+  static const char *headerValue(const char *text, const char *name)
+  {
+    text += strlen(name);
+    while (*text == ' ' || *text == '\t')
+    {
+      text++;
+    }
+    return text;
+  }
+
+  void onLine()
+  {
+    switch (state)
+    {
+    case HTTP_RESPONSE_STATUS:
+    {
+      const char *code = strchr(line, ' ');
+      if (!hasPrefix(line, "HTTP/") || !code)
+      {
+        state = HTTP_RESPONSE_ERROR;
+        return;
+      }
+      status = atoi(code + 1);
+      state = HTTP_RESPONSE_HEADERS;
+      break;
+    }
+
+    case HTTP_RESPONSE_HEADERS:
+      if (line[0] != '\0')
+      {
+        onHeader();
+      }
+      else
+      {
+        onHeadersEnd();
+      }
+      break;
+
+    case HTTP_RESPONSE_CHUNK_SIZE:
+      // Chunk extensions (";name=value") are ignored by strtoul.
+      remaining = strtoul(line, nullptr, 16);
+      state = remaining > 0 ? HTTP_RESPONSE_CHUNK_DATA : HTTP_RESPONSE_TRAILERS;
+      break;
+
+    case HTTP_RESPONSE_CHUNK_END:
+      state = line[0] == '\0' ? HTTP_RESPONSE_CHUNK_SIZE : HTTP_RESPONSE_ERROR;
+      break;
+
+    case HTTP_RESPONSE_TRAILERS:
+      if (line[0] == '\0')
+      {
+        state = HTTP_RESPONSE_DONE;
+      }
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  void onHeader()
+  {
+    if (hasPrefix(line, "Content-Length:"))
+    {
+      contentLength = atol(headerValue(line, "Content-Length:"));
+    }
+    else if (hasPrefix(line, "Transfer-Encoding:"))
+    {
+      chunked = strstr(headerValue(line, "Transfer-Encoding:"), "chunked") != nullptr;
+    }
+    else if (hasPrefix(line, "Connection:"))
+    {
+      closeRequested = hasPrefix(headerValue(line, "Connection:"), "close");
+    }
+  }
+
+  void onHeadersEnd()
+  {
+    // 1xx, 204 and 304 responses never have a body.
+    if ((status >= 100 && status < 200) || status == 204 || status == 304)
+    {
+      state = status < 200 ? HTTP_RESPONSE_STATUS : HTTP_RESPONSE_DONE;
+      contentLength = -1;
+      chunked = false;
+    }
+    else if (chunked)
+    {
+      state = HTTP_RESPONSE_CHUNK_SIZE;
+    }
+    else if (contentLength > 0)
+    {
+      remaining = contentLength;
+      state = HTTP_RESPONSE_BODY;
+    }
+    else
+    {
+      closeDelimited = contentLength < 0;
+      state = HTTP_RESPONSE_DONE;
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Histogram in power-of-two buckets of any unit: [0, 1), [1, 2), [2, 4), ... [2^(N-2), inf).
+ * Constant size and O(1) recording, percentiles are approximated by the bucket upper bound.
+ * Recording is lock-free, so one task can record while another reads and resets; a reading taken
+ * meanwhile may miss the values in flight.
+ */
+template <size_t N>
+class Pow2Histogram
+{
+public:
+  static const size_t BUCKETS = N;
+
+  void record(uint32_t value)
+  {
+    size_t bucket = 0;
+    while (bucket < BUCKETS - 1 && value >= (1u << bucket))
+    {
+      bucket++;
+    }
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t currentMax = maxValue.load(std::memory_order_relaxed);
+    while (value > currentMax && !maxValue.compare_exchange_weak(currentMax, value, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  /**
+   * Returns the upper bound of the bucket holding the given percentile, capped at the maximum.
+   *
+   * @param percent The percentile, between 0 and 100.
+   */
+  uint32_t percentile(uint32_t percent) const
+  {
+    uint32_t count = getCount();
+    if (count == 0)
+    {
+      return 0;
+    }
+    uint32_t rank = (count * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKETS; bucket++)
+    {
+      seen += getBucket(bucket);
+      if (seen >= rank && seen > 0)
+      {
+        uint32_t max = getMax();
+        return bucket == BUCKETS - 1 || max < (1u << bucket) ? max : (1u << bucket);
+      }
+    }
+    return getMax();
+  }
+
+  void reset()
+  {
+    for (size_t bucket = 0; bucket < BUCKETS; bucket++)
+    {
+      buckets[bucket].store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+    maxValue.store(0, std::memory_order_relaxed);
+  }
+
+  uint32_t getCount() const { return total.load(std::memory_order_relaxed); }
+  uint32_t getMax() const { return maxValue.load(std::memory_order_relaxed); }
+  uint32_t getBucket(size_t bucket) const { return buckets[bucket].load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint32_t> buckets[BUCKETS] = {};
+  std::atomic<uint32_t> total{0};
+  std::atomic<uint32_t> maxValue{0};
+};
+
+/**
+ * Latencies in milliseconds, up to [2048, inf).
+ */
+typedef Pow2Histogram<13> LatencyHistogram;
+
+#endif
@@ -0,0 +1,73 @@
+#include <Arduino.h>
+#include <stdarg.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/ringbuf.h>
+#include <freertos/task.h>
+#include "log.h"
+#include "metrics.h"
+
+static const size_t LOG_RING_SIZE = 4096;
+static const size_t LOG_MESSAGE_SIZE = 192;
+static const uint32_t LOG_TASK_STACK = 2048;
+static const UBaseType_t LOG_TASK_PRIORITY = 1;
+
+static RingbufHandle_t logRing = nullptr;
+static MetricCounter droppedLogs("log_dropped");
+
+static void logTask(void *)
+{
+  while (true)
+  {
+    size_t length;
+    char *message = (char *)xRingbufferReceive(logRing, &length, portMAX_DELAY);
+    if (message)
+    {
+      Serial.write((const uint8_t *)message, length);
+      vRingbufferReturnItem(logRing, message);
+    }
+  }
+}
+
+bool loadLogger(uint32_t baud)
+{
+  Serial.begin(baud);
+
+  logRing = xRingbufferCreate(LOG_RING_SIZE, RINGBUF_TYPE_NOSPLIT);
+  if (!logRing)
+  {
+    return false;
+  }
+  return xTaskCreate(logTask, "log", LOG_TASK_STACK, nullptr, LOG_TASK_PRIORITY, nullptr) == pdPASS;
+}
+
+void logMessage(const char *format, ...)
+{
+  char message[LOG_MESSAGE_SIZE];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  if (length < 0)
+  {
+    return;
+  }
+  if ((size_t)length >= sizeof(message))
+  {
+    length = sizeof(message) - 1;
+  }
+
+  if (!logRing)
+  {
+    Serial.write((const uint8_t *)message, length);
+    return;
+  }
+  if (xRingbufferSend(logRing, message, length, 0) != pdTRUE)
+  {
+    droppedLogs.add();
+  }
+}
+
+uint32_t getDroppedLogs()
+{
+  return droppedLogs.get();
+}
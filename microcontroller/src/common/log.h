@@ -0,0 +1,63 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+// Set per build in platformio.ini (build_flags = -DLOG_LEVEL=...). Everything is printed by default.
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+static const uint32_t LOG_BAUD_RATE = 115200;
+
+/**
+ * Whether a level is compiled in.
+ */
+constexpr bool isLogEnabled(int level)
+{
+  return LOG_LEVEL >= level;
+}
+
+/**
+ * Loads the serial port and the task printing the logs (REQUIRED AT THE START, instead of Serial.begin()).
+ * Until then logs are printed directly.
+ *
+ * @param baud The serial baud rate.
+ * @return Whether loaded successfully.
+ */
+bool loadLogger(uint32_t baud = LOG_BAUD_RATE);
+
+/**
+ * Formats a log into the log ring, printed later by a low priority task. Never blocks:
+ * the log is dropped (and counted) when the ring is full.
+ */
+void logMessage(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * Returns the number of logs dropped because the ring was full.
+ */
+uint32_t getDroppedLogs();
+
+// Calls above LOG_LEVEL compile to nothing, format strings included.
+#define LOG_AT(level, ...)          \
+  do                                \
+  {                                 \
+    if (isLogEnabled(level))        \
+    {                               \
+      logMessage(__VA_ARGS__);      \
+    }                               \
+  } while (0)
+
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+#endif
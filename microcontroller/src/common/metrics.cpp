@@ -0,0 +1,26 @@
+#include <ArduinoJson.h>
+#include "metrics.h"
+
+Metric *Metric::first = nullptr;
+
+size_t writeMetrics(uint8_t *out, size_t size)
+{
+  JsonDocument doc;
+  for (const Metric *metric = Metric::getFirst(); metric; metric = metric->getNext())
+  {
+    if (metric->isHistogram())
+    {
+      const MetricHistogram *histogram = static_cast<const MetricHistogram *>(metric);
+      JsonArray values = doc[metric->getName()].to<JsonArray>();
+      values.add(histogram->getCount());
+      values.add(histogram->percentile(50));
+      values.add(histogram->percentile(99));
+      values.add(histogram->getMax());
+    }
+    else
+    {
+      doc[metric->getName()] = static_cast<const MetricCounter *>(metric)->get();
+    }
+  }
+  return measureJson(doc) < size ? serializeJson(doc, out, size) : 0;
+}
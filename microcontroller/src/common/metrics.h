@@ -0,0 +1,107 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "latency_histogram.h"
+
+// Topic (without the device prefix) where metric snapshots are published.
+static constexpr const char *METRICS_TOPIC = "metrics";
+
+/**
+ * A named metric. Every metric links itself into a static list when constructed, so metrics are
+ * defined as globals next to the code they measure and need no central table.
+ */
+class Metric
+{
+public:
+  Metric(const char *name, bool histogram) : name(name), histogram(histogram), next(first)
+  {
+    first = this;
+  }
+
+  const char *getName() const { return name; }
+  bool isHistogram() const { return histogram; }
+  const Metric *getNext() const { return next; }
+  static const Metric *getFirst() { return first; }
+
+private:
+  const char *name;
+  bool histogram;
+  const Metric *next;
+  static Metric *first;
+};
+
+/**
+ * Monotonic counter, safe to increment from any task or core.
+ */
+class MetricCounter : public Metric
+{
+public:
+  explicit MetricCounter(const char *name) : Metric(name, false) {}
+
+  void add(uint32_t amount = 1) { value.fetch_add(amount, std::memory_order_relaxed); }
+  uint32_t get() const { return value.load(std::memory_order_relaxed); }
+  void reset() { value.store(0, std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint32_t> value{0};
+};
+
+/**
+ * Histogram in power-of-two buckets of any unit, up to [2^14, inf) (see Pow2Histogram).
+ * Recording is lock-free, so it is safe from any task or core.
+ */
+class MetricHistogram : public Metric
+{
+public:
+  explicit MetricHistogram(const char *name) : Metric(name, true) {}
+
+  void record(uint32_t value) { values.record(value); }
+  uint32_t getCount() const { return values.getCount(); }
+  uint32_t percentile(uint32_t percent) const { return values.percentile(percent); }
+  uint32_t getMax() const { return values.getMax(); }
+  void reset() { values.reset(); }
+
+private:
+  Pow2Histogram<16> values;
+};
+
+/**
+ * Returns the time in microseconds used by ScopedTimer (micros() on the device).
+ */
+uint32_t metricsNowUs();
+
+/**
+ * Records the microseconds spent in a scope into a histogram.
+ */
+class ScopedTimer
+{
+public:
+  explicit ScopedTimer(MetricHistogram &histogram) : histogram(histogram), startUs(metricsNowUs()) {}
+  ~ScopedTimer() { histogram.record(metricsNowUs() - startUs); }
+
+private:
+  MetricHistogram &histogram;
+  uint32_t startUs;
+};
+
+/**
+ * Writes every metric as one compact JSON object:
+ * {"<counter>":n,"<histogram>":[count,p50,p99,max],...}
+ *
+ * @param out The output buffer.
+ * @param size The output buffer size.
+ * @return The length written, 0 if it did not fit.
+ */
+size_t writeMetrics(uint8_t *out, size_t size);
+
+/**
+ * Publishes a snapshot of every metric to "<nodeId>/metrics".
+ *
+ * @return Whether the snapshot was handed to the client.
+ */
+bool publishMetrics(const char *nodeId);
+
+#endif
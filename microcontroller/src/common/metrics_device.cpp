@@ -0,0 +1,26 @@
+#include <Arduino.h>
+#include "metrics.h"
+#include "mqtt.h"
+#include "topic_router.h"
+
+// Fits in MQTT_PACKET_BUFFER_SIZE along with the topic.
+static const size_t METRICS_MESSAGE_SIZE = 704;
+// PubSubClient adds up to 5 bytes of fixed header and 2 of topic length.
+static_assert(METRICS_MESSAGE_SIZE + topicSize(METRICS_TOPIC) + 7 <= MQTT_PACKET_BUFFER_SIZE, "metric snapshots must fit in the MQTT packet buffer");
+
+uint32_t metricsNowUs()
+{
+  return micros();
+}
+
+bool publishMetrics(const char *nodeId)
+{
+  char topic[topicSize(METRICS_TOPIC)];
+  uint8_t payload[METRICS_MESSAGE_SIZE];
+  size_t length = writeMetrics(payload, sizeof(payload));
+  if (length == 0 || buildTopic(topic, sizeof(topic), nodeId, METRICS_TOPIC) == 0)
+  {
+    return false;
+  }
+  return publishMQTT(topic, payload, length);
+}
@@ -1,36 +1,86 @@
 #include <PubSubClient.h>
+#include <WiFi.h>
 #include <WiFiClientSecure.h>
+#include "mqtt.h"
+#include "mqtt_session.h"
+
+// Bounds the only blocking part left, a single connection attempt.
+static const unsigned long MQTT_HANDSHAKE_TIMEOUT_S = 5;
+static const uint16_t MQTT_SOCKET_TIMEOUT_S = 5;
 
 WiFiClientSecure espClient;
 PubSubClient client(espClient);
 
-void loadMQTT(const char *mqttServer, int mqttPort, void (*callback)(char *topic, uint8_t *payload, unsigned int length))
+class PubSubBrokerClient : public MqttBrokerClient
+{
+public:
+  const char *clientId = "";
+  const char *username = "";
+  const char *password = "";
+
+  bool connect() override
+  {
+    return WiFi.status() == WL_CONNECTED && client.connect(clientId, username, password);
+  }
+
+  bool connected() override { return client.connected(); }
+  bool subscribe(const char *topic) override { return client.subscribe(topic); }
+
+  bool publish(const char *topic, const uint8_t *payload, size_t length, bool retained) override
+  {
+    return client.publish(topic, payload, length, retained);
+  }
+
+  void loop() override { client.loop(); }
+};
+
+static PubSubBrokerClient brokerClient;
+static MqttSession session(
+    brokerClient,
+    []() -> uint32_t
+    { return millis(); },
+    []() -> uint32_t
+    { return esp_random(); });
+
+void loadMQTT(const char *mqttServer, int mqttPort, const char *mqttClientId, const char *mqttUsername, const char *mqttPassword,
+              void (*callback)(char *topic, uint8_t *payload, unsigned int length))
 {
   espClient.setInsecure();
+  espClient.setHandshakeTimeout(MQTT_HANDSHAKE_TIMEOUT_S);
   client.setServer(mqttServer, mqttPort);
+  client.setSocketTimeout(MQTT_SOCKET_TIMEOUT_S);
+  client.setBufferSize(MQTT_PACKET_BUFFER_SIZE);
   client.setCallback(callback);
+
+  brokerClient.clientId = mqttClientId;
+  brokerClient.username = mqttUsername;
+  brokerClient.password = mqttPassword;
+
+  char subscription[MqttSession::TOPIC_SIZE];
+  snprintf(subscription, sizeof(subscription), "%s/#", mqttClientId);
+  session.setSubscription(subscription);
 }
 
-void loopMQTT(const char *mqttClientId, const char *mqttUsername, const char *mqttPassword, String mqttTopics[], int topicCount)
+void setMQTTConnectCallback(void (*callback)())
 {
-  while (!client.connected())
-  {
-    if (client.connect(mqttClientId, mqttUsername, mqttPassword))
-    {
-      for (int i = 0; i < topicCount; i++)
-      {
-        client.subscribe(mqttTopics[i].c_str());
-      }
-    }
-    else
-    {
-      delay(5000);
-    }
-  }
+  session.setConnectCallback(callback);
+}
+
+void loopMQTT()
+{
+  session.loop();
+}
+
+bool isMQTTConnected()
+{
+  return session.getState() == MQTT_STATE_CONNECTED;
+}
 
-  client.loop();
+const MqttSessionStats &getMQTTStats()
+{
+  return session.getStats();
 }
 
-void publishMQTT(const char *topic, uint8_t *payload, unsigned int length) {
-  client.publish(topic, payload, length);
-}
\ No newline at end of file
+bool publishMQTT(const char *topic, const uint8_t *payload, unsigned int length, bool retained, uint8_t qos) {
+  return session.publish(topic, payload, length, qos, retained);
+}
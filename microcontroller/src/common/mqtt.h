@@ -2,26 +2,50 @@
 #define MQTT_H
 
 #include <PubSubClient.h>
+#include "mqtt_data.h"
+#include "topic_router.h"
+#include "mqtt_session.h"
+
+static const size_t MQTT_MESSAGE_BUFFER_SIZE = 256;
+// Whole packets (header, topic and payload) the client can send or receive; PubSubClient defaults to
+// 256 B and silently drops larger publishes, such as the metric snapshots.
+static const uint16_t MQTT_PACKET_BUFFER_SIZE = 768;
 
 /**
- * Loads the MQTT client (REQUIRED AT THE START).
+ * Loads the MQTT client and subscribes to "<mqttClientId>/#" on every connection (REQUIRED AT THE START).
  *
  * @param mqttServer The MQTT server address.
  * @param mqttPort The MQTT server port.
+ * @param mqttClientId A unique MQTT client ID (the device unique ID).
+ * @param mqttUsername The MQTT username.
+ * @param mqttPassword The MQTT password.
  * @param callback A function to call whenever a new message arrives.
  */
-void loadMQTT(const char *mqttServer, int mqttPort, void (*callback)(char *topic, uint8_t *payload, unsigned int length));
+void loadMQTT(const char *mqttServer, int mqttPort, const char *mqttClientId, const char *mqttUsername, const char *mqttPassword,
+              void (*callback)(char *topic, uint8_t *payload, unsigned int length));
 
 /**
- * Loops the MQTT client (REQUIRED IN THE LOOP).
+ * Sets a function to call every time the client (re)connects, after subscribing.
  *
- * @param mqttClientId A unique MQTT client ID.
- * @param mqttUsername The MQTT username.
- * @param mqttPassword The MQTT password.
- * @param mqttTopics The MQTT topics to subscribe to.
- * @param topicCount The number of topics to subscribe to.
+ * @param callback The function to call.
+ */
+void setMQTTConnectCallback(void (*callback)());
+
+/**
+ * Loops the MQTT client (REQUIRED IN THE LOOP). Never waits for the broker: while disconnected,
+ * connection attempts are spaced with jittered exponential backoff.
+ */
+void loopMQTT();
+
+/**
+ * Whether the client is connected to the broker.
  */
-void loopMQTT(const char *mqttClientId, const char *mqttUsername, const char *mqttPassword, String mqttTopics[], int topicCount);
+bool isMQTTConnected();
+
+/**
+ * Returns the connection and publish counters.
+ */
+const MqttSessionStats &getMQTTStats();
 
 /**
  * Publish a message to MQTT.
@@ -29,7 +53,37 @@ void loopMQTT(const char *mqttClientId, const char *mqttUsername, const char *mq
  * @param topic The topic to publish the message.
  * @param payload The message payload to publish.
  * @param length The message payload length to publish.
+ * @param retained Whether the broker should keep the message for future subscribers.
+ * @param qos 1 to queue the message and replay it once reconnected, 0 to drop it while disconnected.
+ * @return Whether the message was handed to the client (or queued).
+ */
+bool publishMQTT(const char *topic, const uint8_t *payload, unsigned int length, bool retained = false, uint8_t qos = 0);
+
+/**
+ * Publish a message to another node, in the wire format of its topic (see formatForTopic()).
+ *
+ * @param nodeId The ID of the node receiving the message.
+ * @param data The message to publish.
+ * @param qos 1 to queue the message while disconnected, 0 to drop it.
+ * @return Whether the message was encoded and handed to the client.
  */
-void publishMQTT(const char *topic, uint8_t *payload, unsigned int length);
+template <typename T>
+bool publishMessage(const char *nodeId, const T &data, uint8_t qos = 1)
+{
+  char topic[topicSize(T::TOPIC)];
+  if (buildTopic(topic, sizeof(topic), nodeId, T::TOPIC) == 0)
+  {
+    return false;
+  }
+
+  uint8_t payload[MQTT_MESSAGE_BUFFER_SIZE];
+  size_t length = encodeMessage(data, formatForTopic(T::TOPIC), payload, sizeof(payload));
+  if (length == 0)
+  {
+    return false;
+  }
+
+  return publishMQTT(topic, payload, length, false, qos);
+}
 
 #endif
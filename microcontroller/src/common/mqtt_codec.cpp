@@ -0,0 +1,42 @@
+#include <string.h>
+#include "mqtt_codec.h"
+#include "mqtt_data.h"
+
+struct TopicFormat
+{
+  const char *topic;
+  MqttFormat format;
+};
+
+// Every message type our nodes publish to each other; the app only publishes JSON.
+static TopicFormat topicFormats[] = {
+    {BuzzerData::TOPIC, MQTT_FORMAT_BINARY},
+    {OledData::TOPIC, MQTT_FORMAT_BINARY},
+    {UltrasonicData::TOPIC, MQTT_FORMAT_BINARY},
+    {FingerprintData::TOPIC, MQTT_FORMAT_BINARY},
+};
+
+MqttFormat formatForTopic(const char *topic)
+{
+  for (const TopicFormat &entry : topicFormats)
+  {
+    if (strcmp(entry.topic, topic) == 0)
+    {
+      return entry.format;
+    }
+  }
+  return MQTT_FORMAT_JSON;
+}
+
+bool setTopicFormat(const char *topic, MqttFormat format)
+{
+  for (TopicFormat &entry : topicFormats)
+  {
+    if (strcmp(entry.topic, topic) == 0)
+    {
+      entry.format = format;
+      return true;
+    }
+  }
+  return false;
+}
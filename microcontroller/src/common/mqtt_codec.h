@@ -0,0 +1,177 @@
+#ifndef MQTT_CODEC_H
+#define MQTT_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Binary messages start with a magic byte that can never start a JSON document ('{' is 0x7B),
+// so receivers can accept both formats on every topic.
+// Layout: magic, version, message type, then the message fields (little-endian integers,
+// strings as a length byte followed by the bytes and a NUL terminator).
+static const uint8_t MQTT_BINARY_MAGIC = 0xB7;
+// 2: FingerprintData carries the enrollment stage and error. 3: and the touch age. 4: and the user table hash.
+static const uint8_t MQTT_BINARY_VERSION = 4;
+static const size_t MQTT_BINARY_HEADER_SIZE = 3;
+
+enum MqttFormat : uint8_t
+{
+  MQTT_FORMAT_JSON,
+  MQTT_FORMAT_BINARY
+};
+
+enum MqttMessageType : uint8_t
+{
+  MQTT_BUZZER_MESSAGE = 1,
+  MQTT_OLED_MESSAGE = 2,
+  MQTT_ULTRASONIC_MESSAGE = 3,
+  MQTT_FINGERPRINT_MESSAGE = 4
+};
+
+class BinaryWriter
+{
+public:
+  BinaryWriter(uint8_t *out, size_t size) : out(out), size(size) {}
+
+  void header(MqttMessageType type)
+  {
+    writeU8(MQTT_BINARY_MAGIC);
+    writeU8(MQTT_BINARY_VERSION);
+    writeU8(type);
+  }
+
+  void writeU8(uint8_t value)
+  {
+    if (reserve(1))
+      out[len++] = value;
+  }
+
+  void writeU32(uint32_t value)
+  {
+    if (!reserve(4))
+      return;
+    for (int i = 0; i < 4; i++)
+      out[len++] = (uint8_t)(value >> (8 * i));
+  }
+
+  void writeString(const char *value)
+  {
+    size_t n = value ? strlen(value) : 0;
+    if (n > UINT8_MAX || !reserve(n + 2))
+    {
+      overflow = true;
+      return;
+    }
+    out[len++] = (uint8_t)n;
+    memcpy(out + len, value, n);
+    len += n;
+    out[len++] = '\0';
+  }
+
+  /**
+   * @return The encoded length, 0 if the message did not fit.
+   */
+  size_t length() const { return overflow ? 0 : len; }
+
+private:
+  uint8_t *out;
+  size_t size;
+  size_t len = 0;
+  bool overflow = false;
+
+  bool reserve(size_t n)
+  {
+    if (overflow || len + n > size)
+    {
+      overflow = true;
+      return false;
+    }
+    return true;
+  }
+};
+
+class BinaryReader
+{
+public:
+  BinaryReader(const uint8_t *in, size_t size) : in(in), size(size) {}
+
+  /**
+   * Reads the header and checks it against the expected message type.
+   */
+  bool header(MqttMessageType type)
+  {
+    return readU8() == MQTT_BINARY_MAGIC && readU8() == MQTT_BINARY_VERSION && readU8() == type;
+  }
+
+  uint8_t readU8()
+  {
+    return available(1) ? in[pos++] : 0;
+  }
+
+  uint32_t readU32()
+  {
+    if (!available(4))
+      return 0;
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+      value |= (uint32_t)in[pos++] << (8 * i);
+    return value;
+  }
+
+  /**
+   * Returns the string in place (no copy), valid for as long as the payload is.
+   */
+  const char *readString()
+  {
+    uint8_t n = readU8();
+    if (!available((size_t)n + 1) || in[pos + n] != '\0')
+    {
+      failed = true;
+      return "";
+    }
+    const char *value = (const char *)(in + pos);
+    pos += n + 1;
+    return value;
+  }
+
+  bool ok() const { return !failed; }
+
+private:
+  const uint8_t *in;
+  size_t size;
+  size_t pos = 0;
+  bool failed = false;
+
+  bool available(size_t n)
+  {
+    if (failed || pos + n > size)
+    {
+      failed = true;
+      return false;
+    }
+    return true;
+  }
+};
+
+/**
+ * Whether a payload is in the binary format.
+ */
+inline bool isBinaryMessage(const uint8_t *payload, size_t length)
+{
+  return length >= MQTT_BINARY_HEADER_SIZE && payload[0] == MQTT_BINARY_MAGIC;
+}
+
+/**
+ * Returns the format to publish a topic with (the topic without the device prefix).
+ * Topics only exchanged between our nodes use the binary format, anything else stays JSON for the app.
+ */
+MqttFormat formatForTopic(const char *topic);
+
+/**
+ * Overrides the format used to publish a topic (the topic without the device prefix).
+ *
+ * @return Whether the topic is known.
+ */
+bool setTopicFormat(const char *topic, MqttFormat format);
+
+#endif
@@ -2,12 +2,16 @@
 #define MQTT_DATA_H
 
 #include <ArduinoJson.h>
+#include "mqtt_codec.h"
 
 enum FingerprintDataType : int
 {
   FINGERPRINT_REGISTRATION = 0,
   FINGERPRINT_UPDATE = 1,
-  FINGERPRINT_TOUCH = 2
+  FINGERPRINT_TOUCH = 2,
+  FINGERPRINT_CANCEL = 3,
+  FINGERPRINT_SYNC = 4,
+  FINGERPRINT_PROGRESS = 5 // Enrollment stage or error (FingerprintStage, FingerprintError).
 };
 
 struct BuzzerData
@@ -17,10 +21,11 @@ private:
 
 public:
   static constexpr const char *TOPIC = "sensor/buzzer";
+  static constexpr const MqttMessageType MESSAGE_TYPE = MQTT_BUZZER_MESSAGE;
 
   uint32_t duration = DEFAULT_DURATION;
 
-  BuzzerData(uint32_t d) : duration(d) {}
+  BuzzerData(uint32_t d = DEFAULT_DURATION) : duration(d) {}
 
   static BuzzerData fromJson(const JsonDocument &doc)
   {
@@ -32,38 +37,78 @@ public:
   {
     doc["duration"] = duration;
   }
+
+  static BuzzerData fromBinary(BinaryReader &reader)
+  {
+    return {
+        reader.readU32()};
+  }
+
+  void toBinary(BinaryWriter &writer) const
+  {
+    writer.writeU32(duration);
+  }
 };
 
 struct OledData
 {
   static constexpr const char *TOPIC = "sensor/oled";
+  static constexpr const MqttMessageType MESSAGE_TYPE = MQTT_OLED_MESSAGE;
 
   const char *message;
   bool isQrCode;
+  const char *qrData;
+  uint32_t duration;
 
-  OledData(const char *m, bool q) : message(m), isQrCode(q) {}
+  OledData(const char *m = "", bool q = false, const char *qr = "", uint32_t d = 0) : message(m), isQrCode(q), qrData(qr), duration(d) {}
 
+  // Also accepts the side-by-side layout ({"layout", "qrData", "textData"}) sent by older nodes.
   static OledData fromJson(const JsonDocument &doc)
   {
+    bool hasLayout = !doc["layout"].isNull();
     return {
-        doc["message"] | "",
-        doc["isQrCode"] | false};
+        hasLayout ? doc["textData"] | "" : doc["message"] | "",
+        doc["isQrCode"] | hasLayout,
+        doc["qrData"] | "",
+        doc["duration"] | 0u};
   }
 
   void toJson(JsonDocument &doc) const
   {
     doc["message"] = message;
     doc["isQrCode"] = isQrCode;
+    if (isQrCode)
+      doc["qrData"] = qrData;
+    if (duration > 0)
+      doc["duration"] = duration;
+  }
+
+  static OledData fromBinary(BinaryReader &reader)
+  {
+    uint8_t flags = reader.readU8();
+    uint32_t duration = reader.readU32();
+    const char *message = reader.readString();
+    const char *qrData = reader.readString();
+    return {message, (flags & 1) != 0, qrData, duration};
+  }
+
+  void toBinary(BinaryWriter &writer) const
+  {
+    writer.writeU8(isQrCode ? 1 : 0);
+    writer.writeU32(duration);
+    writer.writeString(message);
+    writer.writeString(isQrCode ? qrData : "");
   }
 };
 
 struct UltrasonicData
 {
   static constexpr const char *TOPIC = "sensor/ultrasonic";
+  static constexpr const MqttMessageType MESSAGE_TYPE = MQTT_ULTRASONIC_MESSAGE;
 
   bool isClose;
 
-  UltrasonicData(bool c) : isClose(c) {}
+  UltrasonicData(bool c = false) : isClose(c) {}
 
   static UltrasonicData fromJson(const JsonDocument &doc)
   {
@@ -75,24 +120,47 @@ struct UltrasonicData
   {
     doc["isClose"] = isClose;
   }
+
+  static UltrasonicData fromBinary(BinaryReader &reader)
+  {
+    return {
+        reader.readU8() != 0};
+  }
+
+  void toBinary(BinaryWriter &writer) const
+  {
+    writer.writeU8(isClose ? 1 : 0);
+  }
 };
 
 struct FingerprintData
 {
   static constexpr const char *TOPIC = "sensor/fingerprint";
+  static constexpr const MqttMessageType MESSAGE_TYPE = MQTT_FINGERPRINT_MESSAGE;
 
   FingerprintDataType type;
   const char *userId;
   bool isNew;
+  uint8_t stage;  // FINGERPRINT_PROGRESS only.
+  uint8_t error;  // FINGERPRINT_PROGRESS only.
+  uint32_t ageMs; // FINGERPRINT_TOUCH only: from the touch to the message being sent.
+  // FINGERPRINT_SYNC only: hash of the WROOM's user table (hashUserId()). A sync with no user ends the
+  // table, and the WROVER sends it back once every user of the table is in Firestore.
+  uint32_t tableHash;
 
-  FingerprintData(FingerprintDataType t, const char *i = "", bool n = false) : type(t), userId(i), isNew(n) {}
+  FingerprintData(FingerprintDataType t = FINGERPRINT_REGISTRATION, const char *i = "", bool n = false, uint8_t s = 0, uint8_t e = 0, uint32_t a = 0, uint32_t h = 0)
+      : type(t), userId(i), isNew(n), stage(s), error(e), ageMs(a), tableHash(h) {}
 
   static FingerprintData fromJson(const JsonDocument &doc)
   {
     return {
         static_cast<FingerprintDataType>(doc["type"] | 0),
         doc["userId"] | "",
-        doc["isNew"] | false};
+        doc["isNew"] | false,
+        doc["stage"] | (uint8_t)0,
+        doc["error"] | (uint8_t)0,
+        doc["ageMs"] | (uint32_t)0,
+        doc["tableHash"] | (uint32_t)0};
   }
 
   void toJson(JsonDocument &doc) const
@@ -100,9 +168,104 @@ struct FingerprintData
     doc["type"] = type;
     doc["userId"] = userId;
     doc["isNew"] = isNew;
+    if (type == FINGERPRINT_PROGRESS)
+    {
+      doc["stage"] = stage;
+      doc["error"] = error;
+    }
+    if (type == FINGERPRINT_TOUCH)
+    {
+      doc["ageMs"] = ageMs;
+    }
+    if (type == FINGERPRINT_SYNC)
+    {
+      doc["tableHash"] = tableHash;
+    }
+  }
+
+  static FingerprintData fromBinary(BinaryReader &reader)
+  {
+    FingerprintDataType type = static_cast<FingerprintDataType>(reader.readU8());
+    bool isNew = reader.readU8() != 0;
+    const char *userId = reader.readString();
+    uint8_t stage = reader.readU8();
+    uint8_t error = reader.readU8();
+    uint32_t ageMs = reader.readU32();
+    return {type, userId, isNew, stage, error, ageMs, reader.readU32()};
+  }
+
+  void toBinary(BinaryWriter &writer) const
+  {
+    writer.writeU8(static_cast<uint8_t>(type));
+    writer.writeU8(isNew ? 1 : 0);
+    writer.writeString(userId);
+    writer.writeU8(stage);
+    writer.writeU8(error);
+    writer.writeU32(ageMs);
+    writer.writeU32(tableHash);
   }
 };
 
-static const char *TAKE_PHOTO_TOPIC = "sensor/camera/take_photo";
+static constexpr const char *TAKE_PHOTO_TOPIC = "sensor/camera/take_photo";
+// Enrollment progress for the app (FingerprintData of type FINGERPRINT_PROGRESS, JSON).
+static constexpr const char *ENROLLMENT_PROGRESS_TOPIC = "fingerprint/progress";
+// Published by the app once the device is claimed.
+static constexpr const char *OWNER_TOPIC = "owner";
+
+/**
+ * Encodes a message in the given format.
+ *
+ * @param data The message.
+ * @param format The wire format.
+ * @param out The output buffer.
+ * @param size The output buffer size.
+ * @return The encoded length, 0 if the message did not fit.
+ */
+template <typename T>
+size_t encodeMessage(const T &data, MqttFormat format, uint8_t *out, size_t size)
+{
+  if (format == MQTT_FORMAT_BINARY)
+  {
+    BinaryWriter writer(out, size);
+    writer.header(T::MESSAGE_TYPE);
+    data.toBinary(writer);
+    return writer.length();
+  }
+
+  JsonDocument doc;
+  data.toJson(doc);
+  size_t len = measureJson(doc);
+  return len <= size ? serializeJson(doc, out, size) : 0;
+}
+
+/**
+ * Decodes a message in either format. Strings point into the payload (binary) or into doc (JSON).
+ *
+ * @param payload The message payload.
+ * @param length The message payload length.
+ * @param doc The document used to parse JSON payloads.
+ * @param out The decoded message.
+ * @return Whether decoded successfully.
+ */
+template <typename T>
+bool decodeMessage(const uint8_t *payload, size_t length, JsonDocument &doc, T &out)
+{
+  if (isBinaryMessage(payload, length))
+  {
+    BinaryReader reader(payload, length);
+    if (!reader.header(T::MESSAGE_TYPE))
+      return false;
+    T data = T::fromBinary(reader);
+    if (!reader.ok())
+      return false;
+    out = data;
+    return true;
+  }
+
+  if (deserializeJson(doc, payload, length))
+    return false;
+  out = T::fromJson(doc);
+  return true;
+}
 
 #endif
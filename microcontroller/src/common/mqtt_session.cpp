@@ -0,0 +1,132 @@
+#include <string.h>
+#include "mqtt_session.h"
+
+void MqttSession::setSubscription(const char *topic)
+{
+  strncpy(subscription, topic, sizeof(subscription) - 1);
+  subscription[sizeof(subscription) - 1] = '\0';
+}
+
+void MqttSession::loop()
+{
+  switch (state)
+  {
+  case MQTT_STATE_CONNECTED:
+    client.loop();
+    if (client.connected())
+    {
+      replayPending();
+      return;
+    }
+    stats.disconnects++;
+    attempt = 0;
+    scheduleReconnect();
+    return;
+
+  case MQTT_STATE_BACKOFF:
+    if (clockMs() - backoffStartMs < backoffMs)
+    {
+      return;
+    }
+    tryConnect();
+    return;
+
+  case MQTT_STATE_DISCONNECTED:
+    tryConnect();
+    return;
+  }
+}
+
+bool MqttSession::publish(const char *topic, const uint8_t *payload, size_t length, uint8_t qos, bool retained)
+{
+  // QoS 1 messages wait behind the queued ones so that they keep their order.
+  bool canSendNow = state == MQTT_STATE_CONNECTED && (qos == 0 || pendingCount == 0);
+  if (canSendNow && client.publish(topic, payload, length, retained))
+  {
+    stats.published++;
+    return true;
+  }
+
+  if (qos == 0)
+  {
+    stats.dropped++;
+    return false;
+  }
+  return enqueue(topic, payload, length, retained);
+}
+
+void MqttSession::tryConnect()
+{
+  if (!client.connect())
+  {
+    stats.connectFailures++;
+    scheduleReconnect();
+    return;
+  }
+
+  state = MQTT_STATE_CONNECTED;
+  attempt = 0;
+  stats.connects++;
+
+  if (subscription[0] != '\0')
+  {
+    client.subscribe(subscription);
+  }
+  if (connectCallback)
+  {
+    connectCallback();
+  }
+  replayPending();
+}
+
+void MqttSession::scheduleReconnect()
+{
+  // "Equal jitter": wait between half and all of the exponential ceiling, so nodes that lost
+  // the broker together do not reconnect in lockstep.
+  uint32_t shift = attempt < 16 ? attempt : 16;
+  uint64_t ceiling = (uint64_t)baseBackoffMs << shift;
+  if (ceiling > maxBackoffMs)
+  {
+    ceiling = maxBackoffMs;
+  }
+  uint32_t half = (uint32_t)(ceiling / 2);
+
+  backoffMs = half + random() % ((uint32_t)ceiling - half + 1);
+  backoffStartMs = clockMs();
+  stats.lastBackoffMs = backoffMs;
+  attempt++;
+  state = MQTT_STATE_BACKOFF;
+}
+
+bool MqttSession::enqueue(const char *topic, const uint8_t *payload, size_t length, bool retained)
+{
+  if (pendingCount == QUEUE_DEPTH || length > PAYLOAD_SIZE || strlen(topic) >= TOPIC_SIZE)
+  {
+    stats.dropped++;
+    return false;
+  }
+
+  PendingMessage &message = pending[(pendingHead + pendingCount) % QUEUE_DEPTH];
+  strcpy(message.topic, topic);
+  memcpy(message.payload, payload, length);
+  message.length = length;
+  message.retained = retained;
+  pendingCount++;
+  stats.queued++;
+  return true;
+}
+
+void MqttSession::replayPending()
+{
+  while (pendingCount > 0 && state == MQTT_STATE_CONNECTED)
+  {
+    const PendingMessage &message = pending[pendingHead];
+    if (!client.publish(message.topic, message.payload, message.length, message.retained))
+    {
+      return;
+    }
+    pendingHead = (pendingHead + 1) % QUEUE_DEPTH;
+    pendingCount--;
+    stats.replayed++;
+  }
+}
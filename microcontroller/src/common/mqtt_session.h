@@ -0,0 +1,123 @@
+#ifndef MQTT_SESSION_H
+#define MQTT_SESSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum MqttState : uint8_t
+{
+  MQTT_STATE_DISCONNECTED, // Not connected, next loop() attempts to connect.
+  MQTT_STATE_BACKOFF,      // Waiting before the next connection attempt.
+  MQTT_STATE_CONNECTED
+};
+
+/**
+ * The broker connection driven by MqttSession. The device wraps PubSubClient, host tests can script a fake broker.
+ */
+class MqttBrokerClient
+{
+public:
+  virtual ~MqttBrokerClient() {}
+
+  virtual bool connect() = 0;
+  virtual bool connected() = 0;
+  virtual bool subscribe(const char *topic) = 0;
+  virtual bool publish(const char *topic, const uint8_t *payload, size_t length, bool retained) = 0;
+  virtual void loop() = 0;
+};
+
+struct MqttSessionStats
+{
+  uint32_t connects = 0;
+  uint32_t connectFailures = 0;
+  uint32_t disconnects = 0;
+  uint32_t published = 0;
+  uint32_t queued = 0;   // QoS 1 messages held back while disconnected.
+  uint32_t replayed = 0; // Queued messages published after reconnecting.
+  uint32_t dropped = 0;  // QoS 0 messages published while disconnected, or messages that did not fit the queue.
+  uint32_t lastBackoffMs = 0;
+};
+
+/**
+ * Connection state machine around an MQTT client. loop() never waits: reconnection attempts are spaced
+ * with jittered exponential backoff, and QoS 1 publishes made while disconnected are queued and replayed
+ * in order once connected. QoS 0 publishes are dropped while disconnected.
+ */
+class MqttSession
+{
+public:
+  static const size_t QUEUE_DEPTH = 8;
+  static const size_t TOPIC_SIZE = 64;
+  static const size_t PAYLOAD_SIZE = 256;
+
+  /**
+   * @param client The broker connection.
+   * @param clockMs Returns the time in milliseconds.
+   * @param random Returns a random number (used for the backoff jitter).
+   * @param baseBackoffMs The backoff ceiling after the first failure.
+   * @param maxBackoffMs The maximum backoff ceiling.
+   */
+  MqttSession(MqttBrokerClient &client, uint32_t (*clockMs)(), uint32_t (*random)(), uint32_t baseBackoffMs = 1000, uint32_t maxBackoffMs = 60000)
+      : client(client), clockMs(clockMs), random(random), baseBackoffMs(baseBackoffMs), maxBackoffMs(maxBackoffMs) {}
+
+  /**
+   * Sets the topic filter subscribed to after every connection (e.g. "<id>/#").
+   */
+  void setSubscription(const char *topic);
+
+  /**
+   * Sets a function to call every time the session (re)connects, after subscribing.
+   */
+  void setConnectCallback(void (*callback)()) { connectCallback = callback; }
+
+  /**
+   * Advances the state machine and services the client (REQUIRED IN THE LOOP).
+   */
+  void loop();
+
+  /**
+   * Publishes a message now, or queues it until reconnected when qos is 1.
+   *
+   * @return Whether the message was published or queued.
+   */
+  bool publish(const char *topic, const uint8_t *payload, size_t length, uint8_t qos = 0, bool retained = false);
+
+  MqttState getState() const { return state; }
+  size_t getPendingCount() const { return pendingCount; }
+  const MqttSessionStats &getStats() const { return stats; }
+
+private:
+  struct PendingMessage
+  {
+    char topic[TOPIC_SIZE];
+    uint8_t payload[PAYLOAD_SIZE];
+    size_t length;
+    bool retained;
+  };
+
+  MqttBrokerClient &client;
+  uint32_t (*clockMs)();
+  uint32_t (*random)();
+  uint32_t baseBackoffMs;
+  uint32_t maxBackoffMs;
+  void (*connectCallback)() = nullptr;
+
+  char subscription[TOPIC_SIZE] = "";
+  MqttState state = MQTT_STATE_DISCONNECTED;
+  uint32_t attempt = 0;
+  uint32_t backoffStartMs = 0;
+  uint32_t backoffMs = 0;
+
+  PendingMessage pending[QUEUE_DEPTH];
+  size_t pendingHead = 0;
+  size_t pendingCount = 0;
+
+  MqttSessionStats stats;
+
+  void tryConnect();
+  void scheduleReconnect();
+  bool enqueue(const char *topic, const uint8_t *payload, size_t length, bool retained);
+  void replayPending();
+};
+
+#endif
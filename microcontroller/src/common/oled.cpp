@@ -1,10 +1,11 @@
 #include <Adafruit_SSD1306.h>
 #include <QRCodeGFX.h>
 #include <Wire.h>
-#include <Ticker.h>
 #include <ArduinoJson.h>
 #include <common/oled.h>
-#include <common/utils.h>
+#include <common/frame_flusher.h>
+#include <common/bitmap_cache.h>
+#include <common/text_layout.h>
 
 #define SCREEN_WIDTH 128
 #define SCREEN_HEIGHT 64
@@ -15,53 +16,159 @@
 #define I2C_ADDRESS 0x3C
 #define CHAR_W 6
 #define CHAR_H 9
+#define MAX_LINES (SCREEN_HEIGHT / CHAR_H)
+#define I2C_CLOCK 400000
+// ESP32 Wire buffers 128 bytes per transaction, one goes to the control byte.
+#define I2C_DATA_CHUNK 64
+#define FRAME_INTERVAL_MS 50
+#define QR_PAGES (SCREEN_HEIGHT / 8)
+#define QR_CACHE_SIZE 4
 
 Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, RESET_PIN);
 QRCodeGFX qrcode(display);
 
-Ticker displayTimeoutTimer;
+// Writes column spans straight over I2C, as display() always sends the whole 1 KB frame.
+class Ssd1306Panel : public FramePanel
+{
+public:
+  size_t writeColumns(uint8_t page, uint8_t column, const uint8_t *data, size_t length) override
+  {
+    Wire.beginTransmission(I2C_ADDRESS);
+    Wire.write((uint8_t)0x00);
+    Wire.write((uint8_t)SSD1306_PAGEADDR);
+    Wire.write(page);
+    Wire.write(page);
+    Wire.write((uint8_t)SSD1306_COLUMNADDR);
+    Wire.write(column);
+    Wire.write((uint8_t)(column + length - 1));
+    Wire.endTransmission();
+    size_t bytes = 9;
+
+    for (size_t sent = 0; sent < length; sent += I2C_DATA_CHUNK)
+    {
+      size_t chunk = length - sent < I2C_DATA_CHUNK ? length - sent : I2C_DATA_CHUNK;
+      Wire.beginTransmission(I2C_ADDRESS);
+      Wire.write((uint8_t)0x40);
+      Wire.write(data + sent, chunk);
+      Wire.endTransmission();
+      bytes += chunk + 2;
+    }
+    return bytes;
+  }
+};
+
+static Ssd1306Panel panel;
+static FrameFlusher<SCREEN_WIDTH, SCREEN_HEIGHT> flusher(panel, FRAME_INTERVAL_MS);
+
+// Rendered QR codes (the right half of the frame), as the same ones are shown over and over.
+static BitmapCache<HALF_SCREEN_WIDTH * QR_PAGES, QR_CACHE_SIZE> qrCache;
+
+static bool isClearPending = false;
+static uint32_t clearAtMs = 0;
+
+static void showFor(int duration)
+{
+  flusher.request();
+  isClearPending = duration > 0;
+  clearAtMs = millis() + duration;
+}
 
 void drawTextArea(const char *text, int x, int y, int width, int height)
 {
   display.setTextSize(1);
   display.setTextColor(SSD1306_WHITE);
   display.setTextWrap(false);
-  display.setCursor(x, y);
 
-  wrapText(text, x, y, width, height, [=](const char *text, int lineOffset)
-           {
-    display.println(text);
-    display.setCursor(x, y + CHAR_H * lineOffset); });
+  TextLayout<MAX_LINES> layout;
+  size_t lineCount = layout.layout(text, width, height);
+  for (size_t i = 0; i < lineCount; i++)
+  {
+    const TextSpan &line = layout.getLine(i);
+    display.setCursor(x, y + CHAR_H * i);
+    display.write((const uint8_t *)line.text, line.length);
+  }
+  if (layout.isTruncated())
+  {
+    display.print("...");
+  }
 }
 
 bool loadOLED()
 {
   Wire.begin(SDA_PIN, SCL_PIN);
-  return display.begin(SSD1306_SWITCHCAPVCC, I2C_ADDRESS);
+  if (!display.begin(SSD1306_SWITCHCAPVCC, I2C_ADDRESS))
+  {
+    return false;
+  }
+  Wire.setClock(I2C_CLOCK);
+
+  // The panel RAM is undefined after a reset, so the first flush sends the whole frame.
+  flusher.invalidate();
+  display.clearDisplay();
+  flusher.request();
+  return true;
 }
 
-void clearDisplay()
+void loopOLED()
 {
-  display.clearDisplay();
-  display.display();
+  uint32_t now = millis();
+  if (isClearPending && (int32_t)(now - clearAtMs) >= 0)
+  {
+    isClearPending = false;
+    display.clearDisplay();
+    flusher.request();
+  }
+  flusher.loop(display.getBuffer(), now);
 }
 
-void displayText(const char *text, int duration)
+// The right half of the frame, where QR codes are drawn.
+static uint8_t *rightHalfRow(int page)
 {
-  display.clearDisplay();
+  return display.getBuffer() + page * SCREEN_WIDTH + HALF_SCREEN_WIDTH;
+}
 
-  display.setTextSize(1);
-  display.setTextColor(SSD1306_WHITE);
-  display.setCursor(0, 0);
-  display.println(text);
+static void drawQRCode(const char *qrCodeMsg)
+{
+  const auto *cached = qrCache.find(qrCodeMsg);
+  if (cached)
+  {
+    for (int page = 0; page < QR_PAGES; page++)
+    {
+      memcpy(rightHalfRow(page), cached->data + page * HALF_SCREEN_WIDTH, HALF_SCREEN_WIDTH);
+    }
+    return;
+  }
 
-  displayTimeoutTimer.detach();
-  display.display();
+  uint32_t start = micros();
+  qrcode.setBackgroundColor(WHITE).setScale(2);
+  qrcode.generateData(qrCodeMsg);
+  qrcode.draw(HALF_SCREEN_WIDTH, 0, false);
 
-  if (duration > 0)
+  uint8_t bitmap[HALF_SCREEN_WIDTH * QR_PAGES];
+  for (int page = 0; page < QR_PAGES; page++)
   {
-    displayTimeoutTimer.once_ms(duration, clearDisplay);
+    memcpy(bitmap + page * HALF_SCREEN_WIDTH, rightHalfRow(page), HALF_SCREEN_WIDTH);
   }
+  qrCache.insert(qrCodeMsg, bitmap, micros() - start);
+}
+
+const BitmapCacheStats &getQRCodeCacheStats()
+{
+  return qrCache.getStats();
+}
+
+const FrameFlusherStats &getOLEDStats()
+{
+  return flusher.getStats();
+}
+
+void displayText(const char *text, int duration)
+{
+  display.clearDisplay();
+
+  drawTextArea(text, 0, 0, SCREEN_WIDTH / CHAR_W, MAX_LINES);
+
+  showFor(duration);
 }
 
 void displayQRCode(const char *qrCodeMsg, const char *text, int duration)
@@ -70,15 +177,7 @@ void displayQRCode(const char *qrCodeMsg, const char *text, int duration)
 
   drawTextArea(text, 0, 0, HALF_SCREEN_WIDTH / CHAR_W, SCREEN_HEIGHT / CHAR_H);
 
-  qrcode.setBackgroundColor(WHITE).setScale(2);
-  qrcode.generateData(qrCodeMsg);
-  qrcode.draw(HALF_SCREEN_WIDTH, 0, false);
+  drawQRCode(qrCodeMsg);
 
-  displayTimeoutTimer.detach();
-  display.display();
-
-  if (duration > 0)
-  {
-    displayTimeoutTimer.once_ms(duration, clearDisplay);
-  }
+  showFor(duration);
 }
\ No newline at end of file
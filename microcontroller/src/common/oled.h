@@ -1,6 +1,9 @@
 #ifndef OLED_H
 #define OLED_H
 
+#include "frame_flusher.h"
+#include "bitmap_cache.h"
+
 /**
  * Loads the OLED display (REQUIRED AT THE START).
  *
@@ -9,7 +12,23 @@
 bool loadOLED();
 
 /**
- * Display text on the OLED display.
+ * Sends the changes drawn since the last call to the display, at most once per frame interval,
+ * and clears it once the display duration is over (REQUIRED IN THE LOOP).
+ */
+void loopOLED();
+
+/**
+ * Returns the flush counters (flushes, skipped identical frames, bytes sent).
+ */
+const FrameFlusherStats &getOLEDStats();
+
+/**
+ * Returns the QR code cache counters (hits, misses, render time saved).
+ */
+const BitmapCacheStats &getQRCodeCacheStats();
+
+/**
+ * Display text on the OLED display. Drawn now, sent by the next loopOLED().
  *
  * @param text The text to be displayed.
  * @param duration The duration to display the text (in milliseconds).
@@ -0,0 +1,140 @@
+#ifndef SCAN_POLICY_H
+#define SCAN_POLICY_H
+
+#include <stdint.h>
+
+/**
+ * Decides when to poll the fingerprint sensor. Scans run fast while someone is close, touched the
+ * sensor or kept a finger on it, and back off exponentially to the idle interval otherwise.
+ * When the sensor's touch line is wired, a touch makes the next check due straight away.
+ *
+ * A finger counts as one touch until it is lifted: a scan has to find the sensor empty before the
+ * next finger is reported, so a held finger does not ring the doorbell on every scan.
+ */
+class ScanPolicy
+{
+public:
+  /**
+   * @param fastMs The interval while someone is around.
+   * @param idleMs The longest interval when nobody is around.
+   * @param holdMs How long activity keeps the fast interval.
+   */
+  ScanPolicy(uint32_t fastMs = 100, uint32_t idleMs = 2000, uint32_t holdMs = 10000)
+      : fastMs(fastMs), idleMs(idleMs), holdMs(holdMs), intervalMs(idleMs) {}
+
+  /**
+   * Reports a touch on the sensor's touch line. Ignored while the last finger was not lifted.
+   *
+   * @param touchMs When the touch happened.
+   */
+  void onTouch(uint32_t touchMs)
+  {
+    if (!fingerHeld && !touchPending)
+    {
+      touchPending = true;
+      this->touchMs = touchMs;
+    }
+  }
+
+  /**
+   * Reports the ultrasonic proximity state.
+   */
+  void onProximity(bool isClose, uint32_t nowMs)
+  {
+    close = isClose;
+    markActivity(nowMs);
+  }
+
+  /**
+   * Whether a scan should run now.
+   *
+   * @param nowMs The time in milliseconds.
+   * @param triggerMs Set to when the trigger happened, to measure latency from: the touch, or else
+   * the last scan, as a finger found by polling may have been put down any time since (so the wait
+   * the interval adds is counted).
+   */
+  bool isDue(uint32_t nowMs, uint32_t &triggerMs)
+  {
+    if (touchPending)
+    {
+      touchPending = false;
+      triggerMs = touchMs;
+      markActivity(nowMs);
+      return true;
+    }
+    if (hasScanned && nowMs - lastScanMs < intervalMs)
+    {
+      return false;
+    }
+    triggerMs = hasScanned ? lastScanMs : nowMs;
+    return true;
+  }
+
+  /**
+   * Reports a finished scan and picks the next interval.
+   *
+   * @param fingerPresent Whether a finger was on the sensor.
+   * @return Whether it is a new finger (the sensor was found empty since the last one).
+   */
+  bool onScanned(bool fingerPresent, uint32_t nowMs)
+  {
+    lastScanMs = nowMs;
+    hasScanned = true;
+    if (fingerPresent)
+    {
+      markActivity(nowMs);
+    }
+
+    if (close || (hadActivity && nowMs - activityMs < holdMs))
+    {
+      intervalMs = fastMs;
+    }
+    else if (intervalMs < idleMs)
+    {
+      intervalMs = intervalMs * 2 < idleMs ? intervalMs * 2 : idleMs;
+    }
+
+    bool isNewFinger = fingerPresent && !fingerHeld;
+    fingerHeld = fingerPresent;
+    return isNewFinger;
+  }
+
+  /**
+   * Reports a scan that failed (the sensor did not answer), backing off towards the idle interval
+   * so a failing sensor is not polled at the fast rate. Whether a finger is held is left as it was.
+   */
+  void onError(uint32_t nowMs)
+  {
+    lastScanMs = nowMs;
+    hasScanned = true;
+    intervalMs = intervalMs * 2 < idleMs ? intervalMs * 2 : idleMs;
+  }
+
+  bool isFingerHeld() const { return fingerHeld; }
+  uint32_t getIntervalMs() const { return intervalMs; }
+
+private:
+  void markActivity(uint32_t nowMs)
+  {
+    hadActivity = true;
+    activityMs = nowMs;
+    intervalMs = fastMs;
+  }
+
+  uint32_t fastMs;
+  uint32_t idleMs;
+  uint32_t holdMs;
+
+  uint32_t intervalMs;
+  uint32_t lastScanMs = 0;
+  bool hasScanned = false;
+  uint32_t activityMs = 0;
+  bool hadActivity = false;
+  bool close = false;
+  bool fingerHeld = false;
+
+  bool touchPending = false;
+  uint32_t touchMs = 0;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef SCENARIO_RECORDER_H
+#define SCENARIO_RECORDER_H
+
+#include <stdint.h>
+#include "metrics.h"
+
+/**
+ * End-to-end latency of a user-visible scenario (e.g. "person close -> photo logged"), measured on
+ * the device. Its counters and latency are metrics, so they go out with the metric snapshots. The
+ * counts are cumulative: comparing started and completed across snapshots shows how the node keeps
+ * up as events get more frequent. Scenarios start on the MQTT task and finish on the pipeline tasks,
+ * which the metrics allow without a lock.
+ */
+class ScenarioRecorder
+{
+public:
+  /**
+   * @param startedName The counter of started scenarios (e.g. "doorbell_start").
+   * @param completedName The counter of completed ones.
+   * @param latencyName The histogram of their latency in milliseconds.
+   */
+  ScenarioRecorder(const char *startedName, const char *completedName, const char *latencyName)
+      : started(startedName), completed(completedName), latency(latencyName) {}
+
+  void start() { started.add(); }
+
+  /**
+   * @param latencyMs The time since the scenario started.
+   */
+  void finish(uint32_t latencyMs)
+  {
+    completed.add();
+    latency.record(latencyMs);
+  }
+
+  uint32_t getStarted() const { return started.get(); }
+  uint32_t getCompleted() const { return completed.get(); }
+  const MetricHistogram &getLatency() const { return latency; }
+
+  void reset()
+  {
+    started.reset();
+    completed.reset();
+    latency.reset();
+  }
+
+private:
+  MetricCounter started;
+  MetricCounter completed;
+  MetricHistogram latency;
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "scheduler.h"
+
+int Scheduler::addPeriodic(const char *name, TaskStep step, uint32_t periodMs, TaskPriority priority, uint32_t budgetUs)
+{
+  return addTask(name, step, periodMs * 1000, priority, budgetUs);
+}
+
+int Scheduler::addEvent(const char *name, TaskStep step, TaskPriority priority, uint32_t budgetUs)
+{
+  return addTask(name, step, 0, priority, budgetUs);
+}
+
+int Scheduler::addTask(const char *name, TaskStep step, uint32_t periodUs, TaskPriority priority, uint32_t budgetUs)
+{
+  if (taskCount == MAX_TASKS)
+  {
+    return -1;
+  }
+
+  Task &task = tasks[taskCount];
+  task.name = name;
+  task.step = step;
+  task.periodUs = periodUs;
+  task.priority = priority;
+  task.budgetUs = budgetUs;
+  task.deadlineUs = clockUs();
+  task.resuming = false;
+  return taskCount++;
+}
+
+void Scheduler::notify(int id)
+{
+  if (id < 0 || (size_t)id >= taskCount)
+  {
+    return;
+  }
+  // Only the first notification sets the time, so jitter covers the whole wait.
+  if (!tasks[id].notified.load())
+  {
+    tasks[id].notifiedAtUs.store(clockUs());
+  }
+  tasks[id].notified.store(true);
+}
+
+bool Scheduler::isDue(Task &task, uint32_t now) const
+{
+  if (task.resuming)
+  {
+    return true;
+  }
+  if (task.periodUs == 0)
+  {
+    return task.notified.load();
+  }
+  return (int32_t)(now - task.deadlineUs) >= 0;
+}
+
+size_t Scheduler::loop()
+{
+  bool ran[MAX_TASKS] = {};
+  size_t runCount = 0;
+
+  for (;;)
+  {
+    uint32_t now = clockUs();
+
+    // Most urgent due task: highest priority first, then earliest deadline.
+    int best = -1;
+    for (size_t i = 0; i < taskCount; i++)
+    {
+      Task &task = tasks[i];
+      if (ran[i] || !isDue(task, now))
+      {
+        continue;
+      }
+      if (best < 0 || task.priority > tasks[best].priority ||
+          (task.priority == tasks[best].priority && (int32_t)(task.deadlineUs - tasks[best].deadlineUs) < 0))
+      {
+        best = i;
+      }
+    }
+    if (best < 0)
+    {
+      return runCount;
+    }
+
+    ran[best] = true;
+    run(tasks[best], now);
+    runCount++;
+  }
+}
+
+void Scheduler::run(Task &task, uint32_t now)
+{
+  bool isEvent = task.periodUs == 0;
+  if (isEvent && !task.resuming)
+  {
+    task.deadlineUs = task.notifiedAtUs.load();
+    task.notified.store(false);
+  }
+
+  uint32_t jitter = task.resuming ? 0 : now - task.deadlineUs;
+  uint32_t start = clockUs();
+  task.resuming = task.step();
+  uint32_t elapsed = clockUs() - start;
+
+  SchedulerTaskStats &stats = task.stats;
+  stats.runs++;
+  stats.lastRunUs = elapsed;
+  stats.totalRunUs += elapsed;
+  if (elapsed > stats.maxRunUs)
+  {
+    stats.maxRunUs = elapsed;
+  }
+  stats.lastJitterUs = jitter;
+  if (jitter > stats.maxJitterUs)
+  {
+    stats.maxJitterUs = jitter;
+  }
+
+  bool isOverBudget = task.budgetUs > 0 && elapsed > task.budgetUs;
+  bool missedPeriod = !isEvent && jitter >= task.periodUs;
+  if (isOverBudget || missedPeriod)
+  {
+    stats.overruns++;
+  }
+
+  if (!isEvent && !task.resuming)
+  {
+    // Keep the original phase, unless a whole period was missed.
+    task.deadlineUs += task.periodUs;
+    uint32_t after = clockUs();
+    if ((int32_t)(after - task.deadlineUs) >= 0)
+    {
+      task.deadlineUs = after + task.periodUs;
+    }
+  }
+}
+
+uint32_t Scheduler::getIdleUs(uint32_t maxUs) const
+{
+  uint32_t now = clockUs();
+  uint32_t idle = maxUs;
+  for (size_t i = 0; i < taskCount; i++)
+  {
+    const Task &task = tasks[i];
+    if (task.resuming || (task.periodUs == 0 && task.notified.load()))
+    {
+      return 0;
+    }
+    if (task.periodUs == 0)
+    {
+      continue;
+    }
+    int32_t untilDue = (int32_t)(task.deadlineUs - now);
+    if (untilDue <= 0)
+    {
+      return 0;
+    }
+    if ((uint32_t)untilDue < idle)
+    {
+      idle = untilDue;
+    }
+  }
+  return idle;
+}
@@ -0,0 +1,115 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+enum TaskPriority : uint8_t
+{
+  TASK_PRIORITY_LOW,
+  TASK_PRIORITY_NORMAL,
+  TASK_PRIORITY_HIGH
+};
+
+/**
+ * One step of a task.
+ *
+ * @return Whether the task has more work and should run again on the next pass (resumable tasks),
+ *         false once it is done until its next period or notification.
+ */
+typedef bool (*TaskStep)();
+
+struct SchedulerTaskStats
+{
+  uint32_t runs = 0;
+  uint32_t overruns = 0; // Runs over budget, or that started a whole period late.
+  uint32_t lastRunUs = 0;
+  uint32_t maxRunUs = 0;
+  uint64_t totalRunUs = 0;
+  uint32_t lastJitterUs = 0; // How late the run started compared to its deadline.
+  uint32_t maxJitterUs = 0;
+
+  uint32_t averageRunUs() const { return runs ? (uint32_t)(totalRunUs / runs) : 0; }
+};
+
+/**
+ * Cooperative scheduler: tasks run to completion (or to their next step) on the thread calling loop(),
+ * ordered by priority, then by deadline. Periodic tasks run every period, event tasks run after
+ * notify(), and a task returning true keeps running step by step on the next passes.
+ * The clock is injected so the scheduler can run on the host with a simulated clock.
+ */
+class Scheduler
+{
+public:
+  static const size_t MAX_TASKS = 8;
+
+  explicit Scheduler(uint32_t (*clockUs)()) : clockUs(clockUs) {}
+
+  /**
+   * Adds a task that runs every periodMs.
+   *
+   * @param name The task name (for stats).
+   * @param step The task function.
+   * @param periodMs The period in milliseconds.
+   * @param priority The priority among tasks due at the same time.
+   * @param budgetUs The expected maximum run time, 0 for none.
+   * @return The task ID, -1 if there is no room left.
+   */
+  int addPeriodic(const char *name, TaskStep step, uint32_t periodMs, TaskPriority priority = TASK_PRIORITY_NORMAL, uint32_t budgetUs = 0);
+
+  /**
+   * Adds a task that runs after each notify().
+   *
+   * @return The task ID, -1 if there is no room left.
+   */
+  int addEvent(const char *name, TaskStep step, TaskPriority priority = TASK_PRIORITY_NORMAL, uint32_t budgetUs = 0);
+
+  /**
+   * Makes an event task due. Safe to call from other tasks and interrupts (as long as the clock is).
+   */
+  void notify(int id);
+
+  /**
+   * Runs every due task once, most urgent first (REQUIRED IN THE LOOP).
+   *
+   * @return The number of tasks that ran.
+   */
+  size_t loop();
+
+  /**
+   * Returns how long the caller can sleep before the next periodic task is due (0 if something is due now).
+   *
+   * @param maxUs The maximum to return.
+   */
+  uint32_t getIdleUs(uint32_t maxUs) const;
+
+  size_t getTaskCount() const { return taskCount; }
+  const char *getTaskName(int id) const { return tasks[id].name; }
+  const SchedulerTaskStats &getTaskStats(int id) const { return tasks[id].stats; }
+
+private:
+  struct Task
+  {
+    const char *name;
+    TaskStep step;
+    uint32_t periodUs; // 0 for event tasks.
+    TaskPriority priority;
+    uint32_t budgetUs;
+    uint32_t deadlineUs;
+    std::atomic<bool> notified{false};
+    std::atomic<uint32_t> notifiedAtUs{0};
+    bool resuming;
+    SchedulerTaskStats stats;
+  };
+
+  uint32_t (*clockUs)();
+  Task tasks[MAX_TASKS];
+  size_t taskCount = 0;
+
+  int addTask(const char *name, TaskStep step, uint32_t periodUs, TaskPriority priority, uint32_t budgetUs);
+  bool isDue(Task &task, uint32_t now) const;
+  void run(Task &task, uint32_t now);
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+
+/**
+ * Lock-free ring buffer for exactly one producer and one consumer (e.g. an ISR and a task).
+ * Holds N - 1 items. N must be a power of two.
+ */
+template <typename T, size_t N>
+class SpscRing
+{
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+  /**
+   * Adds an item (producer side).
+   *
+   * @return Whether the item was added (false when full).
+   */
+  bool push(const T &item)
+  {
+    size_t head = headIndex.load(std::memory_order_relaxed);
+    size_t next = (head + 1) & (N - 1);
+    if (next == tailIndex.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    items[head] = item;
+    headIndex.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Removes the oldest item (consumer side).
+   *
+   * @return Whether an item was removed (false when empty).
+   */
+  bool pop(T &item)
+  {
+    size_t tail = tailIndex.load(std::memory_order_relaxed);
+    if (tail == headIndex.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    item = items[tail];
+    tailIndex.store((tail + 1) & (N - 1), std::memory_order_release);
+    return true;
+  }
+
+private:
+  T items[N];
+  std::atomic<size_t> headIndex{0};
+  std::atomic<size_t> tailIndex{0};
+};
+
+#endif
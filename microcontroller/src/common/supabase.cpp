@@ -1,10 +1,167 @@
-#include "ESPSupabase.h"
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include "supabase.h"
+#include "connections.h"
 
-Supabase supabase;
+#define REQUEST_HEAD_SIZE 1536
+#define TOKEN_REFRESH_MARGIN_MS 60000
+#define DEFAULT_TOKEN_LIFETIME_S 3600
+
+static SupabaseUploadStats lastUploadStats;
+
+static const char *supabaseURL = "";
+static char supabaseHost[SUPABASE_HOST_SIZE] = "";
+static const char *supabaseAnonKey = "";
+static const char *supabaseUsername = "";
+static const char *supabasePassword = "";
+static String supabaseAccessToken;
+static uint32_t tokenRefreshMs = 0;
+static char requestHead[REQUEST_HEAD_SIZE];
+
+// Signs in with the stored credentials and schedules the next sign in shortly before the token expires.
+static bool signIn()
+{
+  // The storage uploads authenticate with our own token, so we sign in directly instead of through the library.
+  // Signing in over the pooled connection also leaves a warm session for the next upload.
+  WiFiClientSecure *authClient = acquireConnection(supabaseHost);
+  if (!authClient)
+  {
+    return false;
+  }
+
+  HTTPClient https;
+  https.setReuse(true);
+  String url = supabaseURL;
+  url.concat("/auth/v1/token?grant_type=password");
+  if (!https.begin(*authClient, url))
+  {
+    releaseConnection(authClient, false);
+    return false;
+  }
+  https.addHeader("apikey", supabaseAnonKey);
+  https.addHeader("Content-Type", "application/json");
+
+  JsonDocument credentials;
+  credentials["email"] = supabaseUsername;
+  credentials["password"] = supabasePassword;
+  String body;
+  serializeJson(credentials, body);
+
+  int res = https.POST(body);
+  String token;
+  uint32_t lifetimeMs = DEFAULT_TOKEN_LIFETIME_S * 1000UL;
+  if (res == 200)
+  {
+    JsonDocument session;
+    deserializeJson(session, https.getString());
+    token = session["access_token"] | "";
+    lifetimeMs = (session["expires_in"] | DEFAULT_TOKEN_LIFETIME_S) * 1000UL;
+  }
+  https.end();
+  releaseConnection(authClient, res > 0);
+
+  if (res != 200 || token.length() == 0)
+  {
+    return false;
+  }
+  supabaseAccessToken = token;
+  tokenRefreshMs = millis() + (lifetimeMs > 2 * TOKEN_REFRESH_MARGIN_MS ? lifetimeMs - TOKEN_REFRESH_MARGIN_MS : lifetimeMs / 2);
+  return true;
+}
 
 bool loadSupabase(const char *projectURL, const char *anonKey, const char *username, const char *password)
 {
-  supabase.begin(projectURL, anonKey);
-  int res = supabase.login_email(username, password);
-  return res == 200;
+  if (!parseSupabaseHost(projectURL, supabaseHost, sizeof(supabaseHost)))
+  {
+    return false;
+  }
+  supabaseURL = projectURL;
+  supabaseAnonKey = anonKey;
+  supabaseUsername = username;
+  supabasePassword = password;
+
+  return signIn();
+}
+
+static uint32_t nowMs()
+{
+  return millis();
+}
+
+static void waitForSocket()
+{
+  delay(1);
+}
+
+static uint32_t freeHeap()
+{
+  return ESP.getFreeHeap();
+}
+
+static const RequestPlatform devicePlatform = {nowMs, waitForSocket, freeHeap};
+
+int uploadToSupabase(const char *bucket, const char *path, const char *mimeType, const uint8_t *data, size_t len, SupabaseUploadStats *stats)
+{
+  SupabaseUploadStats s;
+  uint32_t start = millis();
+  sampleRequestHeap(devicePlatform, s);
+
+  if ((int32_t)(millis() - tokenRefreshMs) >= 0)
+  {
+    signIn();
+  }
+
+  bool retriedSession = false;
+  bool retriedAuth = false;
+  for (;;)
+  {
+    if (buildUploadHead(requestHead, sizeof(requestHead), supabaseHost, supabaseAnonKey, supabaseAccessToken.c_str(),
+                        bucket, path, mimeType, len) == 0)
+    {
+      s.status = -1;
+      break;
+    }
+
+    bool reused = false;
+    uint32_t connectStart = millis();
+    WiFiClientSecure *client = acquireConnection(supabaseHost, 443, &reused);
+    if (!client)
+    {
+      s.status = -1;
+      break;
+    }
+    s.connectMs = millis() - connectStart;
+
+    streamRequest(*client, requestHead, data, len, devicePlatform, s);
+    releaseConnection(client, s.status > 0 && s.reusable);
+
+    // A kept-alive session may have been closed by the server in the meantime, so one retry on a fresh one.
+    if (s.status <= 0 && reused && !retriedSession)
+    {
+      retriedSession = true;
+      continue;
+    }
+    // The token was revoked or expired early, so one retry after signing in again.
+    if ((s.status == 401 || s.status == 403) && !retriedAuth && signIn())
+    {
+      retriedAuth = true;
+      continue;
+    }
+    break;
+  }
+
+  s.totalMs = millis() - start;
+  lastUploadStats = s;
+  if (stats)
+  {
+    *stats = s;
+  }
+  return s.status;
+}
+
+const SupabaseUploadStats &getSupabaseUploadStats()
+{
+  return lastUploadStats;
 }
@@ -1,12 +1,11 @@
 #ifndef SUPABASE_H
 #define SUPABASE_H
 
-#include "ESPSupabase.h"
-
-extern Supabase supabase;
+#include "supabase_request.h"
 
 /**
- * Loads the Supabase client (REQUIRED AT THE START).
+ * Loads the Supabase client and signs in (REQUIRED AT THE START). The access token is renewed
+ * before it expires, and after a 401/403 from storage.
  *
  * @param projectURL The Supabase project URL.
  * @param anonKey The Supabase project's anon key.
@@ -16,4 +15,23 @@ extern Supabase supabase;
  */
 bool loadSupabase(const char *projectURL, const char *anonKey, const char *username, const char *password);
 
-#endif
\ No newline at end of file
+/**
+ * Uploads a file to Supabase storage, writing the body straight from the given buffer to the
+ * socket in fixed-size chunks (no intermediate copy of the body is made).
+ *
+ * @param bucket The storage bucket.
+ * @param path The object path inside the bucket.
+ * @param mimeType The object content type.
+ * @param data The object bytes (e.g. a camera frame buffer).
+ * @param len The object length.
+ * @param stats Where to store the upload metrics (optional).
+ * @return The HTTP status code, negative on connection errors.
+ */
+int uploadToSupabase(const char *bucket, const char *path, const char *mimeType, const uint8_t *data, size_t len, SupabaseUploadStats *stats = nullptr);
+
+/**
+ * Returns the metrics of the last upload.
+ */
+const SupabaseUploadStats &getSupabaseUploadStats();
+
+#endif
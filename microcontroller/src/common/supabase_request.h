@@ -0,0 +1,171 @@
+#ifndef SUPABASE_REQUEST_H
+#define SUPABASE_REQUEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "http_response.h"
+
+#define UPLOAD_CHUNK_SIZE 1024
+#define UPLOAD_TIMEOUT_MS 15000
+
+// Longest project host name, including the terminator (the connection pool keeps as much).
+static const size_t SUPABASE_HOST_SIZE = 64;
+
+/**
+ * Metrics of the last streaming upload.
+ */
+struct SupabaseUploadStats
+{
+  int status = 0;          // HTTP status code (negative on connection errors).
+  size_t bytesSent = 0;    // Body bytes written to the socket.
+  uint32_t connectMs = 0;  // Time spent opening the TLS connection.
+  uint32_t ttfbMs = 0;     // Time from the first request byte to the first response byte.
+  uint32_t totalMs = 0;    // Time of the whole exchange.
+  uint32_t minFreeHeap = 0; // Lowest free heap observed while uploading (peak usage).
+  bool reusable = false;    // Whether the response was read to its end and the connection kept open.
+};
+
+/**
+ * What streamRequest() needs from the platform (millis(), delay(1) and ESP.getFreeHeap() on the device).
+ */
+struct RequestPlatform
+{
+  uint32_t (*nowMs)();
+  void (*idle)();          // Called while the socket is not ready.
+  uint32_t (*freeHeap)();
+};
+
+/**
+ * Extracts the host name from a project URL: "https://abc.supabase.co/" gives "abc.supabase.co".
+ * The scheme is optional; the host ends at the first '/' or ':'.
+ *
+ * @param projectURL The Supabase project URL.
+ * @param out The host buffer.
+ * @param size The buffer size.
+ * @return Whether a host was found and fits the buffer.
+ */
+inline bool parseSupabaseHost(const char *projectURL, char *out, size_t size)
+{
+  const char *scheme = strstr(projectURL, "://");
+  const char *host = scheme ? scheme + 3 : projectURL;
+  size_t length = strcspn(host, "/:");
+  if (length == 0 || length >= size)
+  {
+    return false;
+  }
+  memcpy(out, host, length);
+  out[length] = '\0';
+  return true;
+}
+
+/**
+ * Writes the request line and headers of a storage upload, without the final empty line.
+ *
+ * @return The head length, 0 if it did not fit.
+ */
+inline size_t buildUploadHead(char *out, size_t size, const char *host, const char *anonKey, const char *token,
+                              const char *bucket, const char *path, const char *mimeType, size_t len)
+{
+  int length = snprintf(out, size,
+                        "POST /storage/v1/object/%s/%s HTTP/1.1\r\n"
+                        "Host: %s\r\n"
+                        "apikey: %s\r\n"
+                        "Authorization: Bearer %s\r\n"
+                        "Content-Type: %s\r\n"
+                        "Content-Length: %u\r\n"
+                        "x-upsert: true\r\n"
+                        "Connection: keep-alive\r\n",
+                        bucket, path, host, anonKey, token, mimeType, (unsigned)len);
+  return length > 0 && (size_t)length < size ? (size_t)length : 0;
+}
+
+// Keeps the lowest free heap seen during an upload.
+inline void sampleRequestHeap(const RequestPlatform &platform, SupabaseUploadStats &stats)
+{
+  uint32_t freeHeap = platform.freeHeap();
+  if (stats.minFreeHeap == 0 || freeHeap < stats.minFreeHeap)
+  {
+    stats.minFreeHeap = freeHeap;
+  }
+}
+
+// Waits for response bytes until the deadline or the server closes the connection.
+template <typename Client>
+bool waitForResponseData(Client &client, const RequestPlatform &platform, uint32_t deadline)
+{
+  while (!client.available())
+  {
+    if (!client.connected() || (int32_t)(platform.nowMs() - deadline) >= 0)
+    {
+      return false;
+    }
+    platform.idle();
+  }
+  return true;
+}
+
+/**
+ * Streams an HTTP request with a body over an already connected client, in fixed-size chunks,
+ * and reads the response to its end (see HttpResponseReader). Used by uploadToSupabase().
+ *
+ * Client needs print(const char *), write(buf, len), available(), read() and connected()
+ * (WiFiClientSecure on the device).
+ *
+ * @param client The connected client.
+ * @param head The request line and headers, without the final empty line.
+ * @param data The body bytes.
+ * @param len The body length.
+ * @param platform The clock, idle wait and heap probe.
+ * @param stats Where to store the upload metrics.
+ * @return The HTTP status code, negative on errors.
+ */
+template <typename Client>
+int streamRequest(Client &client, const char *head, const uint8_t *data, size_t len, const RequestPlatform &platform, SupabaseUploadStats &stats)
+{
+  uint32_t start = platform.nowMs();
+  uint32_t deadline = start + UPLOAD_TIMEOUT_MS;
+  sampleRequestHeap(platform, stats);
+
+  client.print(head);
+  client.print("\r\n");
+
+  stats.bytesSent = 0;
+  while (stats.bytesSent < len)
+  {
+    size_t chunk = len - stats.bytesSent < UPLOAD_CHUNK_SIZE ? len - stats.bytesSent : UPLOAD_CHUNK_SIZE;
+    size_t written = client.write(data + stats.bytesSent, chunk);
+    if (written == 0)
+    {
+      if (!client.connected() || (int32_t)(platform.nowMs() - deadline) >= 0)
+      {
+        return stats.status = -2;
+      }
+      platform.idle();
+      continue;
+    }
+    stats.bytesSent += written;
+    sampleRequestHeap(platform, stats);
+  }
+
+  if (!waitForResponseData(client, platform, deadline))
+  {
+    return stats.status = -3;
+  }
+  stats.ttfbMs = platform.nowMs() - start;
+
+  // Reads up to the end of the body so a kept-alive connection is left at a message boundary.
+  HttpResponseReader response;
+  while (!response.isFinished() && waitForResponseData(client, platform, deadline))
+  {
+    response.feed((char)client.read());
+  }
+  stats.status = response.getStatus() > 0 ? response.getStatus() : -4;
+  stats.reusable = response.canReuse();
+
+  sampleRequestHeap(platform, stats);
+  return stats.status;
+}
+
+#endif
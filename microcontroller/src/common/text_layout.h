@@ -0,0 +1,140 @@
+#ifndef TEXT_LAYOUT_H
+#define TEXT_LAYOUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+static const size_t TEXT_ELLIPSIS_LENGTH = 3;
+
+/**
+ * A line of laid out text, pointing into the source string (not null-terminated).
+ */
+struct TextSpan
+{
+  const char *text;
+  size_t length;
+};
+
+/**
+ * Breaks text into lines of at most width characters, in a single pass and without copying.
+ * Lines break at spaces and on '\n', words longer than a line are split. When the text does not
+ * fit in maxLines, the last line is shortened to leave room for an ellipsis.
+ *
+ * @param text The text.
+ * @param width The line width in characters.
+ * @param lines The output lines.
+ * @param maxLines The maximum number of lines.
+ * @param truncated Set to whether the text did not fit (an ellipsis should follow the last line).
+ * @return The number of lines.
+ */
+inline size_t layoutText(const char *text, size_t width, TextSpan *lines, size_t maxLines, bool &truncated)
+{
+  truncated = false;
+  if (width == 0 || maxLines == 0)
+  {
+    return 0;
+  }
+
+  const char *pos = text;
+  size_t count = 0;
+  while (*pos && count < maxLines)
+  {
+    while (*pos == ' ')
+    {
+      pos++;
+    }
+
+    const char *lineStart = pos;
+    const char *lineEnd = pos;
+    const char *next = pos;
+    const char *p = pos;
+    while (true)
+    {
+      if (*p == '\0' || *p == '\n')
+      {
+        next = *p ? p + 1 : p;
+        break;
+      }
+
+      const char *wordStart = p;
+      while (*p && *p != ' ' && *p != '\n')
+      {
+        p++;
+      }
+
+      if ((size_t)(p - lineStart) <= width)
+      {
+        lineEnd = p;
+        while (*p == ' ')
+        {
+          p++;
+        }
+        continue;
+      }
+
+      if (lineEnd == lineStart)
+      {
+        // The word alone is wider than a line.
+        lineEnd = lineStart + width;
+        next = lineEnd;
+      }
+      else
+      {
+        next = wordStart;
+      }
+      break;
+    }
+
+    lines[count].text = lineStart;
+    lines[count].length = lineEnd - lineStart;
+    count++;
+    pos = next;
+  }
+
+  while (*pos == ' ' || *pos == '\n')
+  {
+    pos++;
+  }
+  if (*pos)
+  {
+    truncated = true;
+    TextSpan &last = lines[count - 1];
+    size_t room = width > TEXT_ELLIPSIS_LENGTH ? width - TEXT_ELLIPSIS_LENGTH : 0;
+    if (last.length > room)
+    {
+      last.length = room;
+    }
+  }
+  return count;
+}
+
+/**
+ * Fixed-capacity storage for layoutText().
+ */
+template <size_t MAX_LINES>
+class TextLayout
+{
+public:
+  /**
+   * @param text The text, which must outlive the layout.
+   * @param width The line width in characters.
+   * @param maxLines The maximum number of lines (at most MAX_LINES).
+   * @return The number of lines.
+   */
+  size_t layout(const char *text, size_t width, size_t maxLines = MAX_LINES)
+  {
+    count = layoutText(text, width, lines, maxLines < MAX_LINES ? maxLines : MAX_LINES, truncated);
+    return count;
+  }
+
+  size_t getLineCount() const { return count; }
+  const TextSpan &getLine(size_t index) const { return lines[index]; }
+  bool isTruncated() const { return truncated; }
+
+private:
+  TextSpan lines[MAX_LINES];
+  size_t count = 0;
+  bool truncated = false;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef TOPIC_ROUTER_H
+#define TOPIC_ROUTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Whether a topic (without the device prefix) is the expected one.
+ */
+inline bool isTopic(const char *topic, const char *expected)
+{
+  return strcmp(topic, expected) == 0;
+}
+
+// Longest device ID a topic buffer has room for (the IDs are UUIDs).
+static const size_t NODE_ID_MAX_LENGTH = 40;
+
+/**
+ * Length of a string, at compile time for constants.
+ */
+constexpr size_t constLength(const char *text)
+{
+  return *text ? 1 + constLength(text + 1) : 0;
+}
+
+/**
+ * Size of a buffer holding "<nodeId>/<subtopic>" for any device ID, usable as an array size:
+ * char topic[topicSize(FingerprintData::TOPIC)];
+ */
+constexpr size_t topicSize(const char *subtopic)
+{
+  return NODE_ID_MAX_LENGTH + 1 + constLength(subtopic) + 1;
+}
+
+/**
+ * Writes "<nodeId>/<subtopic>" into a caller buffer.
+ *
+ * @return The topic length, 0 if it did not fit.
+ */
+inline size_t buildTopic(char *out, size_t size, const char *nodeId, const char *subtopic)
+{
+  size_t idLength = strlen(nodeId);
+  size_t subtopicLength = strlen(subtopic);
+  if (idLength + 1 + subtopicLength + 1 > size)
+  {
+    return 0;
+  }
+  memcpy(out, nodeId, idLength);
+  out[idLength] = '/';
+  memcpy(out + idLength + 1, subtopic, subtopicLength + 1);
+  return idLength + 1 + subtopicLength;
+}
+
+/**
+ * The "<id>/" prefix of every topic addressed to this device, measured once.
+ */
+class TopicPrefix
+{
+public:
+  explicit TopicPrefix(const char *nodeId) : nodeId(nodeId), length(strlen(nodeId)) {}
+
+  /**
+   * Returns the topic without the device prefix, or nullptr if the topic is not addressed to this device.
+   */
+  const char *strip(const char *topic) const
+  {
+    if (strncmp(topic, nodeId, length) != 0 || topic[length] != '/')
+    {
+      return nullptr;
+    }
+    return topic + length + 1;
+  }
+
+private:
+  const char *nodeId;
+  size_t length;
+};
+
+#endif
@@ -0,0 +1,282 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include "esp_now.h"
+#include "mqtt.h"
+#include "transport.h"
+
+// Frame layout: magic, message ID (little endian), topic length, topic, payload.
+static const uint8_t LINK_FRAME_MAGIC = 0x4D;
+static const size_t LINK_FRAME_HEADER_SIZE = 4;
+static const size_t LINK_QUEUE_DEPTH = 8;
+static const size_t LINK_OUTBOX_DEPTH = 8;
+static const int LINK_MAX_RETRIES = 2;
+static const uint32_t LINK_ACK_TIMEOUT_MS = 50;
+static const uint32_t LINK_TASK_STACK = 3072;
+
+struct LinkFrame
+{
+  uint8_t length;
+  uint8_t data[ESP_NOW_MAX_DATA_LEN];
+};
+
+static QueueHandle_t receivedFrames = nullptr;
+static QueueHandle_t outgoingFrames = nullptr;
+static QueueHandle_t undeliveredFrames = nullptr;
+static SemaphoreHandle_t sendDone = nullptr;
+static volatile bool lastSendDelivered = false;
+static const uint8_t *acceptedMac = nullptr;
+// Guards the peer address (EspNowTransport::peerMac and acceptedMac), which setPeer() changes while
+// the WiFi and sender tasks read it.
+static portMUX_TYPE peerMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Runs on the WiFi task, so it only copies the frame for EspNowTransport::loop().
+static void onEspNowReceive(const uint8_t *mac, const uint8_t *data, int len)
+{
+  portENTER_CRITICAL(&peerMux);
+  bool isPeer = acceptedMac != nullptr && memcmp(mac, acceptedMac, 6) == 0;
+  portEXIT_CRITICAL(&peerMux);
+  if (!isPeer)
+    return;
+  if (len < (int)LINK_FRAME_HEADER_SIZE || len > ESP_NOW_MAX_DATA_LEN || data[0] != LINK_FRAME_MAGIC)
+    return;
+
+  LinkFrame frame;
+  frame.length = (uint8_t)len;
+  memcpy(frame.data, data, len);
+  xQueueSend(receivedFrames, &frame, 0);
+}
+
+static void onEspNowSent(const uint8_t *mac, esp_now_send_status_t status)
+{
+  lastSendDelivered = status == ESP_NOW_SEND_SUCCESS;
+  xSemaphoreGive(sendDone);
+}
+
+// Splits a frame into its message ID, topic (copied to be terminated) and payload.
+static bool parseFrame(const LinkFrame &frame, uint16_t &messageId, char *topic, size_t topicSize, const uint8_t *&payload, size_t &length)
+{
+  size_t topicLength = frame.data[3];
+  if (LINK_FRAME_HEADER_SIZE + topicLength > frame.length || topicLength >= topicSize)
+  {
+    return false;
+  }
+  messageId = (uint16_t)(frame.data[1] | (frame.data[2] << 8));
+  memcpy(topic, frame.data + LINK_FRAME_HEADER_SIZE, topicLength);
+  topic[topicLength] = '\0';
+  payload = frame.data + LINK_FRAME_HEADER_SIZE + topicLength;
+  length = frame.length - LINK_FRAME_HEADER_SIZE - topicLength;
+  return true;
+}
+
+bool MqttTransport::send(const char *topic, const uint8_t *payload, size_t length)
+{
+  stats.sent++;
+  char fullTopic[MqttSession::TOPIC_SIZE];
+  if (buildTopic(fullTopic, sizeof(fullTopic), nodeId, topic) == 0)
+  {
+    stats.lost++;
+    return false;
+  }
+
+  uint32_t start = micros();
+  if (!publishMQTT(fullTopic, payload, length, false, 1))
+  {
+    stats.lost++;
+    return false;
+  }
+  stats.recordDelivery(micros() - start);
+  return true;
+}
+
+bool MqttTransport::send(uint16_t messageId, const char *topic, const uint8_t *payload, size_t length)
+{
+  char linkTopic[MqttSession::TOPIC_SIZE];
+  uint8_t linkPayload[MqttSession::PAYLOAD_SIZE];
+  size_t linkLength = wrapLinkMessage(messageId, topic, payload, length, linkTopic, sizeof(linkTopic), linkPayload, sizeof(linkPayload));
+  if (linkLength == 0)
+  {
+    stats.sent++;
+    stats.lost++;
+    return false;
+  }
+  return send(linkTopic, linkPayload, linkLength);
+}
+
+bool EspNowTransport::begin()
+{
+  receivedFrames = xQueueCreate(LINK_QUEUE_DEPTH, sizeof(LinkFrame));
+  outgoingFrames = xQueueCreate(LINK_OUTBOX_DEPTH, sizeof(LinkFrame));
+  undeliveredFrames = xQueueCreate(LINK_OUTBOX_DEPTH, sizeof(LinkFrame));
+  sendDone = xSemaphoreCreateBinary();
+  if (!receivedFrames || !outgoingFrames || !undeliveredFrames || !sendDone)
+  {
+    return false;
+  }
+
+  // Random start so the peer does not mistake our first messages after a reboot for duplicates.
+  seedMessageIds((uint16_t)esp_random());
+  return loadEspNow(onEspNowReceive) && esp_now_register_send_cb(onEspNowSent) == ESP_OK &&
+         xTaskCreatePinnedToCore(sendTask, "espnow_tx", LINK_TASK_STACK, this, 2, nullptr, 1) == pdPASS;
+}
+
+void EspNowTransport::announce(const char *peerId)
+{
+  char topic[topicSize(LINK_MAC_TOPIC)];
+  buildTopic(topic, sizeof(topic), peerId, LINK_MAC_TOPIC);
+
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  publishMQTT(topic, mac, sizeof(mac), true);
+}
+
+bool EspNowTransport::setPeer(const uint8_t *mac, size_t length)
+{
+  if (length != sizeof(peerMac))
+  {
+    return false;
+  }
+  if (peerKnown && memcmp(mac, peerMac, sizeof(peerMac)) == 0)
+  {
+    return true;
+  }
+
+  // Only this function writes peerMac, so it reads it here without the lock.
+  if (peerKnown)
+  {
+    portENTER_CRITICAL(&peerMux);
+    acceptedMac = nullptr;
+    portEXIT_CRITICAL(&peerMux);
+    esp_now_del_peer(peerMac);
+  }
+  portENTER_CRITICAL(&peerMux);
+  memcpy(peerMac, mac, sizeof(peerMac));
+  portEXIT_CRITICAL(&peerMux);
+
+  EspNowReceiver peer(peerMac);
+  bool isRegistered = esp_now_is_peer_exist(peerMac) || peer.load();
+  portENTER_CRITICAL(&peerMux);
+  acceptedMac = isRegistered ? peerMac : nullptr;
+  portEXIT_CRITICAL(&peerMux);
+  peerKnown = isRegistered;
+  return isRegistered;
+}
+
+bool EspNowTransport::send(const char *topic, const uint8_t *payload, size_t length)
+{
+  return send(newMessageId(), topic, payload, length);
+}
+
+bool EspNowTransport::send(uint16_t messageId, const char *topic, const uint8_t *payload, size_t length)
+{
+  size_t topicLen = strlen(topic);
+  size_t frameLen = LINK_FRAME_HEADER_SIZE + topicLen + length;
+  if (!peerKnown || !outgoingFrames || topicLen > UINT8_MAX || frameLen > ESP_NOW_MAX_DATA_LEN)
+  {
+    return false;
+  }
+
+  LinkFrame frame;
+  frame.length = (uint8_t)frameLen;
+  frame.data[0] = LINK_FRAME_MAGIC;
+  frame.data[1] = (uint8_t)messageId;
+  frame.data[2] = (uint8_t)(messageId >> 8);
+  frame.data[3] = (uint8_t)topicLen;
+  memcpy(frame.data + LINK_FRAME_HEADER_SIZE, topic, topicLen);
+  memcpy(frame.data + LINK_FRAME_HEADER_SIZE + topicLen, payload, length);
+
+  if (xQueueSend(outgoingFrames, &frame, 0) != pdTRUE)
+  {
+    return false;
+  }
+  stats.sent++;
+  return true;
+}
+
+// Sends the queued frames one at a time, waiting for each ack. Retries keep the message ID, so a
+// frame whose ack got lost is dropped by the peer's LinkInbox.
+void EspNowTransport::sendTask(void *arg)
+{
+  EspNowTransport *link = static_cast<EspNowTransport *>(arg);
+  LinkFrame frame;
+  for (;;)
+  {
+    if (xQueueReceive(outgoingFrames, &frame, portMAX_DELAY) != pdTRUE)
+    {
+      continue;
+    }
+
+    // A copy, so setPeer() can change the address while this frame is retried.
+    uint8_t peerMac[6];
+    portENTER_CRITICAL(&peerMux);
+    memcpy(peerMac, link->peerMac, sizeof(peerMac));
+    portEXIT_CRITICAL(&peerMux);
+
+    bool delivered = false;
+    EspNowReceiver peer(peerMac);
+    for (int attempt = 0; attempt <= LINK_MAX_RETRIES && !delivered; attempt++)
+    {
+      if (attempt > 0)
+      {
+        link->stats.retries++;
+      }
+
+      xSemaphoreTake(sendDone, 0);
+      uint32_t start = micros();
+      if (!peer.send(frame.data, frame.length))
+      {
+        continue;
+      }
+      if (xSemaphoreTake(sendDone, pdMS_TO_TICKS(LINK_ACK_TIMEOUT_MS)) == pdTRUE && lastSendDelivered)
+      {
+        link->stats.recordDelivery(micros() - start);
+        delivered = true;
+      }
+    }
+
+    if (!delivered)
+    {
+      link->stats.lost++;
+      xQueueSend(undeliveredFrames, &frame, 0);
+    }
+  }
+}
+
+void EspNowTransport::loop(const char *nodeId, void (*callback)(char *topic, uint8_t *payload, unsigned int length))
+{
+  LinkFrame frame;
+  uint16_t messageId;
+  char frameTopic[64];
+  const uint8_t *framePayload;
+  size_t frameLength;
+
+  while (receivedFrames && xQueueReceive(receivedFrames, &frame, 0) == pdTRUE)
+  {
+    if (!parseFrame(frame, messageId, frameTopic, sizeof(frameTopic), framePayload, frameLength))
+    {
+      continue;
+    }
+    stats.received++;
+
+    // Delivered like the same message sent over MQTT, so LinkInbox drops whichever copy comes second.
+    char linkTopic[MqttSession::TOPIC_SIZE];
+    uint8_t payload[LINK_MESSAGE_ID_SIZE + ESP_NOW_MAX_DATA_LEN];
+    size_t length = wrapLinkMessage(messageId, frameTopic, framePayload, frameLength, linkTopic, sizeof(linkTopic), payload, sizeof(payload));
+    char topic[MqttSession::TOPIC_SIZE];
+    if (length == 0 || buildTopic(topic, sizeof(topic), nodeId, linkTopic) == 0)
+    {
+      continue;
+    }
+    callback(topic, payload, length);
+  }
+
+  while (undeliveredFrames && xQueueReceive(undeliveredFrames, &frame, 0) == pdTRUE)
+  {
+    if (undeliveredListener && parseFrame(frame, messageId, frameTopic, sizeof(frameTopic), framePayload, frameLength))
+    {
+      undeliveredListener->onUndelivered(*this, messageId, frameTopic, framePayload, frameLength);
+    }
+  }
+}
@@ -0,0 +1,416 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "mqtt_data.h"
+
+// Topic (without the device prefix) where each node announces its MAC address to the other one.
+static constexpr const char *LINK_MAC_TOPIC = "link/mac";
+
+// Prefix of the topic of node-to-node messages that carry their ID ("link/msg/<topic>"). The payload
+// starts with the ID (little endian), so the receiver can drop a copy that came over the other link.
+static constexpr const char *LINK_MESSAGE_TOPIC = "link/msg/";
+static const size_t LINK_MESSAGE_ID_SIZE = 2;
+
+/**
+ * Delivery counters and latency of a link. Atomic, since the ESP-NOW sender task counts into them
+ * while the loop task sends and reads them.
+ */
+struct LinkStats
+{
+  std::atomic<uint32_t> sent{0};
+  std::atomic<uint32_t> delivered{0};
+  std::atomic<uint32_t> lost{0};      // Messages that failed after every retry.
+  std::atomic<uint32_t> retries{0};
+  std::atomic<uint32_t> fallbacks{0}; // Messages sent over the fallback link.
+  std::atomic<uint32_t> received{0};
+  std::atomic<uint32_t> lastLatencyUs{0};
+  std::atomic<uint32_t> maxLatencyUs{0};
+  std::atomic<uint64_t> totalLatencyUs{0};
+
+  void recordDelivery(uint32_t latencyUs)
+  {
+    delivered++;
+    lastLatencyUs = latencyUs;
+    totalLatencyUs += latencyUs;
+    uint32_t max = maxLatencyUs.load();
+    while (latencyUs > max && !maxLatencyUs.compare_exchange_weak(max, latencyUs))
+    {
+    }
+  }
+
+  uint32_t averageLatencyUs() const { return delivered ? (uint32_t)(totalLatencyUs / delivered) : 0; }
+};
+
+class Transport;
+
+/**
+ * Told about messages a link accepted but could not deliver in the end (see Transport::send()).
+ */
+class UndeliveredListener
+{
+public:
+  virtual ~UndeliveredListener() {}
+
+  virtual void onUndelivered(Transport &link, uint16_t messageId, const char *topic, const uint8_t *payload, size_t length) = 0;
+};
+
+/**
+ * A way of delivering messages to the other node.
+ */
+class Transport
+{
+public:
+  virtual ~Transport() {}
+
+  /**
+   * Sends a message to the other node.
+   *
+   * @param topic The topic without the device prefix (e.g. FingerprintData::TOPIC).
+   * @param payload The message payload.
+   * @param length The message payload length.
+   * @return Whether the message was delivered (or handed to the broker).
+   */
+  virtual bool send(const char *topic, const uint8_t *payload, size_t length) = 0;
+
+  /**
+   * Sends a message with an ID, so that a copy sent over another link can be dropped by the other
+   * node's LinkInbox. Links that cannot carry an ID send the message as is.
+   *
+   * An asynchronous link returns once the message is queued; if it then fails, the
+   * UndeliveredListener is told from the link's loop.
+   */
+  virtual bool send(uint16_t messageId, const char *topic, const uint8_t *payload, size_t length)
+  {
+    return send(topic, payload, length);
+  }
+
+  /**
+   * Whether the link can currently be used (e.g. the peer address is known).
+   */
+  virtual bool isReady() const { return true; }
+
+  void setUndeliveredListener(UndeliveredListener *listener) { undeliveredListener = listener; }
+
+  const LinkStats &getStats() const { return stats; }
+
+  /**
+   * Returns a new message ID, shared by every link of the node.
+   */
+  static uint16_t newMessageId() { return messageIds().fetch_add(1, std::memory_order_relaxed); }
+
+  /**
+   * Sets where message IDs start (random at boot, so the other node does not take the first
+   * messages after a reboot for copies of the last ones before it).
+   */
+  static void seedMessageIds(uint16_t seed) { messageIds().store(seed, std::memory_order_relaxed); }
+
+protected:
+  LinkStats stats;
+  UndeliveredListener *undeliveredListener = nullptr;
+
+private:
+  static std::atomic<uint16_t> &messageIds()
+  {
+    static std::atomic<uint16_t> next{0};
+    return next;
+  }
+};
+
+/**
+ * Builds a message that carries its ID: LINK_MESSAGE_TOPIC + topic, and the ID followed by the payload.
+ *
+ * @return The length of the new payload, 0 if either does not fit.
+ */
+inline size_t wrapLinkMessage(uint16_t messageId, const char *topic, const uint8_t *payload, size_t length,
+                              char *linkTopic, size_t linkTopicSize, uint8_t *out, size_t outSize)
+{
+  size_t prefixLength = strlen(LINK_MESSAGE_TOPIC);
+  size_t topicLength = strlen(topic);
+  if (prefixLength + topicLength >= linkTopicSize || LINK_MESSAGE_ID_SIZE + length > outSize)
+  {
+    return 0;
+  }
+  memcpy(linkTopic, LINK_MESSAGE_TOPIC, prefixLength);
+  memcpy(linkTopic + prefixLength, topic, topicLength + 1);
+
+  out[0] = (uint8_t)messageId;
+  out[1] = (uint8_t)(messageId >> 8);
+  memcpy(out + LINK_MESSAGE_ID_SIZE, payload, length);
+  return LINK_MESSAGE_ID_SIZE + length;
+}
+
+/**
+ * Receiving end of the node-to-node links. Unwraps messages that carry their ID and drops the ones
+ * already received, whichever link they came over: a message whose ESP-NOW ack got lost is sent
+ * again over MQTT, but must only ring the doorbell once.
+ */
+class LinkInbox
+{
+public:
+  static const size_t HISTORY = 16;
+
+  /**
+   * Unwraps a message in place. Messages without an ID (e.g. from the app) are left as they are.
+   *
+   * @param subtopic The topic without the device prefix, set to the inner topic.
+   * @param payload Set to the inner payload.
+   * @param length Set to the inner payload length.
+   * @return Whether the message should be handled (false for a copy of a recent one).
+   */
+  bool accept(const char *&subtopic, const uint8_t *&payload, size_t &length)
+  {
+    size_t prefixLength = strlen(LINK_MESSAGE_TOPIC);
+    if (strncmp(subtopic, LINK_MESSAGE_TOPIC, prefixLength) != 0)
+    {
+      return true;
+    }
+    if (length < LINK_MESSAGE_ID_SIZE)
+    {
+      return false;
+    }
+
+    uint16_t messageId = (uint16_t)(payload[0] | (payload[1] << 8));
+    subtopic += prefixLength;
+    payload += LINK_MESSAGE_ID_SIZE;
+    length -= LINK_MESSAGE_ID_SIZE;
+
+    for (size_t i = 0; i < count; i++)
+    {
+      if (recent[i] == messageId)
+      {
+        duplicates++;
+        return false;
+      }
+    }
+    recent[next] = messageId;
+    next = (next + 1) % HISTORY;
+    if (count < HISTORY)
+    {
+      count++;
+    }
+    return true;
+  }
+
+  /**
+   * Copies dropped so far.
+   */
+  uint32_t getDuplicates() const { return duplicates; }
+
+private:
+  uint16_t recent[HISTORY] = {};
+  size_t count = 0;
+  size_t next = 0;
+  uint32_t duplicates = 0;
+};
+
+/**
+ * Publishes through the MQTT broker, to "<nodeId>/<topic>".
+ */
+class MqttTransport : public Transport
+{
+public:
+  explicit MqttTransport(const char *nodeId) : nodeId(nodeId) {}
+
+  bool send(const char *topic, const uint8_t *payload, size_t length) override;
+
+  /**
+   * Publishes to "<nodeId>/link/msg/<topic>", with the ID in front of the payload.
+   */
+  bool send(uint16_t messageId, const char *topic, const uint8_t *payload, size_t length) override;
+
+private:
+  const char *nodeId;
+};
+
+/**
+ * Sends directly to the other node over ESP-NOW. send() only queues the frame: a sender task waits
+ * for the link-layer ack and retries, so the caller never blocks on the radio. Frames that fail
+ * every retry are handed to the UndeliveredListener from loop().
+ * The peer MAC address is learned from the retained LINK_MAC_TOPIC message the other node publishes.
+ * Only one instance can be loaded at a time.
+ */
+class EspNowTransport : public Transport
+{
+public:
+  /**
+   * Loads ESP-NOW, registers the receive and ack callbacks and starts the sender task (REQUIRED AT THE START, after WiFi).
+   *
+   * @return Whether loaded successfully.
+   */
+  bool begin();
+
+  /**
+   * Publishes this node's MAC address (retained) so the other node can reach us.
+   *
+   * @param peerId The ID of the other node.
+   */
+  void announce(const char *peerId);
+
+  /**
+   * Sets the MAC address of the other node.
+   *
+   * @return Whether the peer was registered.
+   */
+  bool setPeer(const uint8_t *mac, size_t length);
+
+  bool isReady() const override { return peerKnown; }
+
+  bool send(const char *topic, const uint8_t *payload, size_t length) override;
+
+  /**
+   * Queues a frame for the sender task.
+   *
+   * @return Whether queued (false when the peer is unknown or the queue is full).
+   */
+  bool send(uint16_t messageId, const char *topic, const uint8_t *payload, size_t length) override;
+
+  /**
+   * Dispatches received messages as if they had arrived from MQTT, on "<nodeId>/link/msg/<topic>"
+   * (see LinkInbox), and reports the frames the sender task gave up on (REQUIRED IN THE LOOP).
+   *
+   * @param nodeId The ID of this node (used to rebuild the full topic).
+   * @param callback The MQTT message callback.
+   */
+  void loop(const char *nodeId, void (*callback)(char *topic, uint8_t *payload, unsigned int length));
+
+private:
+  // setPeer() writes it under a spinlock, and the sender task copies it under the same lock (transport.cpp).
+  uint8_t peerMac[6] = {};
+  std::atomic<bool> peerKnown{false};
+
+  static void sendTask(void *arg);
+};
+
+/**
+ * Sends over a primary link and falls back to a secondary one when the primary fails, with the same
+ * message ID on both so the other node handles the message once (see LinkInbox).
+ * After a failure the primary is skipped for PRIMARY_RETRY_MS, then probed again.
+ */
+class FallbackTransport : public Transport, public UndeliveredListener
+{
+public:
+  /**
+   * @param primary The preferred link.
+   * @param fallback The link used when the primary is not ready or fails.
+   * @param clockMs Returns the time in milliseconds. Without a clock the primary is retried on every send.
+   */
+  FallbackTransport(Transport &primary, Transport &fallback, uint32_t (*clockMs)() = nullptr)
+      : primary(primary), fallback(fallback), clockMs(clockMs)
+  {
+    primary.setUndeliveredListener(this);
+  }
+
+  bool send(const char *topic, const uint8_t *payload, size_t length) override
+  {
+    return send(newMessageId(), topic, payload, length);
+  }
+
+  bool send(uint16_t messageId, const char *topic, const uint8_t *payload, size_t length) override
+  {
+    stats.sent++;
+
+    bool isPrimaryResting = isPrimaryDown && clockMs && clockMs() - primaryDownSinceMs < PRIMARY_RETRY_MS;
+    if (primary.isReady() && !isPrimaryResting)
+    {
+      if (primary.send(messageId, topic, payload, length))
+      {
+        isPrimaryDown = false;
+        stats.delivered++;
+        return true;
+      }
+      markPrimaryDown();
+    }
+
+    return sendFallback(messageId, topic, payload, length);
+  }
+
+  /**
+   * The primary gave up on a message it had accepted: it goes over the fallback with the same ID.
+   */
+  void onUndelivered(Transport &link, uint16_t messageId, const char *topic, const uint8_t *payload, size_t length) override
+  {
+    markPrimaryDown();
+    stats.delivered--; // Counted when the primary accepted it.
+    sendFallback(messageId, topic, payload, length);
+  }
+
+  const Transport &getPrimary() const { return primary; }
+  const Transport &getFallback() const { return fallback; }
+
+private:
+  static const uint32_t PRIMARY_RETRY_MS = 30000;
+
+  Transport &primary;
+  Transport &fallback;
+  uint32_t (*clockMs)();
+  bool isPrimaryDown = false;
+  uint32_t primaryDownSinceMs = 0;
+
+  void markPrimaryDown()
+  {
+    isPrimaryDown = true;
+    primaryDownSinceMs = clockMs ? clockMs() : 0;
+  }
+
+  bool sendFallback(uint16_t messageId, const char *topic, const uint8_t *payload, size_t length)
+  {
+    stats.fallbacks++;
+    if (fallback.send(messageId, topic, payload, length))
+    {
+      stats.delivered++;
+      return true;
+    }
+    stats.lost++;
+    return false;
+  }
+};
+
+/**
+ * Delivers messages straight to a handler in the same process (for host tests).
+ * Every dropEvery-th message is lost when dropEvery is set.
+ */
+class LoopbackTransport : public Transport
+{
+public:
+  explicit LoopbackTransport(void (*handler)(const char *topic, const uint8_t *payload, size_t length), uint32_t dropEvery = 0)
+      : handler(handler), dropEvery(dropEvery) {}
+
+  bool send(const char *topic, const uint8_t *payload, size_t length) override
+  {
+    stats.sent++;
+    if (dropEvery > 0 && stats.sent % dropEvery == 0)
+    {
+      stats.lost++;
+      return false;
+    }
+    handler(topic, payload, length);
+    stats.received++;
+    stats.recordDelivery(0);
+    return true;
+  }
+
+private:
+  void (*handler)(const char *topic, const uint8_t *payload, size_t length);
+  uint32_t dropEvery;
+};
+
+/**
+ * Encodes a message in the wire format of its topic and sends it over a transport.
+ *
+ * @param transport The link to the other node.
+ * @param data The message to send.
+ * @return Whether the message was delivered.
+ */
+template <typename T>
+bool sendMessage(Transport &transport, const T &data)
+{
+  uint8_t payload[200];
+  size_t length = encodeMessage(data, formatForTopic(T::TOPIC), payload, sizeof(payload));
+  return length > 0 && transport.send(T::TOPIC, payload, length);
+}
+
+#endif
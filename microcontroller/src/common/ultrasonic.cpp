@@ -1,23 +1,51 @@
 #include <Arduino.h>
+#include "spsc_ring.h"
 #include "ultrasonic.h"
 
 const int TRIG_PORT = 5;
 const int ECHO_PORT = 18;
 
+// Sound travels 0.0343 cm/us and the echo covers the distance twice.
+static const float CM_PER_ECHO_US = 0.0343f / 2;
+
+static volatile uint32_t echoStartUs = 0;
+static SpscRing<uint32_t, 16> echoWidthsUs;
+
+static void IRAM_ATTR onEchoEdge()
+{
+  uint32_t now = micros();
+  if (digitalRead(ECHO_PORT) == HIGH)
+  {
+    echoStartUs = now;
+  }
+  else if (echoStartUs != 0)
+  {
+    echoWidthsUs.push(now - echoStartUs);
+    echoStartUs = 0;
+  }
+}
+
 bool loadUltrasonic() {
   pinMode(TRIG_PORT, OUTPUT);
   pinMode(ECHO_PORT, INPUT);
+  attachInterrupt(digitalPinToInterrupt(ECHO_PORT), onEchoEdge, CHANGE);
   return true;
 }
 
-float fetchDistance() {
+void triggerUltrasonic() {
   digitalWrite(TRIG_PORT, LOW);
   delayMicroseconds(2);
   digitalWrite(TRIG_PORT, HIGH);
   delayMicroseconds(10);
   digitalWrite(TRIG_PORT, LOW);
+}
 
-  long duration = pulseIn(ECHO_PORT, HIGH);
-
-  return duration * 0.034 / 2;
-}
\ No newline at end of file
+bool readUltrasonic(float &distanceCm) {
+  uint32_t widthUs;
+  if (!echoWidthsUs.pop(widthUs))
+  {
+    return false;
+  }
+  distanceCm = widthUs * CM_PER_ECHO_US;
+  return true;
+}
@@ -2,17 +2,24 @@
 #define ULTRASONIC_H
 
 /**
- * Loads the Ultrasonic sensor.
+ * Loads the Ultrasonic sensor and attaches the echo interrupt.
  *
  * @return Whether loaded successfully.
  */
 bool loadUltrasonic();
 
 /**
- * Fetches the distance in cm.
+ * Starts a measurement without waiting for the echo, which is timed by the echo interrupt.
+ * Measurements should be at least 60 ms apart.
+ */
+void triggerUltrasonic();
+
+/**
+ * Takes the oldest measured distance.
  *
- * @return The distance in cm.
+ * @param distanceCm The distance in cm.
+ * @return Whether a measurement was available.
  */
-float fetchDistance();
+bool readUltrasonic(float &distanceCm);
 
 #endif
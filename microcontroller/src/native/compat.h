@@ -0,0 +1,26 @@
+#ifndef NATIVE_COMPAT_H
+#define NATIVE_COMPAT_H
+
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Functions of the ESP32 libc missing from older host libcs. Included in every native build
+ * unit (build_flags = -include src/native/compat.h).
+ */
+
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+inline size_t strlcpy(char *dst, const char *src, size_t size)
+{
+  size_t length = strlen(src);
+  if (size > 0)
+  {
+    size_t copied = length < size - 1 ? length : size - 1;
+    memcpy(dst, src, copied);
+    dst[copied] = '\0';
+  }
+  return length;
+}
+#endif
+
+#endif
@@ -0,0 +1,39 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <chrono>
+#include <common/log.h>
+#include <common/metrics.h>
+
+// Host versions of the device-only functions the common modules call (native env only).
+
+static const size_t LOG_MESSAGE_SIZE = 192;
+
+bool loadLogger(uint32_t baud)
+{
+  return true;
+}
+
+// Formatted like on the device, but printed right away.
+void logMessage(const char *format, ...)
+{
+  char message[LOG_MESSAGE_SIZE];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  if (length > 0)
+  {
+    fputs(message, stdout);
+  }
+}
+
+uint32_t getDroppedLogs()
+{
+  return 0;
+}
+
+uint32_t metricsNowUs()
+{
+  using namespace std::chrono;
+  return (uint32_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <string.h>
+#include <ArduinoJson.h>
+#include <common/mqtt_data.h>
+#include <common/topic_router.h>
+#include <common/log.h>
+#include "handlers.h"
+
+void WroomHandlers::onMessage(const char *subtopic, const uint8_t *payload, size_t length)
+{
+  if (isTopic(subtopic, OledData::TOPIC))
+  {
+    onOledMessage(payload, length);
+  }
+  else if (isTopic(subtopic, FingerprintData::TOPIC))
+  {
+    onFingerprintMessage(payload, length);
+  }
+}
+
+void WroomHandlers::onOledMessage(const uint8_t *payload, size_t length)
+{
+  JsonDocument doc;
+  oledReceived = true;
+  OledData oledData;
+  if (decodeMessage(payload, length, doc, oledData))
+  {
+    if (oledData.isQrCode)
+    {
+      hal.display->showQRCode(oledData.qrData, oledData.message, oledData.duration);
+    }
+    else
+    {
+      hal.display->showText(oledData.message, oledData.duration);
+    }
+  }
+}
+
+void WroomHandlers::onFingerprintMessage(const uint8_t *payload, size_t length)
+{
+  JsonDocument doc;
+  FingerprintData fingerprintData;
+  if (!decodeMessage(payload, length, doc, fingerprintData))
+  {
+    return;
+  }
+  switch (fingerprintData.type)
+  {
+  case FINGERPRINT_REGISTRATION:
+    LOG_INFO("[MQTT] Received FINGERPRINT_REGISTRATION\n");
+    if (hal.fingerprintUsers->isEnrolling())
+    {
+      LOG_WARN("[MQTT] Already registering, ignored\n");
+      break;
+    }
+    strlcpy(enrollmentUserId, fingerprintData.userId, sizeof(enrollmentUserId));
+    if (onEnrollmentRequested)
+    {
+      onEnrollmentRequested();
+    }
+    break;
+
+  case FINGERPRINT_CANCEL:
+    LOG_INFO("[MQTT] Received FINGERPRINT_CANCEL\n");
+    hal.fingerprintUsers->cancelEnrollment();
+    break;
+
+  case FINGERPRINT_SYNC:
+    // The WROVER acknowledges a table once every user in it is in Firestore.
+    LOG_INFO("[MQTT] Fingerprint users synced\n");
+    hal.fingerprintUsers->setSyncedHash(fingerprintData.tableHash);
+    break;
+
+  default:
+    break;
+  }
+}
+
+bool WroomHandlers::syncUsers()
+{
+  uint32_t tableHash = USER_TABLE_HASH_OFFSET;
+  for (uint16_t id = 1; id < FINGERPRINT_MAX_USERS; id++)
+  {
+    const char *userId = hal.fingerprintUsers->getUser(id);
+    if (userId[0] != '\0')
+    {
+      tableHash = hashUserId(tableHash, userId);
+    }
+  }
+  if (tableHash == hal.fingerprintUsers->getSyncedHash())
+  {
+    return false;
+  }
+
+  for (uint16_t id = 1; id < FINGERPRINT_MAX_USERS; id++)
+  {
+    const char *userId = hal.fingerprintUsers->getUser(id);
+    if (userId[0] != '\0')
+    {
+      sendMessage(wroverLink, FingerprintData(FINGERPRINT_SYNC, userId, false, 0, 0, 0, tableHash));
+    }
+  }
+  // No user: the end of the table.
+  sendMessage(wroverLink, FingerprintData(FINGERPRINT_SYNC, "", false, 0, 0, 0, tableHash));
+  return true;
+}
+
+void WroomHandlers::onFingerprintScanned(uint16_t id, uint32_t touchAgeMs)
+{
+  const char *fingerprintUserId = hal.fingerprintUsers->getUser(id);
+
+  FingerprintData newFingerprintData(FINGERPRINT_TOUCH, fingerprintUserId, false, 0, 0, touchAgeMs);
+  sendMessage(wroverLink, newFingerprintData);
+
+  char greeting[FINGERPRINT_USER_ID_SIZE + 16];
+  if (fingerprintUserId[0] == '\0')
+  {
+    strlcpy(greeting, "Hello!", sizeof(greeting));
+  }
+  else
+  {
+    snprintf(greeting, sizeof(greeting), "Hello, %s!", fingerprintUserId);
+  }
+  hal.display->showText(greeting, 2000);
+}
+
+void WroomHandlers::onProximity()
+{
+  sendMessage(wroverLink, UltrasonicData(true));
+}
+
+void WroomHandlers::onEnrollmentProgress(FingerprintStage stage, FingerprintError error)
+{
+  // The app follows the enrollment through the WROVER, not only the user at the door.
+  sendMessage(wroverLink, FingerprintData(FINGERPRINT_PROGRESS, enrollmentUserId, false, stage, error));
+
+  switch (stage)
+  {
+  case FINGERPRINT_FIRST_REGISTRATION_STAGE:
+    break;
+  case FINGERPRINT_REMOVE_FINGER_STAGE:
+    hal.display->showText("Remove your finger...", 0);
+    break;
+  case FINGERPRINT_SECOND_REGISTRATION_STAGE:
+    hal.display->showText("Place the same finger again...", 0);
+    break;
+  case FINGERPRINT_FINISHED_STAGE:
+    hal.display->showText("Fingerprint enrolled successfully!", 2000);
+    break;
+  case FINGERPRINT_ERROR:
+    if (error == FINGERPRINT_TIMEOUT_ERROR)
+    {
+      hal.display->showText("Registration timed out", 2000);
+    }
+    else if (error == FINGERPRINT_CANCELLED_ERROR)
+    {
+      hal.display->showText("Registration cancelled", 2000);
+    }
+    else if (error == FINGERPRINT_INDEX_ERROR)
+    {
+      hal.display->showText("Sensor not ready, try again", 2000);
+    }
+    else
+    {
+      hal.display->showText("ERROR", 2000);
+    }
+    break;
+  }
+}
+
+void WroomHandlers::onEnrollmentSucceeded(uint16_t id)
+{
+  bool isNew = !hal.fingerprintUsers->hasUser(enrollmentUserId);
+  hal.fingerprintUsers->setUser(id, enrollmentUserId);
+
+  FingerprintData newFingerprintData = {
+      FINGERPRINT_UPDATE,
+      enrollmentUserId,
+      isNew};
+
+  LOG_INFO("[MQTT] Publishing FINGERPRINT_UPDATE for %s\n", enrollmentUserId);
+  sendMessage(wroverLink, newFingerprintData);
+}
@@ -0,0 +1,88 @@
+#ifndef WROOM_HANDLERS_H
+#define WROOM_HANDLERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <common/hal.h>
+#include <common/transport.h>
+#include <common/fingerprint_enrollment.h>
+#include <common/fingerprint_users.h>
+
+/**
+ * What the WROOM does with messages from the WROVER and with its own sensor events. Only depends on
+ * the HAL (display and fingerprint directory) and the link to the WROVER, so it runs on the host
+ * against fakes.
+ */
+class WroomHandlers
+{
+public:
+  /**
+   * @param hal The backends, display and fingerprintUsers are required.
+   * @param wroverLink The link to the WROVER.
+   * @param onEnrollmentRequested Called when the WROVER asks for a registration (wakes the enrollment task).
+   */
+  WroomHandlers(const Hal &hal, Transport &wroverLink, void (*onEnrollmentRequested)() = nullptr)
+      : hal(hal), wroverLink(wroverLink), onEnrollmentRequested(onEnrollmentRequested) {}
+
+  /**
+   * Handles a message from the WROVER.
+   *
+   * @param subtopic The topic without the device prefix.
+   */
+  void onMessage(const char *subtopic, const uint8_t *payload, size_t length);
+
+  /**
+   * Sends the scanned fingerprint to the WROVER (rings the doorbell) and greets the user.
+   *
+   * @param id The fingerprint ID as returned by scanFingerprint(), 0 when unknown.
+   * @param touchAgeMs The time since the finger touched the sensor, for the WROVER's doorbell latency.
+   */
+  void onFingerprintScanned(uint16_t id, uint32_t touchAgeMs = 0);
+
+  /**
+   * Sends every user to the WROVER, which adds the missing ones to Firestore (e.g. after an update was
+   * lost offline). Skipped while the table is the one the WROVER last acknowledged.
+   *
+   * @return Whether the users were sent.
+   */
+  bool syncUsers();
+
+  /**
+   * Tells the WROVER someone came close to the door.
+   */
+  void onProximity();
+
+  /**
+   * Shows the progress of the running enrollment and reports it to the WROVER.
+   */
+  void onEnrollmentProgress(FingerprintStage stage, FingerprintError error);
+
+  /**
+   * Maps the enrolled fingerprint to the requesting user and tells the WROVER.
+   *
+   * @param id The slot the fingerprint was stored in.
+   */
+  void onEnrollmentSucceeded(uint16_t id);
+
+  /**
+   * The user the last registration was requested for.
+   */
+  const char *getEnrollmentUser() const { return enrollmentUserId; }
+
+  /**
+   * Whether the WROVER sent the first OLED message (it is up and connected).
+   */
+  bool hasReceivedOled() const { return oledReceived; }
+
+private:
+  Hal hal;
+  Transport &wroverLink;
+  void (*onEnrollmentRequested)();
+  char enrollmentUserId[FINGERPRINT_USER_ID_SIZE] = "";
+  volatile bool oledReceived = false;
+
+  void onOledMessage(const uint8_t *payload, size_t length);
+  void onFingerprintMessage(const uint8_t *payload, size_t length);
+};
+
+#endif
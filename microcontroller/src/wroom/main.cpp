@@ -1,242 +1,256 @@
 #include <HardwareSerial.h>
+#include <esp_timer.h>
 #include <ArduinoJson.h>
 #include <common/wifi.h>
 #include <common/env/env.h>
-#include <common/utils.h>
 #include <common/mqtt.h>
 #include <common/mqtt_data.h>
+#include <common/transport.h>
+#include <common/topic_router.h>
 #include <common/oled.h>
 #include <common/fingerprint.h>
 #include <common/ultrasonic.h>
-#include <unordered_map>
-#undef B1
-#include <fmt/core.h>
-#include <Ticker.h>
+#include <common/distance_filter.h>
+#include <common/scheduler.h>
+#include <common/scan_policy.h>
+#include <common/metrics.h>
+#include <common/log.h>
+#include "handlers.h"
 
 using namespace std;
 
 static const int MAX_ULTRASONIC_DISTANCE = 10;
-static volatile bool isSomeoneClose = false;
-static volatile bool initialOledReceived = false;
+static const int ULTRASONIC_EXIT_DISTANCE = 15;
+static const uint32_t ULTRASONIC_INTERVAL_MS = 100;
+static const uint32_t FINGERPRINT_FAST_SCAN_MS = 100;
+static const uint32_t FINGERPRINT_IDLE_SCAN_MS = 2000;
+static const uint32_t FINGERPRINT_ACTIVE_HOLD_MS = 10000;
+static const uint32_t NETWORK_INTERVAL_MS = 10;
+static const uint32_t OLED_INTERVAL_MS = 50;
+static const uint32_t SCHEDULER_STATS_INTERVAL_MS = 60000;
+static const uint32_t SCHEDULER_MAX_IDLE_US = 10000;
+// A scan is getImage, image2Tz and a search over the sensor's UART. An enrollment step is at most one
+// command (getImage or image2Tz), or createModel and storeModel once at the end, so the same budget holds.
+static const uint32_t FINGERPRINT_STEP_BUDGET_US = 300000;
 
-struct CompositeOled
-{
-  String layout;
-  String qrData;
-  String textData;
-  static CompositeOled fromJson(const JsonDocument &d)
-  {
-    CompositeOled c;
-    c.layout = d["layout"].as<String>();
-    c.qrData = d["qrData"].as<String>();
-    c.textData = d["textData"].as<String>();
-    return c;
-  }
-};
-
-String MQTT_TOPICS[] = {
-    OledData::TOPIC,
-    FingerprintData::TOPIC};
-const size_t MQTT_TOPIC_COUNT = sizeof(MQTT_TOPICS) / sizeof(MQTT_TOPICS[0]);
-String *fullTopics;
+EspNowTransport espNowLink;
+MqttTransport mqttLink(WROVER_UNIQUE_ID);
+FallbackTransport wroverLink(espNowLink, mqttLink, []() -> uint32_t
+                             { return millis(); });
+LinkInbox linkInbox;
+TopicPrefix topicPrefix(WROOM_UNIQUE_ID);
 
-std::unordered_map<int, string> fingerprintUserIds;
+DistanceFilter distanceFilter(MAX_ULTRASONIC_DISTANCE, ULTRASONIC_EXIT_DISTANCE);
+ScanPolicy scanPolicy(FINGERPRINT_FAST_SCAN_MS, FINGERPRINT_IDLE_SCAN_MS, FINGERPRINT_ACTIVE_HOLD_MS);
+MetricHistogram scanLatency("scan_ms"); // Touch (or the previous scan, when polling) to decision.
+MetricCounter fingerprintScans("fp_scans");
+MetricCounter fingerprintMatches("fp_matches");
+MetricCounter proximityEvents("proximity");
+MetricCounter mqttReceived("mqtt_rx");
+MetricHistogram oledFlushUs("oled_us");
 
-Ticker fingerprintIntervalTimer;
-Ticker ultrasonicIntervalTimer;
+Scheduler scheduler([]() -> uint32_t
+                    { return micros(); });
+int enrollmentTaskId = -1;
+WroomHandlers handlers(getDeviceHal(), wroverLink, []()
+                       { scheduler.notify(enrollmentTaskId); });
 
 void fingerprintCallback(FingerprintStage stage, FingerprintError error)
 {
-  switch (stage)
-  {
-  case FINGERPRINT_FIRST_REGISTRATION_STAGE:
-    break;
-  case FINGERPRINT_REMOVE_FINGER_STAGE:
-    displayText("Remove your finger...");
-    break;
-  case FINGERPRINT_SECOND_REGISTRATION_STAGE:
-    displayText("Place the same finger again...");
-    break;
-  case FINGERPRINT_FINISHED_STAGE:
-    displayText("Fingerprint enrolled successfully!", 2000);
-    break;
-  case FINGERPRINT_ERROR:
-    displayText("ERROR", 2000);
-    break;
-  }
+  handlers.onEnrollmentProgress(stage, error);
 }
 
 void mqttCallback(char *topic, uint8_t *payload, unsigned int length)
 {
-  JsonDocument doc;
-  deserializeJson(doc, payload, length);
-
-  string topicPrefix = string(WROOM_UNIQUE_ID) + "/";
-  size_t topicPrefixLen = strlen(topicPrefix.c_str());
-  if (strncmp(topic, topicPrefix.c_str(), topicPrefixLen) != 0)
+  mqttReceived.add();
+  const char *subtopic = topicPrefix.strip(topic);
+  if (subtopic == nullptr)
   {
     return;
   }
-  topic += topicPrefixLen;
-
-  if (strcmp(topic, OledData::TOPIC) == 0)
+  const uint8_t *body = payload;
+  size_t bodyLength = length;
+  if (!linkInbox.accept(subtopic, body, bodyLength))
   {
-    initialOledReceived = true;
-    JsonDocument doc;
-    DeserializationError err = deserializeJson(doc, payload, length);
-    if (!err)
-    {
-      if (doc.containsKey("layout"))
-      {
-        const char *qrData = doc["qrData"] | "";
-        const char *textData = doc["textData"] | "";
-        int duration = doc["duration"] | 0;
-        displayQRCode(qrData, textData, duration);
-      }
-      else if (doc.containsKey("message"))
-      {
-        const char *msg = doc["message"] | "";
-        int duration = doc["duration"] | 0;
-        displayText(msg, duration);
-      }
-    }
     return;
   }
-  else if (strcmp(topic, FingerprintData::TOPIC) == 0)
+
+  if (isTopic(subtopic, LINK_MAC_TOPIC))
   {
-    FingerprintData fingerprintData = FingerprintData::fromJson(doc);
-    switch (fingerprintData.type)
-    {
-    case FINGERPRINT_REGISTRATION:
-      Serial.println("[MQTT] Received FINGERPRINT_REGISTRATION");
-      Serial.print  ("[MQTT] Calling registerFingerprint()… ");
-      uint16_t id = registerFingerprint(fingerprintCallback);
-      Serial.print  ("[MQTT] registerFingerprint() returned ID=");
-      Serial.println(id);
-      Serial.println("[MQTT] After registerFingerprint()");
-      if (id > 0)
-      {
-         Serial.println("[MQTT] id > 0, proceeding to send update");
-          bool isNew = fingerprintUserIds.count(id) == 0;
-          char allocatedUserId[strlen(fingerprintData.userId) + 1];
-          strcpy(allocatedUserId, fingerprintData.userId);
-          fingerprintUserIds[id] = string(allocatedUserId);
+    espNowLink.setPeer(body, bodyLength);
+  }
+  else
+  {
+    handlers.onMessage(subtopic, body, bodyLength);
+  }
+}
 
-          FingerprintData newFingerprintData = {
-            FINGERPRINT_UPDATE,
-            fingerprintData.userId,
-            isNew
-          };
+// Runs step by step until the registration finishes, so the other tasks keep running meanwhile.
+bool enrollmentTask()
+{
+  if (!getFingerprintEnrollment().isActive())
+  {
+    return startFingerprintEnrollment(fingerprintCallback);
+  }
 
-          // Serialize to JSON
-          StaticJsonDocument<256> jsonDoc;
-          newFingerprintData.toJson(jsonDoc);
-          char jsonOut[256];
-          size_t jsonLen = serializeJson(jsonDoc, jsonOut, sizeof(jsonOut));
+  switch (loopFingerprintEnrollment())
+  {
+  case ENROLLMENT_SUCCEEDED:
+  {
+    handlers.onEnrollmentSucceeded(getFingerprintEnrollment().getId());
+    return false;
+  }
+  case ENROLLMENT_FAILED:
+  case ENROLLMENT_IDLE:
+    return false;
+  default:
+    return true;
+  }
+}
 
-          // Build topic
-          String topicStr = String(WROVER_UNIQUE_ID) + String("/") + String(FingerprintData::TOPIC);
+bool networkTask()
+{
+  loopMQTT();
+  espNowLink.loop(WROOM_UNIQUE_ID, mqttCallback);
+  return false;
+}
 
-          // Debug prints
-          Serial.print("[MQTT] Publishing to topic: ");
-          Serial.println(topicStr);
-          Serial.print("[MQTT] Payload (len=");
-          Serial.print(jsonLen);
-          Serial.print("): ");
-          Serial.println(jsonOut);
+// Set by the touch interrupt and read by the scan task. The interrupt only writes these and calls
+// esp_timer_get_time() (in IRAM), the scan policy and millis() are not safe from it.
+static volatile bool fingerprintTouched = false;
+static volatile uint32_t fingerprintTouchUs = 0;
 
-          // Actually publish
-          publishMQTT(topicStr.c_str(), (uint8_t*)jsonOut, jsonLen);
-          Serial.println("[MQTT] publishMQTT() called");
-      } else {
-        Serial.println("[MQTT] id == 0, registration failed or cancelled");
-      }
-      break;
-    }
+void IRAM_ATTR onFingerprintTouch()
+{
+  if (!fingerprintTouched)
+  {
+    fingerprintTouchUs = (uint32_t)esp_timer_get_time();
+    fingerprintTouched = true;
   }
 }
 
-void loopScanFingerprint()
+// Runs every FINGERPRINT_FAST_SCAN_MS, the scan policy decides whether the sensor is polled.
+bool scanFingerprintTask()
 {
-  if (!isFingerprintRegistering)
+  if (fingerprintTouched)
   {
-    int16_t id = scanFingerprint();
-    if (id >= 0)
-    {
-      string fingerprintUserId = fingerprintUserIds[id];
-
-      FingerprintData newFingerprintData = {FINGERPRINT_TOUCH, fingerprintUserId.c_str()};
-
-      JsonDocument json;
-      newFingerprintData.toJson(json);
-      uint8_t jsonBuffer[256];
-      size_t jsonLen = serializeJson(json, jsonBuffer);
+    uint32_t touchAgeUs = (uint32_t)esp_timer_get_time() - fingerprintTouchUs;
+    fingerprintTouched = false;
+    scanPolicy.onTouch(millis() - touchAgeUs / 1000);
+  }
 
-      publishMQTT(string(WROVER_UNIQUE_ID + string("/sensor/fingerprint")).c_str(), jsonBuffer, jsonLen);
+  uint32_t triggerMs;
+  if (isFingerprintRegistering || !scanPolicy.isDue(millis(), triggerMs))
+  {
+    return false;
+  }
 
-      displayText(fingerprintUserId == "" ? "Hello!" : string("Hello, " + fingerprintUserId + "!").c_str(), 2000);
-    }
+  int16_t id = scanFingerprint();
+  fingerprintScans.add();
+  if (id == FINGERPRINT_SCAN_ERROR)
+  {
+    scanPolicy.onError(millis());
+    return false;
+  }
+  // A finger kept on the sensor rings once, until it is lifted.
+  if (!scanPolicy.onScanned(id >= 0, millis()))
+  {
+    return false;
+  }
+  if (id > 0)
+  {
+    fingerprintMatches.add();
   }
+
+  handlers.onFingerprintScanned(id, millis() - triggerMs);
+  scanLatency.record(millis() - triggerMs);
+  return false;
 }
 
-void loopUltrasonicSensor()
+bool oledTask()
 {
-  float distance = fetchDistance();
-  if (distance < 0) {
-    Serial.println("Distance: no echo");
-  } else {
-    Serial.printf("Distance: %.1f cm\n", distance);
-  }
-  Serial.printf("Max Distance: %d cm\n", MAX_ULTRASONIC_DISTANCE);
-  Serial.printf("isSomeoneClose: %s\n\n", (distance>0 && distance <= MAX_ULTRASONIC_DISTANCE) ? "true":"false");
+  ScopedTimer timer(oledFlushUs);
+  loopOLED();
+  return false;
+}
 
-  if (distance <= MAX_ULTRASONIC_DISTANCE && !isSomeoneClose)
+bool ultrasonicTask()
+{
+  float distance;
+  while (readUltrasonic(distance))
   {
-    isSomeoneClose = true;
-    UltrasonicData newFingerprintData = {true};
+    switch (distanceFilter.update(distance))
+    {
+    case DISTANCE_ENTERED:
+      LOG_DEBUG("Someone is close (%.1f cm)\n", distanceFilter.getDistance());
+      handlers.onProximity();
+      scanPolicy.onProximity(true, millis());
+      proximityEvents.add();
+      break;
+    case DISTANCE_LEFT:
+      LOG_DEBUG("Nobody is close anymore (%.1f cm)\n", distanceFilter.getDistance());
+      scanPolicy.onProximity(false, millis());
+      break;
+    case DISTANCE_NO_EVENT:
+      break;
+    }
+  }
 
-    JsonDocument json;
-    newFingerprintData.toJson(json);
-    uint8_t jsonBuffer[256];
-    size_t jsonLen = serializeJson(json, jsonBuffer);
+  // The echo of this trigger is read on the next run.
+  triggerUltrasonic();
+  return false;
+}
 
-    publishMQTT(string(WROVER_UNIQUE_ID + string("/sensor/ultrasonic")).c_str(), jsonBuffer, jsonLen);
-  }
-  else
+bool schedulerStatsTask()
+{
+  for (size_t i = 0; i < scheduler.getTaskCount(); i++)
   {
-    isSomeoneClose = false;
+    const SchedulerTaskStats &stats = scheduler.getTaskStats(i);
+    LOG_DEBUG("[Scheduler] %-12s runs=%u avg=%uus max=%uus jitter=%uus overruns=%u\n",
+              scheduler.getTaskName(i), stats.runs, stats.averageRunUs(), stats.maxRunUs, stats.maxJitterUs, stats.overruns);
   }
-  delay(500);
+  const FrameFlusherStats &oledStats = getOLEDStats();
+  LOG_DEBUG("[OLED] requests=%u flushes=%u skipped=%u coalesced=%u bytes=%llu\n",
+            oledStats.requests, oledStats.flushes, oledStats.skipped, oledStats.coalesced, (unsigned long long)oledStats.totalBytes);
+  const BitmapCacheStats &qrStats = getQRCodeCacheStats();
+  LOG_DEBUG("[OLED] QR cache hits=%u misses=%u evictions=%u saved=%llums\n",
+            qrStats.hits, qrStats.misses, qrStats.evictions, (unsigned long long)(qrStats.savedUs / 1000));
+  publishMetrics(WROOM_UNIQUE_ID);
+  return false;
 }
 
 void setup()
 {
-  Serial.begin(9600);
-  Serial.println("Loading WiFi...");
+  loadLogger();
+  LOG_INFO("Loading WiFi...\n");
   connectWifi(WIFI_SSID, WIFI_PASSWORD);
-  Serial.println("Loading timestamp...");
+  LOG_INFO("Loading timestamp...\n");
   configTimestamp();
-  Serial.println("Loading OLED...");
+  LOG_INFO("Loading OLED...\n");
   loadOLED();
-  Serial.println("Loading fingerprint...");
+  LOG_INFO("Loading fingerprint...\n");
   loadFingerprint();
-  Serial.println("Loading ultrasonic...");
+  if (attachFingerprintTouch(onFingerprintTouch))
+  {
+    LOG_INFO("Fingerprint touch line attached\n");
+  }
+  LOG_INFO("Loading ultrasonic...\n");
   loadUltrasonic();
-  Serial.println("Loading MQTT...");
-  loadMQTT(MQTT_SERVER, MQTT_PORT, mqttCallback);
-
-  fullTopics = addPrefixToTopics(fmt::format("{}/", WROOM_UNIQUE_ID).c_str(), MQTT_TOPICS, MQTT_TOPIC_COUNT);
+  LOG_INFO("Loading ESP-NOW...\n");
+  espNowLink.begin();
+  LOG_INFO("Loading MQTT...\n");
+  loadMQTT(MQTT_SERVER, MQTT_PORT, WROOM_UNIQUE_ID, MQTT_USERNAME, MQTT_PASSWORD, mqttCallback);
+  setMQTTConnectCallback([]()
+                         { espNowLink.announce(WROVER_UNIQUE_ID); });
 
-  Serial.println("------------------");
-  Serial.print("Unique ID: ");
-  Serial.println(WROOM_UNIQUE_ID);
-  Serial.print("MAC address: ");
-  Serial.println(WiFi.macAddress());
-  Serial.println("------------------");
+  LOG_INFO("------------------\n");
+  LOG_INFO("Unique ID: %s\n", WROOM_UNIQUE_ID);
+  LOG_INFO("MAC address: %s\n", WiFi.macAddress().c_str());
+  LOG_INFO("------------------\n");
 
-  Serial.println("Ready!");
+  LOG_INFO("Ready!\n");
   int dotCount = 0;
-  while (!initialOledReceived)
+  while (!handlers.hasReceivedOled())
   {
     char buf[16];
     int dots = dotCount % 4;
@@ -246,22 +260,32 @@ void setup()
     unsigned long start = millis();
     while (millis() - start < 500)
     {
-      loopMQTT(
-          WROOM_UNIQUE_ID,
-          MQTT_USERNAME,
-          MQTT_PASSWORD,
-          fullTopics,
-          MQTT_TOPIC_COUNT);
+      loopMQTT();
+      espNowLink.loop(WROOM_UNIQUE_ID, mqttCallback);
+      loopOLED();
       delay(20);
     }
     dotCount++;
   }  
+
+  // Make sure WROVER has every user registered here in Firestore (e.g. after an update was lost offline).
+  if (!handlers.syncUsers())
+  {
+    LOG_INFO("[WROOM] Fingerprint users already synced\n");
+  }
   
-  fingerprintIntervalTimer.attach_ms(2000, loopScanFingerprint);
-  ultrasonicIntervalTimer.attach_ms(2000, loopUltrasonicSensor);
+  scheduler.addPeriodic("network", networkTask, NETWORK_INTERVAL_MS, TASK_PRIORITY_HIGH);
+  scheduler.addPeriodic("fingerprint", scanFingerprintTask, FINGERPRINT_FAST_SCAN_MS, TASK_PRIORITY_NORMAL, FINGERPRINT_STEP_BUDGET_US);
+  scheduler.addPeriodic("oled", oledTask, OLED_INTERVAL_MS, TASK_PRIORITY_NORMAL, 30000);
+  scheduler.addPeriodic("ultrasonic", ultrasonicTask, ULTRASONIC_INTERVAL_MS, TASK_PRIORITY_NORMAL, 2000);
+  scheduler.addPeriodic("stats", schedulerStatsTask, SCHEDULER_STATS_INTERVAL_MS, TASK_PRIORITY_LOW);
+  enrollmentTaskId = scheduler.addEvent("enrollment", enrollmentTask, TASK_PRIORITY_LOW, FINGERPRINT_STEP_BUDGET_US);
 }
 
+// The Arduino loop task is pinned to the APP core, so every scheduled task (and the MQTT client,
+// which is not thread-safe) stays on one core, away from the WiFi stack.
 void loop()
 {
-  loopMQTT(WROOM_UNIQUE_ID, MQTT_USERNAME, MQTT_PASSWORD, fullTopics, MQTT_TOPIC_COUNT);
+  scheduler.loop();
+  delay(scheduler.getIdleUs(SCHEDULER_MAX_IDLE_US) / 1000);
 }
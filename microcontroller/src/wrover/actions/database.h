@@ -1,9 +1,7 @@
 #ifndef DATABASE_H
 #define DATABASE_H
 
-#include <Arduino.h>           
-#include <Firebase_ESP_Client.h> 
-#include <ArduinoJson.h>        
+#include <time.h>
 
 enum LogType {
   RING_DOORBELL = 0,
@@ -12,6 +10,9 @@ enum LogType {
   NEW_FINGERPRINT = 3
 };
 
+/**
+ * A log entry. It is encoded for Firestore by encodeLogDocument() (see log_encoder.h).
+ */
 struct LogData
 {
   LogType     type;
@@ -29,41 +30,27 @@ struct LogData
       userId((u && u[0] != '\0') ? u : "Anonymous")
   {
   }
+};
 
-  static String toRFC3339(int epoch)
-  {
-    struct tm tmstruct;
-    gmtime_r((time_t *)&epoch, &tmstruct);
-    char buf[32];
-    sprintf(buf,
-            "%04d-%02d-%02dT%02d:%02d:%02dZ",
-            tmstruct.tm_year + 1900,
-            tmstruct.tm_mon + 1,
-            tmstruct.tm_mday,
-            tmstruct.tm_hour,
-            tmstruct.tm_min,
-            tmstruct.tm_sec);
-    return String(buf);
-  }
-
-  String toJson() const
-  {
-    StaticJsonDocument<384> root;
-    JsonObject fields = root.createNestedObject("fields");
-    JsonObject typeObj = fields.createNestedObject("type");
-    typeObj["integerValue"] = static_cast<int>(type);
-    String ts = toRFC3339(createdAt);
-    JsonObject createdObj = fields.createNestedObject("createdAt");
-    createdObj["timestampValue"] = ts;
-    JsonObject photoObj = fields.createNestedObject("photoURL");
-    photoObj["stringValue"] = photoURL ? photoURL : "";
-    JsonObject userObj = fields.createNestedObject("userId");
-    userObj["stringValue"] = userId;
-
-    String out;
-    serializeJson(root, out);
-    return out;
-  }
+/**
+ * Photo and event logs of the node (photo pipeline and Firestore log sink).
+ */
+class EventLog
+{
+public:
+  virtual ~EventLog() {}
+
+  /**
+   * Queues a photo to be taken, uploaded and logged. Never blocks.
+   *
+   * @return Whether the request was queued.
+   */
+  virtual bool requestPhoto(LogType type, const char *userId) = 0;
+
+  /**
+   * Queues a log without a photo.
+   */
+  virtual void log(const char *nodeId, const LogData &logData) = 0;
 };
 
-#endif 
+#endif
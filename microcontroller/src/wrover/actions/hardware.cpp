@@ -1,18 +1,19 @@
 #include <common/camera.h>
 #include <common/supabase.h>
-#include <common/utils.h>
 #include <common/env/env.h>
+#include <common/firebase.h>
 #include <Firebase_ESP_Client.h>
 #undef B1
 #include <fmt/core.h>
 #include <Ticker.h>
 #include "database.h"
 #include "hardware.h"
-#include <common/mqtt.h>
-#include <common/mqtt_data.h>
+#include "pipeline.h"
+#include "log_sink.h"
+#include <common/metrics.h>
+#include <common/scenario_recorder.h>
+#include <common/log.h>
 #include <ArduinoJson.h>
-#include <Firebase_ESP_Client.h>
-#include <fmt/core.h>
 #include <time.h>
 
 using namespace std;
@@ -23,8 +24,6 @@ Ticker buzzerTimeoutTimer;
 
 extern const char *FIREBASE_PROJECT;
 
-FirebaseData fbdo;
-
 void beep(uint32_t duration)
 {
   digitalWrite(BUZZER_PIN, HIGH);
@@ -35,49 +34,167 @@ void beep(uint32_t duration)
                               digitalWrite(LED_PIN, LOW); });
 }
 
-void takePhotoToSupabase(const char *bucket, const char *folderName, function<void(string photoURL, time_t timestamp)> callback)
+class PinBuzzer : public Buzzer
+{
+public:
+  void beep(uint32_t durationMs) override { ::beep(durationMs); }
+};
+
+Buzzer &getBuzzer()
+{
+  static PinBuzzer buzzer;
+  return buzzer;
+}
+
+// Scenarios timed from the MQTT event to the photo log being queued for Firestore. The doorbell is
+// timed from the touch to the buzzer instead (WroverHandlers).
+static ScenarioRecorder proximityScenario("proximity_start", "proximity_done", "proximity_ms");         // Person close to the ultrasonic sensor.
+static ScenarioRecorder userRequestScenario("user_request_start", "user_request_done", "user_request_ms"); // take_photo from the app.
+
+static ScenarioRecorder *scenarioForLog(uint8_t logType)
+{
+  switch (logType)
+  {
+  case LogType::PROXIMITY:
+    return &proximityScenario;
+  case LogType::USER_REQUEST:
+    return &userRequestScenario;
+  default:
+    return nullptr;
+  }
+}
+
+static MetricHistogram firestoreUserUs("fs_user_us");
+
+static bool captureFrame(PhotoJob &job)
+{
+  camera_fb_t *fb = takePhotoAt(job.eventMs);
+  if (!fb)
+  {
+    return false;
+  }
+
+  job.timestamp = time(NULL);
+
+  // The frame is copied, so the camera buffer (or ring slot) goes back before the upload starts.
+  // A ring slot pinned for a whole upload stops being refreshed, and a burst of events would pin
+  // every slot and leave later photos on stale frames.
+  job.image = (uint8_t *)(psramFound() ? ps_malloc(fb->len) : malloc(fb->len));
+  if (job.image)
+  {
+    memcpy(job.image, fb->buf, fb->len);
+    job.imageLen = fb->len;
+  }
+  releasePhoto(fb);
+
+  return job.image != nullptr;
+}
+
+static bool uploadFrame(PhotoJob &job)
+{
+  string filePath = fmt::format("{}/{}.jpg", WROVER_UNIQUE_ID, job.timestamp);
+
+  int res = uploadToSupabase(SUPABASE_BUCKET, filePath.c_str(), "image/jpeg", job.image, job.imageLen);
+  if (res < 200 || res >= 300)
+  {
+    LOG_ERROR("[uploadFrame] Supabase upload failed: %d\n", res);
+    job.photoURL[0] = '\0';
+    return false;
+  }
+
+  string photoURL = fmt::format(SUPABASE_PUBLIC_STORAGE_URL_TEMPLATE, SUPABASE_URL, SUPABASE_BUCKET, filePath);
+  strlcpy(job.photoURL, photoURL.c_str(), sizeof(job.photoURL));
+  return true;
+}
+
+static void logFrame(const PhotoJob &job)
 {
-  camera_fb_t *fb = takePhoto();
+  LogData logData = {
+      static_cast<LogType>(job.logType),
+      (int)job.timestamp,
+      job.photoURL,
+      job.userId};
+  logToFirebase(WROVER_UNIQUE_ID, logData);
+  ScenarioRecorder *scenario = scenarioForLog(job.logType);
+  if (scenario)
+  {
+    scenario->finish(millis() - job.eventMs);
+  }
+}
 
-  time_t now = time(NULL);
-  string filename = to_string(now) + ".jpg";
-  string filePath = (string)folderName + "/" + filename;
+static void releaseFrame(PhotoJob &job)
+{
+  free(job.image);
+  job.image = nullptr;
+  job.imageLen = 0;
+}
 
-  int res = supabase.upload(bucket, filePath.c_str(), "image/jpeg", fb->buf, fb->len);
+static PhotoPipeline photoPipeline({
+    captureFrame,
+    uploadFrame,
+    logFrame,
+    releaseFrame,
+    []() -> uint32_t
+    { return micros(); },
+});
 
-  esp_camera_fb_return(fb);
+bool loadPhotoPipeline()
+{
+  return photoPipeline.start();
+}
 
-  string photoURL = fmt::format(SUPABASE_PUBLIC_STORAGE_URL_TEMPLATE, SUPABASE_URL, bucket, filePath);
+bool requestPhotoLog(LogType type, const char *userId)
+{
+  ScenarioRecorder *scenario = scenarioForLog(type);
+  if (scenario)
+  {
+    scenario->start();
+  }
+  return photoPipeline.enqueue(type, userId, millis());
+}
 
-  callback(photoURL, now);
+PhotoPipelineStats getPhotoPipelineStats()
+{
+  return photoPipeline.getStats();
 }
 
-void addFingerprintUserToFirebase(const char *nodeId, const char *userId)
+bool addFingerprintUserToFirebase(const char *nodeId, const char *userId)
 {
-  Serial.printf("[addFingerprintUserToFirebase] nodeId: %s | userId: %s\n", nodeId, userId);
+  ScopedTimer timer(firestoreUserUs);
+  LOG_INFO("[addFingerprintUserToFirebase] nodeId: %s | userId: %s\n", nodeId, userId);
 
   String path = "devices/";
   path.concat(nodeId);
 
-  Serial.print("[addFingerprintUserToFirebase] Fetching document at "); Serial.println(path);
+  FirestoreSession session;
+
+  LOG_DEBUG("[addFingerprintUserToFirebase] Fetching document at %s\n", path.c_str());
 
   if (!Firebase.Firestore.getDocument(&fbdo, FIREBASE_PROJECT, "", path.c_str()))
   {
-    Serial.printf("[addFingerprintUserToFirebase] getDocument failed: %s\n", fbdo.errorReason().c_str());
-    return;
+    LOG_ERROR("[addFingerprintUserToFirebase] getDocument failed: %s\n", fbdo.errorReason().c_str());
+    return false;
   }
-  Serial.printf("[addFingerprintUserToFirebase] HTTP code: %d\n", fbdo.httpCode());
+  LOG_DEBUG("[addFingerprintUserToFirebase] HTTP code: %d\n", fbdo.httpCode());
   if (fbdo.httpCode() != 200)
   {
-    return;
+    return false;
   }
 
   DynamicJsonDocument inDoc(1024);
   deserializeJson(inDoc, fbdo.payload());
   JsonVariant valuesVar = inDoc["fields"]["registeredUsers"]["arrayValue"]["values"];
   bool hasExisting = valuesVar.is<JsonArray>();
-  Serial.printf("[addFingerprintUserToFirebase] existing registeredUsers array? %s\n", hasExisting ? "yes" : "no");
+  LOG_DEBUG("[addFingerprintUserToFirebase] existing registeredUsers array? %s\n", hasExisting ? "yes" : "no");
   JsonArray existing = hasExisting ? valuesVar.as<JsonArray>() : JsonArray();
+  for (JsonObject v : existing)
+  {
+    if (strcmp(v["stringValue"] | "", userId) == 0)
+    {
+      LOG_DEBUG("[addFingerprintUserToFirebase] user already registered\n");
+      return true;
+    }
+  }
 
   String body = "{\"fields\":{";
   body.concat("\"registeredUsers\":{");
@@ -99,73 +216,21 @@ void addFingerprintUserToFirebase(const char *nodeId, const char *userId)
   body.concat("\"}");
   body.concat("]}}}}");
 
-  Serial.println("[addFingerprintUserToFirebase] Patching document with new registeredUsers list");
+  LOG_DEBUG("[addFingerprintUserToFirebase] Patching document with new registeredUsers list\n");
   if (!Firebase.Firestore.patchDocument(&fbdo, FIREBASE_PROJECT, "", path, body, "registeredUsers"))
   {
-    Serial.printf("[addFingerprintUserToFirebase] patchDocument failed: %s\n", fbdo.errorReason().c_str());
-    return;
+    LOG_ERROR("[addFingerprintUserToFirebase] patchDocument failed: %s\n", fbdo.errorReason().c_str());
+    return false;
   }
-  Serial.println("[addFingerprintUserToFirebase] patchDocument succeeded");
+  LOG_DEBUG("[addFingerprintUserToFirebase] patchDocument succeeded\n");
+  return true;
 }
 
 void logToFirebase(const char *deviceId, LogData logData)
 {
-  // 1) Convert createdAt (epoch seconds) → RFC3339 string: "YYYY-MM-DDThh:mm:ssZ"
-  time_t raw      = (time_t)logData.createdAt;
-  struct tm tmbuf;
-  gmtime_r(&raw, &tmbuf);
-  char ts[32];
-  strftime(ts, sizeof(ts), "%FT%TZ", &tmbuf);
-  //   e.g. ts == "2025-06-04T12:34:56Z"
-
-  // 2) Build Firestore JSON payload under "fields": { … }
-  String payload = "{ \"fields\": {";
-
-  // nodeId → stringValue
-  payload += "\"deviceId\":{ \"stringValue\":\"";
-  payload += deviceId;
-  payload += "\" },";
-
-  // createdAt → timestampValue
-  payload += "\"createdAt\":{ \"timestampValue\":\"";
-  payload += ts;
-  payload += "\" },";
-
-  // photoURL → stringValue
-  payload += "\"photoURL\":{ \"stringValue\":\"";
-  payload += (logData.photoURL ? logData.photoURL : "");
-  payload += "\" },";
-
-  // type → integerValue
-  payload += "\"type\":{ \"integerValue\":\"";
-  payload += String(static_cast<int>(logData.type));
-  payload += "\" },";
-
-  // userId → stringValue
-  payload += "\"userId\":{ \"stringValue\":\"";
-  payload += (logData.userId ? logData.userId : "Anonymous");
-  payload += "\" }";
-
-  // close the “fields” container
-  payload += " }}";
-
-  // 3) Write to Firestore under collection “logs”, with an auto‐generated document ID:
-  if (! Firebase.Firestore.createDocument(
-          &fbdo,
-          FIREBASE_PROJECT,
-         "",       
-         "logs",   
-         "",      
-          payload.c_str(),
-         ""       
-          ))
+  if (!appendLog(deviceId, logData))
   {
-    Serial.printf("Firestore.createDocument failed: %s\n",
-                  fbdo.errorReason().c_str());
-  }
-  else
-  {
-    Serial.println("Log successfully written to Firestore → logs collection");
+    LOG_ERROR("Failed to queue log for Firestore\n");
   }
 }
 
@@ -173,80 +238,50 @@ bool deviceHasOwner(const char *nodeId)
 {
   String path = "devices/";
   path.concat(nodeId);
+
+  FirestoreSession session;
   if (!Firebase.Firestore.getDocument(&fbdo, FIREBASE_PROJECT, "", path.c_str())) {
-    Serial.printf("getDocument failed: %s\n", fbdo.errorReason().c_str());
+    LOG_WARN("getDocument failed: %s\n", fbdo.errorReason().c_str());
     return false;
   }
   if (fbdo.httpCode() != 200) {
-    Serial.printf("HTTP %d on getDocument for %s\n", fbdo.httpCode(), path.c_str());
+    LOG_WARN("HTTP %d on getDocument for %s\n", fbdo.httpCode(), path.c_str());
     return false;
   }
   DynamicJsonDocument json(512);
   deserializeJson(json, fbdo.payload());
   const char *owner = json["fields"]["ownerId"]["stringValue"];
   if (!owner || strlen(owner) == 0) {
-    Serial.println("no owner set");
+    LOG_INFO("no owner set\n");
     return false;
   }
 
-  Serial.printf("ownerId is set to: %s\n", owner);
+  LOG_INFO("ownerId is set to: %s\n", owner);
   return true;
 }
 
-void sendOled(const char *payloadJson)
+class FirestoreDatabase : public DeviceDatabase
 {
-  static unsigned long lastTs = 0;
-  unsigned long now = millis();
-  Serial.printf("\n[WROVER %lu] ➤ sendOled() called\n", now - lastTs);
-  lastTs = now;
-
-  String topic = WROOM_UNIQUE_ID;
-  topic.concat("/");
-  topic.concat(OledData::TOPIC);
+public:
+  bool hasOwner(const char *nodeId) override { return deviceHasOwner(nodeId); }
+  bool addUser(const char *nodeId, const char *userId) override { return addFingerprintUserToFirebase(nodeId, userId); }
+};
 
-  Serial.printf("[WROVER]   topic: %s\n", topic.c_str());
-  Serial.printf("[WROVER]   payload: %s\n", payloadJson);
-  publishMQTT(topic.c_str(), (uint8_t*)payloadJson, strlen(payloadJson));
-}
-
-
-void showRegistrationPrompt()
+DeviceDatabase &getFirestoreDatabase()
 {
-  JsonDocument jd;
-  jd["layout"]   = "side_by_side";
-  jd["qrData"]   = WROVER_UNIQUE_ID;
-  jd["textData"] = "Please register via app";
-
-  String payload;
-  serializeJson(jd, payload);
-  sendOled(payload.c_str());
+  static FirestoreDatabase database;
+  return database;
 }
 
-void showWelcome()
+class PipelineEventLog : public EventLog
 {
-  JsonDocument jd;
-  jd["message"]   = "Welcome to Lookout!";
-  jd["isQrCode"]  = false;
+public:
+  bool requestPhoto(LogType type, const char *userId) override { return requestPhotoLog(type, userId); }
+  void log(const char *nodeId, const LogData &logData) override { logToFirebase(nodeId, logData); }
+};
 
-  String payload;
-  serializeJson(jd, payload);
-  sendOled(payload.c_str());
-}
-
-void showFingerprintPrompt() {
-  StaticJsonDocument<128> jd;
-  jd["message"]   = "Place your finger on\nthe sensor";
-  jd["isQrCode"]  = false;
-  String out;
-  serializeJson(jd, out);
-  sendOled(out.c_str());
+EventLog &getEventLog()
+{
+  static PipelineEventLog events;
+  return events;
 }
-
-void showRegisterPrompt() {
-  StaticJsonDocument<128> jd;
-  jd["message"]   = "Place your preferred \nfinger on the sensor\n to register";
-  jd["isQrCode"]  = false;
-  String out;
-  serializeJson(jd, out);
-  sendOled(out.c_str());
-}
\ No newline at end of file
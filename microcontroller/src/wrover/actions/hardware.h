@@ -1,7 +1,10 @@
 #ifndef HARDWARE_ACTIONS_H
 #define HARDWARE_ACTIONS_H
 
+#include <stdint.h>
 #include "database.h"
+#include "pipeline.h"
+#include <common/hal.h>
 
 using namespace std;
 
@@ -16,24 +19,43 @@ static const int LED_PIN = 2;
 void beep(uint32_t duration);
 
 /**
- * Takes a photo and uploads it to Supabase.
+ * Returns beep() as a Buzzer backend.
+ */
+Buzzer &getBuzzer();
+
+/**
+ * Starts the capture -> upload -> log photo pipeline (REQUIRED AT THE START).
  *
- * @param bucket The name of the Supabase bucket where the photo will be uploaded.
- * @param folderName The name of the folder in Supabase where the photo will be uploaded.
- * @param callback The callback function to be called when photo is send.
+ * @return Whether loaded successfully.
  */
-void takePhotoToSupabase(const char *bucket, const char *folderName, function<void(string photoURL, time_t timestamp)> callback);
+bool loadPhotoPipeline();
 
 /**
- * Adds a fingerprint user to Firebase.
+ * Queues a photo to be taken, uploaded to Supabase and logged to Firebase.
+ * Returns immediately, so it is safe to call from the MQTT callback.
+ *
+ * @param type The type of log to store alongside the photo.
+ * @param userId The ID of the user that triggered the photo (optional).
+ * @return Whether the request was queued (false when the pipeline is full).
+ */
+bool requestPhotoLog(LogType type, const char *userId = "");
+
+/**
+ * Returns a snapshot of the per-stage counters and latencies of the photo pipeline.
+ */
+PhotoPipelineStats getPhotoPipelineStats();
+
+/**
+ * Adds a fingerprint user to the registeredUsers of the device in Firebase (once per user).
  *
  * @param userId The ID of the user to be added.
  * @param nodeId The ID of the node (ESP32) where the user is being added.
+ * @return Whether the user is registered (already or now).
  */
-void addFingerprintUserToFirebase(const char *nodeId, const char *userId);
+bool addFingerprintUserToFirebase(const char *nodeId, const char *userId);
 
 /**
- * Logs data to Firebase.
+ * Logs data to Firebase (queued and written in batches by the log sink).
  *
  * @param nodeId The ID of the node (ESP32) where the log is being sent.
  * @param logData The log data to be sent.
@@ -46,19 +68,13 @@ void logToFirebase(const char *nodeId, LogData logData);
 bool deviceHasOwner(const char *nodeId);
 
 /**
- * Sends two MQTT‐OLED commands to the Wroom:
- *   1) QR code with the Wrover’s unique ID
- *   2) “Please register via app” text
+ * Returns deviceHasOwner() and addFingerprintUserToFirebase() as a DeviceDatabase backend.
  */
-void showRegistrationPrompt();
+DeviceDatabase &getFirestoreDatabase();
 
 /**
- * Sends one MQTT‐OLED command to the Wroom:
- *   “Welcome to Lookout!”
+ * Returns requestPhotoLog() and logToFirebase() as an EventLog backend.
  */
-void showWelcome();
-
-void showFingerprintPrompt();
-void showRegisterPrompt();
+EventLog &getEventLog();
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,146 @@
+#include <string.h>
+#include "log_encoder.h"
+
+// Field prefixes of the Firestore document, emitted as-is.
+static const char DOC_OPEN[] = "{\"fields\":{\"deviceId\":{\"stringValue\":\"";
+static const char CREATED_AT_PREFIX[] = "\"},\"createdAt\":{\"timestampValue\":\"";
+static const char PHOTO_URL_PREFIX[] = "\"},\"photoURL\":{\"stringValue\":\"";
+static const char TYPE_PREFIX[] = "\"},\"type\":{\"integerValue\":\"";
+static const char USER_ID_PREFIX[] = "\"},\"userId\":{\"stringValue\":\"";
+static const char DOC_CLOSE[] = "\"}}}";
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+struct Writer
+{
+  char *out;
+  size_t size;
+  size_t len = 0;
+  bool overflow = false;
+
+  Writer(char *o, size_t s) : out(o), size(s) {}
+
+  void put(const char *data, size_t n)
+  {
+    if (overflow || len + n >= size)
+    {
+      overflow = true;
+      return;
+    }
+    memcpy(out + len, data, n);
+    len += n;
+  }
+
+  template <size_t N>
+  void put(const char (&literal)[N])
+  {
+    put(literal, N - 1);
+  }
+
+  void putEscaped(const char *str)
+  {
+    for (const char *c = str ? str : ""; *c; c++)
+    {
+      unsigned char ch = (unsigned char)*c;
+      if (ch == '"' || ch == '\\')
+      {
+        char escaped[2] = {'\\', (char)ch};
+        put(escaped, 2);
+      }
+      else if (ch < 0x20)
+      {
+        char escaped[6] = {'\\', 'u', '0', '0', HEX_DIGITS[ch >> 4], HEX_DIGITS[ch & 0xF]};
+        put(escaped, 6);
+      }
+      else
+      {
+        put((const char *)&ch, 1);
+      }
+    }
+  }
+
+  void putUnsigned(uint32_t value)
+  {
+    char digits[10];
+    size_t n = sizeof(digits);
+    do
+    {
+      digits[--n] = (char)('0' + value % 10);
+      value /= 10;
+    } while (value);
+    put(digits + n, sizeof(digits) - n);
+  }
+};
+
+static inline void twoDigits(char *out, int value)
+{
+  out[0] = (char)('0' + value / 10);
+  out[1] = (char)('0' + value % 10);
+}
+
+size_t formatRFC3339(int64_t epoch, char *out)
+{
+  int64_t days = epoch / 86400;
+  int64_t secs = epoch % 86400;
+  if (secs < 0)
+  {
+    secs += 86400;
+    days--;
+  }
+
+  // Civil date from days since 1970-01-01 (proleptic Gregorian, H. Hinnant's algorithm).
+  days += 719468;
+  int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  int64_t doe = days - era * 146097;
+  int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  int64_t mp = (5 * doy + 2) / 153;
+  int day = (int)(doy - (153 * mp + 2) / 5 + 1);
+  int month = (int)(mp < 10 ? mp + 3 : mp - 9);
+  int year = (int)(yoe + era * 400 + (month <= 2));
+
+  twoDigits(out, year / 100 % 100);
+  twoDigits(out + 2, year % 100);
+  out[4] = '-';
+  twoDigits(out + 5, month);
+  out[7] = '-';
+  twoDigits(out + 8, day);
+  out[10] = 'T';
+  twoDigits(out + 11, (int)(secs / 3600));
+  out[13] = ':';
+  twoDigits(out + 14, (int)(secs / 60 % 60));
+  out[16] = ':';
+  twoDigits(out + 17, (int)(secs % 60));
+  out[19] = 'Z';
+  out[20] = '\0';
+  return 20;
+}
+
+size_t encodeLogDocument(char *out, size_t size, const char *deviceId, uint8_t type, int32_t createdAt, const char *photoURL, const char *userId)
+{
+  char timestamp[RFC3339_SIZE];
+  size_t timestampLen = formatRFC3339(createdAt, timestamp);
+
+  Writer w(out, size);
+  w.put(DOC_OPEN);
+  w.putEscaped(deviceId);
+  w.put(CREATED_AT_PREFIX);
+  w.put(timestamp, timestampLen);
+  w.put(PHOTO_URL_PREFIX);
+  w.putEscaped(photoURL);
+  w.put(TYPE_PREFIX);
+  w.putUnsigned(type);
+  w.put(USER_ID_PREFIX);
+  w.putEscaped(userId);
+  w.put(DOC_CLOSE);
+
+  if (w.overflow)
+  {
+    if (size > 0)
+      out[0] = '\0';
+    return 0;
+  }
+
+  out[w.len] = '\0';
+  return w.len;
+}
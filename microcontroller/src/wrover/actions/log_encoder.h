@@ -0,0 +1,37 @@
+#ifndef LOG_ENCODER_H
+#define LOG_ENCODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// "YYYY-MM-DDThh:mm:ssZ" plus the terminator.
+static const size_t RFC3339_SIZE = 21;
+
+// Enough for a LogRecord with every string at its maximum length and no escaping.
+static const size_t LOG_DOCUMENT_SIZE = 512;
+
+/**
+ * Formats epoch seconds as an RFC 3339 UTC timestamp, without going through gmtime/strftime.
+ *
+ * @param epoch The epoch seconds.
+ * @param out The output buffer (at least RFC3339_SIZE bytes).
+ * @return The formatted length.
+ */
+size_t formatRFC3339(int64_t epoch, char *out);
+
+/**
+ * Encodes a log as a Firestore document ({"fields": {...}} with typed values) into a caller-provided
+ * buffer, without allocating.
+ *
+ * @param out The output buffer.
+ * @param size The output buffer size.
+ * @param deviceId The ID of the node (ESP32) sending the log.
+ * @param type The LogType.
+ * @param createdAt The epoch seconds of the event.
+ * @param photoURL The photo URL (may be empty).
+ * @param userId The user ID.
+ * @return The encoded length, 0 if the document did not fit.
+ */
+size_t encodeLogDocument(char *out, size_t size, const char *deviceId, uint8_t type, int32_t createdAt, const char *photoURL, const char *userId);
+
+#endif
@@ -0,0 +1,142 @@
+#include "log_queue.h"
+
+void LogQueue::load()
+{
+  uint32_t size = store.size();
+  uint32_t head = store.loadHead();
+  fileBase = 0;
+  walHead = head <= size ? head : 0;
+  walSize = size;
+  if (walHead > 0 || walSize % RECORD_SIZE != 0)
+  {
+    walSize = store.compact(walHead);
+    walHead = 0;
+    store.saveHead(0);
+  }
+  isolateUntil = 0;
+  oldestPendingMs = clockMs();
+}
+
+bool LogQueue::append(const LogRecord &record)
+{
+  if (getPending() >= maxPending)
+  {
+    walHead += RECORD_SIZE;
+    stats.dropped++;
+    compactIfWorthIt();
+    store.saveHead(walHead - fileBase);
+  }
+
+  if (!store.append(record))
+  {
+    return false;
+  }
+  if (walSize == walHead)
+  {
+    oldestPendingMs = clockMs();
+  }
+  walSize += RECORD_SIZE;
+  stats.appended++;
+  return true;
+}
+
+bool LogQueue::isFlushDue() const
+{
+  uint32_t pending = getPending();
+  bool isDue = pending >= BATCH_SIZE || (pending > 0 && clockMs() - oldestPendingMs >= batchMaxAgeMs);
+  bool isBackingOff = retryDelayMs > 0 && (int32_t)(clockMs() - retryAtMs) < 0;
+  return isDue && !isBackingOff;
+}
+
+size_t LogQueue::readBatch(LogRecord *records, uint32_t &batchHead)
+{
+  batchHead = walHead;
+  size_t limit = walHead < isolateUntil ? 1 : BATCH_SIZE;
+  if (limit > getPending())
+  {
+    limit = getPending();
+  }
+  return limit > 0 ? store.read(walHead - fileBase, records, limit) : 0;
+}
+
+bool LogQueue::isRetryable(int status)
+{
+  // The Firebase client renews its token by itself, so 401 and 403 are worth retrying too.
+  return status <= 0 || status == 401 || status == 403 || status == 408 || status == 429 || status >= 500;
+}
+
+void LogQueue::onCommitted(uint32_t batchHead, size_t count, int status, uint32_t elapsedMs)
+{
+  uint32_t end = batchHead + count * RECORD_SIZE;
+
+  if (status >= 200 && status < 300)
+  {
+    advance(end);
+    stats.flushed += count;
+    stats.batches++;
+    stats.lastFlushMs = elapsedMs;
+    stats.totalFlushMs += elapsedMs;
+    if (elapsedMs > stats.maxFlushMs)
+      stats.maxFlushMs = elapsedMs;
+    if (stats.firstFlushAtMs == 0)
+      stats.firstFlushAtMs = clockMs() - elapsedMs;
+    stats.lastFlushAtMs = clockMs();
+    retryDelayMs = 0;
+  }
+  else if (!isRetryable(status))
+  {
+    // A commit is all or nothing, so a batch is retried record by record to find the bad ones.
+    if (count > 1)
+    {
+      isolateUntil = end;
+    }
+    else
+    {
+      advance(end);
+      stats.rejected += count;
+    }
+    retryDelayMs = 0;
+  }
+  else
+  {
+    stats.failures++;
+    retryDelayMs = retryDelayMs ? (retryDelayMs * 2 < retryMaxMs ? retryDelayMs * 2 : retryMaxMs) : retryMinMs;
+    retryAtMs = clockMs() + retryDelayMs;
+  }
+}
+
+LogSinkStats LogQueue::getStats() const
+{
+  LogSinkStats snapshot = stats;
+  snapshot.pending = getPending();
+  return snapshot;
+}
+
+void LogQueue::advance(uint32_t end)
+{
+  // Records dropped while committing may already have moved the head past part of the batch.
+  if (end > walHead)
+    walHead = end;
+
+  if (walHead == walSize)
+  {
+    store.clear();
+    fileBase = walHead = walSize = isolateUntil = 0;
+    return;
+  }
+  compactIfWorthIt();
+  store.saveHead(walHead - fileBase);
+  oldestPendingMs = clockMs();
+}
+
+void LogQueue::compactIfWorthIt()
+{
+  uint32_t sent = walHead - fileBase;
+  if (sent < COMPACT_MIN_RECORDS * RECORD_SIZE || sent < walSize - walHead)
+  {
+    return;
+  }
+  walSize = walHead + store.compact(sent);
+  fileBase = walHead;
+  stats.compactions++;
+}
@@ -0,0 +1,178 @@
+#ifndef LOG_QUEUE_H
+#define LOG_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A log as stored in the write-ahead queue (fixed size, so the queue file can be indexed).
+ */
+struct LogRecord
+{
+  uint8_t type;
+  int32_t createdAt;
+  uint32_t id; // Random document ID suffix, so retried batches overwrite instead of duplicating.
+  char deviceId[40];
+  char userId[40];
+  char photoURL[192];
+};
+
+struct LogSinkStats
+{
+  uint32_t appended = 0;
+  uint32_t flushed = 0;
+  uint32_t batches = 0;
+  uint32_t failures = 0;
+  uint32_t dropped = 0;  // Oldest records discarded because the queue was full.
+  uint32_t rejected = 0; // Records Firestore refused (e.g. 400), discarded instead of retried.
+  uint32_t compactions = 0;
+  uint32_t pending = 0;
+  uint32_t lastFlushMs = 0;
+  uint32_t maxFlushMs = 0;
+  uint64_t totalFlushMs = 0;
+  uint32_t firstFlushAtMs = 0;
+  uint32_t lastFlushAtMs = 0;
+
+  /**
+   * Flushed logs per second since the first flush.
+   */
+  float throughput() const
+  {
+    uint32_t elapsed = lastFlushAtMs - firstFlushAtMs;
+    return elapsed ? flushed * 1000.0f / elapsed : 0.0f;
+  }
+};
+
+/**
+ * The queue file behind LogQueue. Offsets are in bytes from the start of the file. The device
+ * stores it in LittleFS, host tests keep it in memory.
+ */
+class LogStore
+{
+public:
+  virtual ~LogStore() {}
+
+  virtual uint32_t size() = 0;
+
+  /**
+   * @return The number of whole records read.
+   */
+  virtual size_t read(uint32_t offset, LogRecord *records, size_t count) = 0;
+
+  virtual bool append(const LogRecord &record) = 0;
+
+  /**
+   * Rewrites the whole records from offset on at the start of a new file.
+   *
+   * @return The new file size.
+   */
+  virtual uint32_t compact(uint32_t offset) = 0;
+
+  virtual void clear() = 0;
+
+  /**
+   * Persists the offset of the first record not yet in Firestore, so a reboot does not resend the rest.
+   */
+  virtual void saveHead(uint32_t head) = 0;
+  virtual uint32_t loadHead() = 0;
+};
+
+/**
+ * Write-ahead log queue flushed in batches. Decides when a batch is due, backs off after failures,
+ * discards what Firestore will never accept, and compacts the file as records leave it. It has no
+ * RTOS or network dependency: the log sink calls it under its mutex and commits the batches itself.
+ *
+ * Positions are logical (they keep increasing across compactions), so a batch read before a
+ * compaction is still acknowledged at the right place.
+ */
+class LogQueue
+{
+public:
+  static const size_t BATCH_SIZE = 8;
+  static const uint32_t RECORD_SIZE = sizeof(LogRecord);
+
+  // The file is compacted once at least this many records were sent (or dropped) and they take more
+  // room than the pending ones, so compacting costs at most one copy per record.
+  static const uint32_t COMPACT_MIN_RECORDS = 64;
+
+  /**
+   * @param store The queue file.
+   * @param clockMs Returns the time in milliseconds.
+   * @param maxPending The queued records above which the oldest is dropped.
+   * @param batchMaxAgeMs How long a partial batch waits for more records.
+   * @param retryMinMs The delay after the first failed flush.
+   * @param retryMaxMs The maximum delay between flushes while they fail.
+   */
+  LogQueue(LogStore &store, uint32_t (*clockMs)(), uint32_t maxPending = 512, uint32_t batchMaxAgeMs = 3000, uint32_t retryMinMs = 2000, uint32_t retryMaxMs = 60000)
+      : store(store), clockMs(clockMs), maxPending(maxPending), batchMaxAgeMs(batchMaxAgeMs), retryMinMs(retryMinMs), retryMaxMs(retryMaxMs) {}
+
+  /**
+   * Restores the queue left by a previous boot, dropping a torn trailing record.
+   */
+  void load();
+
+  /**
+   * Appends a record, dropping the oldest one when the queue is full.
+   *
+   * @return Whether stored.
+   */
+  bool append(const LogRecord &record);
+
+  /**
+   * Whether a batch should be committed now: a full batch or an old enough one, and not backing off.
+   */
+  bool isFlushDue() const;
+
+  /**
+   * Reads the next batch. After a rejected batch its records are read one by one, so only the
+   * offending ones are discarded.
+   *
+   * @param records At least BATCH_SIZE records.
+   * @param batchHead Set to the position of the batch, to pass to onCommitted().
+   * @return The number of records read.
+   */
+  size_t readBatch(LogRecord *records, uint32_t &batchHead);
+
+  /**
+   * Acknowledges a commit attempt.
+   *
+   * @param batchHead The position returned by readBatch().
+   * @param count The number of records in the batch.
+   * @param status The HTTP status of the commit, 0 or negative when it did not reach Firestore.
+   * @param elapsedMs The time spent committing.
+   */
+  void onCommitted(uint32_t batchHead, size_t count, int status, uint32_t elapsedMs);
+
+  /**
+   * Whether a commit that failed with this status should be retried (network errors, expired
+   * tokens, timeouts, throttling and server errors) rather than discarded.
+   */
+  static bool isRetryable(int status);
+
+  uint32_t getPending() const { return (walSize - walHead) / RECORD_SIZE; }
+  LogSinkStats getStats() const;
+
+private:
+  LogStore &store;
+  uint32_t (*clockMs)();
+  uint32_t maxPending;
+  uint32_t batchMaxAgeMs;
+  uint32_t retryMinMs;
+  uint32_t retryMaxMs;
+
+  // [walHead, walSize) are not yet in Firestore, fileBase is the position of the first byte of the file.
+  uint32_t fileBase = 0;
+  uint32_t walHead = 0;
+  uint32_t walSize = 0;
+  uint32_t isolateUntil = 0;
+  uint32_t oldestPendingMs = 0;
+  uint32_t retryDelayMs = 0;
+  uint32_t retryAtMs = 0;
+
+  LogSinkStats stats;
+
+  void advance(uint32_t end);
+  void compactIfWorthIt();
+};
+
+#endif
@@ -0,0 +1,248 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <LittleFS.h>
+#include <Firebase_ESP_Client.h>
+#include <common/firebase.h>
+#include <vector>
+#include "log_sink.h"
+#include "log_encoder.h"
+#include "log_queue.h"
+#include <common/log.h>
+
+#define WAL_PATH "/logs.wal"
+#define WAL_HEAD_PATH "/logs.head"
+#define WAL_COMPACT_PATH "/logs.tmp"
+
+#define FLUSH_TASK_STACK 8192
+#define FLUSH_POLL_MS 500
+
+extern const char *FIREBASE_PROJECT;
+
+static const uint32_t RECORD_SIZE = sizeof(LogRecord);
+
+class LittleFsLogStore : public LogStore
+{
+public:
+  uint32_t size() override
+  {
+    File file = LittleFS.open(WAL_PATH, "r");
+    uint32_t size = file ? file.size() : 0;
+    if (file)
+      file.close();
+    return size;
+  }
+
+  size_t read(uint32_t offset, LogRecord *records, size_t count) override
+  {
+    size_t read = 0;
+    File file = LittleFS.open(WAL_PATH, "r");
+    if (file)
+    {
+      file.seek(offset);
+      while (read < count && file.read((uint8_t *)&records[read], RECORD_SIZE) == RECORD_SIZE)
+      {
+        read++;
+      }
+      file.close();
+    }
+    return read;
+  }
+
+  bool append(const LogRecord &record) override
+  {
+    File file = LittleFS.open(WAL_PATH, "a");
+    bool ok = file && file.write((const uint8_t *)&record, RECORD_SIZE) == RECORD_SIZE;
+    if (file)
+      file.close();
+    return ok;
+  }
+
+  // Rewrites the pending records at the start of a new file (also drops a torn trailing record).
+  uint32_t compact(uint32_t offset) override
+  {
+    File in = LittleFS.open(WAL_PATH, "r");
+    File out = LittleFS.open(WAL_COMPACT_PATH, "w");
+    if (!in || !out)
+    {
+      return size() - offset;
+    }
+
+    LogRecord record;
+    uint32_t size = 0;
+    in.seek(offset);
+    while (in.read((uint8_t *)&record, RECORD_SIZE) == RECORD_SIZE)
+    {
+      out.write((const uint8_t *)&record, RECORD_SIZE);
+      size += RECORD_SIZE;
+    }
+    in.close();
+    out.close();
+
+    LittleFS.remove(WAL_PATH);
+    LittleFS.rename(WAL_COMPACT_PATH, WAL_PATH);
+    return size;
+  }
+
+  void clear() override
+  {
+    LittleFS.remove(WAL_PATH);
+    LittleFS.remove(WAL_HEAD_PATH);
+  }
+
+  void saveHead(uint32_t head) override
+  {
+    File file = LittleFS.open(WAL_HEAD_PATH, "w");
+    if (file)
+    {
+      file.write((const uint8_t *)&head, sizeof(head));
+      file.close();
+    }
+  }
+
+  uint32_t loadHead() override
+  {
+    uint32_t head = 0;
+    File file = LittleFS.open(WAL_HEAD_PATH, "r");
+    if (file)
+    {
+      file.read((uint8_t *)&head, sizeof(head));
+      file.close();
+    }
+    return head;
+  }
+};
+
+static SemaphoreHandle_t walMutex = nullptr;
+static TaskHandle_t flushTask = nullptr;
+
+static LittleFsLogStore walStore;
+static LogQueue walQueue(walStore, []() -> uint32_t
+                         { return millis(); });
+
+static LogRecord batch[LogQueue::BATCH_SIZE];
+static char document[LOG_DOCUMENT_SIZE];
+
+// Returns the HTTP status of the commit, or the client error (negative) when it did not get one.
+static int commitBatch(size_t count)
+{
+  std::vector<struct firebase_firestore_document_write_t> writes;
+  writes.reserve(count);
+
+  char documentPath[96];
+  for (size_t i = 0; i < count; i++)
+  {
+    const LogRecord &record = batch[i];
+    snprintf(documentPath, sizeof(documentPath), "logs/%s-%ld-%08lx", record.deviceId, (long)record.createdAt, (unsigned long)record.id);
+
+    if (!encodeLogDocument(document, sizeof(document), record.deviceId, record.type, record.createdAt, record.photoURL, record.userId))
+    {
+      LOG_WARN("[LogSink] Log %s does not fit in a document, skipping\n", documentPath);
+      continue;
+    }
+
+    struct firebase_firestore_document_write_t write;
+    write.type = firebase_firestore_document_write_type_update;
+    write.update_document_path = documentPath;
+    write.update_document_content = document;
+    writes.push_back(write);
+  }
+
+  FirestoreSession session;
+  if (!Firebase.Firestore.commitDocument(&fbdo, FIREBASE_PROJECT, "", writes, ""))
+  {
+    LOG_WARN("[LogSink] commitDocument failed (%d): %s\n", fbdo.httpCode(), fbdo.errorReason().c_str());
+    return fbdo.httpCode() >= 200 && fbdo.httpCode() < 300 ? -1 : fbdo.httpCode();
+  }
+  return 200;
+}
+
+static void flushBatch()
+{
+  uint32_t batchHead;
+  xSemaphoreTake(walMutex, portMAX_DELAY);
+  size_t count = walQueue.readBatch(batch, batchHead);
+  xSemaphoreGive(walMutex);
+  if (count == 0)
+  {
+    return;
+  }
+
+  // The commit runs without the mutex, so logs keep being appended meanwhile.
+  uint32_t start = millis();
+  int status = commitBatch(count);
+  uint32_t elapsed = millis() - start;
+
+  xSemaphoreTake(walMutex, portMAX_DELAY);
+  walQueue.onCommitted(batchHead, count, status, elapsed);
+  xSemaphoreGive(walMutex);
+
+  if (status >= 300 && !LogQueue::isRetryable(status))
+  {
+    LOG_WARN("[LogSink] Firestore rejected %u log(s) (%d), %s\n", (unsigned)count, status, count > 1 ? "retrying one by one" : "discarding it");
+  }
+}
+
+static void flushLoop(void *)
+{
+  for (;;)
+  {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(FLUSH_POLL_MS));
+
+    xSemaphoreTake(walMutex, portMAX_DELAY);
+    bool isDue = walQueue.isFlushDue();
+    xSemaphoreGive(walMutex);
+
+    if (isDue && WiFi.isConnected())
+    {
+      flushBatch();
+    }
+  }
+}
+
+bool loadLogSink()
+{
+  if (!LittleFS.begin(true))
+  {
+    return false;
+  }
+
+  walMutex = xSemaphoreCreateMutex();
+  if (!walMutex)
+  {
+    return false;
+  }
+
+  walQueue.load();
+
+  return xTaskCreatePinnedToCore(flushLoop, "log_flush", FLUSH_TASK_STACK, nullptr, 1, &flushTask, 1) == pdPASS;
+}
+
+bool appendLog(const char *deviceId, const LogData &logData)
+{
+  LogRecord record = {};
+  record.type = static_cast<uint8_t>(logData.type);
+  record.createdAt = logData.createdAt;
+  record.id = esp_random();
+  strlcpy(record.deviceId, deviceId, sizeof(record.deviceId));
+  strlcpy(record.userId, logData.userId ? logData.userId : "Anonymous", sizeof(record.userId));
+  strlcpy(record.photoURL, logData.photoURL ? logData.photoURL : "", sizeof(record.photoURL));
+
+  xSemaphoreTake(walMutex, portMAX_DELAY);
+  bool ok = walQueue.append(record);
+  uint32_t pending = walQueue.getPending();
+  xSemaphoreGive(walMutex);
+
+  if (ok && pending >= LogQueue::BATCH_SIZE && flushTask)
+  {
+    xTaskNotifyGive(flushTask);
+  }
+  return ok;
+}
+
+LogSinkStats getLogSinkStats()
+{
+  xSemaphoreTake(walMutex, portMAX_DELAY);
+  LogSinkStats snapshot = walQueue.getStats();
+  xSemaphoreGive(walMutex);
+  return snapshot;
+}
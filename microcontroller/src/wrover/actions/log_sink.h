@@ -0,0 +1,32 @@
+#ifndef LOG_SINK_H
+#define LOG_SINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "database.h"
+#include "log_queue.h"
+
+/**
+ * Loads the batched log sink (REQUIRED AT THE START, after Firebase).
+ * Logs left in the flash queue by a previous boot are sent again.
+ *
+ * @return Whether loaded successfully.
+ */
+bool loadLogSink();
+
+/**
+ * Appends a log to the flash queue. Logs are written to Firestore in a single commit once
+ * enough of them are queued or the oldest one is old enough.
+ *
+ * @param deviceId The ID of the node (ESP32) sending the log.
+ * @param logData The log data.
+ * @return Whether the log was queued.
+ */
+bool appendLog(const char *deviceId, const LogData &logData);
+
+/**
+ * Returns the sink counters and flush latencies.
+ */
+LogSinkStats getLogSinkStats();
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef OWNER_DISCOVERY_H
+#define OWNER_DISCOVERY_H
+
+#include <stdint.h>
+
+struct OwnerDiscoveryStats
+{
+  uint32_t checks = 0; // Firestore requests made.
+  uint32_t pushes = 0; // Owner messages received from the app.
+};
+
+/**
+ * Decides when to look the device owner up in Firestore while waiting to be claimed.
+ * The app announces a claim on "<id>/owner" (retained, so it also reaches a device that subscribes
+ * later), which makes one check due right away and cancels the fallback polling. Without it, the
+ * fallback checks start after initialMs and back off exponentially to maxMs.
+ */
+class OwnerDiscovery
+{
+public:
+  OwnerDiscovery(uint32_t initialMs, uint32_t maxMs, uint32_t timeoutMs)
+      : initialMs(initialMs), maxMs(maxMs), timeoutMs(timeoutMs) {}
+
+  void start(uint32_t nowMs)
+  {
+    startMs = nowMs;
+    lastCheckMs = nowMs;
+    intervalMs = initialMs;
+    isPushPending = false;
+    isPolling = true;
+    stats = OwnerDiscoveryStats();
+  }
+
+  /**
+   * Reports an owner message from the app.
+   */
+  void onPush()
+  {
+    isPushPending = true;
+    isPolling = false;
+    stats.pushes++;
+  }
+
+  bool isCheckDue(uint32_t nowMs) const
+  {
+    return isPushPending || (isPolling && nowMs - lastCheckMs >= intervalMs);
+  }
+
+  /**
+   * Reports a Firestore check that found no owner.
+   */
+  void onChecked(uint32_t nowMs)
+  {
+    stats.checks++;
+    lastCheckMs = nowMs;
+    if (isPushPending)
+    {
+      // The owner message was stale (e.g. a retained claim since removed): fall back to polling.
+      isPushPending = false;
+      isPolling = true;
+      return;
+    }
+    intervalMs = intervalMs * 2 < maxMs ? intervalMs * 2 : maxMs;
+  }
+
+  bool isTimedOut(uint32_t nowMs) const { return nowMs - startMs >= timeoutMs; }
+
+  const OwnerDiscoveryStats &getStats() const { return stats; }
+
+private:
+  uint32_t initialMs;
+  uint32_t maxMs;
+  uint32_t timeoutMs;
+
+  uint32_t startMs = 0;
+  uint32_t lastCheckMs = 0;
+  uint32_t intervalMs = 0;
+  bool isPushPending = false;
+  bool isPolling = false;
+  OwnerDiscoveryStats stats;
+};
+
+#endif
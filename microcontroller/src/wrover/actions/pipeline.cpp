@@ -0,0 +1,92 @@
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "pipeline.h"
+
+static const uint32_t CAPTURE_TASK_STACK = 4096;
+static const uint32_t UPLOAD_TASK_STACK = 8192;
+static const uint32_t LOG_TASK_STACK = 8192;
+static const UBaseType_t PIPELINE_TASK_PRIORITY = 2;
+static const BaseType_t PIPELINE_TASK_CORE = 1;
+
+bool PhotoPipeline::start(size_t queueDepth)
+{
+  captureQueue = xQueueCreate(queueDepth, sizeof(PhotoJob));
+  uploadQueue = xQueueCreate(queueDepth, sizeof(PhotoJob));
+  logQueue = xQueueCreate(queueDepth, sizeof(PhotoJob));
+
+  if (!captureQueue || !uploadQueue || !logQueue)
+  {
+    return false;
+  }
+
+  return xTaskCreatePinnedToCore(captureTask, "photo_capture", CAPTURE_TASK_STACK, this, PIPELINE_TASK_PRIORITY, nullptr, PIPELINE_TASK_CORE) == pdPASS &&
+         xTaskCreatePinnedToCore(uploadTask, "photo_upload", UPLOAD_TASK_STACK, this, PIPELINE_TASK_PRIORITY, nullptr, PIPELINE_TASK_CORE) == pdPASS &&
+         xTaskCreatePinnedToCore(logTask, "photo_log", LOG_TASK_STACK, this, PIPELINE_TASK_PRIORITY, nullptr, PIPELINE_TASK_CORE) == pdPASS;
+}
+
+bool PhotoPipeline::enqueue(uint8_t logType, const char *userId, uint32_t eventMs)
+{
+  PhotoJob job = PhotoStages::makeJob(logType, userId, eventMs);
+  if (!captureQueue || xQueueSend((QueueHandle_t)captureQueue, &job, 0) != pdTRUE)
+  {
+    stages.dropBeforeCapture();
+    return false;
+  }
+  return true;
+}
+
+void PhotoPipeline::captureTask(void *arg)
+{
+  PhotoPipeline *self = static_cast<PhotoPipeline *>(arg);
+  PhotoJob job;
+
+  for (;;)
+  {
+    if (xQueueReceive((QueueHandle_t)self->captureQueue, &job, portMAX_DELAY) != pdTRUE || !self->stages.runCapture(job))
+    {
+      continue;
+    }
+
+    if (xQueueSend((QueueHandle_t)self->uploadQueue, &job, 0) != pdTRUE)
+    {
+      self->stages.dropBeforeUpload(job);
+    }
+  }
+}
+
+void PhotoPipeline::uploadTask(void *arg)
+{
+  PhotoPipeline *self = static_cast<PhotoPipeline *>(arg);
+  PhotoJob job;
+
+  for (;;)
+  {
+    if (xQueueReceive((QueueHandle_t)self->uploadQueue, &job, portMAX_DELAY) != pdTRUE)
+    {
+      continue;
+    }
+
+    self->stages.runUpload(job);
+
+    if (xQueueSend((QueueHandle_t)self->logQueue, &job, 0) != pdTRUE)
+    {
+      self->stages.dropBeforeLog();
+    }
+  }
+}
+
+void PhotoPipeline::logTask(void *arg)
+{
+  PhotoPipeline *self = static_cast<PhotoPipeline *>(arg);
+  PhotoJob job;
+
+  for (;;)
+  {
+    if (xQueueReceive((QueueHandle_t)self->logQueue, &job, portMAX_DELAY) == pdTRUE)
+    {
+      self->stages.runLog(job);
+    }
+  }
+}
@@ -0,0 +1,231 @@
+#ifndef PIPELINE_ACTIONS_H
+#define PIPELINE_ACTIONS_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+static const size_t PHOTO_JOB_USER_ID_SIZE = 40;
+static const size_t PHOTO_JOB_URL_SIZE = 192;
+
+/**
+ * A single photo request travelling through the capture -> upload -> log stages.
+ * Jobs are copied by value between stage queues, so they must stay trivially copyable.
+ */
+struct PhotoJob
+{
+  uint8_t logType;
+  char userId[PHOTO_JOB_USER_ID_SIZE];
+  uint32_t eventMs; // millis() when the job was enqueued.
+  time_t timestamp; // Epoch seconds of the captured frame.
+
+  uint8_t *image; // The JPEG bytes, released by the upload stage.
+  size_t imageLen;
+  void *frame; // Camera frame backing image when it is not a copy.
+
+  char photoURL[PHOTO_JOB_URL_SIZE];
+};
+
+/**
+ * The work done by each stage. The device wires these to the camera, Supabase and Firestore,
+ * while host builds can plug in fakes.
+ */
+struct PhotoPipelineBackend
+{
+  bool (*capture)(PhotoJob &job); // Fills image, imageLen, frame and timestamp.
+  bool (*upload)(PhotoJob &job);  // Fills photoURL.
+  void (*log)(const PhotoJob &job);
+  void (*release)(PhotoJob &job); // Frees image or gives frame back.
+  uint32_t (*clockUs)();
+};
+
+struct PhotoStageStats
+{
+  uint32_t processed = 0;
+  uint32_t failed = 0;
+  uint32_t dropped = 0; // Jobs rejected because the next queue was full.
+  uint32_t lastUs = 0;
+  uint32_t maxUs = 0;
+  uint64_t totalUs = 0;
+
+  uint32_t averageUs() const { return processed ? (uint32_t)(totalUs / processed) : 0; }
+};
+
+struct PhotoPipelineStats
+{
+  PhotoStageStats capture;
+  PhotoStageStats upload;
+  PhotoStageStats log;
+};
+
+/**
+ * Counters of a stage. Only the stage's task records runs, but drops are counted by the task
+ * feeding it, and the stats are read from yet another one, so every field is atomic.
+ */
+class PhotoStageCounters
+{
+public:
+  void record(uint32_t elapsedUs, bool ok)
+  {
+    if (!ok)
+    {
+      failed.fetch_add(1, std::memory_order_relaxed);
+    }
+    processed.fetch_add(1, std::memory_order_relaxed);
+    lastUs.store(elapsedUs, std::memory_order_relaxed);
+    totalUs.fetch_add(elapsedUs, std::memory_order_relaxed);
+    uint32_t currentMax = maxUs.load(std::memory_order_relaxed);
+    while (elapsedUs > currentMax && !maxUs.compare_exchange_weak(currentMax, elapsedUs, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  void drop() { dropped.fetch_add(1, std::memory_order_relaxed); }
+
+  PhotoStageStats snapshot() const
+  {
+    PhotoStageStats stats;
+    stats.processed = processed.load(std::memory_order_relaxed);
+    stats.failed = failed.load(std::memory_order_relaxed);
+    stats.dropped = dropped.load(std::memory_order_relaxed);
+    stats.lastUs = lastUs.load(std::memory_order_relaxed);
+    stats.maxUs = maxUs.load(std::memory_order_relaxed);
+    stats.totalUs = totalUs.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+private:
+  std::atomic<uint32_t> processed{0};
+  std::atomic<uint32_t> failed{0};
+  std::atomic<uint32_t> dropped{0};
+  std::atomic<uint32_t> lastUs{0};
+  std::atomic<uint32_t> maxUs{0};
+  std::atomic<uint64_t> totalUs{0};
+};
+
+/**
+ * The work of each stage around the backend, with its counters. Has no RTOS dependency: the
+ * device runs it from the PhotoPipeline tasks, host tests call it directly.
+ */
+class PhotoStages
+{
+public:
+  explicit PhotoStages(const PhotoPipelineBackend &backend) : backend(backend) {}
+
+  static PhotoJob makeJob(uint8_t logType, const char *userId, uint32_t eventMs)
+  {
+    PhotoJob job = {};
+    job.logType = logType;
+    job.eventMs = eventMs;
+    strlcpy(job.userId, userId ? userId : "", sizeof(job.userId));
+    return job;
+  }
+
+  /**
+   * @return Whether the job should be passed to the upload stage.
+   */
+  bool runCapture(PhotoJob &job)
+  {
+    uint32_t start = backend.clockUs();
+    bool ok = backend.capture(job);
+    capture.record(backend.clockUs() - start, ok);
+    return ok;
+  }
+
+  /**
+   * Uploads and releases the image. A failed upload is still logged (without a photo URL) so
+   * the event itself is not lost.
+   *
+   * @return Whether uploaded.
+   */
+  bool runUpload(PhotoJob &job)
+  {
+    uint32_t start = backend.clockUs();
+    bool ok = backend.upload(job);
+    backend.release(job);
+    upload.record(backend.clockUs() - start, ok);
+    return ok;
+  }
+
+  void runLog(const PhotoJob &job)
+  {
+    uint32_t start = backend.clockUs();
+    backend.log(job);
+    log.record(backend.clockUs() - start, true);
+  }
+
+  /**
+   * Counts a job the upload queue had no room for, and releases its image.
+   */
+  void dropBeforeUpload(PhotoJob &job)
+  {
+    backend.release(job);
+    upload.drop();
+  }
+
+  void dropBeforeCapture() { capture.drop(); }
+  void dropBeforeLog() { log.drop(); }
+
+  PhotoPipelineStats getStats() const
+  {
+    PhotoPipelineStats stats;
+    stats.capture = capture.snapshot();
+    stats.upload = upload.snapshot();
+    stats.log = log.snapshot();
+    return stats;
+  }
+
+private:
+  PhotoPipelineBackend backend;
+  PhotoStageCounters capture;
+  PhotoStageCounters upload;
+  PhotoStageCounters log;
+};
+
+/**
+ * Bounded capture -> upload -> log pipeline. Every stage runs on its own FreeRTOS task and the
+ * stages are linked by fixed-depth queues, so producers never block.
+ */
+class PhotoPipeline
+{
+public:
+  explicit PhotoPipeline(const PhotoPipelineBackend &backend) : stages(backend) {}
+
+  /**
+   * Creates the stage queues and tasks.
+   *
+   * @param queueDepth The maximum number of jobs waiting in front of each stage.
+   * @return Whether started successfully.
+   */
+  bool start(size_t queueDepth = 4);
+
+  /**
+   * Enqueues a photo request without blocking.
+   *
+   * @param logType The LogType to store alongside the photo.
+   * @param userId The user that triggered the photo (optional).
+   * @param eventMs The event time in milliseconds.
+   * @return Whether the job was accepted.
+   */
+  bool enqueue(uint8_t logType, const char *userId, uint32_t eventMs);
+
+  /**
+   * Returns a snapshot of the per-stage counters and latencies.
+   */
+  PhotoPipelineStats getStats() const { return stages.getStats(); }
+
+private:
+  PhotoStages stages;
+
+  void *captureQueue = nullptr;
+  void *uploadQueue = nullptr;
+  void *logQueue = nullptr;
+
+  static void captureTask(void *arg);
+  static void uploadTask(void *arg);
+  static void logTask(void *arg);
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include <time.h>
+#include <ArduinoJson.h>
+#include <common/mqtt_data.h>
+#include <common/topic_router.h>
+#include <common/metrics.h>
+#include <common/log.h>
+#include "handlers.h"
+
+static MetricCounter oledSent("oled_tx");
+
+void WroverHandlers::onMessage(const char *subtopic, const uint8_t *payload, size_t length)
+{
+  JsonDocument docIn;
+  if (isTopic(subtopic, BuzzerData::TOPIC))
+  {
+    BuzzerData b;
+    if (decodeMessage(payload, length, docIn, b))
+      hal.buzzer->beep(b.duration);
+  }
+  else if (isTopic(subtopic, UltrasonicData::TOPIC))
+  {
+    UltrasonicData u;
+    if (decodeMessage(payload, length, docIn, u) && u.isClose)
+      events.requestPhoto(LogType::PROXIMITY, "");
+  }
+  else if (isTopic(subtopic, FingerprintData::TOPIC))
+  {
+    onFingerprintMessage(payload, length);
+  }
+  else if (isTopic(subtopic, OWNER_TOPIC))
+  {
+    ownerDiscovery.onPush();
+  }
+  else if (isTopic(subtopic, TAKE_PHOTO_TOPIC))
+  {
+    events.requestPhoto(LogType::USER_REQUEST, "");
+  }
+  else if (isTopic(subtopic, OledData::TOPIC))
+  {
+    wroomLink.send(OledData::TOPIC, payload, length);
+  }
+}
+
+void WroverHandlers::onFingerprintMessage(const uint8_t *payload, size_t length)
+{
+  uint32_t receivedUs = metricsNowUs();
+  JsonDocument docIn;
+  FingerprintData fpd;
+  if (!decodeMessage(payload, length, docIn, fpd))
+    return;
+  switch (fpd.type)
+  {
+  case FINGERPRINT_UPDATE:
+    LOG_INFO("[WROVER] Received FINGERPRINT_UPDATE\n");
+    if (fpd.isNew)
+    {
+      hal.database->addUser(nodeId, fpd.userId);
+      LOG_INFO("[WROVER] Fingerprint Registered to Firebase\n");
+      events.log(nodeId, LogData(LogType::NEW_FINGERPRINT, (int)time(nullptr), "", fpd.userId));
+      LOG_INFO("[WROVER] Logged NEW_FINGERPRINT event\n");
+    }
+    showFingerprintPrompt();
+    break;
+
+  case FINGERPRINT_TOUCH:
+    LOG_INFO("[WROVER] Received FINGERPRINT_TOUCH\n");
+    doorbell.start();
+    hal.buzzer->beep(2000);
+    // The WROOM's part up to sending, then ours up to the buzzer. The hop between the two has no
+    // common clock, so it is not included.
+    doorbell.finish(fpd.ageMs + (metricsNowUs() - receivedUs) / 1000);
+    events.requestPhoto(LogType::RING_DOORBELL, fpd.userId);
+    showFingerprintPrompt();
+    break;
+
+  case FINGERPRINT_REGISTRATION:
+    LOG_INFO("[WROVER] Received FINGERPRINT_REGISTRATION – forwarding to WROOM\n");
+    wroomLink.send(FingerprintData::TOPIC, payload, length);
+    showRegisterPrompt();
+    break;
+
+  case FINGERPRINT_SYNC:
+    onSyncMessage(fpd);
+    break;
+
+  case FINGERPRINT_CANCEL:
+    LOG_INFO("[WROVER] Received FINGERPRINT_CANCEL – forwarding to WROOM\n");
+    wroomLink.send(FingerprintData::TOPIC, payload, length);
+    showFingerprintPrompt();
+    break;
+
+  case FINGERPRINT_PROGRESS:
+  {
+    LOG_INFO("[WROVER] Enrollment of %s: stage %u, error %u\n", fpd.userId, fpd.stage, fpd.error);
+    uint8_t progress[200];
+    size_t progressLength = encodeMessage(fpd, MQTT_FORMAT_JSON, progress, sizeof(progress));
+    if (progressLength == 0 || !appLink.send(ENROLLMENT_PROGRESS_TOPIC, progress, progressLength))
+      LOG_WARN("[WROVER] Could not publish the enrollment progress\n");
+    break;
+  }
+  }
+}
+
+void WroverHandlers::onSyncMessage(const FingerprintData &fpd)
+{
+  if (fpd.tableHash != syncTableHash)
+  {
+    syncTableHash = fpd.tableHash;
+    syncReceivedHash = USER_TABLE_HASH_OFFSET;
+    syncFailed = false;
+  }
+
+  if (fpd.userId[0] != '\0')
+  {
+    LOG_INFO("[WROVER] Received FINGERPRINT_SYNC for %s\n", fpd.userId);
+    syncReceivedHash = hashUserId(syncReceivedHash, fpd.userId);
+    if (!hal.database->addUser(nodeId, fpd.userId))
+      syncFailed = true;
+    return;
+  }
+
+  // The end of the table. A lost message or a failed write leaves it unacknowledged, so the WROOM
+  // syncs again on its next boot.
+  if (!syncFailed && syncReceivedHash == fpd.tableHash)
+  {
+    LOG_INFO("[WROVER] Fingerprint users synced\n");
+    sendMessage(wroomLink, FingerprintData(FINGERPRINT_SYNC, "", false, 0, 0, 0, fpd.tableHash));
+  }
+  else
+  {
+    LOG_WARN("[WROVER] Fingerprint user sync incomplete\n");
+  }
+  syncTableHash = 0;
+}
+
+void WroverHandlers::sendOled(const OledData &oledData)
+{
+  oledSent.add();
+  LOG_DEBUG("[WROVER] sendOled: %s\n", oledData.message);
+  sendMessage(wroomLink, oledData);
+}
+
+void WroverHandlers::showRegistrationPrompt()
+{
+  sendOled(OledData("Please register via app", true, nodeId));
+}
+
+void WroverHandlers::showWelcome()
+{
+  sendOled(OledData("Welcome to Lookout!"));
+}
+
+void WroverHandlers::showFingerprintPrompt()
+{
+  sendOled(OledData("Place your finger on\nthe sensor"));
+}
+
+void WroverHandlers::showRegisterPrompt()
+{
+  sendOled(OledData("Place your preferred \nfinger on the sensor\n to register"));
+}
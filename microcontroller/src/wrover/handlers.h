@@ -0,0 +1,76 @@
+#ifndef WROVER_HANDLERS_H
+#define WROVER_HANDLERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <common/hal.h>
+#include <common/fingerprint_users.h>
+#include <common/scenario_recorder.h>
+#include <common/transport.h>
+#include "actions/database.h"
+#include "actions/owner_discovery.h"
+
+/**
+ * What the WROVER does with messages from the WROOM and the app, and the prompts it shows on the
+ * WROOM's screen. Only depends on the HAL (buzzer and database), the event log and the links to the
+ * WROOM and the app, so it runs on the host against fakes.
+ */
+class WroverHandlers
+{
+public:
+  /**
+   * @param nodeId The ID of this node.
+   * @param hal The backends, buzzer and database are required.
+   * @param wroomLink The link to the WROOM.
+   * @param appLink Publishes under this node's topics, for the app.
+   * @param events The photo and event logs.
+   * @param ownerDiscovery Told when the app announces the claim.
+   */
+  WroverHandlers(const char *nodeId, const Hal &hal, Transport &wroomLink, Transport &appLink, EventLog &events, OwnerDiscovery &ownerDiscovery)
+      : nodeId(nodeId), hal(hal), wroomLink(wroomLink), appLink(appLink), events(events), ownerDiscovery(ownerDiscovery) {}
+
+  /**
+   * Handles a message from the WROOM or the app.
+   *
+   * @param subtopic The topic without the device prefix.
+   */
+  void onMessage(const char *subtopic, const uint8_t *payload, size_t length);
+
+  /**
+   * QR code with the node ID and "Please register via app".
+   */
+  void showRegistrationPrompt();
+
+  /**
+   * "Welcome to Lookout!"
+   */
+  void showWelcome();
+
+  void showFingerprintPrompt();
+  void showRegisterPrompt();
+
+  /**
+   * Doorbell latency, from the finger touching the WROOM's sensor to the buzzer starting.
+   */
+  const ScenarioRecorder &getDoorbellScenario() const { return doorbell; }
+
+private:
+  const char *nodeId;
+  Hal hal;
+  Transport &wroomLink;
+  Transport &appLink;
+  EventLog &events;
+  OwnerDiscovery &ownerDiscovery;
+  ScenarioRecorder doorbell{"doorbell_start", "doorbell_done", "doorbell_ms"};
+  // The user table sync in progress: its table hash, the hash of the users received so far and
+  // whether any of them could not be added to Firestore.
+  uint32_t syncTableHash = 0;
+  uint32_t syncReceivedHash = USER_TABLE_HASH_OFFSET;
+  bool syncFailed = false;
+
+  void onFingerprintMessage(const uint8_t *payload, size_t length);
+  void onSyncMessage(const FingerprintData &fpd);
+  void sendOled(const OledData &oledData);
+};
+
+#endif
@@ -3,54 +3,88 @@
 #include <common/wifi.h>
 #include <common/camera.h>
 #include <common/env/env.h>
-#include <common/utils.h>
 #include <common/mqtt.h>
 #include <common/mqtt_data.h>
+#include <common/transport.h>
+#include <common/topic_router.h>
 #include <common/supabase.h>
 #include <common/firebase.h>
+#include <common/metrics.h>
+#include <common/log.h>
 #include "actions/hardware.h"
 #include "actions/database.h"
-#undef B1
-#include <fmt/core.h>
+#include "actions/log_sink.h"
+#include "actions/owner_discovery.h"
+#include "handlers.h"
 
 using namespace std;
-static const unsigned long OWNER_POLL_INTERVAL = 5000UL;
+// Fallback polling for when the app's owner message does not arrive.
+static const unsigned long OWNER_FIRST_CHECK_MS = 30000UL;
+static const unsigned long OWNER_MAX_CHECK_MS = 120000UL;
+static const unsigned long OWNER_PROMPT_INTERVAL = 15000UL;
 static const unsigned long OWNER_RETRY_DELAY = 50UL;
 static const unsigned long OWNER_TIMEOUT = 300000UL;
 static const unsigned long WELCOME_BROADCAST_MS = 3000UL;
 static const unsigned long WELCOME_RETRY_DELAY = 500UL;
+static const unsigned long METRICS_INTERVAL_MS = 60000UL;
+
+EspNowTransport espNowLink;
+MqttTransport mqttLink(WROOM_UNIQUE_ID);
+FallbackTransport wroomLink(espNowLink, mqttLink, []() -> uint32_t
+                            { return millis(); });
+// This node's own topics, for what the app reads (enrollment progress).
+MqttTransport appLink(WROVER_UNIQUE_ID);
+LinkInbox linkInbox;
+TopicPrefix topicPrefix(WROVER_UNIQUE_ID);
+MetricCounter mqttReceived("mqtt_rx");
+OwnerDiscovery ownerDiscovery(OWNER_FIRST_CHECK_MS, OWNER_MAX_CHECK_MS, OWNER_TIMEOUT);
+
+static Hal wroverHal()
+{
+  Hal hal = getDeviceHal();
+  hal.buzzer = &getBuzzer();
+  hal.database = &getFirestoreDatabase();
+  return hal;
+}
 
-String MQTT_TOPICS[] = {
-    BuzzerData::TOPIC,
-    UltrasonicData::TOPIC,
-    FingerprintData::TOPIC,
-    TAKE_PHOTO_TOPIC,
-    OledData::TOPIC};
-const size_t MQTT_TOPIC_COUNT = sizeof(MQTT_TOPICS) / sizeof(MQTT_TOPICS[0]);
-String *fullTopics;
+WroverHandlers handlers(WROVER_UNIQUE_ID, wroverHal(), wroomLink, appLink, getEventLog(), ownerDiscovery);
 
-bool waitForOwner() {
-  unsigned long start = millis();
-  while (millis() - start < OWNER_TIMEOUT) {
-    showRegistrationPrompt();  
-    unsigned long t0 = millis();
-    while (millis() - t0 < OWNER_POLL_INTERVAL) {
-      loopMQTT(
-        WROVER_UNIQUE_ID,
-        MQTT_USERNAME,
-        MQTT_PASSWORD,
-        fullTopics,
-        MQTT_TOPIC_COUNT
-      );
-      delay(OWNER_RETRY_DELAY);
+void mqttCallback(char *topic, uint8_t *payload, unsigned int length);
+
+// Waits for the app to announce the claim on "<id>/owner", polling Firestore with a backoff only in case it was missed.
+bool waitForOwner()
+{
+  ownerDiscovery.start(millis());
+  unsigned long lastPromptMs = millis();
+  handlers.showRegistrationPrompt();
+
+  while (!ownerDiscovery.isTimedOut(millis()))
+  {
+    loopMQTT();
+    espNowLink.loop(WROVER_UNIQUE_ID, mqttCallback);
+
+    if (ownerDiscovery.isCheckDue(millis()))
+    {
+      bool hasOwner = deviceHasOwner(WROVER_UNIQUE_ID);
+      ownerDiscovery.onChecked(millis());
+      if (hasOwner)
+      {
+        const OwnerDiscoveryStats &stats = ownerDiscovery.getStats();
+        LOG_INFO("→ owner found after %u Firestore requests (%u pushes)\n", stats.checks, stats.pushes);
+        return true;
+      }
+      LOG_INFO("…still no owner, retrying\n");
     }
-    if (deviceHasOwner(WROVER_UNIQUE_ID)) {
-      Serial.println("→ owner found!");
-      return true;
+
+    // Keeps the QR code up if the WROOM restarted meanwhile.
+    if (millis() - lastPromptMs >= OWNER_PROMPT_INTERVAL)
+    {
+      lastPromptMs = millis();
+      handlers.showRegistrationPrompt();
     }
-    Serial.println("…still no owner, retrying");
+    delay(OWNER_RETRY_DELAY);
   }
-  Serial.println("!! owner lookup timed out");
+  LOG_WARN("!! owner lookup timed out\n");
   return false;
 }
 
@@ -59,186 +93,92 @@ void broadcastWelcome()
   unsigned long start = millis();
   while (millis() - start < WELCOME_BROADCAST_MS)
   {
-    showWelcome();
-    loopMQTT(WROVER_UNIQUE_ID, MQTT_USERNAME, MQTT_PASSWORD,
-             fullTopics, MQTT_TOPIC_COUNT);
+    handlers.showWelcome();
+    loopMQTT();
+    espNowLink.loop(WROVER_UNIQUE_ID, mqttCallback);
     delay(WELCOME_RETRY_DELAY);
   }
 }
 
 void mqttCallback(char *topic, uint8_t *payload, unsigned int length)
 {
-  StaticJsonDocument<256> docIn;
-  DeserializationError err = deserializeJson(docIn, payload, length);
-  if (err)
-    return;
-
-  string prefix = string(WROVER_UNIQUE_ID) + "/";
-  if (strncmp(topic, prefix.c_str(), prefix.length()) != 0)
-    return;
-  topic += prefix.length();
-
-  if (strcmp(topic, BuzzerData::TOPIC) == 0)
-  {
-    BuzzerData b = BuzzerData::fromJson(docIn);
-    beep(b.duration);
-    return;
-  }
-
-  if (strcmp(topic, UltrasonicData::TOPIC) == 0)
-  {
-    UltrasonicData u = UltrasonicData::fromJson(docIn);
-    if (u.isClose)
-    {
-      takePhotoToSupabase(
-          SUPABASE_BUCKET,
-          WROVER_UNIQUE_ID,
-          [&](string photoURL, time_t timestamp)
-          {
-            LogData logData = {
-                LogType::PROXIMITY,
-                timestamp,
-                photoURL.c_str(),
-                ""};
-            logToFirebase(WROVER_UNIQUE_ID, logData);
-          });
-    }
-    
+  mqttReceived.add();
+  const char *subtopic = topicPrefix.strip(topic);
+  if (subtopic == nullptr)
     return;
-  }
-
- if (strcmp(topic, FingerprintData::TOPIC) == 0)
-{
-  FingerprintData fpd = FingerprintData::fromJson(docIn);
-  switch (fpd.type)
-  {
-case FINGERPRINT_UPDATE:
-  Serial.println("[WROVER] Received FINGERPRINT_UPDATE");
-  if (fpd.isNew)
-  {
-    addFingerprintUserToFirebase(WROVER_UNIQUE_ID, fpd.userId);
-    Serial.println("[WROVER] Fingerprint Registered to Firebase");
-    {
-      time_t now = time(nullptr);
-      LogData logData = {
-        LogType::NEW_FINGERPRINT,
-        now,
-        "",          
-        fpd.userId
-      };
-      logToFirebase(WROVER_UNIQUE_ID, logData);
-      Serial.println("[WROVER] Logged NEW_FINGERPRINT event");
-    }
-  }
-  break;
-
-    case FINGERPRINT_TOUCH:
-      Serial.println("[WROVER] Received FINGERPRINT_TOUCH");
-      beep(2000);
-      takePhotoToSupabase(
-        SUPABASE_BUCKET,
-        WROVER_UNIQUE_ID,
-        [=](string photoURL, time_t timestamp)
-        {
-          LogData logData = {
-            LogType::RING_DOORBELL,
-            timestamp,
-            photoURL.c_str(),
-            fpd.userId
-          };
-          logToFirebase(WROVER_UNIQUE_ID, logData);
-          Serial.println("[WROVER] Logged ring event after fingerprint touch");
-        }
-      );
-      break;
-
-    case FINGERPRINT_REGISTRATION:
-      Serial.println("[WROVER] Received FINGERPRINT_REGISTRATION – forwarding to WROOM");
-      publishMQTT(
-        (string(WROOM_UNIQUE_ID) + "/" + FingerprintData::TOPIC).c_str(),
-        payload,
-        length
-      );
-      showRegisterPrompt();
-      break;
-  }
-}
-
-  if (strcmp(topic, TAKE_PHOTO_TOPIC) == 0)
-  {
-    takePhotoToSupabase(
-        SUPABASE_BUCKET,
-        WROVER_UNIQUE_ID,
-        [=](string photoURL, time_t timestamp)
-        {
-          LogData logData = {
-              LogType::USER_REQUEST,
-              timestamp,
-              photoURL.c_str(),
-              ""};
-          logToFirebase(WROVER_UNIQUE_ID, logData);
-        });
+  const uint8_t *body = payload;
+  size_t bodyLength = length;
+  if (!linkInbox.accept(subtopic, body, bodyLength))
     return;
-  }
 
-  if (strcmp(topic, OledData::TOPIC) == 0)
-  {
-    publishMQTT(
-        (string(WROOM_UNIQUE_ID) + "/" + OledData::TOPIC).c_str(),
-        payload,
-        length);
-  }
-  showFingerprintPrompt();
+  if (isTopic(subtopic, LINK_MAC_TOPIC))
+    espNowLink.setPeer(body, bodyLength);
+  else
+    handlers.onMessage(subtopic, body, bodyLength);
 }
 
 void setup()
 {
-  Serial.begin(9600);
+  loadLogger();
   pinMode(BUZZER_PIN, OUTPUT);
   pinMode(LED_PIN, OUTPUT);
 
-  Serial.println("Loading WiFi...");
+  LOG_INFO("Loading WiFi...\n");
   connectWifi(WIFI_SSID, WIFI_PASSWORD);
 
-  Serial.println("Loading timestamp...");
+  LOG_INFO("Loading timestamp...\n");
   configTimestamp();
 
-  Serial.println("Loading camera...");
+  LOG_INFO("Loading camera...\n");
   loadCamera();
+  startContinuousCapture();
 
-  Serial.println("Loading Firebase...");
+  LOG_INFO("Loading Firebase...\n");
   loadFirebase(FIREBASE_API_KEY, FIREBASE_EMAIL, FIREBASE_PASSWORD);
 
-  Serial.println("Loading Supabase...");
+  LOG_INFO("Loading log sink...\n");
+  loadLogSink();
+
+  LOG_INFO("Loading Supabase...\n");
   loadSupabase(SUPABASE_URL, SUPABASE_ANON_KEY, SUPABASE_USERNAME, SUPABASE_PASSWORD);
 
-  Serial.println("Loading MQTT...");
-  loadMQTT(MQTT_SERVER, MQTT_PORT, mqttCallback);
+  LOG_INFO("Loading photo pipeline...\n");
+  loadPhotoPipeline();
+
+  LOG_INFO("Loading ESP-NOW...\n");
+  espNowLink.begin();
 
-  fullTopics = addPrefixToTopics(
-      fmt::format("{}/", WROVER_UNIQUE_ID).c_str(),
-      MQTT_TOPICS,
-      MQTT_TOPIC_COUNT);
+  LOG_INFO("Loading MQTT...\n");
+  loadMQTT(MQTT_SERVER, MQTT_PORT, WROVER_UNIQUE_ID, MQTT_USERNAME, MQTT_PASSWORD, mqttCallback);
+  setMQTTConnectCallback([]()
+                         { espNowLink.announce(WROOM_UNIQUE_ID); });
 
-  Serial.println("------------------");
-  Serial.printf("Unique ID: %s\n", WROVER_UNIQUE_ID);
-  Serial.printf("MAC address: %s\n", WiFi.macAddress());
-  Serial.println("------------------");
+  LOG_INFO("------------------\n");
+  LOG_INFO("Unique ID: %s\n", WROVER_UNIQUE_ID);
+  LOG_INFO("MAC address: %s\n", WiFi.macAddress().c_str());
+  LOG_INFO("------------------\n");
 
  if (deviceHasOwner(WROVER_UNIQUE_ID)) {
-    Serial.println("already has owner");
+    LOG_INFO("already has owner\n");
   } else {
-    Serial.println("no owner set, entering waitForOwner()");
+    LOG_INFO("no owner set, entering waitForOwner()\n");
     waitForOwner();
   }
-  Serial.println("left loop");
+  LOG_INFO("left loop\n");
   broadcastWelcome();
-  showFingerprintPrompt();
+  handlers.showFingerprintPrompt();
 }
 
 void loop()
 {
-  loopMQTT(WROVER_UNIQUE_ID, MQTT_USERNAME, MQTT_PASSWORD,
-           fullTopics, MQTT_TOPIC_COUNT);
-  delay(2000);
+  static unsigned long lastMetricsMs = millis();
+
+  loopMQTT();
+  espNowLink.loop(WROVER_UNIQUE_ID, mqttCallback);
+  if (millis() - lastMetricsMs >= METRICS_INTERVAL_MS)
+  {
+    lastMetricsMs = millis();
+    publishMetrics(WROVER_UNIQUE_ID);
+  }
+  delay(20);
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef FAKE_BROKER_H
+#define FAKE_BROKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <common/mqtt_session.h>
+
+/**
+ * Scripted MQTT broker: reachable or not, counts every call and keeps the last publish and the
+ * topics of the first HISTORY ones.
+ */
+class FakeBroker : public MqttBrokerClient
+{
+public:
+  static const size_t HISTORY = 16;
+
+  bool reachable = true;
+  uint32_t connectCalls = 0;
+  uint32_t subscribeCalls = 0;
+  uint32_t publishCalls = 0;
+  uint32_t loopCalls = 0;
+  char lastSubscription[64] = "";
+  char lastTopic[64] = "";
+  uint8_t lastPayload[256] = {};
+  size_t lastLength = 0;
+  bool lastRetained = false;
+  char topics[HISTORY][64] = {};
+
+  bool connect() override
+  {
+    connectCalls++;
+    isConnected = reachable;
+    return isConnected;
+  }
+
+  bool connected() override
+  {
+    if (!reachable)
+    {
+      isConnected = false;
+    }
+    return isConnected;
+  }
+
+  bool subscribe(const char *topic) override
+  {
+    subscribeCalls++;
+    strncpy(lastSubscription, topic, sizeof(lastSubscription) - 1);
+    return isConnected;
+  }
+
+  bool publish(const char *topic, const uint8_t *payload, size_t length, bool retained) override
+  {
+    if (!isConnected || length > sizeof(lastPayload))
+    {
+      return false;
+    }
+    if (publishCalls < HISTORY)
+    {
+      strncpy(topics[publishCalls], topic, sizeof(topics[0]) - 1);
+    }
+    publishCalls++;
+    strncpy(lastTopic, topic, sizeof(lastTopic) - 1);
+    memcpy(lastPayload, payload, length);
+    lastLength = length;
+    lastRetained = retained;
+    return true;
+  }
+
+  void loop() override { loopCalls++; }
+
+private:
+  bool isConnected = false;
+};
+
+#endif
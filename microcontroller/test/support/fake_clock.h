@@ -0,0 +1,28 @@
+#ifndef FAKE_CLOCK_H
+#define FAKE_CLOCK_H
+
+#include <stdint.h>
+
+/**
+ * Simulated time for host tests. millis() and micros() match the function pointer clocks the
+ * modules take (e.g. Scheduler, MqttSession, FingerprintEnrollment).
+ */
+class FakeClock
+{
+public:
+  static uint32_t millis() { return (uint32_t)(nowUs() / 1000); }
+  static uint32_t micros() { return (uint32_t)nowUs(); }
+
+  static void advanceMs(uint32_t ms) { nowUs() += (uint64_t)ms * 1000; }
+  static void advanceUs(uint32_t us) { nowUs() += us; }
+  static void reset(uint32_t ms = 0) { nowUs() = (uint64_t)ms * 1000; }
+
+private:
+  static uint64_t &nowUs()
+  {
+    static uint64_t now = 0;
+    return now;
+  }
+};
+
+#endif
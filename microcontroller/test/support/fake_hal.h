@@ -0,0 +1,241 @@
+#ifndef FAKE_HAL_H
+#define FAKE_HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <common/hal.h>
+#include <common/fingerprint_users.h>
+#include "fake_clock.h"
+
+/**
+ * In-memory backends of the HAL for host tests. Each one records what it was asked to do,
+ * and the slow ones (storage, database) advance the FakeClock by an injected latency.
+ */
+
+class FakeDisplay : public Display
+{
+public:
+  uint32_t shown = 0;
+  char lastText[128] = "";
+  char lastQrData[64] = "";
+  int lastDuration = 0;
+
+  void showText(const char *text, int duration) override
+  {
+    shown++;
+    copy(lastText, text, sizeof(lastText));
+    lastQrData[0] = '\0';
+    lastDuration = duration;
+  }
+
+  void showQRCode(const char *qrData, const char *text, int duration) override
+  {
+    showText(text, duration);
+    copy(lastQrData, qrData, sizeof(lastQrData));
+  }
+
+private:
+  static void copy(char *out, const char *text, size_t size)
+  {
+    strncpy(out, text, size - 1);
+    out[size - 1] = '\0';
+  }
+};
+
+/**
+ * Plays back a recorded trace of distances, one per trigger().
+ */
+class FakeDistanceSensor : public DistanceSensor
+{
+public:
+  FakeDistanceSensor(const float *trace, size_t length) : trace(trace), length(length) {}
+
+  void trigger() override
+  {
+    if (next < length)
+    {
+      pending = true;
+    }
+  }
+
+  bool read(float &distanceCm) override
+  {
+    if (!pending)
+    {
+      return false;
+    }
+    pending = false;
+    distanceCm = trace[next++];
+    return true;
+  }
+
+  bool isFinished() const { return next >= length; }
+
+private:
+  const float *trace;
+  size_t length;
+  size_t next = 0;
+  bool pending = false;
+};
+
+/**
+ * Sensor with a simulated finger: placed or lifted by the test.
+ */
+class FakeFingerprintSensor : public FingerprintSensor
+{
+public:
+  bool fingerPresent = false;
+  uint8_t storeResult = FINGERPRINT_SENSOR_OK;
+  uint32_t imageCalls = 0;
+  int storedId = -1;
+
+  uint8_t getImage() override
+  {
+    imageCalls++;
+    return fingerPresent ? FINGERPRINT_SENSOR_OK : FINGERPRINT_SENSOR_NO_FINGER;
+  }
+
+  uint8_t image2Tz(uint8_t slot) override { return FINGERPRINT_SENSOR_OK; }
+  uint8_t createModel() override { return FINGERPRINT_SENSOR_OK; }
+
+  uint8_t storeModel(uint16_t id) override
+  {
+    if (storeResult == FINGERPRINT_SENSOR_OK)
+    {
+      storedId = id;
+    }
+    return storeResult;
+  }
+};
+
+class FakeFingerprintDirectory : public FingerprintDirectory
+{
+public:
+  bool enrolling = false;
+  uint32_t cancels = 0;
+  uint32_t syncedHash = 0;
+
+  const char *getUser(uint16_t id) override { return users.get(id); }
+  bool hasUser(const char *userId) override { return users.find(userId) >= 0; }
+  bool setUser(uint16_t id, const char *userId) override { return users.set(id, userId); }
+
+  uint32_t getSyncedHash() override { return syncedHash; }
+  bool setSyncedHash(uint32_t tableHash) override
+  {
+    syncedHash = tableHash;
+    return true;
+  }
+
+  bool isEnrolling() override { return enrolling; }
+  void cancelEnrollment() override { cancels++; }
+
+private:
+  FingerprintUserTable<64, FINGERPRINT_USER_ID_SIZE> users;
+};
+
+/**
+ * Camera returning synthetic JPEG frames (0xFF 0xD8 + frame number).
+ */
+class FakeCamera : public Camera
+{
+public:
+  static const size_t FRAME_SIZE = 64;
+
+  bool available = true;
+  uint32_t captures = 0;
+  uint32_t releases = 0;
+  uint32_t lastEventMs = 0;
+
+  bool capture(uint32_t eventMs, CameraFrame &frame) override
+  {
+    if (!available)
+    {
+      return false;
+    }
+    captures++;
+    lastEventMs = eventMs;
+    memset(buffer, 0, sizeof(buffer));
+    buffer[0] = 0xFF;
+    buffer[1] = 0xD8;
+    buffer[2] = (uint8_t)captures;
+    frame.data = buffer;
+    frame.length = sizeof(buffer);
+    frame.handle = buffer;
+    return true;
+  }
+
+  void release(CameraFrame &frame) override
+  {
+    releases++;
+    frame = CameraFrame();
+  }
+
+  uint32_t getOutstanding() const { return captures - releases; }
+
+private:
+  uint8_t buffer[FRAME_SIZE];
+};
+
+/**
+ * Object storage answering with a fixed status after an injected latency.
+ */
+class FakeObjectStore : public ObjectStore
+{
+public:
+  int status = 200;
+  uint32_t latencyMs = 0;
+  uint32_t uploads = 0;
+  size_t totalBytes = 0;
+  char lastPath[96] = "";
+
+  int upload(const char *bucket, const char *path, const char *mimeType, const uint8_t *data, size_t length) override
+  {
+    uploads++;
+    totalBytes += length;
+    strncpy(lastPath, path, sizeof(lastPath) - 1);
+    FakeClock::advanceMs(latencyMs);
+    return status;
+  }
+};
+
+class FakeDatabase : public DeviceDatabase
+{
+public:
+  bool owned = false;
+  uint32_t latencyMs = 0;
+  uint32_t ownerChecks = 0;
+  uint32_t usersAdded = 0;
+  bool addUserResult = true;
+  char lastUser[FINGERPRINT_USER_ID_SIZE] = "";
+
+  bool hasOwner(const char *nodeId) override
+  {
+    ownerChecks++;
+    FakeClock::advanceMs(latencyMs);
+    return owned;
+  }
+
+  bool addUser(const char *nodeId, const char *userId) override
+  {
+    usersAdded++;
+    strncpy(lastUser, userId, sizeof(lastUser) - 1);
+    FakeClock::advanceMs(latencyMs);
+    return addUserResult;
+  }
+};
+
+class FakeBuzzer : public Buzzer
+{
+public:
+  uint32_t beeps = 0;
+  uint32_t lastDurationMs = 0;
+
+  void beep(uint32_t durationMs) override
+  {
+    beeps++;
+    lastDurationMs = durationMs;
+  }
+};
+
+#endif
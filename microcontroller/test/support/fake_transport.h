@@ -0,0 +1,71 @@
+#ifndef FAKE_TRANSPORT_H
+#define FAKE_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <common/transport.h>
+
+/**
+ * Link to the other node that records every message instead of sending it.
+ */
+class FakeTransport : public Transport
+{
+public:
+  static const size_t CAPACITY = 32;
+  static const size_t TOPIC_SIZE = 64;
+  static const size_t PAYLOAD_SIZE = 256;
+
+  struct Message
+  {
+    char topic[TOPIC_SIZE];
+    uint8_t payload[PAYLOAD_SIZE];
+    size_t length;
+  };
+
+  bool ready = true;
+  bool failing = false; // Every send fails while set.
+
+  bool send(const char *topic, const uint8_t *payload, size_t length) override
+  {
+    stats.sent++;
+    if (failing || length > PAYLOAD_SIZE)
+    {
+      stats.lost++;
+      return false;
+    }
+    if (count < CAPACITY)
+    {
+      Message &message = messages[count++];
+      strncpy(message.topic, topic, TOPIC_SIZE - 1);
+      message.topic[TOPIC_SIZE - 1] = '\0';
+      memcpy(message.payload, payload, length);
+      message.length = length;
+    }
+    stats.recordDelivery(0);
+    return true;
+  }
+
+  bool isReady() const override { return ready; }
+
+  size_t getCount() const { return count; }
+  const Message &get(size_t i) const { return messages[i]; }
+  const Message &last() const { return messages[count - 1]; }
+
+  /**
+   * Decodes a recorded message. Strings point into the recorded payload (binary) or into doc (JSON).
+   */
+  template <typename T>
+  bool decode(size_t i, JsonDocument &doc, T &out) const
+  {
+    return i < count && strcmp(messages[i].topic, T::TOPIC) == 0 && decodeMessage(messages[i].payload, messages[i].length, doc, out);
+  }
+
+  void clear() { count = 0; }
+
+private:
+  Message messages[CAPACITY];
+  size_t count = 0;
+};
+
+#endif
@@ -0,0 +1,172 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <common/bitmap_cache.h>
+
+static const size_t ENTRY_SIZE = 16;
+static const size_t CAPACITY = 3;
+
+typedef BitmapCache<ENTRY_SIZE, CAPACITY> Cache;
+
+// The registration prompt's QR code holds the WROVER's ID.
+static const char *const NODE_ID = "6f1c2a9e-3b4d-4e5f-8a7b-9c0d1e2f3a4b";
+static const char *const OTHER_NODE_ID = "6f1c2a9e-3b4d-4e5f-8a7b-9c0d1e2f3a4c";
+
+static Cache cache;
+
+// A bitmap filled with one byte, so entries can be told apart.
+static const uint8_t *bitmap(uint8_t fill)
+{
+  static uint8_t data[ENTRY_SIZE];
+  memset(data, fill, sizeof(data));
+  return data;
+}
+
+void setUp(void)
+{
+  cache = Cache();
+}
+
+void tearDown(void) {}
+
+void test_payload_hash_is_fnv1a(void)
+{
+  TEST_ASSERT_EQUAL_UINT32(PAYLOAD_HASH_OFFSET, hashPayload(""));
+  TEST_ASSERT_EQUAL_UINT32(0xe40c292cu, hashPayload("a"));
+  TEST_ASSERT_TRUE(hashPayload(NODE_ID) != hashPayload(OTHER_NODE_ID));
+}
+
+void test_miss_then_hit(void)
+{
+  TEST_ASSERT_NULL(cache.find(NODE_ID));
+  cache.insert(NODE_ID, bitmap(0xAA), 4000);
+
+  const Cache::Entry *entry = cache.find(NODE_ID);
+  TEST_ASSERT_NOT_NULL(entry);
+  TEST_ASSERT_EQUAL_MEMORY(bitmap(0xAA), entry->data, ENTRY_SIZE);
+  cache.find(NODE_ID);
+
+  const BitmapCacheStats &stats = cache.getStats();
+  TEST_ASSERT_EQUAL_UINT32(2, stats.hits);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.misses);
+  TEST_ASSERT_TRUE(stats.savedUs == 8000);
+}
+
+void test_payloads_with_the_same_hash_are_kept_apart(void)
+{
+  // Birthday search for two payloads whose 32-bit hashes collide (about 80k payloads).
+  std::unordered_map<uint32_t, std::string> seen;
+  std::string first;
+  std::string second;
+  char payload[32];
+  for (uint32_t i = 0; first.empty(); i++)
+  {
+    snprintf(payload, sizeof(payload), "claim-%u", (unsigned)i);
+    auto inserted = seen.emplace(hashPayload(payload), payload);
+    if (!inserted.second)
+    {
+      first = inserted.first->second;
+      second = payload;
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(hashPayload(first.c_str()), hashPayload(second.c_str()));
+
+  cache.insert(first.c_str(), bitmap(1), 100);
+  TEST_ASSERT_NULL(cache.find(second.c_str()));
+
+  cache.insert(second.c_str(), bitmap(2), 100);
+  TEST_ASSERT_EQUAL_MEMORY(bitmap(1), cache.find(first.c_str())->data, ENTRY_SIZE);
+  TEST_ASSERT_EQUAL_MEMORY(bitmap(2), cache.find(second.c_str())->data, ENTRY_SIZE);
+}
+
+void test_evicts_the_least_recently_used(void)
+{
+  cache.insert("1", bitmap(1), 100);
+  cache.insert("2", bitmap(2), 100);
+  cache.insert("3", bitmap(3), 100);
+  // 1 is used again, so 2 is now the oldest.
+  cache.find("1");
+  cache.insert("4", bitmap(4), 100);
+
+  TEST_ASSERT_EQUAL_UINT32(1, cache.getStats().evictions);
+  TEST_ASSERT_NULL(cache.find("2"));
+  TEST_ASSERT_NOT_NULL(cache.find("1"));
+  TEST_ASSERT_NOT_NULL(cache.find("3"));
+  TEST_ASSERT_EQUAL_MEMORY(bitmap(4), cache.find("4")->data, ENTRY_SIZE);
+}
+
+void test_reinserting_a_payload_replaces_it(void)
+{
+  cache.insert("1", bitmap(1), 100);
+  cache.insert("2", bitmap(2), 100);
+  cache.insert("3", bitmap(3), 100);
+  // Full, but "1" is already cached: nothing is evicted or stored twice.
+  cache.insert("1", bitmap(9), 200);
+
+  TEST_ASSERT_EQUAL_UINT32(0, cache.getStats().evictions);
+  TEST_ASSERT_EQUAL_MEMORY(bitmap(9), cache.find("1")->data, ENTRY_SIZE);
+  TEST_ASSERT_NOT_NULL(cache.find("2"));
+  TEST_ASSERT_NOT_NULL(cache.find("3"));
+}
+
+void test_long_payloads_are_not_cached(void)
+{
+  std::string payload(64, 'q');
+  cache.insert(payload.c_str(), bitmap(1), 100);
+
+  TEST_ASSERT_NULL(cache.find(payload.c_str()));
+  payload.resize(63);
+  cache.insert(payload.c_str(), bitmap(1), 100);
+  TEST_ASSERT_NOT_NULL(cache.find(payload.c_str()));
+}
+
+void test_clear_forgets_every_entry(void)
+{
+  cache.insert("1", bitmap(1), 100);
+  cache.insert("2", bitmap(2), 100);
+  cache.clear();
+
+  TEST_ASSERT_NULL(cache.find("1"));
+  TEST_ASSERT_NULL(cache.find("2"));
+  cache.insert("3", bitmap(3), 100);
+  TEST_ASSERT_NOT_NULL(cache.find("3"));
+  TEST_ASSERT_EQUAL_UINT32(0, cache.getStats().evictions);
+}
+
+// The registration prompt while a node waits for its owner: the same QR code re-shown every prompt
+// interval (OWNER_PROMPT_INTERVAL), with text screens in between that do not touch the cache.
+void test_registration_prompt_hit_rate(void)
+{
+  static const uint32_t RENDER_US = 30000;
+  static const int PROMPTS = 20; // Five minutes of prompts.
+  for (int prompt = 0; prompt < PROMPTS; prompt++)
+  {
+    if (!cache.find(NODE_ID))
+    {
+      cache.insert(NODE_ID, bitmap(0x5A), RENDER_US);
+    }
+  }
+
+  const BitmapCacheStats &stats = cache.getStats();
+  printf("registration prompt: %u hits, %u misses, %llu ms of rendering saved\n",
+         (unsigned)stats.hits, (unsigned)stats.misses, (unsigned long long)(stats.savedUs / 1000));
+  TEST_ASSERT_EQUAL_UINT32(1, stats.misses);
+  TEST_ASSERT_EQUAL_UINT32(PROMPTS - 1, stats.hits);
+  TEST_ASSERT_TRUE(stats.savedUs == (uint64_t)(PROMPTS - 1) * RENDER_US);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_payload_hash_is_fnv1a);
+  RUN_TEST(test_miss_then_hit);
+  RUN_TEST(test_payloads_with_the_same_hash_are_kept_apart);
+  RUN_TEST(test_evicts_the_least_recently_used);
+  RUN_TEST(test_reinserting_a_payload_replaces_it);
+  RUN_TEST(test_long_payloads_are_not_cached);
+  RUN_TEST(test_clear_forgets_every_entry);
+  RUN_TEST(test_registration_prompt_hit_rate);
+  return UNITY_END();
+}
@@ -0,0 +1,194 @@
+#include <unity.h>
+#include <string>
+#include <common/connection_pool.h>
+#include <fake_clock.h>
+
+static const uint32_t IDLE_TIMEOUT_MS = 50000;
+
+/**
+ * A client whose session stays open until stopped or closed by the "server".
+ */
+class FakeClient
+{
+public:
+  static uint32_t connects;
+  static bool refuse;
+
+  bool connected() const { return open; }
+
+  bool connect(const char *host, uint16_t port)
+  {
+    connects++;
+    open = !refuse;
+    this->host = host;
+    return open;
+  }
+
+  void stop() { open = false; }
+
+  bool open = false;
+  std::string host;
+};
+
+uint32_t FakeClient::connects = 0;
+bool FakeClient::refuse = false;
+
+struct NoLock
+{
+  void lock() {}
+  void unlock() {}
+};
+
+typedef ConnectionPool<FakeClient, NoLock, 2> Pool;
+
+void setUp(void)
+{
+  FakeClock::reset();
+  FakeClient::connects = 0;
+  FakeClient::refuse = false;
+}
+
+void tearDown(void) {}
+
+void test_released_session_is_reused(void)
+{
+  Pool pool(IDLE_TIMEOUT_MS, FakeClock::millis);
+  bool reused = true;
+  FakeClient *client = pool.acquire("a.example", 443, &reused);
+  TEST_ASSERT_NOT_NULL(client);
+  TEST_ASSERT_FALSE(reused);
+  pool.release(client);
+
+  FakeClock::advanceMs(IDLE_TIMEOUT_MS);
+  TEST_ASSERT_TRUE(client == pool.acquire("a.example", 443, &reused));
+  TEST_ASSERT_TRUE(reused);
+  TEST_ASSERT_EQUAL_UINT32(1, FakeClient::connects);
+}
+
+void test_idle_session_is_reopened(void)
+{
+  Pool pool(IDLE_TIMEOUT_MS, FakeClock::millis);
+  bool reused = true;
+  pool.release(pool.acquire("a.example", 443));
+
+  FakeClock::advanceMs(IDLE_TIMEOUT_MS + 1);
+  TEST_ASSERT_NOT_NULL(pool.acquire("a.example", 443, &reused));
+  TEST_ASSERT_FALSE(reused);
+  TEST_ASSERT_EQUAL_UINT32(2, FakeClient::connects);
+}
+
+void test_session_closed_by_the_server_is_reopened(void)
+{
+  Pool pool(IDLE_TIMEOUT_MS, FakeClock::millis);
+  bool reused = true;
+  FakeClient *client = pool.acquire("a.example", 443);
+  pool.release(client);
+  client->open = false;
+
+  TEST_ASSERT_TRUE(client == pool.acquire("a.example", 443, &reused));
+  TEST_ASSERT_FALSE(reused);
+  TEST_ASSERT_TRUE(client->open);
+}
+
+void test_not_kept_alive_is_not_reused(void)
+{
+  Pool pool(IDLE_TIMEOUT_MS, FakeClock::millis);
+  bool reused = true;
+  FakeClient *client = pool.acquire("a.example", 443);
+  pool.release(client, false);
+  TEST_ASSERT_FALSE(client->open);
+
+  pool.acquire("a.example", 443, &reused);
+  TEST_ASSERT_FALSE(reused);
+  TEST_ASSERT_EQUAL_UINT32(2, FakeClient::connects);
+}
+
+void test_busy_pool_refuses(void)
+{
+  Pool pool(IDLE_TIMEOUT_MS, FakeClock::millis);
+  FakeClient *first = pool.acquire("a.example", 443);
+  FakeClient *second = pool.acquire("a.example", 443);
+  TEST_ASSERT_NOT_NULL(first);
+  TEST_ASSERT_NOT_NULL(second);
+  TEST_ASSERT_TRUE(first != second);
+  TEST_ASSERT_NULL(pool.acquire("a.example", 443));
+
+  pool.release(second);
+  TEST_ASSERT_TRUE(second == pool.acquire("a.example", 443));
+}
+
+void test_hosts_keep_their_own_sessions(void)
+{
+  Pool pool(IDLE_TIMEOUT_MS, FakeClock::millis);
+  FakeClient *a = pool.acquire("a.example", 443);
+  FakeClient *b = pool.acquire("b.example", 443);
+  pool.release(a);
+  pool.release(b);
+
+  bool reused = false;
+  TEST_ASSERT_TRUE(b == pool.acquire("b.example", 443, &reused));
+  TEST_ASSERT_TRUE(reused);
+  TEST_ASSERT_TRUE(a == pool.acquire("a.example", 443, &reused));
+  TEST_ASSERT_TRUE(reused);
+}
+
+void test_new_host_takes_the_least_recently_used(void)
+{
+  Pool pool(IDLE_TIMEOUT_MS, FakeClock::millis);
+  FakeClient *a = pool.acquire("a.example", 443);
+  FakeClient *b = pool.acquire("b.example", 443);
+  pool.release(a);
+  FakeClock::advanceMs(10);
+  pool.release(b);
+
+  TEST_ASSERT_TRUE(a == pool.acquire("c.example", 443));
+  TEST_ASSERT_EQUAL_STRING("c.example", a->host.c_str());
+}
+
+void test_host_is_copied(void)
+{
+  Pool pool(IDLE_TIMEOUT_MS, FakeClock::millis);
+  char host[32] = "a.example";
+  pool.release(pool.acquire(host, 443));
+  strcpy(host, "b.example");
+
+  bool reused = true;
+  pool.acquire("a.example", 443, &reused);
+  TEST_ASSERT_TRUE(reused);
+}
+
+void test_failed_connect_frees_the_slot(void)
+{
+  Pool pool(IDLE_TIMEOUT_MS, FakeClock::millis);
+  FakeClient::refuse = true;
+  TEST_ASSERT_NULL(pool.acquire("a.example", 443));
+  TEST_ASSERT_NULL(pool.acquire("a.example", 443));
+
+  FakeClient::refuse = false;
+  TEST_ASSERT_NOT_NULL(pool.acquire("a.example", 443));
+  TEST_ASSERT_NOT_NULL(pool.acquire("a.example", 443));
+}
+
+void test_too_long_host_is_refused(void)
+{
+  Pool pool(IDLE_TIMEOUT_MS, FakeClock::millis);
+  std::string host(Pool::HOST_SIZE, 'a');
+  TEST_ASSERT_NULL(pool.acquire(host.c_str(), 443));
+  TEST_ASSERT_EQUAL_UINT32(0, FakeClient::connects);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_released_session_is_reused);
+  RUN_TEST(test_idle_session_is_reopened);
+  RUN_TEST(test_session_closed_by_the_server_is_reopened);
+  RUN_TEST(test_not_kept_alive_is_not_reused);
+  RUN_TEST(test_busy_pool_refuses);
+  RUN_TEST(test_hosts_keep_their_own_sessions);
+  RUN_TEST(test_new_host_takes_the_least_recently_used);
+  RUN_TEST(test_host_is_copied);
+  RUN_TEST(test_failed_connect_frees_the_slot);
+  RUN_TEST(test_too_long_host_is_refused);
+  return UNITY_END();
+}
@@ -0,0 +1,182 @@
+#include <unity.h>
+#include <common/distance_filter.h>
+#include <fake_hal.h>
+
+// Thresholds and rate as the WROOM's ultrasonic task.
+static const float ENTER_CM = 10;
+static const float EXIT_CM = 15;
+static const uint32_t INTERVAL_MS = 100;
+// How late an event may come after the raw readings cross the threshold.
+static const uint32_t MAX_EVENT_LAG_MS = 500;
+
+// A visit recorded at the door, one reading per trigger (0 is an echo timeout): the empty porch
+// with a stray close echo, someone walking up and standing at the door, leaning about near the
+// thresholds with a missed echo, then walking away.
+static const float VISIT[] = {
+    82, 81, 0, 83, 4, 82, 80, 81,        // Idle, a timeout and a single close spike.
+    70, 55, 41, 30, 22, 16, 12,          // Walking up.
+    9, 8, 8, 7, 9, 8, 400, 8, 7,         // At the door, one missed echo.
+    11, 13, 9, 12, 14, 10, 13, 11, 9, 8, // Leaning about between the thresholds.
+    16, 24, 37, 52, 68, 79, 82, 81, 0, 82, // Walking away.
+};
+static const size_t VISIT_LENGTH = sizeof(VISIT) / sizeof(VISIT[0]);
+static const size_t FIRST_CLOSE = 15; // First raw reading at or below ENTER_CM (spike aside).
+static const size_t FIRST_FAR = 34;   // First raw reading at or above EXIT_CM once they leave.
+
+struct TraceResult
+{
+  uint32_t entered = 0;
+  uint32_t left = 0;
+  size_t enteredAt = 0;
+  size_t leftAt = 0;
+};
+
+/**
+ * Plays a trace through the sensor and the filter, as the ultrasonic task does.
+ */
+static TraceResult play(DistanceFilter &filter, const float *trace, size_t length)
+{
+  FakeDistanceSensor sensor(trace, length);
+  TraceResult result;
+  for (size_t i = 0; !sensor.isFinished(); i++)
+  {
+    sensor.trigger();
+    float distance;
+    while (sensor.read(distance))
+    {
+      switch (filter.update(distance))
+      {
+      case DISTANCE_ENTERED:
+        result.entered++;
+        result.enteredAt = i;
+        break;
+      case DISTANCE_LEFT:
+        result.left++;
+        result.leftAt = i;
+        break;
+      case DISTANCE_NO_EVENT:
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_visit_gives_one_enter_and_one_leave(void)
+{
+  DistanceFilter filter(ENTER_CM, EXIT_CM);
+  TraceResult result = play(filter, VISIT, VISIT_LENGTH);
+
+  TEST_ASSERT_EQUAL_UINT32(1, result.entered);
+  TEST_ASSERT_EQUAL_UINT32(1, result.left);
+  TEST_ASSERT_FALSE(filter.isClose());
+}
+
+void test_visit_events_lag_by_a_few_readings(void)
+{
+  DistanceFilter filter(ENTER_CM, EXIT_CM);
+  TraceResult result = play(filter, VISIT, VISIT_LENGTH);
+
+  // The median and the EMA cost a few readings.
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(FIRST_CLOSE, result.enteredAt);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(MAX_EVENT_LAG_MS, (result.enteredAt - FIRST_CLOSE) * INTERVAL_MS);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(FIRST_FAR, result.leftAt);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(MAX_EVENT_LAG_MS, (result.leftAt - FIRST_FAR) * INTERVAL_MS);
+}
+
+void test_single_threshold_would_flap_on_the_visit(void)
+{
+  // What the filter replaces: the raw reading against one cut-off.
+  uint32_t changes = 0;
+  bool close = false;
+  for (float distance : VISIT)
+  {
+    if (distance > 0 && (distance <= ENTER_CM) != close)
+    {
+      close = !close;
+      changes++;
+    }
+  }
+  TEST_ASSERT_GREATER_THAN_UINT32(2, changes);
+}
+
+void test_single_spike_does_not_trigger(void)
+{
+  const float trace[] = {80, 80, 80, 3, 80, 80, 80};
+  DistanceFilter filter(ENTER_CM, EXIT_CM);
+  TraceResult result = play(filter, trace, sizeof(trace) / sizeof(trace[0]));
+
+  TEST_ASSERT_EQUAL_UINT32(0, result.entered);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 80, filter.getDistance());
+}
+
+void test_waits_for_a_majority_of_the_window(void)
+{
+  DistanceFilter filter(ENTER_CM, EXIT_CM);
+  for (size_t i = 0; i < DistanceFilter::WINDOW / 2; i++)
+  {
+    TEST_ASSERT_EQUAL(DISTANCE_NO_EVENT, filter.update(5));
+  }
+  TEST_ASSERT_EQUAL(DISTANCE_ENTERED, filter.update(5));
+}
+
+void test_invalid_readings_are_ignored(void)
+{
+  DistanceFilter filter(ENTER_CM, EXIT_CM);
+  TEST_ASSERT_TRUE(filter.getDistance() < 0);
+
+  filter.update(0);
+  filter.update(-1);
+  TEST_ASSERT_TRUE(filter.getDistance() < 0);
+
+  filter.update(20);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 20, filter.getDistance());
+}
+
+void test_far_readings_are_clamped(void)
+{
+  DistanceFilter filter(ENTER_CM, EXIT_CM, 0.5f, 100);
+  filter.update(5000);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 100, filter.getDistance());
+}
+
+void test_hysteresis_holds_between_the_thresholds(void)
+{
+  DistanceFilter filter(ENTER_CM, EXIT_CM, 1.0f);
+  for (int i = 0; i < 3; i++)
+  {
+    filter.update(5);
+  }
+  TEST_ASSERT_TRUE(filter.isClose());
+
+  // Back above ENTER_CM but below EXIT_CM: still close.
+  for (int i = 0; i < 5; i++)
+  {
+    TEST_ASSERT_EQUAL(DISTANCE_NO_EVENT, filter.update(14));
+  }
+  TEST_ASSERT_TRUE(filter.isClose());
+
+  DistanceEvent event = DISTANCE_NO_EVENT;
+  for (int i = 0; i < 3 && event == DISTANCE_NO_EVENT; i++)
+  {
+    event = filter.update(15);
+  }
+  TEST_ASSERT_EQUAL(DISTANCE_LEFT, event);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_visit_gives_one_enter_and_one_leave);
+  RUN_TEST(test_visit_events_lag_by_a_few_readings);
+  RUN_TEST(test_single_threshold_would_flap_on_the_visit);
+  RUN_TEST(test_single_spike_does_not_trigger);
+  RUN_TEST(test_waits_for_a_majority_of_the_window);
+  RUN_TEST(test_invalid_readings_are_ignored);
+  RUN_TEST(test_far_readings_are_clamped);
+  RUN_TEST(test_hysteresis_holds_between_the_thresholds);
+  return UNITY_END();
+}
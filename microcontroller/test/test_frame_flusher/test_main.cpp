@@ -0,0 +1,175 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <common/frame_flusher.h>
+
+// The OLED's geometry and frame interval (common/oled.cpp).
+static const size_t WIDTH = 128;
+static const size_t HEIGHT = 64;
+static const uint32_t INTERVAL_MS = 50;
+
+typedef MemoryPanel<WIDTH, HEIGHT> Panel;
+typedef FrameFlusher<WIDTH, HEIGHT> Flusher;
+
+static const size_t PAGES = Flusher::PAGES;
+static const size_t FULL_FRAME_BYTES = PAGES * (WIDTH + Panel::ADDRESS_BYTES);
+
+static Panel panel;
+static uint8_t frame[Flusher::SIZE];
+
+void setUp(void)
+{
+  panel = Panel();
+  memset(frame, 0, sizeof(frame));
+}
+
+void tearDown(void) {}
+
+void test_first_flush_sends_the_whole_frame(void)
+{
+  Flusher flusher(panel, INTERVAL_MS);
+  frame[5] = 0xFF;
+
+  TEST_ASSERT_EQUAL_UINT32(FULL_FRAME_BYTES, flusher.flush(frame));
+  TEST_ASSERT_EQUAL_UINT32(PAGES, panel.writes);
+  TEST_ASSERT_EQUAL_MEMORY(frame, panel.frame, sizeof(frame));
+}
+
+void test_unchanged_frame_sends_nothing(void)
+{
+  Flusher flusher(panel, INTERVAL_MS);
+  flusher.flush(frame);
+
+  TEST_ASSERT_EQUAL_UINT32(0, flusher.flush(frame));
+  TEST_ASSERT_EQUAL_UINT32(1, flusher.getStats().skipped);
+  TEST_ASSERT_EQUAL_UINT32(1, flusher.getStats().flushes);
+}
+
+void test_changed_column_sends_one_span(void)
+{
+  Flusher flusher(panel, INTERVAL_MS);
+  flusher.flush(frame);
+  uint32_t spans = flusher.getStats().spans;
+
+  frame[3 * WIDTH + 40] = 0x81;
+  TEST_ASSERT_EQUAL_UINT32(1 + Panel::ADDRESS_BYTES, flusher.flush(frame));
+  TEST_ASSERT_EQUAL_UINT32(spans + 1, flusher.getStats().spans);
+  TEST_ASSERT_EQUAL_HEX8(0x81, panel.frame[3 * WIDTH + 40]);
+}
+
+void test_close_changes_merge_into_one_span(void)
+{
+  Flusher flusher(panel, INTERVAL_MS, 8);
+  flusher.flush(frame);
+
+  // 8 unchanged columns in between: cheaper to re-send them than to address a second span.
+  frame[10] = 1;
+  frame[19] = 1;
+  TEST_ASSERT_EQUAL_UINT32(10 + Panel::ADDRESS_BYTES, flusher.flush(frame));
+
+  // 9 unchanged columns in between: two spans.
+  frame[30] = 1;
+  frame[40] = 1;
+  TEST_ASSERT_EQUAL_UINT32(2 * (1 + Panel::ADDRESS_BYTES), flusher.flush(frame));
+  TEST_ASSERT_EQUAL_MEMORY(frame, panel.frame, sizeof(frame));
+}
+
+void test_requests_within_the_interval_are_coalesced(void)
+{
+  Flusher flusher(panel, INTERVAL_MS);
+  flusher.request();
+  TEST_ASSERT_TRUE(flusher.loop(frame, 1000));
+
+  frame[0] = 1;
+  flusher.request();
+  frame[1] = 1;
+  flusher.request();
+  frame[2] = 1;
+  flusher.request();
+  TEST_ASSERT_FALSE(flusher.loop(frame, 1000 + INTERVAL_MS - 1));
+  TEST_ASSERT_TRUE(flusher.hasPendingFlush());
+  TEST_ASSERT_TRUE(flusher.loop(frame, 1000 + INTERVAL_MS));
+  TEST_ASSERT_FALSE(flusher.loop(frame, 1000 + 2 * INTERVAL_MS));
+
+  const FrameFlusherStats &stats = flusher.getStats();
+  TEST_ASSERT_EQUAL_UINT32(4, stats.requests);
+  TEST_ASSERT_EQUAL_UINT32(2, stats.coalesced);
+  TEST_ASSERT_EQUAL_UINT32(2, stats.flushes);
+  TEST_ASSERT_EQUAL_UINT32(3 + Panel::ADDRESS_BYTES, stats.lastBytes);
+}
+
+void test_invalidate_resends_the_whole_frame(void)
+{
+  Flusher flusher(panel, INTERVAL_MS);
+  flusher.flush(frame);
+  flusher.invalidate();
+
+  TEST_ASSERT_EQUAL_UINT32(FULL_FRAME_BYTES, flusher.flush(frame));
+  TEST_ASSERT_TRUE(flusher.getStats().totalBytes == 2 * FULL_FRAME_BYTES);
+}
+
+// Same sequence on every run, so the results are reproducible.
+static uint32_t randomState = 1;
+
+static uint32_t nextRandom()
+{
+  randomState = randomState * 1664525u + 1013904223u;
+  return randomState >> 8;
+}
+
+void test_panel_mirrors_random_updates(void)
+{
+  Flusher flusher(panel, INTERVAL_MS);
+  for (int round = 0; round < 200; round++)
+  {
+    // A few scattered bytes, sometimes a whole page (a new text line).
+    for (uint32_t n = nextRandom() % 6; n > 0; n--)
+    {
+      frame[nextRandom() % sizeof(frame)] = (uint8_t)nextRandom();
+    }
+    if (nextRandom() % 10 == 0)
+    {
+      memset(frame + (nextRandom() % PAGES) * WIDTH, (uint8_t)nextRandom(), WIDTH);
+    }
+    flusher.flush(frame);
+    TEST_ASSERT_EQUAL_MEMORY(frame, panel.frame, sizeof(frame));
+  }
+}
+
+// Bytes on the bus for a status screen: one text line redrawn per update, against full frames.
+void test_text_line_update_bytes(void)
+{
+  static const int UPDATES = 100;
+  Flusher flusher(panel, INTERVAL_MS);
+  flusher.flush(frame);
+  uint64_t startBytes = flusher.getStats().totalBytes;
+
+  for (int i = 0; i < UPDATES; i++)
+  {
+    // A 6-column glyph changing on the second page (a seconds counter).
+    for (size_t column = 0; column < 6; column++)
+    {
+      frame[WIDTH + 60 + column] = (uint8_t)(i * 7 + column);
+    }
+    flusher.flush(frame);
+  }
+
+  uint64_t bytes = flusher.getStats().totalBytes - startBytes;
+  printf("text line: %llu bytes per update, full frame: %u bytes\n",
+         (unsigned long long)(bytes / UPDATES), (unsigned)FULL_FRAME_BYTES);
+  TEST_ASSERT_TRUE(bytes <= (uint64_t)UPDATES * (6 + Panel::ADDRESS_BYTES));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_first_flush_sends_the_whole_frame);
+  RUN_TEST(test_unchanged_frame_sends_nothing);
+  RUN_TEST(test_changed_column_sends_one_span);
+  RUN_TEST(test_close_changes_merge_into_one_span);
+  RUN_TEST(test_requests_within_the_interval_are_coalesced);
+  RUN_TEST(test_invalidate_resends_the_whole_frame);
+  RUN_TEST(test_panel_mirrors_random_updates);
+  RUN_TEST(test_text_line_update_bytes);
+  return UNITY_END();
+}
@@ -0,0 +1,147 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <common/frame_ring.h>
+
+static const size_t SLOTS = 4;
+static const size_t SLOT_SIZE = 16;
+
+// Writes a synthetic frame (its first byte is the timestamp) like the capture task does.
+template <size_t N>
+static bool captureAt(FrameRing<N> &ring, uint32_t timestampMs, size_t len = 1)
+{
+  if (!ring.fits(len))
+  {
+    return false;
+  }
+  typename FrameRing<N>::Slot *slot = ring.beginWrite();
+  if (!slot)
+  {
+    return false;
+  }
+  slot->buf[0] = (uint8_t)timestampMs;
+  ring.commitWrite(slot, len, timestampMs);
+  return true;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_empty_ring(void)
+{
+  FrameRing<SLOTS> ring;
+  TEST_ASSERT_TRUE(ring.begin(SLOT_SIZE, malloc));
+
+  int out[SLOTS];
+  TEST_ASSERT_EQUAL(-1, ring.latest());
+  TEST_ASSERT_EQUAL(-1, ring.closest(100));
+  TEST_ASSERT_EQUAL(0, ring.burst(100, 1, 1, out));
+}
+
+void test_closest_frame_to_the_event(void)
+{
+  FrameRing<SLOTS> ring;
+  ring.begin(SLOT_SIZE, malloc);
+  for (uint32_t t = 100; t <= 400; t += 100)
+  {
+    captureAt(ring, t);
+  }
+
+  TEST_ASSERT_EQUAL(200, ring[ring.closest(240)].timestampMs);
+  TEST_ASSERT_EQUAL(400, ring[ring.closest(1000)].timestampMs);
+  TEST_ASSERT_EQUAL(400, ring[ring.latest()].timestampMs);
+}
+
+void test_oldest_frame_is_overwritten(void)
+{
+  FrameRing<SLOTS> ring;
+  ring.begin(SLOT_SIZE, malloc);
+  for (uint32_t t = 100; t <= 600; t += 100)
+  {
+    captureAt(ring, t);
+  }
+
+  TEST_ASSERT_EQUAL(300, ring[ring.closest(0)].timestampMs);
+}
+
+void test_burst_in_capture_order(void)
+{
+  FrameRing<SLOTS> ring;
+  ring.begin(SLOT_SIZE, malloc);
+  for (uint32_t t = 100; t <= 600; t += 100)
+  {
+    captureAt(ring, t);
+  }
+
+  int out[SLOTS];
+  size_t count = ring.burst(410, 1, 5, out);
+  TEST_ASSERT_EQUAL(4, count);
+  TEST_ASSERT_EQUAL(300, ring[out[0]].timestampMs);
+  TEST_ASSERT_EQUAL(600, ring[out[3]].timestampMs);
+}
+
+void test_pinned_frame_is_kept(void)
+{
+  FrameRing<SLOTS> ring;
+  ring.begin(SLOT_SIZE, malloc);
+  captureAt(ring, 100);
+  int pinned = ring.closest(100);
+  ring.pin(pinned);
+
+  for (uint32_t t = 200; t <= 1000; t += 100)
+  {
+    TEST_ASSERT_TRUE(captureAt(ring, t));
+  }
+
+  TEST_ASSERT_EQUAL(100, ring[pinned].timestampMs);
+  TEST_ASSERT_EQUAL(100, ring[pinned].buf[0]);
+  ring.unpin(pinned);
+}
+
+// A burst of events holding every slot stops capture, so later events get stale frames.
+void test_every_slot_pinned_stops_capture(void)
+{
+  FrameRing<SLOTS> ring;
+  ring.begin(SLOT_SIZE, malloc);
+  for (uint32_t t = 100; t <= 400; t += 100)
+  {
+    captureAt(ring, t);
+    ring.pin(ring.latest());
+  }
+
+  TEST_ASSERT_FALSE(captureAt(ring, 500));
+  TEST_ASSERT_EQUAL(400, ring[ring.closest(500)].timestampMs);
+
+  // Copying a frame out and unpinning it right away lets capture continue.
+  ring.unpin(ring.closest(100));
+  TEST_ASSERT_TRUE(captureAt(ring, 500));
+  TEST_ASSERT_EQUAL(500, ring[ring.closest(500)].timestampMs);
+}
+
+// A frame larger than a slot is dropped without losing the oldest frame.
+void test_oversized_frame_keeps_the_ring(void)
+{
+  FrameRing<SLOTS> ring;
+  ring.begin(SLOT_SIZE, malloc);
+  for (uint32_t t = 100; t <= 400; t += 100)
+  {
+    captureAt(ring, t);
+  }
+
+  TEST_ASSERT_TRUE(ring.fits(SLOT_SIZE));
+  TEST_ASSERT_FALSE(captureAt(ring, 500, SLOT_SIZE + 1));
+  TEST_ASSERT_EQUAL(100, ring[ring.closest(0)].timestampMs);
+  TEST_ASSERT_EQUAL(400, ring[ring.latest()].timestampMs);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_ring);
+  RUN_TEST(test_closest_frame_to_the_event);
+  RUN_TEST(test_oldest_frame_is_overwritten);
+  RUN_TEST(test_burst_in_capture_order);
+  RUN_TEST(test_pinned_frame_is_kept);
+  RUN_TEST(test_every_slot_pinned_stops_capture);
+  RUN_TEST(test_oversized_frame_keeps_the_ring);
+  return UNITY_END();
+}
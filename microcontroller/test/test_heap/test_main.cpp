@@ -0,0 +1,94 @@
+#include <unity.h>
+#include <new>
+#include <stdlib.h>
+#include <common/mqtt_data.h>
+#include <common/text_layout.h>
+#include <common/topic_router.h>
+
+// Every operator new in the test binary is counted, so a helper that starts allocating fails here
+// before it fragments the device heap.
+static size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+  allocations++;
+  void *p = malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+static const char *NODE_ID = "6f1c2a9e-3b4d-4e5f-8a7b-9c0d1e2f3a4b";
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_counter_sees_allocations(void)
+{
+  size_t before = allocations;
+  int *value = new int(1);
+  delete value;
+  TEST_ASSERT_EQUAL_UINT32(1, allocations - before);
+}
+
+void test_build_topic_does_not_allocate(void)
+{
+  char topic[topicSize(FingerprintData::TOPIC)];
+  size_t before = allocations;
+
+  size_t length = buildTopic(topic, sizeof(topic), NODE_ID, FingerprintData::TOPIC);
+  TopicPrefix prefix(NODE_ID);
+  const char *subtopic = prefix.strip(topic);
+
+  TEST_ASSERT_EQUAL_UINT32(0, allocations - before);
+  TEST_ASSERT_EQUAL_UINT32(strlen(NODE_ID) + 1 + strlen(FingerprintData::TOPIC), length);
+  TEST_ASSERT_EQUAL_STRING(FingerprintData::TOPIC, subtopic);
+}
+
+void test_layout_text_does_not_allocate(void)
+{
+  TextLayout<4> layout;
+  size_t before = allocations;
+
+  layout.layout("Place the same finger again on the sensor, then wait for the confirmation", 16);
+
+  TEST_ASSERT_EQUAL_UINT32(0, allocations - before);
+  TEST_ASSERT_EQUAL_UINT32(4, layout.getLineCount());
+  TEST_ASSERT_TRUE(layout.isTruncated());
+}
+
+void test_binary_codec_does_not_allocate(void)
+{
+  uint8_t payload[64];
+  JsonDocument doc;
+  FingerprintData decoded;
+  size_t before = allocations;
+
+  size_t length = encodeMessage(FingerprintData(FINGERPRINT_UPDATE, "user-42", true), MQTT_FORMAT_BINARY, payload, sizeof(payload));
+  bool ok = decodeMessage(payload, length, doc, decoded);
+
+  TEST_ASSERT_EQUAL_UINT32(0, allocations - before);
+  TEST_ASSERT_TRUE(ok);
+  TEST_ASSERT_EQUAL_STRING("user-42", decoded.userId);
+  TEST_ASSERT_TRUE(decoded.isNew);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_counter_sees_allocations);
+  RUN_TEST(test_build_topic_does_not_allocate);
+  RUN_TEST(test_layout_text_does_not_allocate);
+  RUN_TEST(test_binary_codec_does_not_allocate);
+  return UNITY_END();
+}
@@ -0,0 +1,130 @@
+#include <unity.h>
+#include <string.h>
+#include <common/http_response.h>
+
+// Feeds a whole response, like a server answering in one segment.
+static void feedAll(HttpResponseReader &reader, const char *response)
+{
+  for (const char *c = response; *c && !reader.isFinished(); c++)
+  {
+    reader.feed(*c);
+  }
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_content_length_body_is_skipped(void)
+{
+  HttpResponseReader reader;
+  feedAll(reader, "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello");
+  TEST_ASSERT_EQUAL(200, reader.getStatus());
+  TEST_ASSERT_EQUAL(HTTP_RESPONSE_DONE, reader.getState());
+  TEST_ASSERT_TRUE(reader.canReuse());
+}
+
+void test_stops_at_the_end_of_the_body(void)
+{
+  HttpResponseReader reader;
+  const char *response = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n{}HTTP/1.1";
+  size_t used = 0;
+  while (!reader.feed(response[used++]))
+  {
+  }
+  TEST_ASSERT_EQUAL(strlen(response) - strlen("HTTP/1.1"), used);
+}
+
+void test_chunked_body_with_extensions_and_trailers(void)
+{
+  HttpResponseReader reader;
+  feedAll(reader, "HTTP/1.1 200 OK\r\n"
+                  "transfer-encoding: chunked\r\n\r\n"
+                  "4;name=value\r\n{\"Ke\r\n"
+                  "a\r\ny\":\"a.jpg\"\r\n"
+                  "0\r\n"
+                  "X-Trailer: 1\r\n\r\n");
+  TEST_ASSERT_EQUAL(200, reader.getStatus());
+  TEST_ASSERT_EQUAL(HTTP_RESPONSE_DONE, reader.getState());
+  TEST_ASSERT_TRUE(reader.canReuse());
+}
+
+void test_chunked_without_chunk_terminator_fails(void)
+{
+  HttpResponseReader reader;
+  feedAll(reader, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n2\r\nabX\r\n0\r\n\r\n");
+  TEST_ASSERT_EQUAL(HTTP_RESPONSE_ERROR, reader.getState());
+  TEST_ASSERT_FALSE(reader.canReuse());
+}
+
+void test_body_without_length_is_not_reusable(void)
+{
+  HttpResponseReader reader;
+  feedAll(reader, "HTTP/1.1 400 Bad Request\r\nContent-Type: application/json\r\n\r\n");
+  TEST_ASSERT_EQUAL(400, reader.getStatus());
+  TEST_ASSERT_TRUE(reader.isFinished());
+  TEST_ASSERT_FALSE(reader.canReuse());
+}
+
+void test_connection_close_is_not_reusable(void)
+{
+  HttpResponseReader reader;
+  feedAll(reader, "HTTP/1.1 401 Unauthorized\r\nConnection: close\r\nContent-Length: 0\r\n\r\n");
+  TEST_ASSERT_EQUAL(401, reader.getStatus());
+  TEST_ASSERT_EQUAL(HTTP_RESPONSE_DONE, reader.getState());
+  TEST_ASSERT_FALSE(reader.canReuse());
+}
+
+void test_no_content_has_no_body(void)
+{
+  HttpResponseReader reader;
+  feedAll(reader, "HTTP/1.1 204 No Content\r\n\r\n");
+  TEST_ASSERT_EQUAL(204, reader.getStatus());
+  TEST_ASSERT_TRUE(reader.canReuse());
+}
+
+void test_continue_is_followed_by_the_final_status(void)
+{
+  HttpResponseReader reader;
+  feedAll(reader, "HTTP/1.1 100 Continue\r\n\r\n");
+  TEST_ASSERT_FALSE(reader.isFinished());
+  feedAll(reader, "HTTP/1.1 201 Created\r\nContent-Length: 3\r\n\r\nabc");
+  TEST_ASSERT_EQUAL(201, reader.getStatus());
+  TEST_ASSERT_TRUE(reader.canReuse());
+}
+
+void test_split_across_reads(void)
+{
+  const char *response = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n0\r\n\r\n";
+  // Whatever the segment boundaries are, the reader only sees bytes in order.
+  HttpResponseReader reader;
+  size_t length = strlen(response);
+  for (size_t i = 0; i < length; i++)
+  {
+    TEST_ASSERT_EQUAL(i + 1 == length, reader.feed(response[i]));
+  }
+  TEST_ASSERT_TRUE(reader.canReuse());
+}
+
+void test_malformed_status_line(void)
+{
+  HttpResponseReader reader;
+  feedAll(reader, "garbage\r\n");
+  TEST_ASSERT_EQUAL(HTTP_RESPONSE_ERROR, reader.getState());
+  TEST_ASSERT_EQUAL(-1, reader.getStatus());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_content_length_body_is_skipped);
+  RUN_TEST(test_stops_at_the_end_of_the_body);
+  RUN_TEST(test_chunked_body_with_extensions_and_trailers);
+  RUN_TEST(test_chunked_without_chunk_terminator_fails);
+  RUN_TEST(test_body_without_length_is_not_reusable);
+  RUN_TEST(test_connection_close_is_not_reusable);
+  RUN_TEST(test_no_content_has_no_body);
+  RUN_TEST(test_continue_is_followed_by_the_final_status);
+  RUN_TEST(test_split_across_reads);
+  RUN_TEST(test_malformed_status_line);
+  return UNITY_END();
+}
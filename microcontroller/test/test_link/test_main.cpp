@@ -0,0 +1,257 @@
+#include <unity.h>
+#include <string.h>
+#include <thread>
+#include <common/transport.h>
+
+// The receiving node: every link ends in its inbox, and the handler counts what gets through.
+static LinkInbox inbox;
+static uint32_t handled = 0;
+static char lastTopic[64];
+static uint8_t lastPayload[64];
+static size_t lastLength = 0;
+
+static void receive(const char *subtopic, const uint8_t *payload, size_t length)
+{
+  if (!inbox.accept(subtopic, payload, length))
+  {
+    return;
+  }
+  handled++;
+  strncpy(lastTopic, subtopic, sizeof(lastTopic) - 1);
+  memcpy(lastPayload, payload, length);
+  lastLength = length;
+}
+
+/**
+ * A link that carries message IDs like the device links. An asynchronous one (like ESP-NOW) accepts
+ * messages and reports the failed ones from pump(); the message may still have reached the other
+ * node when only the ack was lost.
+ */
+class SimulatedLink : public Transport
+{
+public:
+  bool asynchronous = false;
+  bool reachesPeer = true; // Whether the other node receives the message.
+  bool acked = true;       // Whether the sender learns it did.
+  uint32_t lastMessageId = 0;
+
+  bool send(const char *topic, const uint8_t *payload, size_t length) override
+  {
+    return send(newMessageId(), topic, payload, length);
+  }
+
+  bool send(uint16_t messageId, const char *topic, const uint8_t *payload, size_t length) override
+  {
+    stats.sent++;
+    lastMessageId = messageId;
+    char linkTopic[64];
+    uint8_t linkPayload[64];
+    size_t linkLength = wrapLinkMessage(messageId, topic, payload, length, linkTopic, sizeof(linkTopic), linkPayload, sizeof(linkPayload));
+    if (reachesPeer)
+    {
+      receive(linkTopic, linkPayload, linkLength);
+    }
+    if (!acked && asynchronous)
+    {
+      pendingId = messageId;
+      strncpy(pendingTopic, topic, sizeof(pendingTopic) - 1);
+      memcpy(pendingPayload, payload, length);
+      pendingLength = length;
+      hasPending = true;
+      return true;
+    }
+    return acked;
+  }
+
+  // What EspNowTransport::loop() does with the frames its sender task gave up on.
+  void pump()
+  {
+    if (hasPending && undeliveredListener)
+    {
+      hasPending = false;
+      undeliveredListener->onUndelivered(*this, pendingId, pendingTopic, pendingPayload, pendingLength);
+    }
+  }
+
+private:
+  bool hasPending = false;
+  uint16_t pendingId = 0;
+  char pendingTopic[64] = "";
+  uint8_t pendingPayload[64];
+  size_t pendingLength = 0;
+};
+
+static const uint8_t DOORBELL[] = {1, 2, 3};
+
+void setUp(void)
+{
+  inbox = LinkInbox();
+  handled = 0;
+  lastTopic[0] = '\0';
+  lastLength = 0;
+}
+
+void tearDown(void) {}
+
+void test_messages_without_an_id_pass_through(void)
+{
+  receive("fingerprint", DOORBELL, sizeof(DOORBELL));
+  receive("fingerprint", DOORBELL, sizeof(DOORBELL));
+
+  TEST_ASSERT_EQUAL_UINT32(2, handled);
+  TEST_ASSERT_EQUAL_STRING("fingerprint", lastTopic);
+}
+
+void test_message_is_unwrapped(void)
+{
+  char topic[32];
+  uint8_t payload[32];
+  size_t length = wrapLinkMessage(0x1234, "fingerprint", DOORBELL, sizeof(DOORBELL), topic, sizeof(topic), payload, sizeof(payload));
+  TEST_ASSERT_EQUAL_UINT32(LINK_MESSAGE_ID_SIZE + sizeof(DOORBELL), length);
+  TEST_ASSERT_EQUAL_STRING("link/msg/fingerprint", topic);
+
+  receive(topic, payload, length);
+
+  TEST_ASSERT_EQUAL_UINT32(1, handled);
+  TEST_ASSERT_EQUAL_STRING("fingerprint", lastTopic);
+  TEST_ASSERT_EQUAL_UINT32(sizeof(DOORBELL), lastLength);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(DOORBELL, lastPayload, sizeof(DOORBELL));
+}
+
+void test_wrap_checks_the_buffers(void)
+{
+  char topic[12];
+  uint8_t payload[4];
+  TEST_ASSERT_EQUAL_UINT32(0, wrapLinkMessage(1, "fingerprint", DOORBELL, sizeof(DOORBELL), topic, sizeof(topic), payload, sizeof(payload)));
+}
+
+void test_same_id_is_handled_once(void)
+{
+  char topic[32];
+  uint8_t payload[32];
+  size_t length = wrapLinkMessage(7, "fingerprint", DOORBELL, sizeof(DOORBELL), topic, sizeof(topic), payload, sizeof(payload));
+
+  receive(topic, payload, length);
+  receive(topic, payload, length);
+
+  TEST_ASSERT_EQUAL_UINT32(1, handled);
+  TEST_ASSERT_EQUAL_UINT32(1, inbox.getDuplicates());
+}
+
+void test_old_ids_are_forgotten(void)
+{
+  char topic[32];
+  uint8_t payload[32];
+  for (uint16_t id = 0; id <= LinkInbox::HISTORY; id++)
+  {
+    size_t length = wrapLinkMessage(id, "oled", DOORBELL, sizeof(DOORBELL), topic, sizeof(topic), payload, sizeof(payload));
+    receive(topic, payload, length);
+  }
+  size_t length = wrapLinkMessage(0, "oled", DOORBELL, sizeof(DOORBELL), topic, sizeof(topic), payload, sizeof(payload));
+  receive(topic, payload, length);
+
+  TEST_ASSERT_EQUAL_UINT32(LinkInbox::HISTORY + 2, handled);
+}
+
+void test_lost_ack_rings_once(void)
+{
+  SimulatedLink espNow;
+  SimulatedLink mqtt;
+  FallbackTransport link(espNow, mqtt);
+  espNow.asynchronous = true;
+  espNow.acked = false;
+
+  // The frame reached the peer, the ack did not: the sender gives up and resends over MQTT.
+  TEST_ASSERT_TRUE(link.send("fingerprint", DOORBELL, sizeof(DOORBELL)));
+  espNow.pump();
+
+  TEST_ASSERT_EQUAL_UINT32(1, mqtt.getStats().sent);
+  TEST_ASSERT_EQUAL_UINT32(espNow.lastMessageId, mqtt.lastMessageId);
+  TEST_ASSERT_EQUAL_UINT32(1, handled);
+  TEST_ASSERT_EQUAL_UINT32(1, inbox.getDuplicates());
+  TEST_ASSERT_EQUAL_UINT32(1, link.getStats().delivered);
+  TEST_ASSERT_EQUAL_UINT32(1, link.getStats().fallbacks);
+}
+
+void test_lost_frame_arrives_over_the_fallback(void)
+{
+  SimulatedLink espNow;
+  SimulatedLink mqtt;
+  FallbackTransport link(espNow, mqtt);
+  espNow.asynchronous = true;
+  espNow.acked = false;
+  espNow.reachesPeer = false;
+
+  link.send("fingerprint", DOORBELL, sizeof(DOORBELL));
+  TEST_ASSERT_EQUAL_UINT32(0, handled);
+  espNow.pump();
+
+  TEST_ASSERT_EQUAL_UINT32(1, handled);
+  TEST_ASSERT_EQUAL_UINT32(0, inbox.getDuplicates());
+}
+
+void test_synchronous_failure_keeps_the_id(void)
+{
+  SimulatedLink primary;
+  SimulatedLink fallback;
+  FallbackTransport link(primary, fallback);
+  primary.acked = false;
+
+  link.send("fingerprint", DOORBELL, sizeof(DOORBELL));
+
+  TEST_ASSERT_EQUAL_UINT32(primary.lastMessageId, fallback.lastMessageId);
+  TEST_ASSERT_EQUAL_UINT32(1, handled);
+}
+
+void test_every_message_gets_a_new_id(void)
+{
+  SimulatedLink primary;
+  SimulatedLink fallback;
+  FallbackTransport link(primary, fallback);
+
+  link.send("fingerprint", DOORBELL, sizeof(DOORBELL));
+  link.send("fingerprint", DOORBELL, sizeof(DOORBELL));
+
+  TEST_ASSERT_EQUAL_UINT32(2, handled);
+  TEST_ASSERT_EQUAL_UINT32(0, fallback.getStats().sent);
+}
+
+// The ESP-NOW sender task records deliveries while the loop task sends and reads the counters.
+void test_stats_count_from_two_tasks(void)
+{
+  static const uint32_t DELIVERIES = 100000;
+  LinkStats stats;
+  auto record = [&stats](uint32_t latencyUs)
+  {
+    for (uint32_t i = 0; i < DELIVERIES; i++)
+    {
+      stats.recordDelivery(latencyUs + i % 100);
+      stats.sent++;
+    }
+  };
+
+  std::thread sender(record, 1000);
+  record(2000);
+  sender.join();
+
+  TEST_ASSERT_EQUAL_UINT32(2 * DELIVERIES, stats.delivered);
+  TEST_ASSERT_EQUAL_UINT32(2 * DELIVERIES, stats.sent);
+  TEST_ASSERT_EQUAL_UINT32(2099, stats.maxLatencyUs);
+  TEST_ASSERT_EQUAL_UINT32(1549, stats.averageLatencyUs());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_messages_without_an_id_pass_through);
+  RUN_TEST(test_message_is_unwrapped);
+  RUN_TEST(test_wrap_checks_the_buffers);
+  RUN_TEST(test_same_id_is_handled_once);
+  RUN_TEST(test_old_ids_are_forgotten);
+  RUN_TEST(test_lost_ack_rings_once);
+  RUN_TEST(test_lost_frame_arrives_over_the_fallback);
+  RUN_TEST(test_synchronous_failure_keeps_the_id);
+  RUN_TEST(test_every_message_gets_a_new_id);
+  RUN_TEST(test_stats_count_from_two_tasks);
+  return UNITY_END();
+}
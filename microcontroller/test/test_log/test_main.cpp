@@ -0,0 +1,107 @@
+#include <unity.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <chrono>
+#include <common/log.h>
+
+// The native build has LOG_LEVEL=2: LOG_WARN is compiled in, LOG_INFO and LOG_DEBUG are not.
+
+static const uint32_t CALLS = 20000;
+static uint32_t evaluations = 0;
+
+static int counted(int value)
+{
+  evaluations++;
+  return value;
+}
+
+static void logEnabled()
+{
+  for (uint32_t i = 0; i < CALLS; i++)
+    LOG_WARN("[Test] event %05u at %d\n", i, counted(42));
+}
+
+static void logDisabled()
+{
+  for (uint32_t i = 0; i < CALLS; i++)
+    LOG_INFO("[Test] event %05u at %d\n", i, counted(42));
+}
+
+/**
+ * Runs body with stdout sent to a temporary file.
+ *
+ * @return The number of bytes written to stdout.
+ */
+static long captureStdout(void (*body)(), uint64_t &elapsedNs)
+{
+  fflush(stdout);
+  FILE *capture = tmpfile();
+  int saved = dup(fileno(stdout));
+  dup2(fileno(capture), fileno(stdout));
+
+  auto start = std::chrono::steady_clock::now();
+  body();
+  fflush(stdout);
+  elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+  dup2(saved, fileno(stdout));
+  close(saved);
+  long bytes = lseek(fileno(capture), 0, SEEK_END);
+  fclose(capture);
+  return bytes;
+}
+
+void setUp(void)
+{
+  evaluations = 0;
+}
+
+void tearDown(void) {}
+
+void test_levels_of_the_native_build(void)
+{
+  TEST_ASSERT_TRUE(isLogEnabled(LOG_LEVEL_ERROR));
+  TEST_ASSERT_TRUE(isLogEnabled(LOG_LEVEL_WARN));
+  TEST_ASSERT_FALSE(isLogEnabled(LOG_LEVEL_INFO));
+  TEST_ASSERT_FALSE(isLogEnabled(LOG_LEVEL_DEBUG));
+}
+
+void test_disabled_level_costs_nothing(void)
+{
+  uint64_t offNs;
+  long bytes = captureStdout(logDisabled, offNs);
+
+  // Neither formatted nor printed, and the arguments are not even evaluated.
+  TEST_ASSERT_EQUAL(0, bytes);
+  TEST_ASSERT_EQUAL_UINT32(0, evaluations);
+}
+
+void test_enabled_level_prints_every_call(void)
+{
+  uint64_t onNs;
+  long bytes = captureStdout(logEnabled, onNs);
+
+  TEST_ASSERT_EQUAL(CALLS * sizeof("[Test] event 00000 at 42\n") - CALLS, bytes);
+  TEST_ASSERT_EQUAL_UINT32(CALLS, evaluations);
+}
+
+void test_cost_of_logging_on_and_off(void)
+{
+  uint64_t onNs;
+  uint64_t offNs;
+  captureStdout(logEnabled, onNs);
+  captureStdout(logDisabled, offNs);
+
+  printf("LOG_WARN (on): %.1f ns/call, LOG_INFO (off): %.1f ns/call\n", (double)onNs / CALLS, (double)offNs / CALLS);
+  TEST_ASSERT_TRUE(offNs < onNs);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_levels_of_the_native_build);
+  RUN_TEST(test_disabled_level_costs_nothing);
+  RUN_TEST(test_enabled_level_prints_every_call);
+  RUN_TEST(test_cost_of_logging_on_and_off);
+  return UNITY_END();
+}
@@ -0,0 +1,213 @@
+#include <unity.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <string>
+#include <wrover/actions/log_encoder.h>
+#include <wrover/actions/log_queue.h>
+
+// Every operator new in the test binary is counted, for the benchmark's allocations per record.
+static size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+  allocations++;
+  void *p = malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+// The log sink's String concatenation encoder before encodeLogDocument(), with std::string for
+// Arduino's String (both grow on the heap as they are appended to).
+static std::string buildLogDocument(const LogRecord &record)
+{
+  time_t raw = (time_t)record.createdAt;
+  struct tm tmbuf;
+  gmtime_r(&raw, &tmbuf);
+  char ts[32];
+  strftime(ts, sizeof(ts), "%FT%TZ", &tmbuf);
+
+  std::string payload = "{ \"fields\": {";
+
+  payload += "\"deviceId\":{ \"stringValue\":\"";
+  payload += record.deviceId;
+  payload += "\" },";
+
+  payload += "\"createdAt\":{ \"timestampValue\":\"";
+  payload += ts;
+  payload += "\" },";
+
+  payload += "\"photoURL\":{ \"stringValue\":\"";
+  payload += record.photoURL;
+  payload += "\" },";
+
+  payload += "\"type\":{ \"integerValue\":\"";
+  payload += std::to_string(static_cast<int>(record.type));
+  payload += "\" },";
+
+  payload += "\"userId\":{ \"stringValue\":\"";
+  payload += record.userId;
+  payload += "\" }";
+
+  payload += " }}";
+  return payload;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_rfc3339_known_dates(void)
+{
+  char out[RFC3339_SIZE];
+
+  TEST_ASSERT_EQUAL_UINT32(20, formatRFC3339(0, out));
+  TEST_ASSERT_EQUAL_STRING("1970-01-01T00:00:00Z", out);
+  formatRFC3339(951782400, out);
+  TEST_ASSERT_EQUAL_STRING("2000-02-29T00:00:00Z", out);
+  formatRFC3339(1735689599, out);
+  TEST_ASSERT_EQUAL_STRING("2024-12-31T23:59:59Z", out);
+  formatRFC3339(-1, out);
+  TEST_ASSERT_EQUAL_STRING("1969-12-31T23:59:59Z", out);
+}
+
+void test_rfc3339_matches_gmtime(void)
+{
+  char out[RFC3339_SIZE];
+  char expected[RFC3339_SIZE];
+  // From 1970 to 2100 in steps of about 9 days that are not a whole number of days, so the time of day varies.
+  for (int64_t epoch = 0; epoch < 4102444800LL; epoch += 7919 * 97)
+  {
+    time_t t = (time_t)epoch;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    strftime(expected, sizeof(expected), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    formatRFC3339(epoch, out);
+    TEST_ASSERT_EQUAL_STRING(expected, out);
+  }
+}
+
+void test_document_layout(void)
+{
+  char out[LOG_DOCUMENT_SIZE];
+  size_t length = encodeLogDocument(out, sizeof(out), "wrover-1", 3, 1735689599, "https://x/p.jpg", "alice");
+
+  const char *expected = "{\"fields\":{\"deviceId\":{\"stringValue\":\"wrover-1\"},"
+                         "\"createdAt\":{\"timestampValue\":\"2024-12-31T23:59:59Z\"},"
+                         "\"photoURL\":{\"stringValue\":\"https://x/p.jpg\"},"
+                         "\"type\":{\"integerValue\":\"3\"},"
+                         "\"userId\":{\"stringValue\":\"alice\"}}}";
+  TEST_ASSERT_EQUAL_STRING(expected, out);
+  TEST_ASSERT_EQUAL_UINT32(strlen(expected), length);
+}
+
+void test_strings_are_escaped(void)
+{
+  char out[LOG_DOCUMENT_SIZE];
+  encodeLogDocument(out, sizeof(out), "a\"b\\c", 0, 0, "", "line\nbreak\x01");
+
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"stringValue\":\"a\\\"b\\\\c\""));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"stringValue\":\"line\\u000abreak\\u0001\""));
+}
+
+void test_null_strings_are_empty(void)
+{
+  char out[LOG_DOCUMENT_SIZE];
+  encodeLogDocument(out, sizeof(out), "wrover-1", 1, 0, nullptr, nullptr);
+
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"photoURL\":{\"stringValue\":\"\"}"));
+  TEST_ASSERT_NOT_NULL(strstr(out, "\"userId\":{\"stringValue\":\"\"}"));
+}
+
+void test_document_that_does_not_fit(void)
+{
+  char out[LOG_DOCUMENT_SIZE];
+  size_t length = encodeLogDocument(out, sizeof(out), "wrover-1", 255, 0, "", "bob");
+
+  // Room for the document and its terminator is enough, one byte less is not.
+  char exact[LOG_DOCUMENT_SIZE];
+  TEST_ASSERT_EQUAL_UINT32(length, encodeLogDocument(exact, length + 1, "wrover-1", 255, 0, "", "bob"));
+  TEST_ASSERT_EQUAL_STRING(out, exact);
+  TEST_ASSERT_EQUAL_UINT32(0, encodeLogDocument(exact, length, "wrover-1", 255, 0, "", "bob"));
+  TEST_ASSERT_EQUAL_STRING("", exact);
+}
+
+void test_longest_log_fits(void)
+{
+  // The longest strings the log queue stores, without escaping.
+  char deviceId[sizeof(LogRecord::deviceId)];
+  char photoURL[sizeof(LogRecord::photoURL)];
+  char userId[sizeof(LogRecord::userId)];
+  memset(deviceId, 'd', sizeof(deviceId) - 1);
+  memset(photoURL, 'p', sizeof(photoURL) - 1);
+  memset(userId, 'u', sizeof(userId) - 1);
+  deviceId[sizeof(deviceId) - 1] = photoURL[sizeof(photoURL) - 1] = userId[sizeof(userId) - 1] = '\0';
+
+  char out[LOG_DOCUMENT_SIZE];
+  TEST_ASSERT_GREATER_THAN(0, encodeLogDocument(out, sizeof(out), deviceId, 255, INT32_MAX, photoURL, userId));
+}
+
+// Benchmark: bytes, allocations and time per record of a typical doorbell log, old encoder against new.
+void test_encoder_benchmark(void)
+{
+  static const uint32_t ROUNDS = 100000;
+  LogRecord record;
+  strcpy(record.deviceId, "6f1c2a9e-3b4d-4e5f-8a7b-9c0d1e2f3a4b");
+  strcpy(record.photoURL, "https://abcdefghijklmnop.supabase.co/storage/v1/object/public/photos/6f1c2a9e/1735689599.jpg");
+  strcpy(record.userId, "Xq3vB7nL0sKp2WmR9tYc4HfE8dJ1");
+  record.type = 0;
+  record.createdAt = 1735689599;
+
+  size_t oldBytes = 0;
+  size_t before = allocations;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < ROUNDS; i++)
+  {
+    oldBytes = buildLogDocument(record).size();
+  }
+  double oldNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / (double)ROUNDS;
+  double oldAllocations = (allocations - before) / (double)ROUNDS;
+
+  char out[LOG_DOCUMENT_SIZE];
+  size_t newBytes = 0;
+  before = allocations;
+  start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < ROUNDS; i++)
+  {
+    newBytes = encodeLogDocument(out, sizeof(out), record.deviceId, record.type, record.createdAt, record.photoURL, record.userId);
+  }
+  double newNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / (double)ROUNDS;
+  double newAllocations = (allocations - before) / (double)ROUNDS;
+
+  printf("String concatenation: %u bytes, %.1f allocations, %.0f ns per record\n", (unsigned)oldBytes, oldAllocations, oldNs);
+  printf("encodeLogDocument:    %u bytes, %.1f allocations, %.0f ns per record\n", (unsigned)newBytes, newAllocations, newNs);
+  TEST_ASSERT_TRUE(newAllocations == 0);
+  TEST_ASSERT_TRUE(newBytes > 0 && newBytes <= oldBytes);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_rfc3339_known_dates);
+  RUN_TEST(test_rfc3339_matches_gmtime);
+  RUN_TEST(test_document_layout);
+  RUN_TEST(test_strings_are_escaped);
+  RUN_TEST(test_null_strings_are_empty);
+  RUN_TEST(test_document_that_does_not_fit);
+  RUN_TEST(test_longest_log_fits);
+  RUN_TEST(test_encoder_benchmark);
+  return UNITY_END();
+}
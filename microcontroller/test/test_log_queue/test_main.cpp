@@ -0,0 +1,333 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <fake_clock.h>
+#include <wrover/actions/log_queue.h>
+
+static const uint32_t MAX_PENDING = 32;
+static const uint32_t R = LogQueue::RECORD_SIZE;
+
+// The queue file in memory. Records are identified by their id.
+class MemoryLogStore : public LogStore
+{
+public:
+  static const size_t CAPACITY = 1024;
+
+  uint32_t head = 0;
+  uint32_t tornBytes = 0; // A record cut short by a reset.
+  uint32_t compactions = 0;
+
+  uint32_t size() override { return count * R + tornBytes; }
+
+  size_t read(uint32_t offset, LogRecord *out, size_t max) override
+  {
+    size_t read = 0;
+    for (size_t i = offset / R; i < count && read < max; i++)
+    {
+      out[read++] = records[i];
+    }
+    return read;
+  }
+
+  bool append(const LogRecord &record) override
+  {
+    if (count == CAPACITY)
+    {
+      return false;
+    }
+    records[count++] = record;
+    return true;
+  }
+
+  uint32_t compact(uint32_t offset) override
+  {
+    size_t first = offset / R;
+    memmove(records, records + first, (count - first) * sizeof(LogRecord));
+    count -= first;
+    tornBytes = 0;
+    compactions++;
+    return count * R;
+  }
+
+  void clear() override
+  {
+    count = 0;
+    head = 0;
+  }
+
+  void saveHead(uint32_t offset) override { head = offset; }
+  uint32_t loadHead() override { return head; }
+
+private:
+  LogRecord records[CAPACITY];
+  size_t count = 0;
+};
+
+/**
+ * Firestore's commit endpoint: one round trip per request plus a little per document, and a status
+ * per record id (a record with a rejected id fails the whole commit, as Firestore does).
+ */
+class MockFirestore
+{
+public:
+  uint32_t requestMs = 120;
+  uint32_t perRecordMs = 2;
+  int status = 200;
+  uint32_t rejectedId = 0;
+  uint32_t requests = 0;
+  uint32_t committed = 0;
+
+  int commit(const LogRecord *records, size_t count)
+  {
+    requests++;
+    FakeClock::advanceMs(requestMs + perRecordMs * count);
+    for (size_t i = 0; i < count; i++)
+    {
+      if (rejectedId != 0 && records[i].id == rejectedId)
+      {
+        return 400;
+      }
+    }
+    if (status >= 200 && status < 300)
+    {
+      committed += count;
+    }
+    return status;
+  }
+};
+
+static MemoryLogStore store;
+static MockFirestore firestore;
+static LogRecord batch[LogQueue::BATCH_SIZE];
+
+static LogRecord makeRecord(uint32_t id)
+{
+  LogRecord record = {};
+  record.id = id;
+  snprintf(record.deviceId, sizeof(record.deviceId), "wrover-1");
+  return record;
+}
+
+static void appendRecords(LogQueue &queue, uint32_t firstId, uint32_t count)
+{
+  for (uint32_t id = firstId; id < firstId + count; id++)
+  {
+    TEST_ASSERT_TRUE(queue.append(makeRecord(id)));
+  }
+}
+
+// What the flush task does once a batch is due. Returns the records committed.
+static size_t flush(LogQueue &queue)
+{
+  uint32_t batchHead;
+  size_t count = queue.readBatch(batch, batchHead);
+  if (count == 0)
+  {
+    return 0;
+  }
+  uint32_t start = FakeClock::millis();
+  int status = firestore.commit(batch, count);
+  queue.onCommitted(batchHead, count, status, FakeClock::millis() - start);
+  return count;
+}
+
+void setUp(void)
+{
+  FakeClock::reset(1000);
+  store = MemoryLogStore();
+  firestore = MockFirestore();
+}
+
+void tearDown(void) {}
+
+void test_batch_is_due_when_full_or_old(void)
+{
+  LogQueue queue(store, FakeClock::millis, MAX_PENDING, 3000);
+  queue.load();
+
+  appendRecords(queue, 1, LogQueue::BATCH_SIZE - 1);
+  TEST_ASSERT_FALSE(queue.isFlushDue());
+  FakeClock::advanceMs(3000);
+  TEST_ASSERT_TRUE(queue.isFlushDue());
+
+
+  setUp();
+  LogQueue full(store, FakeClock::millis, MAX_PENDING, 3000);
+  full.load();
+  appendRecords(full, 1, LogQueue::BATCH_SIZE);
+  TEST_ASSERT_TRUE(full.isFlushDue());
+}
+
+void test_flushed_queue_clears_the_file(void)
+{
+  LogQueue queue(store, FakeClock::millis);
+  queue.load();
+  appendRecords(queue, 1, 10);
+
+  TEST_ASSERT_EQUAL(LogQueue::BATCH_SIZE, flush(queue));
+  TEST_ASSERT_EQUAL_UINT32(2, queue.getPending());
+  TEST_ASSERT_EQUAL_UINT32(LogQueue::BATCH_SIZE * R, store.head);
+  TEST_ASSERT_EQUAL(2, flush(queue));
+
+  TEST_ASSERT_EQUAL_UINT32(0, queue.getPending());
+  TEST_ASSERT_EQUAL_UINT32(0, store.size());
+  TEST_ASSERT_EQUAL_UINT32(10, queue.getStats().flushed);
+  TEST_ASSERT_EQUAL_UINT32(2, queue.getStats().batches);
+}
+
+void test_server_errors_back_off(void)
+{
+  LogQueue queue(store, FakeClock::millis, MAX_PENDING, 3000, 2000, 60000);
+  queue.load();
+  appendRecords(queue, 1, LogQueue::BATCH_SIZE);
+  firestore.status = 503;
+
+  flush(queue);
+  TEST_ASSERT_FALSE(queue.isFlushDue());
+  FakeClock::advanceMs(2000);
+  TEST_ASSERT_TRUE(queue.isFlushDue());
+
+  flush(queue);
+  FakeClock::advanceMs(2000);
+  TEST_ASSERT_FALSE(queue.isFlushDue());
+  FakeClock::advanceMs(2000);
+  TEST_ASSERT_TRUE(queue.isFlushDue());
+
+  TEST_ASSERT_EQUAL_UINT32(LogQueue::BATCH_SIZE, queue.getPending());
+  TEST_ASSERT_EQUAL_UINT32(2, queue.getStats().failures);
+}
+
+void test_rejected_record_is_discarded_without_blocking_the_rest(void)
+{
+  LogQueue queue(store, FakeClock::millis);
+  queue.load();
+  appendRecords(queue, 1, 10);
+  firestore.rejectedId = 3;
+
+  // The batch fails as a whole, then its records go one by one and only the bad one is dropped.
+  flush(queue);
+  TEST_ASSERT_EQUAL_UINT32(10, queue.getPending());
+  TEST_ASSERT_TRUE(queue.isFlushDue());
+  while (queue.getPending() > 0)
+  {
+    flush(queue);
+  }
+
+  LogSinkStats stats = queue.getStats();
+  TEST_ASSERT_EQUAL_UINT32(9, firestore.committed);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.rejected);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.failures);
+  // 1 failed batch, 8 one by one, then the last 2 batched again.
+  TEST_ASSERT_EQUAL_UINT32(10, firestore.requests);
+}
+
+void test_retryable_statuses(void)
+{
+  TEST_ASSERT_TRUE(LogQueue::isRetryable(-1));
+  TEST_ASSERT_TRUE(LogQueue::isRetryable(401));
+  TEST_ASSERT_TRUE(LogQueue::isRetryable(429));
+  TEST_ASSERT_TRUE(LogQueue::isRetryable(503));
+  TEST_ASSERT_FALSE(LogQueue::isRetryable(400));
+  TEST_ASSERT_FALSE(LogQueue::isRetryable(404));
+}
+
+void test_full_queue_keeps_the_file_bounded(void)
+{
+  LogQueue queue(store, FakeClock::millis, MAX_PENDING);
+  queue.load();
+
+  // Offline for a long time: every append past MAX_PENDING drops the oldest record.
+  const uint32_t appended = 20 * MAX_PENDING;
+  appendRecords(queue, 1, appended);
+
+  LogSinkStats stats = queue.getStats();
+  TEST_ASSERT_EQUAL_UINT32(MAX_PENDING, stats.pending);
+  TEST_ASSERT_EQUAL_UINT32(appended - MAX_PENDING, stats.dropped);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, stats.compactions);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32((MAX_PENDING + LogQueue::COMPACT_MIN_RECORDS) * R, store.size());
+
+  // The newest records are the ones kept.
+  flush(queue);
+  TEST_ASSERT_EQUAL_UINT32(appended - MAX_PENDING + 1, batch[0].id);
+}
+
+void test_batch_in_flight_survives_a_compaction(void)
+{
+  LogQueue queue(store, FakeClock::millis, MAX_PENDING);
+  queue.load();
+  appendRecords(queue, 1, MAX_PENDING);
+
+  uint32_t batchHead;
+  size_t count = queue.readBatch(batch, batchHead);
+  // Appends while the commit is in flight drop records and compact the file.
+  appendRecords(queue, 1000, LogQueue::COMPACT_MIN_RECORDS + 4);
+  TEST_ASSERT_EQUAL_UINT32(1, store.compactions);
+  queue.onCommitted(batchHead, count, 200, 0);
+
+  TEST_ASSERT_EQUAL_UINT32(MAX_PENDING, queue.getPending());
+  flush(queue);
+  TEST_ASSERT_EQUAL_UINT32(1000 + LogQueue::COMPACT_MIN_RECORDS + 4 - MAX_PENDING, batch[0].id);
+}
+
+void test_load_resumes_after_the_saved_head(void)
+{
+  {
+    LogQueue queue(store, FakeClock::millis);
+    queue.load();
+    appendRecords(queue, 1, 12);
+    flush(queue);
+  }
+  store.tornBytes = R / 2;
+
+  LogQueue queue(store, FakeClock::millis);
+  queue.load();
+
+  TEST_ASSERT_EQUAL_UINT32(4, queue.getPending());
+  TEST_ASSERT_EQUAL_UINT32(4 * R, store.size());
+  flush(queue);
+  TEST_ASSERT_EQUAL_UINT32(9, batch[0].id);
+}
+
+// Benchmark: the same logs committed one per request and in batches against the mock endpoint.
+void test_batching_throughput(void)
+{
+  const uint32_t logs = 200;
+  uint32_t elapsedMs[2];
+  for (int batched = 0; batched <= 1; batched++)
+  {
+    setUp();
+    LogQueue queue(store, FakeClock::millis, logs);
+    queue.load();
+    appendRecords(queue, 1, logs);
+
+    uint32_t start = FakeClock::millis();
+    while (queue.getPending() > 0)
+    {
+      uint32_t batchHead;
+      size_t count = queue.readBatch(batch, batchHead);
+      count = batched ? count : 1;
+      uint32_t commitStart = FakeClock::millis();
+      int status = firestore.commit(batch, count);
+      queue.onCommitted(batchHead, count, status, FakeClock::millis() - commitStart);
+    }
+    elapsedMs[batched] = FakeClock::millis() - start;
+    printf("%-9s %u logs in %u requests, %u ms, %.1f logs/s\n", batched ? "batched" : "unbatched",
+           (unsigned)logs, (unsigned)firestore.requests, (unsigned)elapsedMs[batched], queue.getStats().throughput());
+  }
+  TEST_ASSERT_LESS_THAN_UINT32(elapsedMs[0] / 4, elapsedMs[1]);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_batch_is_due_when_full_or_old);
+  RUN_TEST(test_flushed_queue_clears_the_file);
+  RUN_TEST(test_server_errors_back_off);
+  RUN_TEST(test_rejected_record_is_discarded_without_blocking_the_rest);
+  RUN_TEST(test_retryable_statuses);
+  RUN_TEST(test_full_queue_keeps_the_file_bounded);
+  RUN_TEST(test_batch_in_flight_survives_a_compaction);
+  RUN_TEST(test_load_resumes_after_the_saved_head);
+  RUN_TEST(test_batching_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,184 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <common/mqtt_data.h>
+
+static JsonDocument doc;
+
+template <typename T>
+static size_t encodeBinary(const T &data, uint8_t *out, size_t size)
+{
+  return encodeMessage(data, MQTT_FORMAT_BINARY, out, size);
+}
+
+void setUp(void)
+{
+  setTopicFormat(OledData::TOPIC, MQTT_FORMAT_BINARY);
+}
+
+void tearDown(void) {}
+
+void test_buzzer_round_trip(void)
+{
+  uint8_t payload[32];
+  size_t length = encodeBinary(BuzzerData(2500), payload, sizeof(payload));
+  TEST_ASSERT_EQUAL_UINT32(MQTT_BINARY_HEADER_SIZE + 4, length);
+  TEST_ASSERT_EQUAL_UINT8(MQTT_BINARY_MAGIC, payload[0]);
+  TEST_ASSERT_EQUAL_UINT8(MQTT_BINARY_VERSION, payload[1]);
+  TEST_ASSERT_EQUAL_UINT8(MQTT_BUZZER_MESSAGE, payload[2]);
+
+  BuzzerData decoded(0);
+  TEST_ASSERT_TRUE(decodeMessage(payload, length, doc, decoded));
+  TEST_ASSERT_EQUAL_UINT32(2500, decoded.duration);
+}
+
+void test_oled_round_trip(void)
+{
+  uint8_t payload[128];
+  size_t length = encodeBinary(OledData("Scan to register", true, "wrover-1", 3000), payload, sizeof(payload));
+
+  OledData decoded;
+  TEST_ASSERT_TRUE(decodeMessage(payload, length, doc, decoded));
+  TEST_ASSERT_EQUAL_STRING("Scan to register", decoded.message);
+  TEST_ASSERT_TRUE(decoded.isQrCode);
+  TEST_ASSERT_EQUAL_STRING("wrover-1", decoded.qrData);
+  TEST_ASSERT_EQUAL_UINT32(3000, decoded.duration);
+  // Strings are read in place, not copied.
+  TEST_ASSERT_TRUE((const uint8_t *)decoded.message > payload && (const uint8_t *)decoded.message < payload + length);
+}
+
+void test_ultrasonic_and_fingerprint_round_trip(void)
+{
+  uint8_t payload[64];
+  UltrasonicData ultrasonic;
+  size_t length = encodeBinary(UltrasonicData(true), payload, sizeof(payload));
+  TEST_ASSERT_TRUE(decodeMessage(payload, length, doc, ultrasonic));
+  TEST_ASSERT_TRUE(ultrasonic.isClose);
+
+  FingerprintData fingerprint;
+  length = encodeBinary(FingerprintData(FINGERPRINT_TOUCH, "alice", true, 0, 0, 70000), payload, sizeof(payload));
+  TEST_ASSERT_TRUE(decodeMessage(payload, length, doc, fingerprint));
+  TEST_ASSERT_EQUAL(FINGERPRINT_TOUCH, fingerprint.type);
+  TEST_ASSERT_EQUAL_STRING("alice", fingerprint.userId);
+  TEST_ASSERT_TRUE(fingerprint.isNew);
+  TEST_ASSERT_EQUAL_UINT32(70000, fingerprint.ageMs);
+
+  length = encodeBinary(FingerprintData(FINGERPRINT_SYNC, "", false, 0, 0, 0, 0xC0FFEE01u), payload, sizeof(payload));
+  TEST_ASSERT_TRUE(decodeMessage(payload, length, doc, fingerprint));
+  TEST_ASSERT_EQUAL(FINGERPRINT_SYNC, fingerprint.type);
+  TEST_ASSERT_EQUAL_UINT32(0xC0FFEE01u, fingerprint.tableHash);
+}
+
+void test_every_truncation_is_rejected(void)
+{
+  uint8_t payload[128];
+  size_t length = encodeBinary(OledData("Hello", true, "qr", 10), payload, sizeof(payload));
+
+  for (size_t cut = MQTT_BINARY_HEADER_SIZE; cut < length; cut++)
+  {
+    OledData decoded;
+    TEST_ASSERT_FALSE(decodeMessage(payload, cut, doc, decoded));
+  }
+}
+
+void test_wrong_header_is_rejected(void)
+{
+  uint8_t payload[32];
+  size_t length = encodeBinary(BuzzerData(100), payload, sizeof(payload));
+
+  UltrasonicData otherType;
+  TEST_ASSERT_FALSE(decodeMessage(payload, length, doc, otherType));
+
+  BuzzerData otherVersion;
+  payload[1] = MQTT_BINARY_VERSION + 1;
+  TEST_ASSERT_FALSE(decodeMessage(payload, length, doc, otherVersion));
+}
+
+void test_unterminated_string_is_rejected(void)
+{
+  uint8_t payload[64];
+  size_t length = encodeBinary(FingerprintData(FINGERPRINT_TOUCH, "bob"), payload, sizeof(payload));
+  // The string's NUL terminator, just before the stage and error bytes, the touch age and the table hash.
+  payload[length - 11] = 'x';
+
+  FingerprintData decoded;
+  TEST_ASSERT_FALSE(decodeMessage(payload, length, doc, decoded));
+}
+
+void test_message_that_does_not_fit(void)
+{
+  uint8_t payload[16];
+  TEST_ASSERT_EQUAL_UINT32(0, encodeBinary(OledData("A message longer than the buffer"), payload, sizeof(payload)));
+
+  char longString[300];
+  memset(longString, 'a', sizeof(longString) - 1);
+  longString[sizeof(longString) - 1] = '\0';
+  uint8_t large[512];
+  TEST_ASSERT_EQUAL_UINT32(0, encodeBinary(FingerprintData(FINGERPRINT_TOUCH, longString), large, sizeof(large)));
+}
+
+void test_binary_and_json_are_told_apart(void)
+{
+  uint8_t payload[32];
+  size_t length = encodeBinary(UltrasonicData(true), payload, sizeof(payload));
+  const char *json = "{\"isClose\":true}";
+
+  TEST_ASSERT_TRUE(isBinaryMessage(payload, length));
+  TEST_ASSERT_FALSE(isBinaryMessage((const uint8_t *)json, strlen(json)));
+  TEST_ASSERT_FALSE(isBinaryMessage(payload, MQTT_BINARY_HEADER_SIZE - 1));
+}
+
+void test_topic_formats(void)
+{
+  TEST_ASSERT_EQUAL(MQTT_FORMAT_BINARY, formatForTopic(FingerprintData::TOPIC));
+  TEST_ASSERT_EQUAL(MQTT_FORMAT_JSON, formatForTopic(ENROLLMENT_PROGRESS_TOPIC));
+  TEST_ASSERT_EQUAL(MQTT_FORMAT_JSON, formatForTopic("unknown"));
+
+  TEST_ASSERT_TRUE(setTopicFormat(OledData::TOPIC, MQTT_FORMAT_JSON));
+  TEST_ASSERT_EQUAL(MQTT_FORMAT_JSON, formatForTopic(OledData::TOPIC));
+  TEST_ASSERT_FALSE(setTopicFormat("unknown", MQTT_FORMAT_BINARY));
+}
+
+// Benchmark: the OLED prompt the WROVER sends most, encoded and decoded in both formats.
+void test_encode_decode_benchmark(void)
+{
+  static const uint32_t ROUNDS = 100000;
+  const OledData prompt("Please register via app", true, "6f1c2a9e-3b4d-4e5f-8a7b-9c0d1e2f3a4b", 0);
+  const MqttFormat formats[] = {MQTT_FORMAT_BINARY, MQTT_FORMAT_JSON};
+
+  for (MqttFormat format : formats)
+  {
+    uint8_t payload[200];
+    size_t length = 0;
+    uint32_t decoded = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ROUNDS; i++)
+    {
+      length = encodeMessage(prompt, format, payload, sizeof(payload));
+      OledData out;
+      decoded += decodeMessage(payload, length, doc, out) ? 1 : 0;
+    }
+    double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%-6s %3u bytes, %.0f ns per encode and decode\n", format == MQTT_FORMAT_BINARY ? "binary" : "json",
+           (unsigned)length, ns / ROUNDS);
+    TEST_ASSERT_EQUAL_UINT32(ROUNDS, decoded);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_buzzer_round_trip);
+  RUN_TEST(test_oled_round_trip);
+  RUN_TEST(test_ultrasonic_and_fingerprint_round_trip);
+  RUN_TEST(test_every_truncation_is_rejected);
+  RUN_TEST(test_wrong_header_is_rejected);
+  RUN_TEST(test_unterminated_string_is_rejected);
+  RUN_TEST(test_message_that_does_not_fit);
+  RUN_TEST(test_binary_and_json_are_told_apart);
+  RUN_TEST(test_topic_formats);
+  RUN_TEST(test_encode_decode_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,231 @@
+#include <unity.h>
+#include <string.h>
+#include <fake_clock.h>
+#include <fake_broker.h>
+#include <common/mqtt_session.h>
+
+static const uint32_t BASE_MS = 1000;
+static const uint32_t MAX_MS = 60000;
+
+static FakeBroker broker;
+static uint32_t randomValue = 0;
+static uint32_t connectCallbacks = 0;
+
+static uint32_t fixedRandom()
+{
+  return randomValue;
+}
+
+static const uint8_t PAYLOAD[] = {1, 2, 3};
+
+// Calls loop() every 10 ms until the session connects or timeoutMs passes.
+static bool loopUntilConnected(MqttSession &session, uint32_t timeoutMs)
+{
+  for (uint32_t waited = 0; waited <= timeoutMs; waited += 10)
+  {
+    session.loop();
+    if (session.getState() == MQTT_STATE_CONNECTED)
+      return true;
+    FakeClock::advanceMs(10);
+  }
+  return false;
+}
+
+void setUp(void)
+{
+  FakeClock::reset();
+  broker = FakeBroker();
+  randomValue = 0;
+  connectCallbacks = 0;
+}
+
+void tearDown(void) {}
+
+void test_connects_and_subscribes(void)
+{
+  MqttSession session(broker, FakeClock::millis, fixedRandom, BASE_MS, MAX_MS);
+  session.setSubscription("wrover-1/#");
+  session.setConnectCallback([]()
+                             { connectCallbacks++; });
+
+  session.loop();
+
+  TEST_ASSERT_EQUAL(MQTT_STATE_CONNECTED, session.getState());
+  TEST_ASSERT_EQUAL_STRING("wrover-1/#", broker.lastSubscription);
+  TEST_ASSERT_EQUAL_UINT32(1, connectCallbacks);
+  TEST_ASSERT_EQUAL_UINT32(1, session.getStats().connects);
+}
+
+void test_backoff_doubles_up_to_the_maximum(void)
+{
+  MqttSession session(broker, FakeClock::millis, fixedRandom, BASE_MS, MAX_MS);
+  broker.reachable = false;
+  // No jitter: half the ceiling.
+  randomValue = 0;
+
+  uint32_t expected[] = {1000, 2000, 4000, 8000, 16000, 32000, 60000, 60000};
+  for (uint32_t ceiling : expected)
+  {
+    uint32_t calls = broker.connectCalls;
+    session.loop();
+    TEST_ASSERT_EQUAL_UINT32(calls + 1, broker.connectCalls);
+    TEST_ASSERT_EQUAL(MQTT_STATE_BACKOFF, session.getState());
+    uint32_t backoff = session.getStats().lastBackoffMs;
+    TEST_ASSERT_EQUAL_UINT32(ceiling / 2, backoff);
+
+    // Nothing until the backoff is over.
+    FakeClock::advanceMs(backoff - 1);
+    session.loop();
+    TEST_ASSERT_EQUAL_UINT32(calls + 1, broker.connectCalls);
+    FakeClock::advanceMs(1);
+  }
+  TEST_ASSERT_EQUAL_UINT32(8, session.getStats().connectFailures);
+}
+
+void test_jitter_stays_in_the_upper_half(void)
+{
+  broker.reachable = false;
+  for (randomValue = 0; randomValue < 5000; randomValue += 37)
+  {
+    MqttSession session(broker, FakeClock::millis, fixedRandom, BASE_MS, MAX_MS);
+    session.loop();
+    FakeClock::advanceMs(session.getStats().lastBackoffMs);
+    session.loop();
+
+    // Second failure: the ceiling doubled to 2 s.
+    uint32_t backoff = session.getStats().lastBackoffMs;
+    TEST_ASSERT_TRUE(backoff >= 1000 && backoff <= 2000);
+  }
+}
+
+void test_qos0_is_dropped_while_disconnected(void)
+{
+  MqttSession session(broker, FakeClock::millis, fixedRandom, BASE_MS, MAX_MS);
+
+  TEST_ASSERT_FALSE(session.publish("a", PAYLOAD, sizeof(PAYLOAD), 0));
+  session.loop();
+
+  TEST_ASSERT_EQUAL_UINT32(0, broker.publishCalls);
+  TEST_ASSERT_EQUAL_UINT32(1, session.getStats().dropped);
+}
+
+void test_qos1_is_replayed_in_order(void)
+{
+  MqttSession session(broker, FakeClock::millis, fixedRandom, BASE_MS, MAX_MS);
+  broker.reachable = false;
+  session.loop();
+
+  TEST_ASSERT_TRUE(session.publish("a", PAYLOAD, sizeof(PAYLOAD), 1));
+  TEST_ASSERT_TRUE(session.publish("b", PAYLOAD, sizeof(PAYLOAD), 1, true));
+  TEST_ASSERT_TRUE(session.publish("c", PAYLOAD, sizeof(PAYLOAD), 1));
+  TEST_ASSERT_EQUAL_UINT32(3, session.getPendingCount());
+
+  broker.reachable = true;
+  TEST_ASSERT_TRUE(loopUntilConnected(session, MAX_MS));
+
+  TEST_ASSERT_EQUAL_UINT32(3, broker.publishCalls);
+  TEST_ASSERT_EQUAL_STRING("a", broker.topics[0]);
+  TEST_ASSERT_EQUAL_STRING("b", broker.topics[1]);
+  TEST_ASSERT_EQUAL_STRING("c", broker.topics[2]);
+  TEST_ASSERT_EQUAL_UINT32(3, session.getStats().replayed);
+  TEST_ASSERT_EQUAL_UINT32(0, session.getPendingCount());
+}
+
+void test_retained_flag_survives_the_queue(void)
+{
+  MqttSession session(broker, FakeClock::millis, fixedRandom, BASE_MS, MAX_MS);
+  broker.reachable = false;
+  session.loop();
+  session.publish("owner", PAYLOAD, sizeof(PAYLOAD), 1, true);
+
+  broker.reachable = true;
+  loopUntilConnected(session, MAX_MS);
+
+  TEST_ASSERT_TRUE(broker.lastRetained);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(PAYLOAD, broker.lastPayload, sizeof(PAYLOAD));
+}
+
+void test_full_queue_drops_the_newest(void)
+{
+  MqttSession session(broker, FakeClock::millis, fixedRandom, BASE_MS, MAX_MS);
+  broker.reachable = false;
+  session.loop();
+
+  for (size_t i = 0; i < MqttSession::QUEUE_DEPTH; i++)
+  {
+    TEST_ASSERT_TRUE(session.publish("q", PAYLOAD, sizeof(PAYLOAD), 1));
+  }
+  TEST_ASSERT_FALSE(session.publish("q", PAYLOAD, sizeof(PAYLOAD), 1));
+
+  uint8_t large[MqttSession::PAYLOAD_SIZE + 1] = {};
+  MqttSession other(broker, FakeClock::millis, fixedRandom, BASE_MS, MAX_MS);
+  TEST_ASSERT_FALSE(other.publish("q", large, sizeof(large), 1));
+
+  TEST_ASSERT_EQUAL_UINT32(1, session.getStats().dropped);
+  TEST_ASSERT_EQUAL_UINT32(MqttSession::QUEUE_DEPTH, session.getPendingCount());
+}
+
+void test_qos1_waits_behind_the_queue(void)
+{
+  MqttSession session(broker, FakeClock::millis, fixedRandom, BASE_MS, MAX_MS);
+  session.loop();
+  broker.reachable = false;
+  session.loop();
+  session.publish("first", PAYLOAD, sizeof(PAYLOAD), 1);
+
+  broker.reachable = true;
+  TEST_ASSERT_TRUE(loopUntilConnected(session, MAX_MS));
+  TEST_ASSERT_TRUE(session.publish("second", PAYLOAD, sizeof(PAYLOAD), 1));
+
+  TEST_ASSERT_EQUAL_STRING("first", broker.topics[0]);
+  TEST_ASSERT_EQUAL_STRING("second", broker.topics[1]);
+}
+
+void test_disconnect_restarts_the_backoff(void)
+{
+  MqttSession session(broker, FakeClock::millis, fixedRandom, BASE_MS, MAX_MS);
+  broker.reachable = false;
+  for (int i = 0; i < 4; i++)
+  {
+    session.loop();
+    FakeClock::advanceMs(session.getStats().lastBackoffMs);
+  }
+  broker.reachable = true;
+  TEST_ASSERT_TRUE(loopUntilConnected(session, MAX_MS));
+
+  broker.reachable = false;
+  session.loop();
+
+  TEST_ASSERT_EQUAL_UINT32(1, session.getStats().disconnects);
+  TEST_ASSERT_EQUAL(MQTT_STATE_BACKOFF, session.getState());
+  TEST_ASSERT_EQUAL_UINT32(BASE_MS / 2, session.getStats().lastBackoffMs);
+}
+
+void test_connected_loop_services_the_client(void)
+{
+  MqttSession session(broker, FakeClock::millis, fixedRandom, BASE_MS, MAX_MS);
+  session.loop();
+  session.loop();
+  session.loop();
+
+  TEST_ASSERT_EQUAL_UINT32(2, broker.loopCalls);
+  TEST_ASSERT_EQUAL_UINT32(1, broker.connectCalls);
+  TEST_ASSERT_TRUE(session.publish("now", PAYLOAD, sizeof(PAYLOAD)));
+  TEST_ASSERT_EQUAL_UINT32(1, session.getStats().published);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_connects_and_subscribes);
+  RUN_TEST(test_backoff_doubles_up_to_the_maximum);
+  RUN_TEST(test_jitter_stays_in_the_upper_half);
+  RUN_TEST(test_qos0_is_dropped_while_disconnected);
+  RUN_TEST(test_qos1_is_replayed_in_order);
+  RUN_TEST(test_retained_flag_survives_the_queue);
+  RUN_TEST(test_full_queue_drops_the_newest);
+  RUN_TEST(test_qos1_waits_behind_the_queue);
+  RUN_TEST(test_disconnect_restarts_the_backoff);
+  RUN_TEST(test_connected_loop_services_the_client);
+  return UNITY_END();
+}
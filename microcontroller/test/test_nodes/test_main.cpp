@@ -0,0 +1,356 @@
+#include <unity.h>
+#include <string.h>
+#include <fake_clock.h>
+#include <fake_hal.h>
+#include <fake_transport.h>
+#include <wroom/handlers.h>
+#include <wrover/handlers.h>
+
+// Both nodes' handlers wired to each other in-process, with the hardware and cloud services faked.
+
+class FakeEventLog : public EventLog
+{
+public:
+  uint32_t photos = 0;
+  uint32_t logs = 0;
+  LogType lastPhotoType = LogType::USER_REQUEST;
+  LogType lastLogType = LogType::USER_REQUEST;
+  char lastUser[FINGERPRINT_USER_ID_SIZE] = "";
+
+  bool requestPhoto(LogType type, const char *userId) override
+  {
+    photos++;
+    lastPhotoType = type;
+    strncpy(lastUser, userId, sizeof(lastUser) - 1);
+    return true;
+  }
+
+  void log(const char *nodeId, const LogData &logData) override
+  {
+    logs++;
+    lastLogType = logData.type;
+    strncpy(lastUser, logData.userId, sizeof(lastUser) - 1);
+  }
+};
+
+static FakeDisplay display;
+static FakeFingerprintDirectory directory;
+static FakeBuzzer buzzer;
+static FakeDatabase database;
+static FakeEventLog events;
+static OwnerDiscovery ownerDiscovery(10000, 60000, 300000);
+static uint32_t enrollmentRequests = 0;
+
+static void deliverToWrover(const char *topic, const uint8_t *payload, size_t length);
+static void deliverToWroom(const char *topic, const uint8_t *payload, size_t length);
+
+static LoopbackTransport toWrover(deliverToWrover);
+static LoopbackTransport toWroom(deliverToWroom);
+static FakeTransport toApp;
+
+static Hal wroomHal()
+{
+  Hal hal;
+  hal.display = &display;
+  hal.fingerprintUsers = &directory;
+  return hal;
+}
+
+static Hal wroverHal()
+{
+  Hal hal;
+  hal.buzzer = &buzzer;
+  hal.database = &database;
+  return hal;
+}
+
+static WroomHandlers wroom(wroomHal(), toWrover, []()
+                           { enrollmentRequests++; });
+static WroverHandlers wrover("wrover-1", wroverHal(), toWroom, toApp, events, ownerDiscovery);
+
+static void deliverToWrover(const char *topic, const uint8_t *payload, size_t length)
+{
+  wrover.onMessage(topic, payload, length);
+}
+
+static void deliverToWroom(const char *topic, const uint8_t *payload, size_t length)
+{
+  wroom.onMessage(topic, payload, length);
+}
+
+// A message from the app (or the broker) as it reaches the WROVER.
+template <typename T>
+static void sendToWrover(const T &data)
+{
+  uint8_t payload[200];
+  size_t length = encodeMessage(data, MQTT_FORMAT_BINARY, payload, sizeof(payload));
+  TEST_ASSERT_GREATER_THAN(0, length);
+  wrover.onMessage(T::TOPIC, payload, length);
+}
+
+void setUp(void)
+{
+  FakeClock::reset();
+  display = FakeDisplay();
+  directory = FakeFingerprintDirectory();
+  buzzer = FakeBuzzer();
+  database = FakeDatabase();
+  events = FakeEventLog();
+  enrollmentRequests = 0;
+  toApp.clear();
+}
+
+void tearDown(void) {}
+
+void test_known_finger_rings_the_doorbell(void)
+{
+  directory.setUser(3, "alice");
+
+  wroom.onFingerprintScanned(3);
+
+  TEST_ASSERT_EQUAL_UINT32(1, buzzer.beeps);
+  TEST_ASSERT_EQUAL_UINT32(2000, buzzer.lastDurationMs);
+  TEST_ASSERT_EQUAL_UINT32(1, events.photos);
+  TEST_ASSERT_EQUAL(LogType::RING_DOORBELL, events.lastPhotoType);
+  TEST_ASSERT_EQUAL_STRING("alice", events.lastUser);
+  // The WROVER's prompt arrives first, then the greeting replaces it.
+  TEST_ASSERT_EQUAL_UINT32(2, display.shown);
+  TEST_ASSERT_EQUAL_STRING("Hello, alice!", display.lastText);
+}
+
+void test_doorbell_latency_counts_from_the_touch(void)
+{
+  const ScenarioRecorder &doorbell = wrover.getDoorbellScenario();
+  uint32_t completed = doorbell.getCompleted();
+
+  wroom.onFingerprintScanned(3, 250);
+
+  TEST_ASSERT_EQUAL_UINT32(completed + 1, doorbell.getCompleted());
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(250, doorbell.getLatency().getMax());
+  TEST_ASSERT_LESS_THAN_UINT32(250 + 50, doorbell.getLatency().getMax());
+}
+
+void test_unknown_finger_rings_anonymously(void)
+{
+  wroom.onFingerprintScanned(0);
+
+  TEST_ASSERT_EQUAL_UINT32(1, events.photos);
+  TEST_ASSERT_EQUAL_STRING("", events.lastUser);
+  TEST_ASSERT_EQUAL_STRING("Hello!", display.lastText);
+}
+
+void test_proximity_requests_a_photo(void)
+{
+  wroom.onProximity();
+
+  TEST_ASSERT_EQUAL_UINT32(1, events.photos);
+  TEST_ASSERT_EQUAL(LogType::PROXIMITY, events.lastPhotoType);
+  TEST_ASSERT_EQUAL_UINT32(0, buzzer.beeps);
+}
+
+void test_registration_is_forwarded_to_the_wroom(void)
+{
+  sendToWrover(FingerprintData(FINGERPRINT_REGISTRATION, "bob"));
+
+  TEST_ASSERT_EQUAL_UINT32(1, enrollmentRequests);
+  TEST_ASSERT_EQUAL_STRING("bob", wroom.getEnrollmentUser());
+  TEST_ASSERT_EQUAL_STRING("Place your preferred \nfinger on the sensor\n to register", display.lastText);
+}
+
+void test_registration_is_ignored_while_enrolling(void)
+{
+  directory.enrolling = true;
+
+  sendToWrover(FingerprintData(FINGERPRINT_REGISTRATION, "carol"));
+
+  TEST_ASSERT_EQUAL_UINT32(0, enrollmentRequests);
+}
+
+void test_enrollment_updates_firestore_once_per_user(void)
+{
+  sendToWrover(FingerprintData(FINGERPRINT_REGISTRATION, "dave"));
+  wroom.onEnrollmentSucceeded(7);
+
+  TEST_ASSERT_EQUAL_STRING("dave", directory.getUser(7));
+  TEST_ASSERT_EQUAL_UINT32(1, database.usersAdded);
+  TEST_ASSERT_EQUAL_STRING("dave", database.lastUser);
+  TEST_ASSERT_EQUAL_UINT32(1, events.logs);
+  TEST_ASSERT_EQUAL(LogType::NEW_FINGERPRINT, events.lastLogType);
+
+  // A second finger of the same user is not a new user.
+  sendToWrover(FingerprintData(FINGERPRINT_REGISTRATION, "dave"));
+  wroom.onEnrollmentSucceeded(8);
+
+  TEST_ASSERT_EQUAL_UINT32(1, database.usersAdded);
+  TEST_ASSERT_EQUAL_UINT32(1, events.logs);
+}
+
+void test_cancel_is_forwarded_to_the_wroom(void)
+{
+  sendToWrover(FingerprintData(FINGERPRINT_CANCEL));
+
+  TEST_ASSERT_EQUAL_UINT32(1, directory.cancels);
+  TEST_ASSERT_EQUAL_STRING("Place your finger on\nthe sensor", display.lastText);
+}
+
+void test_sync_adds_every_user_once(void)
+{
+  directory.setUser(1, "erin");
+  directory.setUser(4, "frank");
+
+  TEST_ASSERT_TRUE(wroom.syncUsers());
+  TEST_ASSERT_EQUAL_UINT32(2, database.usersAdded);
+  TEST_ASSERT_EQUAL_STRING("frank", database.lastUser);
+  TEST_ASSERT_EQUAL_UINT32(0, events.logs);
+  TEST_ASSERT_EQUAL_UINT32(hashUserId(hashUserId(USER_TABLE_HASH_OFFSET, "erin"), "frank"), directory.syncedHash);
+
+  // Next boot: the WROVER acknowledged this table, so Firestore is not touched.
+  TEST_ASSERT_FALSE(wroom.syncUsers());
+  TEST_ASSERT_EQUAL_UINT32(2, database.usersAdded);
+}
+
+void test_sync_again_after_the_table_changed(void)
+{
+  directory.setUser(1, "erin");
+  wroom.syncUsers();
+  directory.setUser(2, "gina");
+
+  TEST_ASSERT_TRUE(wroom.syncUsers());
+  TEST_ASSERT_EQUAL_UINT32(3, database.usersAdded);
+  TEST_ASSERT_FALSE(wroom.syncUsers());
+}
+
+void test_failed_sync_is_retried(void)
+{
+  directory.setUser(1, "erin");
+  database.addUserResult = false;
+
+  wroom.syncUsers();
+  TEST_ASSERT_EQUAL_UINT32(0, directory.syncedHash);
+
+  database.addUserResult = true;
+  TEST_ASSERT_TRUE(wroom.syncUsers());
+  TEST_ASSERT_NOT_EQUAL(0, directory.syncedHash);
+}
+
+void test_sync_missing_a_user_is_not_acknowledged(void)
+{
+  uint32_t tableHash = hashUserId(hashUserId(USER_TABLE_HASH_OFFSET, "erin"), "frank");
+
+  // The message for frank was lost on the way.
+  sendToWrover(FingerprintData(FINGERPRINT_SYNC, "erin", false, 0, 0, 0, tableHash));
+  sendToWrover(FingerprintData(FINGERPRINT_SYNC, "", false, 0, 0, 0, tableHash));
+
+  TEST_ASSERT_EQUAL_UINT32(1, database.usersAdded);
+  TEST_ASSERT_EQUAL_UINT32(0, directory.syncedHash);
+}
+
+void test_app_messages(void)
+{
+  sendToWrover(BuzzerData(500));
+  TEST_ASSERT_EQUAL_UINT32(500, buzzer.lastDurationMs);
+
+  wrover.onMessage(TAKE_PHOTO_TOPIC, (const uint8_t *)"{}", 2);
+  TEST_ASSERT_EQUAL(LogType::USER_REQUEST, events.lastPhotoType);
+
+  ownerDiscovery.start(0);
+  wrover.onMessage(OWNER_TOPIC, (const uint8_t *)"{}", 2);
+  TEST_ASSERT_EQUAL_UINT32(1, ownerDiscovery.getStats().pushes);
+  TEST_ASSERT_TRUE(ownerDiscovery.isCheckDue(1));
+}
+
+void test_oled_messages_reach_the_screen(void)
+{
+  sendToWrover(OledData("Hi", true, "qr-data", 1000));
+
+  TEST_ASSERT_TRUE(wroom.hasReceivedOled());
+  TEST_ASSERT_EQUAL_STRING("Hi", display.lastText);
+  TEST_ASSERT_EQUAL_STRING("qr-data", display.lastQrData);
+  TEST_ASSERT_EQUAL(1000, display.lastDuration);
+
+  wrover.showRegistrationPrompt();
+  TEST_ASSERT_EQUAL_STRING("wrover-1", display.lastQrData);
+}
+
+void test_enrollment_progress_on_screen(void)
+{
+  FakeFingerprintSensor sensor;
+  FingerprintEnrollment enrollment(sensor, FakeClock::millis, [](FingerprintStage stage, FingerprintError error)
+                                   { wroom.onEnrollmentProgress(stage, error); });
+
+  TEST_ASSERT_TRUE(enrollment.start(4));
+  sensor.fingerPresent = true;
+  enrollment.step();
+  TEST_ASSERT_EQUAL_STRING("Remove your finger...", display.lastText);
+
+  sensor.fingerPresent = false;
+  FakeClock::advanceMs(FingerprintEnrollment::POLL_INTERVAL_MS);
+  enrollment.step();
+  TEST_ASSERT_EQUAL_STRING("Place the same finger again...", display.lastText);
+
+  FakeClock::advanceMs(FingerprintEnrollment::FINGER_TIMEOUT_MS + 1);
+  TEST_ASSERT_EQUAL(ENROLLMENT_FAILED, enrollment.step());
+  TEST_ASSERT_EQUAL_STRING("Registration timed out", display.lastText);
+}
+
+void test_enrollment_progress_reaches_the_app(void)
+{
+  FakeFingerprintSensor sensor;
+  FingerprintEnrollment enrollment(sensor, FakeClock::millis, [](FingerprintStage stage, FingerprintError error)
+                                   { wroom.onEnrollmentProgress(stage, error); });
+  sendToWrover(FingerprintData(FINGERPRINT_REGISTRATION, "carol"));
+
+  TEST_ASSERT_TRUE(enrollment.start(5));
+  TEST_ASSERT_EQUAL_UINT32(1, toApp.getCount());
+  FakeClock::advanceMs(FingerprintEnrollment::FINGER_TIMEOUT_MS + 1);
+  TEST_ASSERT_EQUAL(ENROLLMENT_FAILED, enrollment.step());
+
+  // The start and the timeout, both published under the WROVER's topics.
+  TEST_ASSERT_EQUAL_UINT32(2, toApp.getCount());
+  TEST_ASSERT_EQUAL_STRING(ENROLLMENT_PROGRESS_TOPIC, toApp.last().topic);
+}
+
+void test_progress_carries_stage_and_error(void)
+{
+  uint8_t payload[64];
+  size_t length = encodeMessage(FingerprintData(FINGERPRINT_PROGRESS, "carol", false, FINGERPRINT_ERROR, FINGERPRINT_TIMEOUT_ERROR),
+                                MQTT_FORMAT_BINARY, payload, sizeof(payload));
+  JsonDocument doc;
+  FingerprintData decoded;
+
+  TEST_ASSERT_TRUE(decodeMessage(payload, length, doc, decoded));
+  TEST_ASSERT_EQUAL(FINGERPRINT_PROGRESS, decoded.type);
+  TEST_ASSERT_EQUAL_STRING("carol", decoded.userId);
+  TEST_ASSERT_EQUAL_UINT8(FINGERPRINT_ERROR, decoded.stage);
+  TEST_ASSERT_EQUAL_UINT8(FINGERPRINT_TIMEOUT_ERROR, decoded.error);
+}
+
+void test_links_lose_nothing(void)
+{
+  TEST_ASSERT_EQUAL_UINT32(toWrover.getStats().sent, toWrover.getStats().delivered);
+  TEST_ASSERT_EQUAL_UINT32(toWroom.getStats().sent, toWroom.getStats().delivered);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_known_finger_rings_the_doorbell);
+  RUN_TEST(test_doorbell_latency_counts_from_the_touch);
+  RUN_TEST(test_unknown_finger_rings_anonymously);
+  RUN_TEST(test_proximity_requests_a_photo);
+  RUN_TEST(test_registration_is_forwarded_to_the_wroom);
+  RUN_TEST(test_registration_is_ignored_while_enrolling);
+  RUN_TEST(test_enrollment_updates_firestore_once_per_user);
+  RUN_TEST(test_cancel_is_forwarded_to_the_wroom);
+  RUN_TEST(test_sync_adds_every_user_once);
+  RUN_TEST(test_sync_again_after_the_table_changed);
+  RUN_TEST(test_failed_sync_is_retried);
+  RUN_TEST(test_sync_missing_a_user_is_not_acknowledged);
+  RUN_TEST(test_app_messages);
+  RUN_TEST(test_oled_messages_reach_the_screen);
+  RUN_TEST(test_enrollment_progress_on_screen);
+  RUN_TEST(test_enrollment_progress_reaches_the_app);
+  RUN_TEST(test_progress_carries_stage_and_error);
+  RUN_TEST(test_links_lose_nothing);
+  return UNITY_END();
+}
@@ -0,0 +1,121 @@
+#include <unity.h>
+#include <stdio.h>
+#include <wrover/actions/owner_discovery.h>
+
+// Onboardings played against waitForOwner()'s loop: the user claims the device at some point, the
+// app's owner message may or may not reach the device, and each due check is one Firestore request.
+
+static const uint32_t FIRST_CHECK_MS = 30000;
+static const uint32_t MAX_CHECK_MS = 120000;
+static const uint32_t TIMEOUT_MS = 300000;
+static const uint32_t LOOP_MS = 50;
+static const uint32_t NEVER = UINT32_MAX;
+
+struct Onboarding
+{
+  uint32_t checks;
+  uint32_t foundAfterClaimMs; // NEVER when the wait timed out.
+};
+
+static Onboarding onboard(uint32_t claimMs, uint32_t pushMs)
+{
+  OwnerDiscovery discovery(FIRST_CHECK_MS, MAX_CHECK_MS, TIMEOUT_MS);
+  discovery.start(0);
+  Onboarding result = {0, NEVER};
+
+  for (uint32_t nowMs = 0; !discovery.isTimedOut(nowMs); nowMs += LOOP_MS)
+  {
+    if (nowMs == pushMs)
+    {
+      discovery.onPush();
+    }
+    if (discovery.isCheckDue(nowMs))
+    {
+      bool hasOwner = nowMs >= claimMs;
+      discovery.onChecked(nowMs);
+      if (hasOwner)
+      {
+        result.foundAfterClaimMs = nowMs - claimMs;
+        break;
+      }
+    }
+  }
+  result.checks = discovery.getStats().checks;
+  printf("claim at %ds, push %s: %u requests, found after %dms\n", claimMs == NEVER ? -1 : (int)(claimMs / 1000),
+         pushMs == NEVER ? "missed" : "received", result.checks, result.foundAfterClaimMs == NEVER ? -1 : (int)result.foundAfterClaimMs);
+  return result;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_push_finds_the_owner_with_one_read(void)
+{
+  // A user finishing the claim right after scanning the QR code, before any fallback check.
+  Onboarding result = onboard(20000, 20000 + 200);
+
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(200 + LOOP_MS, result.foundAfterClaimMs);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(1, result.checks);
+}
+
+void test_late_push_adds_one_read_to_the_fallback(void)
+{
+  // Fallback checks at 30 s and 90 s found nothing, then the push confirms the claim.
+  Onboarding result = onboard(95000, 95000 + 200);
+
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(200 + LOOP_MS, result.foundAfterClaimMs);
+  TEST_ASSERT_EQUAL_UINT32(2 + 1, result.checks);
+}
+
+void test_missed_push_is_found_by_the_fallback(void)
+{
+  Onboarding result = onboard(30000 + 1, NEVER);
+
+  // Found by the check at 90 s.
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(2 * FIRST_CHECK_MS, result.foundAfterClaimMs);
+  TEST_ASSERT_EQUAL_UINT32(2, result.checks);
+}
+
+void test_unclaimed_device_stops_at_the_timeout(void)
+{
+  Onboarding result = onboard(NEVER, NEVER);
+
+  TEST_ASSERT_EQUAL_UINT32(NEVER, result.foundAfterClaimMs);
+  // At 30, 90 and 210 s; the next one would be after the timeout.
+  TEST_ASSERT_EQUAL_UINT32(3, result.checks);
+}
+
+void test_push_makes_a_check_due_at_once(void)
+{
+  OwnerDiscovery discovery(FIRST_CHECK_MS, MAX_CHECK_MS, TIMEOUT_MS);
+  discovery.start(0);
+  TEST_ASSERT_FALSE(discovery.isCheckDue(1));
+
+  discovery.onPush();
+
+  TEST_ASSERT_TRUE(discovery.isCheckDue(1));
+  TEST_ASSERT_EQUAL_UINT32(1, discovery.getStats().pushes);
+}
+
+void test_stale_push_resumes_the_fallback(void)
+{
+  OwnerDiscovery discovery(FIRST_CHECK_MS, MAX_CHECK_MS, TIMEOUT_MS);
+  discovery.start(0);
+  discovery.onPush();
+  discovery.onChecked(1000);
+
+  TEST_ASSERT_FALSE(discovery.isCheckDue(1000 + FIRST_CHECK_MS - 1));
+  TEST_ASSERT_TRUE(discovery.isCheckDue(1000 + FIRST_CHECK_MS));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_push_finds_the_owner_with_one_read);
+  RUN_TEST(test_late_push_adds_one_read_to_the_fallback);
+  RUN_TEST(test_missed_push_is_found_by_the_fallback);
+  RUN_TEST(test_unclaimed_device_stops_at_the_timeout);
+  RUN_TEST(test_push_makes_a_check_due_at_once);
+  RUN_TEST(test_stale_push_resumes_the_fallback);
+  return UNITY_END();
+}
@@ -0,0 +1,180 @@
+#include <unity.h>
+#include <stdio.h>
+#include <fake_clock.h>
+#include <fake_hal.h>
+#include <wrover/actions/pipeline.h>
+
+static FakeCamera camera;
+static FakeObjectStore store;
+static uint32_t logged = 0;
+static char lastLoggedURL[PHOTO_JOB_URL_SIZE];
+
+static bool captureFrame(PhotoJob &job)
+{
+  CameraFrame frame;
+  if (!camera.capture(job.eventMs, frame))
+  {
+    return false;
+  }
+  job.image = (uint8_t *)frame.data;
+  job.imageLen = frame.length;
+  job.frame = frame.handle;
+  job.timestamp = FakeClock::millis() / 1000;
+  return true;
+}
+
+static bool uploadFrame(PhotoJob &job)
+{
+  char path[64];
+  snprintf(path, sizeof(path), "node/%ld.jpg", (long)job.timestamp);
+  int status = store.upload("bucket", path, "image/jpeg", job.image, job.imageLen);
+  if (status < 200 || status >= 300)
+  {
+    job.photoURL[0] = '\0';
+    return false;
+  }
+  snprintf(job.photoURL, sizeof(job.photoURL), "https://storage/%s", path);
+  return true;
+}
+
+static void logFrame(const PhotoJob &job)
+{
+  logged++;
+  strlcpy(lastLoggedURL, job.photoURL, sizeof(lastLoggedURL));
+}
+
+static void releaseFrame(PhotoJob &job)
+{
+  CameraFrame frame;
+  frame.handle = job.frame;
+  camera.release(frame);
+  job.frame = nullptr;
+  job.image = nullptr;
+  job.imageLen = 0;
+}
+
+static const PhotoPipelineBackend backend = {captureFrame, uploadFrame, logFrame, releaseFrame, FakeClock::micros};
+
+// Runs a job through every stage, as the stage tasks do.
+static void runJob(PhotoStages &stages, uint8_t logType, const char *userId)
+{
+  PhotoJob job = PhotoStages::makeJob(logType, userId, FakeClock::millis());
+  if (stages.runCapture(job))
+  {
+    stages.runUpload(job);
+    stages.runLog(job);
+  }
+}
+
+void setUp(void)
+{
+  FakeClock::reset(1000000);
+  camera = FakeCamera();
+  store = FakeObjectStore();
+  logged = 0;
+  lastLoggedURL[0] = '\0';
+}
+
+void tearDown(void) {}
+
+void test_job_goes_through_every_stage(void)
+{
+  PhotoStages stages(backend);
+  store.latencyMs = 250;
+
+  runJob(stages, 0, "alice");
+
+  TEST_ASSERT_EQUAL_UINT32(1, store.uploads);
+  TEST_ASSERT_EQUAL_UINT32(FakeCamera::FRAME_SIZE, store.totalBytes);
+  TEST_ASSERT_EQUAL_UINT32(1, logged);
+  TEST_ASSERT_EQUAL_STRING("https://storage/node/1000.jpg", lastLoggedURL);
+  TEST_ASSERT_EQUAL_UINT32(0, camera.getOutstanding());
+
+  PhotoPipelineStats stats = stages.getStats();
+  TEST_ASSERT_EQUAL_UINT32(1, stats.capture.processed);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.upload.processed);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.upload.failed);
+  TEST_ASSERT_EQUAL_UINT32(250000, stats.upload.lastUs);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.log.processed);
+}
+
+void test_failed_upload_is_still_logged(void)
+{
+  PhotoStages stages(backend);
+  store.status = 503;
+
+  runJob(stages, 0, "");
+
+  TEST_ASSERT_EQUAL_UINT32(1, logged);
+  TEST_ASSERT_EQUAL_STRING("", lastLoggedURL);
+  TEST_ASSERT_EQUAL_UINT32(1, stages.getStats().upload.failed);
+  TEST_ASSERT_EQUAL_UINT32(0, camera.getOutstanding());
+}
+
+void test_failed_capture_stops_the_job(void)
+{
+  PhotoStages stages(backend);
+  camera.available = false;
+
+  runJob(stages, 0, "");
+
+  TEST_ASSERT_EQUAL_UINT32(0, store.uploads);
+  TEST_ASSERT_EQUAL_UINT32(0, logged);
+  TEST_ASSERT_EQUAL_UINT32(1, stages.getStats().capture.failed);
+}
+
+void test_drop_releases_the_frame(void)
+{
+  PhotoStages stages(backend);
+  PhotoJob job = PhotoStages::makeJob(0, "", FakeClock::millis());
+  TEST_ASSERT_TRUE(stages.runCapture(job));
+
+  stages.dropBeforeUpload(job);
+  stages.dropBeforeCapture();
+
+  PhotoPipelineStats stats = stages.getStats();
+  TEST_ASSERT_EQUAL_UINT32(1, stats.upload.dropped);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.capture.dropped);
+  TEST_ASSERT_EQUAL_UINT32(0, camera.getOutstanding());
+}
+
+void test_stage_latency_stats(void)
+{
+  PhotoStages stages(backend);
+  const uint32_t latenciesMs[] = {100, 400, 200};
+  for (uint32_t latencyMs : latenciesMs)
+  {
+    store.latencyMs = latencyMs;
+    runJob(stages, 0, "");
+  }
+
+  PhotoStageStats upload = stages.getStats().upload;
+  TEST_ASSERT_EQUAL_UINT32(3, upload.processed);
+  TEST_ASSERT_EQUAL_UINT32(400000, upload.maxUs);
+  TEST_ASSERT_EQUAL_UINT32(200000, upload.lastUs);
+  TEST_ASSERT_EQUAL_UINT32(233333, upload.averageUs());
+}
+
+void test_long_user_id_is_truncated(void)
+{
+  char userId[PHOTO_JOB_USER_ID_SIZE + 10];
+  memset(userId, 'a', sizeof(userId) - 1);
+  userId[sizeof(userId) - 1] = '\0';
+
+  PhotoJob job = PhotoStages::makeJob(0, userId, 0);
+
+  TEST_ASSERT_EQUAL_UINT32(PHOTO_JOB_USER_ID_SIZE - 1, strlen(job.userId));
+  TEST_ASSERT_EQUAL_STRING("", PhotoStages::makeJob(0, nullptr, 0).userId);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_job_goes_through_every_stage);
+  RUN_TEST(test_failed_upload_is_still_logged);
+  RUN_TEST(test_failed_capture_stops_the_job);
+  RUN_TEST(test_drop_releases_the_frame);
+  RUN_TEST(test_stage_latency_stats);
+  RUN_TEST(test_long_user_id_is_truncated);
+  return UNITY_END();
+}
@@ -0,0 +1,184 @@
+#include <unity.h>
+#include <common/scan_policy.h>
+
+static const uint32_t FAST_MS = 100;
+static const uint32_t IDLE_MS = 2000;
+static const uint32_t HOLD_MS = 10000;
+
+// Polls like the scan task (every FAST_MS), with the finger on the sensor or not at each scan.
+// Returns how many new fingers were reported.
+static uint32_t poll(ScanPolicy &policy, uint32_t &nowMs, uint32_t durationMs, bool fingerPresent)
+{
+  uint32_t fingers = 0;
+  for (uint32_t end = nowMs + durationMs; nowMs < end; nowMs += FAST_MS)
+  {
+    uint32_t triggerMs;
+    if (policy.isDue(nowMs, triggerMs) && policy.onScanned(fingerPresent, nowMs))
+    {
+      fingers++;
+    }
+  }
+  return fingers;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_idle_interval_backs_off(void)
+{
+  ScanPolicy policy(FAST_MS, IDLE_MS, HOLD_MS);
+  uint32_t nowMs = 0;
+  policy.onProximity(true, nowMs);
+  policy.onProximity(false, nowMs);
+
+  poll(policy, nowMs, HOLD_MS, false);
+  TEST_ASSERT_EQUAL_UINT32(FAST_MS, policy.getIntervalMs());
+
+  // Doubles on every scan until the idle interval.
+  poll(policy, nowMs, 10 * IDLE_MS, false);
+  TEST_ASSERT_EQUAL_UINT32(IDLE_MS, policy.getIntervalMs());
+}
+
+void test_proximity_keeps_the_fast_interval(void)
+{
+  ScanPolicy policy(FAST_MS, IDLE_MS, HOLD_MS);
+  uint32_t nowMs = 0;
+  policy.onProximity(true, nowMs);
+
+  poll(policy, nowMs, 3 * HOLD_MS, false);
+
+  TEST_ASSERT_EQUAL_UINT32(FAST_MS, policy.getIntervalMs());
+}
+
+void test_touch_makes_a_scan_due_at_once(void)
+{
+  ScanPolicy policy(FAST_MS, IDLE_MS, HOLD_MS);
+  uint32_t nowMs = 50000;
+  uint32_t triggerMs;
+  TEST_ASSERT_TRUE(policy.isDue(nowMs, triggerMs));
+  policy.onScanned(false, nowMs);
+  TEST_ASSERT_FALSE(policy.isDue(nowMs + 1, triggerMs));
+
+  policy.onTouch(nowMs + 5);
+
+  TEST_ASSERT_TRUE(policy.isDue(nowMs + 20, triggerMs));
+  TEST_ASSERT_EQUAL_UINT32(nowMs + 5, triggerMs);
+  TEST_ASSERT_EQUAL_UINT32(FAST_MS, policy.getIntervalMs());
+}
+
+void test_held_finger_is_reported_once(void)
+{
+  ScanPolicy policy(FAST_MS, IDLE_MS, HOLD_MS);
+  uint32_t nowMs = IDLE_MS;
+
+  TEST_ASSERT_EQUAL_UINT32(1, poll(policy, nowMs, 5000, true));
+  TEST_ASSERT_TRUE(policy.isFingerHeld());
+}
+
+void test_finger_is_reported_again_after_lifting(void)
+{
+  ScanPolicy policy(FAST_MS, IDLE_MS, HOLD_MS);
+  uint32_t nowMs = IDLE_MS;
+
+  TEST_ASSERT_EQUAL_UINT32(1, poll(policy, nowMs, 1000, true));
+  TEST_ASSERT_EQUAL_UINT32(0, poll(policy, nowMs, 300, false));
+  TEST_ASSERT_EQUAL_UINT32(1, poll(policy, nowMs, 1000, true));
+}
+
+void test_touches_are_ignored_while_the_finger_is_held(void)
+{
+  ScanPolicy policy(FAST_MS, IDLE_MS, HOLD_MS);
+  uint32_t nowMs = 0;
+  uint32_t triggerMs;
+  policy.onTouch(nowMs);
+  TEST_ASSERT_TRUE(policy.isDue(nowMs, triggerMs));
+  TEST_ASSERT_TRUE(policy.onScanned(true, nowMs));
+
+  // The touch line keeps firing while the finger rests on the sensor.
+  policy.onTouch(nowMs + 10);
+  TEST_ASSERT_FALSE(policy.isDue(nowMs + 10, triggerMs));
+}
+
+void test_repeated_touches_keep_the_first_time(void)
+{
+  ScanPolicy policy(FAST_MS, IDLE_MS, HOLD_MS);
+  uint32_t triggerMs;
+  policy.onTouch(100);
+  policy.onTouch(150);
+
+  TEST_ASSERT_TRUE(policy.isDue(200, triggerMs));
+  TEST_ASSERT_EQUAL_UINT32(100, triggerMs);
+}
+
+void test_polled_latency_counts_the_interval(void)
+{
+  ScanPolicy policy(FAST_MS, IDLE_MS, HOLD_MS);
+  uint32_t nowMs = 0;
+  poll(policy, nowMs, 10 * IDLE_MS, false);
+  TEST_ASSERT_EQUAL_UINT32(IDLE_MS, policy.getIntervalMs());
+
+  // The finger may have been put down right after the last empty scan, a whole interval ago.
+  uint32_t triggerMs = 0;
+  while (!policy.isDue(nowMs, triggerMs))
+  {
+    nowMs += FAST_MS;
+  }
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(IDLE_MS, nowMs - triggerMs);
+}
+
+void test_errors_back_off(void)
+{
+  ScanPolicy policy(FAST_MS, IDLE_MS, HOLD_MS);
+  uint32_t nowMs = 0;
+  policy.onProximity(true, nowMs);
+  uint32_t triggerMs;
+
+  // A sensor that keeps failing while someone stands in front of it.
+  uint32_t scans = 0;
+  for (uint32_t end = nowMs + 10 * IDLE_MS; nowMs < end; nowMs += FAST_MS)
+  {
+    if (policy.isDue(nowMs, triggerMs))
+    {
+      policy.onError(nowMs);
+      scans++;
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(IDLE_MS, policy.getIntervalMs());
+  TEST_ASSERT_LESS_THAN_UINT32(20, scans);
+
+  // The first scan that answers goes back to the fast interval.
+  while (!policy.isDue(nowMs, triggerMs))
+  {
+    nowMs += FAST_MS;
+  }
+  policy.onScanned(false, nowMs);
+  TEST_ASSERT_EQUAL_UINT32(FAST_MS, policy.getIntervalMs());
+}
+
+void test_error_keeps_the_held_finger(void)
+{
+  ScanPolicy policy(FAST_MS, IDLE_MS, HOLD_MS);
+  uint32_t nowMs = IDLE_MS;
+  TEST_ASSERT_EQUAL_UINT32(1, poll(policy, nowMs, 500, true));
+
+  policy.onError(nowMs);
+
+  TEST_ASSERT_TRUE(policy.isFingerHeld());
+  TEST_ASSERT_FALSE(policy.onScanned(true, nowMs + IDLE_MS));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_idle_interval_backs_off);
+  RUN_TEST(test_proximity_keeps_the_fast_interval);
+  RUN_TEST(test_touch_makes_a_scan_due_at_once);
+  RUN_TEST(test_held_finger_is_reported_once);
+  RUN_TEST(test_finger_is_reported_again_after_lifting);
+  RUN_TEST(test_touches_are_ignored_while_the_finger_is_held);
+  RUN_TEST(test_repeated_touches_keep_the_first_time);
+  RUN_TEST(test_polled_latency_counts_the_interval);
+  RUN_TEST(test_errors_back_off);
+  RUN_TEST(test_error_keeps_the_held_finger);
+  return UNITY_END();
+}
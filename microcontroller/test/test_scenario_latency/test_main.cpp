@@ -0,0 +1,287 @@
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <fake_clock.h>
+#include <fake_hal.h>
+#include <fake_transport.h>
+#include <common/scenario_recorder.h>
+#include <wroom/handlers.h>
+#include <wrover/handlers.h>
+#include <wrover/actions/pipeline.h>
+
+// End-to-end scenario latency against the event rate: the WROOM's events go through a broker
+// stand-in to the WROVER's handlers, and the photo jobs they queue run through the pipeline stages
+// with a simulated camera and a storage backend of fixed latency. Time is simulated, so the
+// numbers depend on the injected latencies only and the run takes no wall clock time.
+
+static const uint32_t BROKER_LATENCY_MS = 40;
+static const uint32_t UPLOAD_LATENCY_MS = 300;
+static const size_t QUEUE_DEPTH = 4; // As PhotoPipeline::start().
+static const uint32_t EVENTS = 200;
+
+static FakeDisplay display;
+static FakeFingerprintDirectory directory;
+static FakeBuzzer buzzer;
+static FakeDatabase database;
+static FakeCamera camera;
+static FakeObjectStore store;
+static OwnerDiscovery ownerDiscovery(10000, 60000, 300000);
+static ScenarioRecorder doorbell("doorbell_start", "doorbell_done", "doorbell_ms");
+static ScenarioRecorder proximity("proximity_start", "proximity_done", "proximity_ms");
+static ScenarioRecorder *const scenarios[] = {&doorbell, &proximity};
+
+static ScenarioRecorder &scenarioFor(uint8_t logType)
+{
+  return logType == (uint8_t)LogType::RING_DOORBELL ? doorbell : proximity;
+}
+
+static bool captureFrame(PhotoJob &job)
+{
+  CameraFrame frame;
+  if (!camera.capture(job.eventMs, frame))
+  {
+    return false;
+  }
+  job.image = (uint8_t *)frame.data;
+  job.imageLen = frame.length;
+  job.frame = frame.handle;
+  return true;
+}
+
+static bool uploadFrame(PhotoJob &job)
+{
+  int status = store.upload("bucket", "node/photo.jpg", "image/jpeg", job.image, job.imageLen);
+  return status >= 200 && status < 300;
+}
+
+static void logFrame(const PhotoJob &job)
+{
+  scenarioFor(job.logType).finish(FakeClock::millis() - job.eventMs);
+}
+
+static void releaseFrame(PhotoJob &job)
+{
+  CameraFrame frame;
+  frame.handle = job.frame;
+  camera.release(frame);
+}
+
+static const PhotoPipelineBackend backend = {captureFrame, uploadFrame, logFrame, releaseFrame, FakeClock::micros};
+
+/**
+ * The pipeline as one worker behind a bounded queue. Jobs start when both they and the worker are
+ * ready, so the clock is moved to each job's start before running its stages.
+ */
+class SimulatedPipeline : public EventLog
+{
+public:
+  uint32_t dropped = 0;
+
+  explicit SimulatedPipeline(const PhotoPipelineBackend &backend) : stages(backend) {}
+
+  bool requestPhoto(LogType type, const char *userId) override
+  {
+    scenarioFor(type).start();
+    if (waiting == QUEUE_DEPTH)
+    {
+      dropped++;
+      stages.dropBeforeCapture();
+      return false;
+    }
+    queue[(first + waiting++) % QUEUE_DEPTH] = PhotoStages::makeJob(type, userId, FakeClock::millis());
+    return true;
+  }
+
+  void log(const char *nodeId, const LogData &logData) override {}
+
+  /**
+   * Runs every job that starts before the given time.
+   */
+  void runUntil(uint32_t ms)
+  {
+    while (waiting > 0)
+    {
+      PhotoJob &job = queue[first];
+      uint32_t startMs = job.eventMs > freeMs ? job.eventMs : freeMs;
+      if (startMs >= ms)
+      {
+        return;
+      }
+      FakeClock::reset(startMs);
+      if (stages.runCapture(job))
+      {
+        stages.runUpload(job);
+        stages.runLog(job);
+      }
+      freeMs = FakeClock::millis();
+      first = (first + 1) % QUEUE_DEPTH;
+      waiting--;
+    }
+  }
+
+  void reset()
+  {
+    first = waiting = 0;
+    freeMs = 0;
+    dropped = 0;
+  }
+
+private:
+  PhotoStages stages;
+  PhotoJob queue[QUEUE_DEPTH];
+  size_t first = 0;
+  size_t waiting = 0;
+  uint32_t freeMs = 0;
+};
+
+static SimulatedPipeline pipeline(backend);
+
+static void deliverToWrover(const char *topic, const uint8_t *payload, size_t length);
+static void deliverToWroom(const char *topic, const uint8_t *payload, size_t length) {}
+
+static LoopbackTransport toWrover(deliverToWrover);
+static LoopbackTransport toWroom(deliverToWroom);
+static FakeTransport toApp;
+
+static Hal wroomHal()
+{
+  Hal hal;
+  hal.display = &display;
+  hal.fingerprintUsers = &directory;
+  return hal;
+}
+
+static Hal wroverHal()
+{
+  Hal hal;
+  hal.buzzer = &buzzer;
+  hal.database = &database;
+  return hal;
+}
+
+static WroomHandlers wroom(wroomHal(), toWrover);
+static WroverHandlers wrover("wrover-1", wroverHal(), toWroom, toApp, pipeline, ownerDiscovery);
+
+// The broker hop: the WROVER gets the message some time after the WROOM published it.
+static void deliverToWrover(const char *topic, const uint8_t *payload, size_t length)
+{
+  FakeClock::advanceMs(BROKER_LATENCY_MS);
+  wrover.onMessage(topic, payload, length);
+}
+
+// Same sequence on every run, so the results are reproducible.
+static uint32_t randomState = 1;
+
+static double nextUniform()
+{
+  randomState = randomState * 1664525u + 1013904223u;
+  return ((randomState >> 8) + 1.0) / (double)(1u << 24);
+}
+
+/**
+ * Alternates doorbell rings and proximity events, then lets the pipeline drain.
+ *
+ * @param perSecond The average event rate.
+ * @param poisson Whether the events arrive at random (exponential gaps) rather than evenly.
+ */
+static void runAtRate(double perSecond, bool poisson)
+{
+  double eventMs = 1000;
+  for (uint32_t i = 0; i < EVENTS; i++)
+  {
+    eventMs += poisson ? -log(nextUniform()) * 1000.0 / perSecond : 1000.0 / perSecond;
+    pipeline.runUntil((uint32_t)eventMs);
+    FakeClock::reset((uint32_t)eventMs);
+    if (i % 2 == 0)
+    {
+      wroom.onFingerprintScanned(3);
+    }
+    else
+    {
+      wroom.onProximity();
+    }
+  }
+  pipeline.runUntil(UINT32_MAX);
+
+  for (ScenarioRecorder *scenario : scenarios)
+  {
+    const MetricHistogram &latency = scenario->getLatency();
+    printf("%5.1f events/s %-9s started=%3u completed=%3u p50=%4u p99=%5u max=%5u ms\n",
+           perSecond, scenario == &doorbell ? "doorbell" : "proximity",
+           (unsigned)scenario->getStarted(), (unsigned)scenario->getCompleted(),
+           (unsigned)latency.percentile(50), (unsigned)latency.percentile(99), (unsigned)latency.getMax());
+  }
+}
+
+void setUp(void)
+{
+  FakeClock::reset();
+  camera = FakeCamera();
+  store = FakeObjectStore();
+  store.latencyMs = UPLOAD_LATENCY_MS;
+  directory = FakeFingerprintDirectory();
+  directory.setUser(3, "alice");
+  doorbell.reset();
+  proximity.reset();
+  pipeline.reset();
+  randomState = 1;
+}
+
+void tearDown(void) {}
+
+void test_below_capacity_latency_is_the_upload(void)
+{
+  runAtRate(0.5, false);
+
+  for (ScenarioRecorder *scenario : scenarios)
+  {
+    TEST_ASSERT_EQUAL_UINT32(EVENTS / 2, scenario->getStarted());
+    TEST_ASSERT_EQUAL_UINT32(scenario->getStarted(), scenario->getCompleted());
+    TEST_ASSERT_EQUAL_UINT32(UPLOAD_LATENCY_MS, scenario->getLatency().getMax());
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, pipeline.dropped);
+  TEST_ASSERT_EQUAL_UINT32(0, camera.getOutstanding());
+}
+
+void test_tail_latency_grows_with_the_rate(void)
+{
+  // One upload every 300 ms is 3.3 events/s at most.
+  const double rates[] = {0.5, 1.5, 2.5, 3.0};
+  uint32_t previousP99 = 0;
+  for (double rate : rates)
+  {
+    setUp();
+    runAtRate(rate, true);
+
+    uint32_t p99 = doorbell.getLatency().percentile(99);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(UPLOAD_LATENCY_MS, doorbell.getLatency().percentile(50));
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(previousP99, p99);
+    previousP99 = p99;
+  }
+  TEST_ASSERT_GREATER_THAN_UINT32(2 * UPLOAD_LATENCY_MS, previousP99);
+}
+
+void test_over_capacity_the_queue_bounds_latency(void)
+{
+  runAtRate(10, true);
+
+  uint32_t completed = doorbell.getCompleted() + proximity.getCompleted();
+  TEST_ASSERT_GREATER_THAN_UINT32(0, pipeline.dropped);
+  TEST_ASSERT_EQUAL_UINT32(EVENTS, completed + pipeline.dropped);
+  // A job waits at most for the queue in front of it and the one being uploaded.
+  for (ScenarioRecorder *scenario : scenarios)
+  {
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32((QUEUE_DEPTH + 1) * UPLOAD_LATENCY_MS, scenario->getLatency().getMax());
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, camera.getOutstanding());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_below_capacity_latency_is_the_upload);
+  RUN_TEST(test_tail_latency_grows_with_the_rate);
+  RUN_TEST(test_over_capacity_the_queue_bounds_latency);
+  return UNITY_END();
+}
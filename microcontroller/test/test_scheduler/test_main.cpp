@@ -0,0 +1,202 @@
+#include <unity.h>
+#include <string.h>
+#include <fake_clock.h>
+#include <common/scheduler.h>
+
+// Tasks record the order they ran in and can take simulated time.
+static char order[32];
+static size_t orderLength = 0;
+static uint32_t stepUs = 0;
+static uint32_t steps = 0;
+
+static void ran(char name)
+{
+  if (orderLength < sizeof(order) - 1)
+    order[orderLength++] = name;
+  order[orderLength] = '\0';
+  FakeClock::advanceUs(stepUs);
+}
+
+static bool taskA()
+{
+  ran('A');
+  return false;
+}
+
+static bool taskB()
+{
+  ran('B');
+  return false;
+}
+
+static bool taskC()
+{
+  ran('C');
+  return false;
+}
+
+// Needs three steps, like a resumable enrollment.
+static bool stepper()
+{
+  ran('S');
+  return ++steps % 3 != 0;
+}
+
+// Calls loop() every tickUs for durationUs of simulated time.
+static void runFor(Scheduler &scheduler, uint32_t durationUs, uint32_t tickUs = 1000)
+{
+  uint32_t end = FakeClock::micros() + durationUs;
+  while ((int32_t)(FakeClock::micros() - end) < 0)
+  {
+    scheduler.loop();
+    FakeClock::advanceUs(tickUs);
+  }
+}
+
+void setUp(void)
+{
+  FakeClock::reset();
+  order[0] = '\0';
+  orderLength = 0;
+  stepUs = 0;
+  steps = 0;
+}
+
+void tearDown(void) {}
+
+void test_periodic_task_keeps_its_phase(void)
+{
+  Scheduler scheduler(FakeClock::micros);
+  int id = scheduler.addPeriodic("a", taskA, 10);
+
+  runFor(scheduler, 100000, 3000);
+
+  const SchedulerTaskStats &stats = scheduler.getTaskStats(id);
+  TEST_ASSERT_EQUAL_UINT32(10, stats.runs);
+  // Ticks every 3 ms against a 10 ms period: never more than one tick late, and no drift.
+  TEST_ASSERT_LESS_THAN_UINT32(3000, stats.maxJitterUs);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.overruns);
+}
+
+void test_priority_then_deadline(void)
+{
+  Scheduler scheduler(FakeClock::micros);
+  scheduler.addPeriodic("a", taskA, 10, TASK_PRIORITY_LOW);
+  FakeClock::advanceUs(1);
+  scheduler.addPeriodic("b", taskB, 10, TASK_PRIORITY_NORMAL);
+  FakeClock::advanceUs(1);
+  scheduler.addPeriodic("c", taskC, 10, TASK_PRIORITY_NORMAL);
+
+  TEST_ASSERT_EQUAL_UINT32(3, scheduler.loop());
+
+  // Normal before low, and b's deadline is earlier than c's.
+  TEST_ASSERT_EQUAL_STRING("BCA", order);
+}
+
+void test_event_task_runs_once_per_notification(void)
+{
+  Scheduler scheduler(FakeClock::micros);
+  int id = scheduler.addEvent("a", taskA);
+
+  runFor(scheduler, 5000);
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.getTaskStats(id).runs);
+
+  scheduler.notify(id);
+  scheduler.notify(id);
+  FakeClock::advanceUs(700);
+  scheduler.loop();
+  scheduler.loop();
+
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.getTaskStats(id).runs);
+  // Jitter covers the wait since the first notification.
+  TEST_ASSERT_EQUAL_UINT32(700, scheduler.getTaskStats(id).lastJitterUs);
+}
+
+void test_resumable_task_interleaves_with_the_others(void)
+{
+  Scheduler scheduler(FakeClock::micros);
+  int id = scheduler.addEvent("s", stepper, TASK_PRIORITY_LOW);
+  scheduler.addPeriodic("a", taskA, 1, TASK_PRIORITY_HIGH);
+
+  scheduler.notify(id);
+  runFor(scheduler, 4000);
+
+  // One step per pass, the periodic task keeps running in between.
+  TEST_ASSERT_EQUAL_STRING("ASASASA", order);
+  TEST_ASSERT_EQUAL_UINT32(3, scheduler.getTaskStats(id).runs);
+}
+
+void test_step_over_budget_is_an_overrun(void)
+{
+  Scheduler scheduler(FakeClock::micros);
+  int id = scheduler.addEvent("s", stepper, TASK_PRIORITY_LOW, 300000);
+
+  scheduler.notify(id);
+  stepUs = 250000;
+  scheduler.loop();
+  stepUs = 350000;
+  scheduler.loop();
+
+  const SchedulerTaskStats &stats = scheduler.getTaskStats(id);
+  TEST_ASSERT_EQUAL_UINT32(2, stats.runs);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.overruns);
+  TEST_ASSERT_EQUAL_UINT32(350000, stats.maxRunUs);
+  TEST_ASSERT_EQUAL_UINT32(300000, stats.averageRunUs());
+}
+
+void test_missed_periods_are_not_caught_up(void)
+{
+  Scheduler scheduler(FakeClock::micros);
+  int id = scheduler.addPeriodic("a", taskA, 10);
+  scheduler.loop();
+
+  // A 35 ms stall: the task runs once, late, then resumes its period from there.
+  FakeClock::advanceMs(35);
+  scheduler.loop();
+  scheduler.loop();
+  TEST_ASSERT_EQUAL_UINT32(2, scheduler.getTaskStats(id).runs);
+  TEST_ASSERT_EQUAL_UINT32(1, scheduler.getTaskStats(id).overruns);
+  TEST_ASSERT_EQUAL_UINT32(10000, scheduler.getIdleUs(100000));
+}
+
+void test_idle_time_until_the_next_deadline(void)
+{
+  Scheduler scheduler(FakeClock::micros);
+  scheduler.addPeriodic("a", taskA, 10);
+  int event = scheduler.addEvent("b", taskB);
+  scheduler.loop();
+
+  FakeClock::advanceUs(4000);
+  TEST_ASSERT_EQUAL_UINT32(6000, scheduler.getIdleUs(100000));
+  TEST_ASSERT_EQUAL_UINT32(2000, scheduler.getIdleUs(2000));
+
+  scheduler.notify(event);
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.getIdleUs(100000));
+}
+
+void test_task_table_is_bounded(void)
+{
+  Scheduler scheduler(FakeClock::micros);
+  for (size_t i = 0; i < Scheduler::MAX_TASKS; i++)
+  {
+    TEST_ASSERT_EQUAL_INT(i, scheduler.addEvent("a", taskA));
+  }
+  TEST_ASSERT_EQUAL_INT(-1, scheduler.addEvent("a", taskA));
+  scheduler.notify(-1);
+  scheduler.notify(Scheduler::MAX_TASKS);
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.loop());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_periodic_task_keeps_its_phase);
+  RUN_TEST(test_priority_then_deadline);
+  RUN_TEST(test_event_task_runs_once_per_notification);
+  RUN_TEST(test_resumable_task_interleaves_with_the_others);
+  RUN_TEST(test_step_over_budget_is_an_overrun);
+  RUN_TEST(test_missed_periods_are_not_caught_up);
+  RUN_TEST(test_idle_time_until_the_next_deadline);
+  RUN_TEST(test_task_table_is_bounded);
+  return UNITY_END();
+}
@@ -0,0 +1,200 @@
+#include <unity.h>
+#include <string.h>
+#include <string>
+#include <common/supabase_request.h>
+#include <fake_clock.h>
+
+// A socket that records what is written and answers with a canned response.
+class FakeClient
+{
+public:
+  std::string sent;
+  std::string response;
+  size_t responsePos = 0;
+  size_t maxWrite = UPLOAD_CHUNK_SIZE; // Bytes accepted per write(), like a full TCP window.
+  size_t stalledWrites = 0;            // write() calls that accept nothing before the next one succeeds.
+  bool isConnected = true;
+  size_t writes = 0;
+  size_t largestWrite = 0;
+
+  size_t print(const char *text)
+  {
+    sent += text;
+    return strlen(text);
+  }
+
+  size_t write(const uint8_t *data, size_t len)
+  {
+    if (!isConnected)
+      return 0;
+    if (stalledWrites > 0)
+    {
+      stalledWrites--;
+      return 0;
+    }
+    size_t accepted = len < maxWrite ? len : maxWrite;
+    sent.append((const char *)data, accepted);
+    writes++;
+    largestWrite = accepted > largestWrite ? accepted : largestWrite;
+    return accepted;
+  }
+
+  int available() { return (int)(response.size() - responsePos); }
+  int read() { return responsePos < response.size() ? (uint8_t)response[responsePos++] : -1; }
+  bool connected() { return isConnected; }
+};
+
+static uint32_t heapLeft = 0;
+
+static void idle()
+{
+  FakeClock::advanceMs(1);
+}
+
+static uint32_t freeHeap()
+{
+  return heapLeft;
+}
+
+static const RequestPlatform platform = {FakeClock::millis, idle, freeHeap};
+
+static const char *const HEAD = "POST /storage/v1/object/photos/a.jpg HTTP/1.1\r\nHost: abc.supabase.co\r\n";
+static const char *const CREATED = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n{}";
+
+static uint8_t body[3000];
+
+void setUp(void)
+{
+  FakeClock::reset(1000);
+  heapLeft = 100000;
+  for (size_t i = 0; i < sizeof(body); i++)
+  {
+    body[i] = (uint8_t)i;
+  }
+}
+
+void tearDown(void) {}
+
+void test_host_stops_at_the_path_and_port(void)
+{
+  char host[SUPABASE_HOST_SIZE];
+  TEST_ASSERT_TRUE(parseSupabaseHost("https://abc.supabase.co", host, sizeof(host)));
+  TEST_ASSERT_EQUAL_STRING("abc.supabase.co", host);
+  TEST_ASSERT_TRUE(parseSupabaseHost("https://abc.supabase.co/", host, sizeof(host)));
+  TEST_ASSERT_EQUAL_STRING("abc.supabase.co", host);
+  TEST_ASSERT_TRUE(parseSupabaseHost("https://abc.supabase.co:443/rest", host, sizeof(host)));
+  TEST_ASSERT_EQUAL_STRING("abc.supabase.co", host);
+  TEST_ASSERT_TRUE(parseSupabaseHost("abc.supabase.co/", host, sizeof(host)));
+  TEST_ASSERT_EQUAL_STRING("abc.supabase.co", host);
+}
+
+void test_host_must_fit(void)
+{
+  char host[8];
+  TEST_ASSERT_FALSE(parseSupabaseHost("https://abc.supabase.co", host, sizeof(host)));
+  TEST_ASSERT_FALSE(parseSupabaseHost("https:///storage", host, sizeof(host)));
+  TEST_ASSERT_TRUE(parseSupabaseHost("https://abcdefg/", host, sizeof(host)));
+  TEST_ASSERT_EQUAL_STRING("abcdefg", host);
+}
+
+void test_upload_head(void)
+{
+  char host[SUPABASE_HOST_SIZE];
+  parseSupabaseHost("https://abc.supabase.co/", host, sizeof(host));
+  char head[512];
+  size_t length = buildUploadHead(head, sizeof(head), host, "anon", "token", "photos", "a.jpg", "image/jpeg", 3000);
+
+  TEST_ASSERT_EQUAL_UINT32(strlen(head), length);
+  TEST_ASSERT_NOT_NULL(strstr(head, "POST /storage/v1/object/photos/a.jpg HTTP/1.1\r\n"));
+  TEST_ASSERT_NOT_NULL(strstr(head, "\r\nHost: abc.supabase.co\r\n"));
+  TEST_ASSERT_NOT_NULL(strstr(head, "\r\nContent-Length: 3000\r\n"));
+  TEST_ASSERT_EQUAL_UINT32(0, buildUploadHead(head, 64, host, "anon", "token", "photos", "a.jpg", "image/jpeg", 3000));
+}
+
+void test_body_is_streamed_in_chunks(void)
+{
+  FakeClient client;
+  client.response = CREATED;
+  SupabaseUploadStats stats;
+
+  TEST_ASSERT_EQUAL(200, streamRequest(client, HEAD, body, sizeof(body), platform, stats));
+
+  std::string expected = std::string(HEAD) + "\r\n" + std::string((const char *)body, sizeof(body));
+  TEST_ASSERT_TRUE(client.sent == expected);
+  TEST_ASSERT_EQUAL_UINT32(sizeof(body), stats.bytesSent);
+  TEST_ASSERT_EQUAL_UINT32(3, client.writes);
+  TEST_ASSERT_EQUAL_UINT32(UPLOAD_CHUNK_SIZE, client.largestWrite);
+  TEST_ASSERT_TRUE(stats.reusable);
+  TEST_ASSERT_EQUAL_UINT32(heapLeft, stats.minFreeHeap);
+}
+
+void test_partial_and_stalled_writes_are_resumed(void)
+{
+  FakeClient client;
+  client.response = CREATED;
+  client.maxWrite = 700;
+  client.stalledWrites = 3;
+  SupabaseUploadStats stats;
+
+  TEST_ASSERT_EQUAL(200, streamRequest(client, HEAD, body, sizeof(body), platform, stats));
+
+  TEST_ASSERT_EQUAL_UINT32(sizeof(body), stats.bytesSent);
+  TEST_ASSERT_TRUE(client.sent.compare(client.sent.size() - sizeof(body), sizeof(body), (const char *)body, sizeof(body)) == 0);
+  TEST_ASSERT_EQUAL_UINT32(3, stats.ttfbMs);
+}
+
+void test_closed_connection_while_sending(void)
+{
+  FakeClient client;
+  client.isConnected = false;
+  SupabaseUploadStats stats;
+
+  TEST_ASSERT_EQUAL(-2, streamRequest(client, HEAD, body, sizeof(body), platform, stats));
+  TEST_ASSERT_EQUAL(-2, stats.status);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.bytesSent);
+}
+
+void test_no_response_times_out(void)
+{
+  FakeClient client;
+  SupabaseUploadStats stats;
+
+  TEST_ASSERT_EQUAL(-3, streamRequest(client, HEAD, body, sizeof(body), platform, stats));
+  TEST_ASSERT_EQUAL_UINT32(1000 + UPLOAD_TIMEOUT_MS, FakeClock::millis());
+}
+
+void test_server_closing_the_connection_is_not_reused(void)
+{
+  FakeClient client;
+  client.response = "HTTP/1.1 403 Forbidden\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+  SupabaseUploadStats stats;
+
+  TEST_ASSERT_EQUAL(403, streamRequest(client, HEAD, body, 10, platform, stats));
+  TEST_ASSERT_FALSE(stats.reusable);
+}
+
+void test_truncated_response(void)
+{
+  FakeClient client;
+  client.response = "HTTP/1.1 20";
+  SupabaseUploadStats stats;
+
+  // The reader waits for more until the timeout.
+  TEST_ASSERT_EQUAL(-4, streamRequest(client, HEAD, body, 10, platform, stats));
+  TEST_ASSERT_FALSE(stats.reusable);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_host_stops_at_the_path_and_port);
+  RUN_TEST(test_host_must_fit);
+  RUN_TEST(test_upload_head);
+  RUN_TEST(test_body_is_streamed_in_chunks);
+  RUN_TEST(test_partial_and_stalled_writes_are_resumed);
+  RUN_TEST(test_closed_connection_while_sending);
+  RUN_TEST(test_no_response_times_out);
+  RUN_TEST(test_server_closing_the_connection_is_not_reused);
+  RUN_TEST(test_truncated_response);
+  return UNITY_END();
+}
@@ -0,0 +1,217 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <common/text_layout.h>
+
+// The OLED's text areas (common/oled.cpp): 7 lines of 21 characters, or 10 next to a QR code.
+static const size_t MAX_LINES = 7;
+static const size_t FULL_WIDTH = 21;
+static const size_t QR_WIDTH = 10;
+
+static TextLayout<MAX_LINES> layout;
+
+/**
+ * The line, and "..." after it when it is the last line of a truncated layout.
+ */
+static std::string lineText(size_t index)
+{
+  const TextSpan &line = layout.getLine(index);
+  std::string text(line.text, line.length);
+  if (layout.isTruncated() && index + 1 == layout.getLineCount())
+  {
+    text += "...";
+  }
+  return text;
+}
+
+static void assertLines(const char *const *expected, size_t count)
+{
+  TEST_ASSERT_EQUAL_UINT32(count, layout.getLineCount());
+  for (size_t i = 0; i < count; i++)
+  {
+    TEST_ASSERT_EQUAL_STRING(expected[i], lineText(i).c_str());
+  }
+}
+
+// The word wrapping drawTextArea() used before layoutText(), kept to compare against.
+static void wrapText(const std::string &text, int width, int height, std::function<void(const char *text, int lineOffset)> callback)
+{
+  std::istringstream stream(text);
+  std::string word;
+  std::string line;
+  int lineOffset = 0;
+  while (word != "" || stream >> word)
+  {
+    std::string word2 = word;
+    if ((int)word2.size() > width)
+    {
+      int remainingLen = width - line.size();
+      word = word2.substr(remainingLen);
+      word2 = word2.substr(0, remainingLen);
+    }
+    bool willWordFit = (int)(line.size() + word2.size()) <= width;
+    if (willWordFit)
+    {
+      line += word2 + " ";
+      if (word == word2)
+        word = "";
+    }
+    if (!willWordFit || (int)line.size() >= width)
+    {
+      callback(line.c_str(), ++lineOffset);
+      line = "";
+      if (lineOffset == height)
+        return;
+    }
+  }
+  if (line.size())
+    callback(line.c_str(), lineOffset);
+}
+
+void setUp(void)
+{
+  layout = TextLayout<MAX_LINES>();
+}
+
+void tearDown(void) {}
+
+void test_breaks_at_spaces(void)
+{
+  layout.layout("Please register via app", QR_WIDTH);
+  const char *expected[] = {"Please", "register", "via app"};
+  assertLines(expected, 3);
+  TEST_ASSERT_FALSE(layout.isTruncated());
+}
+
+void test_hard_breaks_and_leading_spaces(void)
+{
+  layout.layout("Place your preferred \nfinger on the sensor\n to register", FULL_WIDTH);
+  const char *expected[] = {"Place your preferred", "finger on the sensor", "to register"};
+  assertLines(expected, 3);
+}
+
+void test_empty_lines_are_kept(void)
+{
+  layout.layout("a\n\nb", FULL_WIDTH);
+  const char *expected[] = {"a", "", "b"};
+  assertLines(expected, 3);
+}
+
+void test_long_words_are_split(void)
+{
+  layout.layout("abcdefghijklmnopqrstuvwxyz", QR_WIDTH);
+  const char *expected[] = {"abcdefghij", "klmnopqrst", "uvwxyz"};
+  assertLines(expected, 3);
+}
+
+void test_exact_fit_is_not_truncated(void)
+{
+  layout.layout("exactly10c", QR_WIDTH, 1);
+  const char *expected[] = {"exactly10c"};
+  assertLines(expected, 1);
+
+  // Trailing blanks after the last line do not count as more text.
+  layout.layout("one two\n  \n", QR_WIDTH, 1);
+  TEST_ASSERT_FALSE(layout.isTruncated());
+}
+
+void test_overflow_ends_with_an_ellipsis(void)
+{
+  layout.layout("one two three four five six seven eight nine ten", QR_WIDTH, 3);
+  const char *expected[] = {"one two", "three four", "five si..."};
+  assertLines(expected, 3);
+  TEST_ASSERT_TRUE(layout.isTruncated());
+}
+
+void test_max_lines_is_capped_by_the_capacity(void)
+{
+  layout.layout("1\n2\n3\n4\n5\n6\n7\n8\n9", FULL_WIDTH, 100);
+  TEST_ASSERT_EQUAL_UINT32(MAX_LINES, layout.getLineCount());
+  TEST_ASSERT_TRUE(layout.isTruncated());
+}
+
+void test_degenerate_sizes(void)
+{
+  bool truncated = true;
+  TextSpan lines[1];
+  TEST_ASSERT_EQUAL_UINT32(0, layoutText("text", 0, lines, 1, truncated));
+  TEST_ASSERT_EQUAL_UINT32(0, layoutText("text", 10, lines, 0, truncated));
+  TEST_ASSERT_EQUAL_UINT32(0, layoutText("", 10, lines, 1, truncated));
+  TEST_ASSERT_FALSE(truncated);
+
+  // No room for any text next to the ellipsis.
+  TEST_ASSERT_EQUAL_UINT32(1, layoutText("abcdef", 2, lines, 1, truncated));
+  TEST_ASSERT_TRUE(truncated);
+  TEST_ASSERT_EQUAL_UINT32(0, lines[0].length);
+}
+
+void test_agrees_with_wrap_text_without_hard_breaks(void)
+{
+  const char *texts[] = {"Please register via app", "Welcome to Lookout!", "Place your finger on the sensor",
+                         "Sensor not ready, try again", "Fingerprint registered successfully"};
+  const size_t widths[] = {QR_WIDTH, FULL_WIDTH};
+  for (const char *text : texts)
+  {
+    for (size_t width : widths)
+    {
+      std::string wrapped;
+      wrapText(text, width, MAX_LINES, [&](const char *line, int lineOffset)
+               { wrapped += std::string(line).erase(std::string(line).find_last_not_of(' ') + 1) + "|"; });
+
+      std::string laidOut;
+      layout.layout(text, width);
+      for (size_t i = 0; i < layout.getLineCount(); i++)
+      {
+        laidOut += lineText(i) + "|";
+      }
+      TEST_ASSERT_EQUAL_STRING(wrapped.c_str(), laidOut.c_str());
+    }
+  }
+}
+
+// Benchmark: the enrollment prompt next to a QR code, as drawn on every screen update.
+void test_layout_benchmark(void)
+{
+  static const int ROUNDS = 100000;
+  const char *text = "Place your preferred \nfinger on the sensor\n to register";
+  size_t sink = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < ROUNDS; i++)
+  {
+    wrapText(text, QR_WIDTH, MAX_LINES, [&](const char *line, int lineOffset)
+             { sink += lineOffset; });
+  }
+  auto middle = std::chrono::steady_clock::now();
+  for (int i = 0; i < ROUNDS; i++)
+  {
+    sink += layout.layout(text, QR_WIDTH);
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  double wrapNs = std::chrono::duration_cast<std::chrono::nanoseconds>(middle - start).count() / (double)ROUNDS;
+  double layoutNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - middle).count() / (double)ROUNDS;
+  printf("wrapText: %.0f ns, layoutText: %.0f ns per layout\n", wrapNs, layoutNs);
+  TEST_ASSERT_TRUE(sink > 0);
+  TEST_ASSERT_TRUE(layoutNs < wrapNs);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_breaks_at_spaces);
+  RUN_TEST(test_hard_breaks_and_leading_spaces);
+  RUN_TEST(test_empty_lines_are_kept);
+  RUN_TEST(test_long_words_are_split);
+  RUN_TEST(test_exact_fit_is_not_truncated);
+  RUN_TEST(test_overflow_ends_with_an_ellipsis);
+  RUN_TEST(test_max_lines_is_capped_by_the_capacity);
+  RUN_TEST(test_degenerate_sizes);
+  RUN_TEST(test_agrees_with_wrap_text_without_hard_breaks);
+  RUN_TEST(test_layout_benchmark);
+  return UNITY_END();
+}
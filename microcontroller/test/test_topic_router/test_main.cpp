@@ -0,0 +1,47 @@
+#include <unity.h>
+#include <common/mqtt_data.h>
+#include <common/topic_router.h>
+
+static_assert(topicSize(FingerprintData::TOPIC) == NODE_ID_MAX_LENGTH + 1 + 18 + 1, "topic buffer size");
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_prefix_is_stripped(void)
+{
+  TopicPrefix prefix("wrover-1");
+
+  TEST_ASSERT_EQUAL_STRING("sensor/oled", prefix.strip("wrover-1/sensor/oled"));
+  TEST_ASSERT_EQUAL_STRING("", prefix.strip("wrover-1/"));
+  TEST_ASSERT_NULL(prefix.strip("wroom-1/sensor/oled"));
+  // Another node whose ID starts with ours.
+  TEST_ASSERT_NULL(prefix.strip("wrover-10/sensor/oled"));
+  TEST_ASSERT_NULL(prefix.strip("wrover-1"));
+}
+
+void test_topic_must_match_exactly(void)
+{
+  TEST_ASSERT_TRUE(isTopic("sensor/oled", OledData::TOPIC));
+  TEST_ASSERT_FALSE(isTopic("sensor/ole", OledData::TOPIC));
+  TEST_ASSERT_FALSE(isTopic("sensor/oledx", OledData::TOPIC));
+  TEST_ASSERT_FALSE(isTopic("", OledData::TOPIC));
+}
+
+void test_build_topic(void)
+{
+  char topic[topicSize(OledData::TOPIC)];
+  TEST_ASSERT_EQUAL_UINT32(20, buildTopic(topic, sizeof(topic), "wrover-1", OledData::TOPIC));
+  TEST_ASSERT_EQUAL_STRING("wrover-1/sensor/oled", topic);
+
+  char small[20];
+  TEST_ASSERT_EQUAL_UINT32(0, buildTopic(small, sizeof(small), "wrover-1", OledData::TOPIC));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_prefix_is_stripped);
+  RUN_TEST(test_topic_must_match_exactly);
+  RUN_TEST(test_build_topic);
+  return UNITY_END();
+}